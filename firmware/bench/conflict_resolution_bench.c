@@ -0,0 +1,171 @@
+/**
+ * bench/conflict_resolution_bench.c
+ * -------------------------------------------------------------
+ * Seed Device Firmware — Merge Flash-Wear Benchmark
+ *
+ * Purpose:
+ *   Measures what one conflict_resolution_run() costs in flash,
+ *   from conflict_resolution_get_last_stats() and the flash
+ *   simulator. Each case starts from a fresh log of BENCH_LOG_TXS
+ *   transactions, then merges:
+ *
+ *     - a batch of 32 newer transactions (the append path)
+ *     - one late transaction landing 1 to 2048 records deep
+ *     - 32 late transactions spread over the last 256 records
+ *     - 32 transactions already stored (must write nothing)
+ *
+ *   Reports records written, flash bytes per merge and per
+ *   accepted transaction, and erases. ledger_storage.c checkpoints
+ *   on its own cadence; a merge that moves a record the last
+ *   checkpoint covers also pays for a new one (the jump between
+ *   16 and 64 records deep here).
+ *
+ *   Build and run on the flash simulator (from firmware/); the
+ *   credit limit is the one the mesh simulator uses, so the
+ *   synthetic accounts can go negative:
+ *     cc -O2 -DSEED_HOST_SIM -DLEDGER_CREDIT_LIMIT=1000.0f \
+ *        -Iledger -Icore -Imesh -Iutils -Idrivers -Iconfig \
+ *        bench/conflict_resolution_bench.c \
+ *        ledger/conflict_resolution.c ledger/ledger_tx_validation.c \
+ *        ledger/ledger_storage.c ledger/ledger_balance_index.c \
+ *        ledger/ledger_tx_index.c ledger/ledger_record_codec.c \
+ *        core/storage_manager.c core/security_module.c core/verify_cache.c \
+ *        mesh/mesh_dedup.c drivers/flash_sim.c drivers/secure_element_sim.c \
+ *        utils/crc16.c utils/siphash.c -o conflict_resolution_bench
+ * -------------------------------------------------------------
+ */
+
+#include "conflict_resolution.h"
+#include "ledger_storage.h"
+#include "storage_manager.h"
+#include "security_module.h"
+#include "verify_cache.h"
+#include "flash_sim.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define BENCH_LOG_TXS           2048
+#define BENCH_BATCH             32
+#define BENCH_SPREAD            256
+#define BENCH_ACCOUNTS          48
+#define BENCH_DEVICES           4
+
+static ledger_tx_t bench_batch[BENCH_BATCH];
+
+// Synthetic transaction n; stored ones have even Lamport values so
+// a late one can be slotted in between with an odd one
+static void bench_tx(ledger_tx_t *tx, uint32_t n, uint32_t lamport)
+{
+    memset(tx, 0, sizeof(*tx));
+    snprintf(tx->tx_id, sizeof(tx->tx_id), "tx-%08x-%08x", (unsigned)n, (unsigned)(n * 2654435761u));
+    snprintf(tx->sender, sizeof(tx->sender), "seed-acct-%02u", (unsigned)((n * 7) % BENCH_ACCOUNTS));
+    snprintf(tx->receiver, sizeof(tx->receiver), "seed-acct-%02u", (unsigned)((n * 5 + 1) % BENCH_ACCOUNTS));
+    snprintf(tx->device_id, sizeof(tx->device_id), "seed-dev-%u", (unsigned)(n % BENCH_DEVICES));
+    tx->amount  = 1.0f;
+    tx->lamport = lamport;
+    (void)security_sign((const uint8_t *)tx, offsetof(ledger_tx_t, signature), tx->signature);
+}
+
+static uint32_t stored_lamport(uint32_t index)
+{
+    return 2 * index + 2;
+}
+
+// Fresh flash holding transactions 0 .. BENCH_LOG_TXS-1, imported the
+// way a sync does
+static bool bench_setup(void)
+{
+    static const uint8_t cache_key[VERIFY_CACHE_KEY_LEN] = { 0x5E, 0xED };
+    flash_sim_config_t cfg;
+
+    flash_sim_default_config(&cfg);
+    if (!flash_sim_open(NULL, &cfg) || !storage_init() || !ledger_storage_init())
+        return false;
+    (void)security_init();
+    verify_cache_init(cache_key);
+
+    for (uint32_t i = 0; i < BENCH_LOG_TXS; i += BENCH_BATCH) {
+        for (uint32_t k = 0; k < BENCH_BATCH; k++)
+            bench_tx(&bench_batch[k], i + k, stored_lamport(i + k));
+        conflict_resolution_run(bench_batch, BENCH_BATCH);
+    }
+    return ledger_storage_get_tx_count() == BENCH_LOG_TXS;
+}
+
+// Non-zero unless exactly `expect` were accepted without a bad program
+static int bench_merge(const char *name, uint32_t count, uint32_t expect)
+{
+    conflict_merge_stats_t st;
+    flash_sim_stats_t fs;
+    uint32_t before = ledger_storage_get_tx_count();
+
+    flash_sim_reset_stats();
+    conflict_resolution_run(bench_batch, count);
+    conflict_resolution_get_last_stats(&st);
+    flash_sim_get_stats(&fs);
+
+    printf("%-18s %5u/%-3u %7u %8u %10u %10.0f %7u\n", name,
+           (unsigned)st.accepted, (unsigned)count,
+           (unsigned)(before - st.rewrite_from), (unsigned)st.records_written,
+           (unsigned)st.flash_bytes_written,
+           st.accepted ? (double)st.flash_bytes_written / st.accepted : 0.0,
+           (unsigned)fs.erases);
+
+    return st.accepted != expect || fs.program_violations != 0;
+}
+
+int main(void)
+{
+    static const uint32_t depths[] = { 1, 16, 64, 256, 2048 };
+    uint32_t n = BENCH_LOG_TXS;
+    char name[32];
+    int failed = 0;
+
+    printf("conflict_resolution: merges into a log of %u transactions\n",
+           (unsigned)BENCH_LOG_TXS);
+    printf("%-18s %9s %7s %8s %10s %10s %7s\n", "merge", "accepted",
+           "depth", "records", "flash B", "B/accepted", "erases");
+
+    // Append path: everything newer than the log
+    if (!bench_setup())
+        return 1;
+    for (uint32_t k = 0; k < BENCH_BATCH; k++, n++)
+        bench_tx(&bench_batch[k], n, stored_lamport(n));
+    failed |= bench_merge("append 32", BENCH_BATCH, BENCH_BATCH);
+    flash_sim_close();
+
+    // One late transaction, just in front of the record `depth` from the end
+    for (size_t d = 0; d < sizeof(depths) / sizeof(depths[0]); d++) {
+        if (!bench_setup())
+            return 1;
+        bench_tx(&bench_batch[0], n++, stored_lamport(BENCH_LOG_TXS - depths[d]) - 1);
+        snprintf(name, sizeof(name), "late 1 @ %u", (unsigned)depths[d]);
+        failed |= bench_merge(name, 1, 1);
+        flash_sim_close();
+    }
+
+    // A late batch spread over the recent past
+    if (!bench_setup())
+        return 1;
+    for (uint32_t k = 0; k < BENCH_BATCH; k++, n++)
+        bench_tx(&bench_batch[k], n,
+                 stored_lamport(BENCH_LOG_TXS - BENCH_SPREAD + k * (BENCH_SPREAD / BENCH_BATCH)) - 1);
+    failed |= bench_merge("late 32 / 256", BENCH_BATCH, BENCH_BATCH);
+
+    // Re-import of what is already stored: nothing may be written
+    for (uint32_t k = 0; k < BENCH_BATCH; k++)
+        bench_tx(&bench_batch[k], BENCH_LOG_TXS - BENCH_BATCH + k,
+                 stored_lamport(BENCH_LOG_TXS - BENCH_BATCH + k));
+    failed |= bench_merge("duplicate 32", BENCH_BATCH, 0);
+
+    conflict_merge_stats_t st;
+    conflict_resolution_get_last_stats(&st);
+    if (st.flash_bytes_written != 0)
+        failed = 1;
+    flash_sim_close();
+
+    return failed;
+}
@@ -0,0 +1,129 @@
+/**
+ * bench/event_scheduler_bench.c
+ * ---------------------------------------------------------
+ * Seed Device Firmware — Host benchmark for event_scheduler.c
+ *
+ * One simulated hour of the main loop's timer set (heartbeat
+ * 10 s, sync and power 5 s, storage 30 s) plus a timer past
+ * the wheel horizon, with a radio frame every 5-55 s. Each
+ * task run costs BENCH_RUN_COST_MS of virtual time. Reports
+ * wake-ups, sleep residency and how early or late timers ran,
+ * against the 200 ms tick the scheduler replaced.
+ *
+ * Build and run (from firmware/):
+ *     cc -O2 -DSEED_HOST_SIM -Icore -Iutils -Iconfig -Idrivers \
+ *        bench/event_scheduler_bench.c core/event_scheduler.c \
+ *        -o event_scheduler_bench && ./event_scheduler_bench
+ * ---------------------------------------------------------
+ */
+
+#include "event_scheduler.h"
+#include "power_manager.h"
+#include "timekeeping.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_HOUR_MS        3600000u
+#define BENCH_RUN_COST_MS    2
+#define BENCH_OLD_TICK_MS    200
+#define BENCH_TIMERS         5
+
+static uint32_t bench_now_ms = 1000;
+static uint32_t bench_next_rx;
+static uint32_t bench_early, bench_late_max;
+static sched_task_t bench_rx_task;
+
+static const uint32_t bench_period_ms[BENCH_TIMERS] = { 10000, 5000, 5000, 30000, 100000 };
+static sched_task_t bench_task[BENCH_TIMERS];
+static uint32_t     bench_due_ms[BENCH_TIMERS];
+
+// Sleep until the deadline or the next simulated radio interrupt
+static void bench_idle(uint32_t deadline_ms)
+{
+    uint32_t wake = deadline_ms;
+
+    if (deadline_ms == SCHED_NEVER || (int32_t)(bench_next_rx - deadline_ms) < 0)
+        wake = bench_next_rx;
+    if ((int32_t)(wake - bench_now_ms) > 0)
+        bench_now_ms = wake;
+
+    if (bench_now_ms == bench_next_rx) {
+        sched_post_event(bench_rx_task, 1);
+        bench_next_rx = bench_now_ms + 5000 + (uint32_t)(rand() % 50000);
+    }
+}
+
+static void bench_rx(uint32_t events, uint32_t now)
+{
+    (void)events;
+    (void)now;
+    bench_now_ms += BENCH_RUN_COST_MS;
+}
+
+static void bench_timer_run(uint8_t i, uint32_t now)
+{
+    int32_t delta = (int32_t)(now - bench_due_ms[i]);
+
+    if (delta < -SCHED_COALESCE_MS)
+        bench_early++;
+    else if (delta > (int32_t)bench_late_max)
+        bench_late_max = (uint32_t)delta;
+
+    bench_now_ms += BENCH_RUN_COST_MS;
+    sched_timer_start(bench_task[i], bench_period_ms[i]);
+    bench_due_ms[i] = bench_now_ms + bench_period_ms[i];
+}
+
+static void bench_heartbeat(uint32_t events, uint32_t now) { (void)events; bench_timer_run(0, now); }
+static void bench_sync(uint32_t events, uint32_t now)      { (void)events; bench_timer_run(1, now); }
+static void bench_power(uint32_t events, uint32_t now)     { (void)events; bench_timer_run(2, now); }
+static void bench_storage(uint32_t events, uint32_t now)   { (void)events; bench_timer_run(3, now); }
+static void bench_parked(uint32_t events, uint32_t now)    { (void)events; bench_timer_run(4, now); }
+
+static const sched_task_fn_t bench_fn[BENCH_TIMERS] = {
+    bench_heartbeat, bench_sync, bench_power, bench_storage, bench_parked
+};
+
+// Host stand-ins for the timekeeping and power_manager calls the
+// scheduler makes: virtual time, and sleeping is bench_idle()'s job
+uint32_t time_now_ms(void)
+{
+    return bench_now_ms;
+}
+
+void power_sleep_until(uint32_t deadline_ms)
+{
+    (void)deadline_ms;
+}
+
+int main(void)
+{
+    sched_stats_t st;
+
+    srand(1);
+    sched_init();
+    sched_set_idle_hook(bench_idle);
+
+    bench_rx_task = sched_add_task(bench_rx, 0);
+    for (uint8_t i = 0; i < BENCH_TIMERS; i++) {
+        bench_task[i] = sched_add_task(bench_fn[i], (uint8_t)(4 + i));
+        sched_timer_start(bench_task[i], bench_period_ms[i]);
+        bench_due_ms[i] = bench_now_ms + bench_period_ms[i];
+    }
+    bench_next_rx = bench_now_ms + 3000;
+
+    uint32_t end = bench_now_ms + BENCH_HOUR_MS;
+    while ((int32_t)(bench_now_ms - end) < 0)
+        sched_run_once();
+
+    sched_get_stats(&st);
+    printf("event_scheduler: one simulated hour, %u ms per task run\n", (unsigned)BENCH_RUN_COST_MS);
+    printf("  wake-ups %u (a %u ms tick: %u), task runs %u, timer fires %u\n",
+           (unsigned)st.wakeups, (unsigned)BENCH_OLD_TICK_MS, (unsigned)(BENCH_HOUR_MS / BENCH_OLD_TICK_MS),
+           (unsigned)st.task_runs, (unsigned)st.timer_fires);
+    printf("  asleep %.2f%% of the time; timers early %u, latest %u ms late\n",
+           100.0 * (double)st.sleep_ms / (double)(st.sleep_ms + st.awake_ms),
+           (unsigned)bench_early, (unsigned)bench_late_max);
+
+    return bench_early != 0;
+}
@@ -0,0 +1,154 @@
+/**
+ * Seed Device Firmware
+ * Mesh Networking Stack — Duplicate / Replay Filter Benchmark
+ *
+ * File: bench/mesh_dedup_bench.c
+ * Purpose:
+ *     Host flood benchmark for mesh/mesh_dedup.c. Each message is heard
+ *     BENCH_COPIES times over BENCH_DELAY_MS at several message rates;
+ *     reports false accepts (a repeat let through) and false drops (a
+ *     new message taken for a repeat) against the 128-entry FIFO ring
+ *     the filter replaced, and the cost per check. Exits non-zero if a
+ *     repeat gets through while the filters are within capacity.
+ *
+ * Build and run (from firmware/):
+ *     cc -O2 -Imesh -Iutils bench/mesh_dedup_bench.c mesh/mesh_dedup.c \
+ *        utils/siphash.c -o mesh_dedup_bench && ./mesh_dedup_bench
+ */
+
+#include "mesh_dedup.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_DURATION_S    600u     // simulated flood length
+#define BENCH_COPIES        4u       // copies of each message heard (relays)
+#define BENCH_DELAY_MS      15000u   // copies spread over this after the first
+#define BENCH_LEGACY_SIZE   128u     // the FIFO ring this module replaced
+#define BENCH_GENERATION_MS (MESH_DEDUP_WINDOW_MS / 2)   // one filter's lifetime
+
+typedef struct {
+    uint32_t t_ms;
+    uint32_t msg;
+} bench_arrival_t;
+
+static uint32_t bench_rng;
+
+static uint32_t bench_rand(void)
+{
+    bench_rng ^= bench_rng << 13;
+    bench_rng ^= bench_rng >> 17;
+    bench_rng ^= bench_rng << 5;
+    return bench_rng;
+}
+
+static int bench_cmp(const void *a, const void *b)
+{
+    const bench_arrival_t *x = (const bench_arrival_t *)a;
+    const bench_arrival_t *y = (const bench_arrival_t *)b;
+    return (x->t_ms > y->t_ms) - (x->t_ms < y->t_ms);
+}
+
+// Legacy behavior: last BENCH_LEGACY_SIZE keys in a FIFO, linear scan
+static bool legacy_check(uint32_t *ring, uint32_t *head, uint32_t key)
+{
+    for (uint32_t i = 0; i < BENCH_LEGACY_SIZE; i++)
+        if (ring[i] == key)
+            return true;
+    ring[*head] = key;
+    *head = (*head + 1) % BENCH_LEGACY_SIZE;
+    return false;
+}
+
+int main(void)
+{
+    static const uint32_t rates[] = { 1, 5, 20, 50, 200 };   // new messages / s
+    uint8_t key[MESH_DEDUP_KEY_LEN];
+    int failed = 0;
+
+    bench_rng = 0x5EED0001u;
+    for (uint8_t i = 0; i < sizeof(key); i++)
+        key[i] = (uint8_t)bench_rand();
+
+    printf("mesh_dedup: %u-bit filters x2, k=%u, window %u ms, capacity %u; "
+           "%u copies/msg over %u ms, %u s flood\n",
+           (unsigned)MESH_DEDUP_FILTER_BITS, (unsigned)MESH_DEDUP_HASHES,
+           (unsigned)MESH_DEDUP_WINDOW_MS, (unsigned)MESH_DEDUP_CAPACITY,
+           (unsigned)BENCH_COPIES, (unsigned)BENCH_DELAY_MS, (unsigned)BENCH_DURATION_S);
+    printf("%8s %14s %14s %14s %14s %10s\n", "msgs/s",
+           "false-accept", "false-drop", "legacy-FA", "legacy-FD", "ns/check");
+
+    for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+        uint32_t msgs  = rates[r] * BENCH_DURATION_S;
+        uint32_t total = msgs * BENCH_COPIES;
+        bench_arrival_t *arr  = malloc(total * sizeof(*arr));
+        uint8_t         *done = calloc(msgs, 2);       // [0..msgs) new, [msgs..) legacy
+        uint32_t        *ring = calloc(BENCH_LEGACY_SIZE, sizeof(uint32_t));
+        uint32_t         head = 0;
+
+        if (arr == NULL || done == NULL || ring == NULL)
+            return 1;
+
+        for (uint32_t m = 0; m < msgs; m++) {
+            uint32_t t0 = (uint32_t)((uint64_t)m * 1000u / rates[r]);
+            for (uint32_t c = 0; c < BENCH_COPIES; c++) {
+                arr[m * BENCH_COPIES + c].t_ms = t0 + (c ? bench_rand() % BENCH_DELAY_MS : 0);
+                arr[m * BENCH_COPIES + c].msg  = m;
+            }
+        }
+        qsort(arr, total, sizeof(*arr), bench_cmp);
+
+        for (uint32_t i = 0; i < BENCH_LEGACY_SIZE; i++)
+            ring[i] = 0xFFFFFFFFu;
+        mesh_dedup_init(key);
+
+        uint64_t fa = 0, fd = 0, lfa = 0, lfd = 0;
+        clock_t start = clock();
+
+        for (uint32_t i = 0; i < total; i++) {
+            uint32_t m   = arr[i].msg;
+            bool     dup = mesh_dedup_check(mesh_dedup_key_msg((uint16_t)(m % 97), m),
+                                            arr[i].t_ms);
+            if (done[m])
+                fa += !dup;             // a repeat we let through
+            else
+                fd += dup;              // a new message we dropped
+            done[m] = 1;
+        }
+        double secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+        for (uint32_t i = 0; i < total; i++) {
+            uint32_t m   = arr[i].msg;
+            bool     dup = legacy_check(ring, &head, m);
+            if (done[msgs + m])
+                lfa += !dup;
+            else
+                lfd += dup;
+            done[msgs + m] = 1;
+        }
+
+        uint64_t repeats = (uint64_t)total - msgs;
+        printf("%8u %13.4f%% %13.4f%% %13.4f%% %13.4f%% %10.1f\n",
+               (unsigned)rates[r],
+               100.0 * (double)fa  / (double)repeats,
+               100.0 * (double)fd  / (double)msgs,
+               100.0 * (double)lfa / (double)repeats,
+               100.0 * (double)lfd / (double)msgs,
+               secs * 1e9 / (double)total);
+
+        // Within capacity the filter must never let a repeat through
+        if (rates[r] * (BENCH_GENERATION_MS / 1000u) <= MESH_DEDUP_CAPACITY && fa != 0)
+            failed = 1;
+
+        free(arr);
+        free(done);
+        free(ring);
+    }
+
+    mesh_dedup_stats_t st;
+    mesh_dedup_get_stats(&st);
+    printf("last run: %u rotations, %u early (filter full)\n",
+           (unsigned)st.rotations, (unsigned)st.early_rotations);
+    return failed;
+}
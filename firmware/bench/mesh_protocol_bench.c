@@ -0,0 +1,196 @@
+// firmware/bench/mesh_protocol_bench.c
+//
+// Host aggregation benchmark for mesh/mesh_protocol.c.
+// ---------------------------------------------------
+// BENCH_PASSES main-loop passes of one node's own traffic: a heartbeat,
+// one to three broadcast transactions of 24-56 bytes, and on every fourth
+// pass a group-savings and a trust-score update. Run twice through the
+// real TX queue and radio path: once flushed after every message (one
+// frame per message, as before aggregation) and once flushed per pass.
+// Every transmitted frame is then replayed into a second node, which
+// counts the messages its handlers receive; any shortfall is a non-zero
+// exit.
+//
+// Build and run (from firmware/):
+//     cc -O2 -DSEED_HOST_SIM
+//        -Icore -Imesh -Iutils -Iledger -Idrivers -Iconfig
+//        bench/mesh_protocol_bench.c
+//        mesh/mesh_protocol.c mesh/mesh_tx_queue.c mesh/mesh_dedup.c
+//        mesh/mesh_gossip.c mesh/mesh_neighbor_table.c mesh/mesh_route_table.c
+//        core/radio_interface.c core/radio_airtime.c core/radio_rx_ring.c
+//        core/packet_pool.c core/security_module.c core/verify_cache.c
+//        core/storage_manager.c ledger/ledger_storage.c ledger/ledger_balance_index.c
+//        ledger/ledger_tx_index.c ledger/ledger_record_codec.c drivers/flash_sim.c
+//        drivers/radio_sim.c drivers/secure_element_sim.c utils/crc16.c
+//        utils/siphash.c -o mesh_protocol_bench
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "mesh_protocol.h"
+#include "mesh_tx_queue.h"
+#include "mesh_neighbor_table.h"
+#include "radio_interface.h"
+#include "packet_pool.h"
+#include "security_module.h"
+#include "storage_manager.h"
+#include "timekeeping.h"
+#include "radio_sim.h"
+
+// mesh_protocol.c
+extern bool mesh_send_transaction_broadcast(const uint8_t *payload, uint8_t len);
+extern bool mesh_send_group_savings_update(const uint8_t *payload, uint8_t len);
+extern bool mesh_send_trust_score_update(const uint8_t *payload, uint8_t len);
+
+#define BENCH_PASSES       200
+#define BENCH_MAX_FRAMES   1024
+#define BENCH_TX_ADDR      0x0101
+#define BENCH_RX_ADDR      0x0202
+
+static uint32_t bench_now_ms = 1000;
+static uint8_t  bench_frame[BENCH_MAX_FRAMES][PACKET_BUF_SIZE];
+static uint16_t bench_frame_len[BENCH_MAX_FRAMES];
+static uint32_t bench_frame_ms[BENCH_MAX_FRAMES];
+static uint32_t bench_frames;
+static bool     bench_capture;
+static uint32_t bench_received;
+
+static void bench_tx_hook(const uint8_t *frame, uint16_t len)
+{
+    if (!bench_capture || bench_frames >= BENCH_MAX_FRAMES || len > PACKET_BUF_SIZE)
+        return;
+
+    memcpy(bench_frame[bench_frames], frame, len);
+    bench_frame_ms[bench_frames]    = bench_now_ms;
+    bench_frame_len[bench_frames++] = len;
+}
+
+// Send everything queued, advancing the clock past duty-cycle waits
+static void bench_drain(void)
+{
+    uint32_t wait;
+
+    while ((wait = mesh_tx_queue_process()) != UINT32_MAX)
+        bench_now_ms += wait ? wait : 1;
+}
+
+static void bench_after_message(bool per_message)
+{
+    if (per_message)
+        (void)mesh_flush_pending();
+}
+
+// Returns the number of messages originated
+static uint32_t bench_run(bool per_message, mesh_agg_stats_t *st)
+{
+    uint8_t  payload[56];
+    uint32_t sent = 0;
+
+    bench_frames  = 0;
+    bench_capture = true;
+    mesh_tx_queue_init();
+    neighbor_table_init();
+    mesh_init(BENCH_TX_ADDR);
+
+    for (uint32_t pass = 0; pass < BENCH_PASSES; pass++) {
+        (void)mesh_send_heartbeat();
+        bench_after_message(per_message);
+        sent++;
+
+        for (uint32_t t = 0; t <= pass % 3; t++) {
+            uint8_t len = (uint8_t)(24 + 8 * ((pass + t) % 5));
+            memset(payload, (int)(pass + t), len);
+            (void)mesh_send_transaction_broadcast(payload, len);
+            bench_after_message(per_message);
+            sent++;
+        }
+
+        if (pass % 4 == 0) {
+            memset(payload, 0x5A, 16);
+            (void)mesh_send_group_savings_update(payload, 16);
+            bench_after_message(per_message);
+            (void)mesh_send_trust_score_update(payload, 8);
+            bench_after_message(per_message);
+            sent += 2;
+        }
+
+        (void)mesh_flush_pending();
+        bench_drain();
+        bench_now_ms += 10000;
+    }
+
+    mesh_get_aggregation_stats(st);
+    bench_capture = false;
+
+    // Replay into a second node, keeping the frames' original spacing
+    uint32_t start = bench_now_ms;
+
+    bench_received = 0;
+    neighbor_table_init();
+    mesh_init(BENCH_RX_ADDR);
+    for (uint32_t i = 0; i < bench_frames; i++) {
+        bench_now_ms = start + (bench_frame_ms[i] - bench_frame_ms[0]);
+        (void)radio_sim_deliver(bench_frame[i], bench_frame_len[i], -90);
+        radio_poll_receive();
+    }
+    return sent;
+}
+
+static void bench_report(const char *name, uint32_t sent, const mesh_agg_stats_t *st)
+{
+    printf("  %-12s messages %u, frames %u (%u aggregated), %u bytes, %u ms on air, received %u\n",
+           name, (unsigned)sent, (unsigned)bench_frames, (unsigned)st->aggregated_frames,
+           (unsigned)st->bytes_on_air, (unsigned)(st->airtime_us / 1000), (unsigned)bench_received);
+}
+
+// Host clock and the upper-layer handlers mesh_protocol.c calls;
+// the receiving node counts every message it is handed
+uint32_t time_now_ms(void)
+{
+    return bench_now_ms;
+}
+
+uint64_t timekeeping_millis(void)
+{
+    return bench_now_ms;
+}
+
+void mesh_on_transaction_message(const uint8_t *payload, uint8_t len)   { (void)payload; (void)len; bench_received++; }
+void mesh_on_heartbeat_message(const uint8_t *payload, uint8_t len)     { (void)payload; (void)len; bench_received++; }
+void mesh_on_group_savings_message(const uint8_t *payload, uint8_t len) { (void)payload; (void)len; bench_received++; }
+void mesh_on_trust_score_message(const uint8_t *payload, uint8_t len)   { (void)payload; (void)len; bench_received++; }
+void mesh_on_ledger_sync_message(const uint8_t *payload, uint8_t len)   { (void)payload; (void)len; }
+void mesh_on_ledger_recon_message(mesh_address_t src, const uint8_t *payload, uint8_t len)
+{
+    (void)src; (void)payload; (void)len;
+}
+
+int main(void)
+{
+    mesh_agg_stats_t single, batched;
+    uint32_t sent_single, sent_batched;
+    uint32_t frames_single, received_single;
+
+    packet_pool_init();
+    radio_init();
+    storage_init();
+    security_init();
+    radio_sim_set_tx_hook(bench_tx_hook);
+
+    sent_single     = bench_run(true, &single);
+    frames_single   = bench_frames;
+    received_single = bench_received;
+    printf("mesh_protocol: %u main-loop passes of heartbeat + transactions\n",
+           (unsigned)BENCH_PASSES);
+    bench_report("per message", sent_single, &single);
+
+    sent_batched = bench_run(false, &batched);
+    bench_report("per pass", sent_batched, &batched);
+    printf("  frames %.2fx fewer, airtime %.2fx less\n",
+           (double)frames_single / (double)bench_frames,
+           (double)single.airtime_us / (double)batched.airtime_us);
+
+    return received_single != sent_single || bench_received != sent_batched;
+}
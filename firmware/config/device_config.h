@@ -41,10 +41,9 @@
     #define LORA_FREQUENCY_HZ    865000000UL
 #endif
 
-// Radio spreading factor (defines range vs speed)
-#define LORA_SPREADING_FACTOR    7
-#define LORA_BANDWIDTH_HZ        125000
-#define LORA_CODING_RATE         5
+// Spreading factor, bandwidth and coding rate live in radio_config.h,
+// the one set airtime and link thresholds are computed from.
+#include "radio_config.h"
 
 // TX Power (adjust based on battery + heat + local RF laws)
 #define LORA_TX_POWER_DBM        17
@@ -75,6 +74,13 @@
 #define MAX_TRANSACTIONS_STORED      4096
 #define MAX_TX_SIZE_BYTES            256
 
+// How far below zero an account may spend. 0 = zero-balance accounts:
+// nothing can be sent before it was received. Host simulations that
+// start every account at zero raise it with -D.
+#ifndef LEDGER_CREDIT_LIMIT
+#define LEDGER_CREDIT_LIMIT          0.0f
+#endif
+
 // File naming convention for block storage
 #define LEDGER_FILE_NAME             "ledger.dat"
 #define CHECKPOINT_FILE_NAME         "checkpoint.dat"
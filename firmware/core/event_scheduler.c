@@ -0,0 +1,371 @@
+/**
+ * event_scheduler.c
+ * ---------------------------------------------------------
+ * Seed Device Firmware — Event-Driven Cooperative Scheduler
+ *
+ * Purpose:
+ *   - Replaces the fixed-tick main loop. Work runs only when
+ *     an interrupt posts an event or a timer deadline passes;
+ *     otherwise the CPU sleeps until the nearest deadline.
+ *   - Each subsystem is a task: a handler, a priority and one
+ *     one-shot timer it re-arms for its own next deadline.
+ *
+ * Design Goals:
+ *   - Run-to-completion tasks, highest priority (lowest
+ *     number) first, re-evaluated after every handler so a
+ *     frame posted mid-pass goes ahead of background work.
+ *   - Hashed timer wheel: SCHED_WHEEL_SLOTS buckets of
+ *     SCHED_WHEEL_RES_MS with an occupancy bitmap, so finding
+ *     the next deadline is one count-trailing-zeros. Deadlines
+ *     past the horizon park in the farthest bucket and are
+ *     rehashed as the wheel turns.
+ *   - Timers due within SCHED_COALESCE_MS of a wake run in
+ *     that wake instead of costing one of their own.
+ *   - Wake-up count and sleep/awake residency are recorded so
+ *     the power budget can be checked from field data.
+ *
+ * NOTE:
+ *   sched_post_event() is the only call that is safe from an
+ *   ISR. Everything else is main-context only. Interrupts are
+ *   masked briefly to take a task's events and around the
+ *   final "anything to do?" check before sleeping, so an event
+ *   posted just before the sleep still wakes the CPU.
+ *
+ *   bench/event_scheduler_bench.c counts wake-ups and sleep
+ *   residency for the main loop's timer set.
+ * ---------------------------------------------------------
+ */
+
+#include "event_scheduler.h"
+#include "power_manager.h"
+#include "timekeeping.h"
+#include <string.h>
+
+#if defined(__arm__) && !defined(SEED_HOST_SIM)
+#define SCHED_IRQ_DISABLE()  __asm__ volatile ("cpsid i" ::: "memory")
+#define SCHED_IRQ_ENABLE()   __asm__ volatile ("cpsie i" ::: "memory")
+#else
+#define SCHED_IRQ_DISABLE()  do { } while (0)
+#define SCHED_IRQ_ENABLE()   do { } while (0)
+#endif
+
+#define WHEEL_MASK           (SCHED_WHEEL_SLOTS - 1)
+#define WHEEL_NONE           0xFF
+
+// ---------------------------------------------------------------------------
+// Internal Static State
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    sched_task_fn_t   fn;
+    volatile uint32_t events;        // written by ISRs, cleared with IRQs masked
+    uint32_t          deadline_ms;   // exact expiry while armed
+    uint8_t           priority;
+    uint8_t           wheel_slot;    // WHEEL_NONE when not armed
+    uint8_t           wheel_next;    // next task in the same bucket
+} sched_task_entry_t;
+
+static sched_task_entry_t tasks[SCHED_MAX_TASKS];
+static uint8_t            task_count;
+
+static uint8_t            wheel[SCHED_WHEEL_SLOTS];   // bucket list heads
+static uint32_t           wheel_occupied;             // bit per non-empty bucket
+static uint32_t           wheel_tick;                 // last bucket processed
+
+static volatile uint32_t  ready_mask;                 // bit per task with events
+static sched_idle_fn_t    idle_hook = power_sleep_until;
+static sched_stats_t      stats;
+static uint32_t           last_wake_ms;
+
+// ---------------------------------------------------------------------------
+// Timer Wheel
+// ---------------------------------------------------------------------------
+
+static uint32_t wheel_tick_of(uint32_t ms)
+{
+    return ms / SCHED_WHEEL_RES_MS;
+}
+
+// Distance from `slot` to the next occupied bucket after it (1..32)
+static uint32_t wheel_distance_after(uint8_t slot)
+{
+    uint32_t n   = (uint32_t)(slot + 1) & WHEEL_MASK;
+    uint32_t rot = n ? (wheel_occupied >> n) | (wheel_occupied << (SCHED_WHEEL_SLOTS - n))
+                     : wheel_occupied;
+    return (uint32_t)__builtin_ctz(rot) + 1;
+}
+
+static void wheel_insert(uint8_t t)
+{
+    uint32_t tick = wheel_tick_of(tasks[t].deadline_ms);
+
+    // Already due, or beyond the horizon: clamp to the nearest/farthest bucket
+    if ((int32_t)(tick - wheel_tick) < 0)
+        tick = wheel_tick;
+    else if (tick - wheel_tick > WHEEL_MASK)
+        tick = wheel_tick + WHEEL_MASK;
+
+    uint8_t slot = (uint8_t)(tick & WHEEL_MASK);
+    tasks[t].wheel_slot = slot;
+    tasks[t].wheel_next = wheel[slot];
+    wheel[slot] = t;
+    wheel_occupied |= 1UL << slot;
+}
+
+static void wheel_remove(uint8_t t)
+{
+    uint8_t slot = tasks[t].wheel_slot;
+    if (slot == WHEEL_NONE)
+        return;
+
+    uint8_t *link = &wheel[slot];
+    while (*link != t)
+        link = &tasks[*link].wheel_next;
+    *link = tasks[t].wheel_next;
+
+    if (wheel[slot] == WHEEL_NONE)
+        wheel_occupied &= ~(1UL << slot);
+    tasks[t].wheel_slot = WHEEL_NONE;
+}
+
+static void timer_fire(uint8_t t)
+{
+    SCHED_IRQ_DISABLE();
+    tasks[t].events |= SCHED_EV_TIMER;
+    ready_mask |= 1UL << t;
+    SCHED_IRQ_ENABLE();
+
+    stats.timer_fires++;
+}
+
+/**
+ * Fire every timer with a deadline at or before `until`, rehashing the
+ * rest of each bucket passed over. Only occupied buckets are visited.
+ * An `until` behind the wheel (after a coalesced expiry) only checks
+ * the current bucket.
+ */
+static void wheel_expire(uint32_t until)
+{
+    uint32_t until_tick = wheel_tick_of(until);
+
+    if ((int32_t)(until_tick - wheel_tick) < 0)
+        until_tick = wheel_tick;
+
+    for (;;) {
+        uint8_t  slot = (uint8_t)(wheel_tick & WHEEL_MASK);
+        uint8_t  t    = wheel[slot];
+
+        wheel[slot] = WHEEL_NONE;
+        wheel_occupied &= ~(1UL << slot);
+
+        while (t != WHEEL_NONE) {
+            uint8_t next = tasks[t].wheel_next;
+            tasks[t].wheel_slot = WHEEL_NONE;
+
+            if ((int32_t)(tasks[t].deadline_ms - until) <= 0)
+                timer_fire(t);
+            else
+                wheel_insert(t);
+            t = next;
+        }
+
+        if (wheel_tick == until_tick)
+            break;
+
+        // Skip straight to the next occupied bucket, but not past `until`
+        if (wheel_occupied == 0) {
+            wheel_tick = until_tick;
+            break;
+        }
+
+        uint32_t step = wheel_distance_after(slot);
+        if (step > until_tick - wheel_tick)
+            step = until_tick - wheel_tick;
+        wheel_tick += step;
+    }
+}
+
+// Earliest armed deadline, or SCHED_NEVER
+static uint32_t wheel_next_deadline(void)
+{
+    if (wheel_occupied == 0)
+        return SCHED_NEVER;
+
+    // Deadlines in the nearest occupied bucket are the earliest, so its
+    // (short) list is all that needs scanning
+    uint8_t  slot   = (uint8_t)(wheel_tick & WHEEL_MASK);
+    uint32_t dist   = wheel_distance_after((uint8_t)(slot - 1)) - 1;
+    uint8_t  first  = (uint8_t)((slot + dist) & WHEEL_MASK);
+    uint32_t bucket = wheel_tick + dist;
+
+    uint32_t best = SCHED_NEVER;
+    for (uint8_t t = wheel[first]; t != WHEEL_NONE; t = tasks[t].wheel_next) {
+        if (best == SCHED_NEVER || (int32_t)(tasks[t].deadline_ms - best) < 0)
+            best = tasks[t].deadline_ms;
+    }
+
+    // Only parked entries: wake when the bucket comes round to rehash them,
+    // since nearer deadlines may have been armed into later buckets since
+    if ((int32_t)(best - (bucket + 1) * SCHED_WHEEL_RES_MS) >= 0)
+        best = bucket * SCHED_WHEEL_RES_MS;
+
+    return best;
+}
+
+// ---------------------------------------------------------------------------
+// Task Dispatch
+// ---------------------------------------------------------------------------
+
+// Ready task with the highest priority, or WHEEL_NONE
+static uint8_t pick_ready(void)
+{
+    uint32_t mask = ready_mask;
+    uint8_t  best = WHEEL_NONE;
+
+    while (mask != 0) {
+        uint8_t t = (uint8_t)__builtin_ctz(mask);
+        mask &= mask - 1;
+
+        if (best == WHEEL_NONE || tasks[t].priority < tasks[best].priority)
+            best = t;
+    }
+    return best;
+}
+
+static void run_task(uint8_t t)
+{
+    SCHED_IRQ_DISABLE();
+    uint32_t events = tasks[t].events;
+    tasks[t].events = 0;
+    ready_mask &= ~(1UL << t);
+    SCHED_IRQ_ENABLE();
+
+    stats.task_runs++;
+    tasks[t].fn(events, time_now_ms());
+}
+
+// ---------------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------------
+
+void sched_init(void)
+{
+    memset(tasks, 0, sizeof(tasks));
+    memset(&stats, 0, sizeof(stats));
+    memset(wheel, WHEEL_NONE, sizeof(wheel));
+
+    task_count     = 0;
+    wheel_occupied = 0;
+    ready_mask     = 0;
+    last_wake_ms   = time_now_ms();
+    wheel_tick     = wheel_tick_of(last_wake_ms);
+}
+
+/**
+ * Register a task. Lower priority values run first. Returns
+ * SCHED_TASK_NONE if the table is full.
+ */
+sched_task_t sched_add_task(sched_task_fn_t fn, uint8_t priority)
+{
+    if (fn == NULL || task_count >= SCHED_MAX_TASKS)
+        return SCHED_TASK_NONE;
+
+    uint8_t t = task_count++;
+    tasks[t].fn         = fn;
+    tasks[t].events     = 0;
+    tasks[t].priority   = priority;
+    tasks[t].wheel_slot = WHEEL_NONE;
+    tasks[t].wheel_next = WHEEL_NONE;
+    return t;
+}
+
+// Replace the sleep routine, e.g. so a host harness can advance its clock
+void sched_set_idle_hook(sched_idle_fn_t idle)
+{
+    idle_hook = idle ? idle : power_sleep_until;
+}
+
+/**
+ * Mark events pending for a task. Safe from an ISR, as long as a given
+ * task is posted to from one interrupt priority level.
+ */
+void sched_post_event(sched_task_t task, uint32_t events)
+{
+    if (task >= task_count || events == 0)
+        return;
+
+    tasks[task].events |= events;
+    ready_mask |= 1UL << task;
+}
+
+// (Re)arm the task's one-shot timer to fire delay_ms from now
+void sched_timer_start(sched_task_t task, uint32_t delay_ms)
+{
+    if (task >= task_count)
+        return;
+
+    wheel_remove(task);
+    tasks[task].deadline_ms = time_now_ms() + delay_ms;
+    wheel_insert(task);
+}
+
+void sched_timer_cancel(sched_task_t task)
+{
+    if (task < task_count)
+        wheel_remove(task);
+}
+
+bool sched_timer_armed(sched_task_t task)
+{
+    return task < task_count && tasks[task].wheel_slot != WHEEL_NONE;
+}
+
+/**
+ * One scheduler pass: fire due timers, run ready tasks until none are
+ * left, then sleep until the next deadline or interrupt.
+ */
+void sched_run_once(void)
+{
+    wheel_expire(time_now_ms() + SCHED_COALESCE_MS);
+
+    for (;;) {
+        uint8_t t = pick_ready();
+        if (t == WHEEL_NONE)
+            break;
+        run_task(t);
+
+        // Only timers already due: one re-armed inside the coalesce window
+        // waits for the next wake, or a task polling its own short deadline
+        // would run again and again without the clock moving
+        wheel_expire(time_now_ms());
+    }
+
+    SCHED_IRQ_DISABLE();
+    if (ready_mask != 0) {
+        // Posted after the last check; go round again instead of sleeping
+        SCHED_IRQ_ENABLE();
+        return;
+    }
+
+    uint32_t sleep_start = time_now_ms();
+    stats.awake_ms += sleep_start - last_wake_ms;
+
+    idle_hook(wheel_next_deadline());
+    SCHED_IRQ_ENABLE();
+
+    last_wake_ms = time_now_ms();
+    stats.sleep_ms += last_wake_ms - sleep_start;
+    stats.wakeups++;
+}
+
+void sched_run(void)
+{
+    for (;;)
+        sched_run_once();
+}
+
+void sched_get_stats(sched_stats_t *out)
+{
+    if (out != NULL)
+        *out = stats;
+}
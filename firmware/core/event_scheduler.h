@@ -0,0 +1,49 @@
+#ifndef EVENT_SCHEDULER_H
+#define EVENT_SCHEDULER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SCHED_MAX_TASKS        12
+#define SCHED_WHEEL_SLOTS      32      // one bit per slot in a 32-bit mask
+#define SCHED_WHEEL_RES_MS     1024    // slot width; horizon is ~32 s
+#define SCHED_COALESCE_MS      20      // timers due this soon run in the current wake
+#define SCHED_NEVER            0xFFFFFFFFu
+
+// Event bit set when a task's timer expires; bits below it are free for
+// the task's own sources (ISRs, other tasks)
+#define SCHED_EV_TIMER         (1UL << 31)
+
+typedef uint8_t sched_task_t;
+
+#define SCHED_TASK_NONE        0xFF
+
+// Runs with the events posted since its last run, timer included
+typedef void (*sched_task_fn_t)(uint32_t events, uint32_t now_ms);
+
+// Sleep until deadline_ms (SCHED_NEVER: no deadline) or an interrupt.
+// Called with interrupts masked; a pending interrupt still wakes the CPU.
+typedef void (*sched_idle_fn_t)(uint32_t deadline_ms);
+
+typedef struct {
+    uint32_t wakeups;          // returns from the idle hook
+    uint32_t task_runs;
+    uint32_t timer_fires;
+    uint64_t sleep_ms;         // time spent in the idle hook
+    uint64_t awake_ms;
+} sched_stats_t;
+
+void         sched_init(void);
+sched_task_t sched_add_task(sched_task_fn_t fn, uint8_t priority);
+void         sched_set_idle_hook(sched_idle_fn_t idle);
+
+void         sched_post_event(sched_task_t task, uint32_t events);
+void         sched_timer_start(sched_task_t task, uint32_t delay_ms);
+void         sched_timer_cancel(sched_task_t task);
+bool         sched_timer_armed(sched_task_t task);
+
+void         sched_run_once(void);
+void         sched_run(void);
+void         sched_get_stats(sched_stats_t *out);
+
+#endif
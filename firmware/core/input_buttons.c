@@ -5,8 +5,8 @@
  * ----------------------------------------
  * Handles all physical button input:
  *  - debouncing
- *  - event classification (short press, long press, hold)
- *  - forwarding input events to the UI/application layer
+ *  - turning a debounced press-and-release into one event
+ *  - handing input events to the UI/application layer
  *  - optional wake-from-sleep triggers
  *
  * This module is intentionally hardware-abstracted so it can run on
@@ -33,9 +33,6 @@
 // debounce window (ms)
 #define DEBOUNCE_MS       40
 
-// long-press recognition threshold (ms)
-#define LONG_PRESS_MS     600
-
 /* -----------------------------
    INTERNAL STATE STRUCTURE
 ------------------------------*/
@@ -53,8 +50,11 @@ static button_state_t btn_down;
 static button_state_t btn_select;
 static button_state_t btn_back;
 
-// callback pointer
-static button_event_callback_t registered_callback = NULL;
+// last completed press, until buttons_read_event() takes it
+static button_event_t pending_event = BUTTON_NONE;
+
+// called from the GPIO edge interrupt
+static buttons_notify_t edge_notify = NULL;
 
 /* -----------------------------
    HARDWARE ABSTRACTION LAYER
@@ -74,9 +74,9 @@ static bool read_gpio(uint8_t pin)
    INITIALIZATION
 ------------------------------*/
 
-void buttons_init(button_event_callback_t cb)
+void buttons_init(void)
 {
-    registered_callback = cb;
+    pending_event = BUTTON_NONE;
 
     // Initialize all button states
     button_state_t initial = {0};
@@ -92,7 +92,7 @@ void buttons_init(button_event_callback_t cb)
 
 static void process_button(button_state_t *btn,
                            uint8_t pin,
-                           button_id_t id,
+                           button_event_t id,
                            uint32_t now)
 {
     bool reading = read_gpio(pin);
@@ -114,14 +114,8 @@ static void process_button(button_state_t *btn,
             // button pressed
             btn->press_start_ms = now;
         } else {
-            // button released → classify event
-            uint32_t duration = now - btn->press_start_ms;
-            button_event_type_t type =
-                (duration >= LONG_PRESS_MS) ? BUTTON_LONG_PRESS : BUTTON_SHORT_PRESS;
-
-            if (registered_callback) {
-                registered_callback(id, type);
-            }
+            // button released → one event for the application
+            pending_event = id;
         }
     }
 }
@@ -133,7 +127,7 @@ static void process_button(button_state_t *btn,
 
 void buttons_update(void)
 {
-    uint32_t now = timekeeping_ms();
+    uint32_t now = time_now_ms();
 
     process_button(&btn_up,     BTN_UP_PIN,     BUTTON_UP,     now);
     process_button(&btn_down,   BTN_DOWN_PIN,   BUTTON_DOWN,   now);
@@ -141,6 +135,43 @@ void buttons_update(void)
     process_button(&btn_back,   BTN_BACK_PIN,   BUTTON_BACK,   now);
 }
 
+// Next button event, or BUTTON_NONE; each press is reported once
+button_event_t buttons_read_event(void)
+{
+    button_event_t ev = pending_event;
+
+    pending_event = BUTTON_NONE;
+    return ev;
+}
+
+/* -----------------------------
+   EDGE INTERRUPT
+   Any button edge wakes the CPU; buttons_update() is then
+   polled only while buttons_busy() says a reading is still
+   settling, instead of on a fixed tick.
+------------------------------*/
+
+void buttons_set_notify(buttons_notify_t fn)
+{
+    edge_notify = fn;
+}
+
+// Board GPIO interrupt handler for the button pins
+void buttons_gpio_isr(void)
+{
+    if (edge_notify) {
+        edge_notify();
+    }
+}
+
+bool buttons_busy(void)
+{
+    return btn_up.raw_state     != btn_up.stable_state     ||
+           btn_down.raw_state   != btn_down.stable_state   ||
+           btn_select.raw_state != btn_select.stable_state ||
+           btn_back.raw_state   != btn_back.stable_state;
+}
+
 /* -----------------------------
    OPTIONAL: WAKE HANDLERS
 ------------------------------*/
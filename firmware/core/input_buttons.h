@@ -12,7 +12,14 @@ typedef enum {
     BUTTON_BACK
 } button_event_t;
 
+// Runs in interrupt context on any button edge
+typedef void (*buttons_notify_t)(void);
+
 void buttons_init(void);
+void buttons_update(void);
 button_event_t buttons_read_event(void);
+void buttons_set_notify(buttons_notify_t fn);
+void buttons_gpio_isr(void);
+bool buttons_busy(void);
 
 #endif
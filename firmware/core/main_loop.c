@@ -2,11 +2,24 @@
 #include <stdbool.h>
 #include "power_manager.h"
 #include "radio_interface.h"
+#include "packet_pool.h"
 #include "storage_manager.h"
 #include "security_module.h"
 #include "ledger_manager.h"
+#include "ledger_storage.h"
+#include "ledger_record_codec.h"
+#include "main_loop.h"
 #include "input_buttons.h"
 #include "timekeeping.h"
+#include "mesh_fragment.h"
+#include "mesh_tx_queue.h"
+#include "mesh_gossip.h"
+#include "mesh_neighbor_table.h"
+#include "mesh_route_table.h"
+#include "mesh_protocol.h"
+#include "mesh_sync.h"
+#include "event_scheduler.h"
+#include "crc16.h"
 
 /*
 ===========================================================
@@ -18,67 +31,160 @@
   - Ledger synchronization
   - User interactions (buttons, screen triggers)
   - Periodic background tasks
+
+ Each subsystem is a task on the event scheduler. Radio
+ frames and button edges post events from their ISRs; the
+ rest re-arm a timer for their own next deadline. Between
+ them the CPU sleeps, rather than waking on a fixed tick.
 ===========================================================
 */
 
-#define MAIN_LOOP_TICK_MS 200          // How often the main loop runs
-#define SYNC_INTERVAL_MS   5000        // How often to attempt ledger sync
+#define SYNC_INTERVAL_MS   5000        // How often to push new ledger records
 #define HEARTBEAT_INTERVAL 10000       // Periodic mesh heartbeat
-#define BUTTON_CHECK_MS      100       // Input polling interval
+#define BUTTON_CHECK_MS      20        // Re-poll while a press is settling
+#define POWER_CHECK_MS     5000        // Battery / power state review
+#define STORAGE_IDLE_MS   30000        // Compaction check when nothing is pending
+#define DEMO_AMOUNT            1.0f    // Test transaction from the select button
+
+// Task priorities, 0 runs first
+enum {
+    PRIO_RADIO_RX = 0,
+    PRIO_BUTTONS,
+    PRIO_RADIO_TX,
+    PRIO_GOSSIP,
+    PRIO_FRAGMENTS,
+    PRIO_HEARTBEAT,
+    PRIO_SYNC,
+    PRIO_POWER,
+    PRIO_STORAGE
+};
+
+#define EV_RADIO_RX     (1UL << 0)
+#define EV_BUTTON_EDGE  (1UL << 0)
+#define EV_KICK         (1UL << 0)
+
+static sched_task_t rx_task;
+static sched_task_t button_task;
+static sched_task_t tx_task;
+static sched_task_t gossip_task;
+static sched_task_t frag_task;
+static sched_task_t storage_task;
+static sched_task_t sync_task;
+static sched_task_t heartbeat_task;
+static sched_task_t power_task;
 
-static uint32_t last_sync_time = 0;
-static uint32_t last_heartbeat_time = 0;
-static uint32_t last_button_poll = 0;
+// mesh_protocol.c
+extern bool mesh_send_transaction_broadcast(const uint8_t *payload, uint8_t len);
+
+/* ---------------------------------------------------------
+   Reassembled ledger snapshot from a neighbor
+--------------------------------------------------------- */
+static void on_snapshot_received(const uint8_t *data, uint16_t length)
+{
+    ledger_merge_remote(data, length);
+}
 
 /* ---------------------------------------------------------
    Initialization
 --------------------------------------------------------- */
+// Short mesh address derived from the device key, so it is stable
+// across reboots; 0 and 0xFFFF (broadcast) are never used
+static mesh_address_t local_mesh_address(void)
+{
+    uint16_t addr = crc16_compute(security_get_public_key(), 32);
+
+    if (addr == 0 || addr == 0xFFFF)
+        addr = 1;
+    return addr;
+}
+
 static void system_init(void)
 {
-    power_manager_init();
+    power_init();
+    packet_pool_init();
     radio_init();
+    mesh_tx_queue_init();
     storage_init();
     security_init();
+    neighbor_table_init();
+    mesh_init(local_mesh_address());
     ledger_init();
-    input_buttons_init();
+    mesh_sync_init();
+    buttons_init();
     timekeeping_init();
+    mesh_fragment_init(on_snapshot_received);
 
     // Load ledger from encrypted flash
     ledger_load_from_storage();
 
     // Announce boot to mesh network
-    radio_send_heartbeat();
+    mesh_send_heartbeat();
+    (void)mesh_flush_pending();
 }
 
 /* ---------------------------------------------------------
-   Handle incoming mesh packets
+   Upper-layer hooks for mesh_protocol.c
+   Frames were already moved out of the radio by its DIO
+   interrupt; radio_poll_receive() passes each one through
+   mesh_protocol, which verifies it and calls these. The
+   payload is a view into the frame buffer, valid only for
+   the call. Neighbor and route state is updated by the
+   mesh layer itself for every verified frame.
 --------------------------------------------------------- */
-static void handle_incoming_packets(void)
+// A transaction travels as one all-literal ledger record
+// (ledger_tx_encode())
+void mesh_on_transaction_message(const uint8_t *payload, uint8_t len)
 {
-    mesh_packet_t packet;
+    ledger_tx_t tx;
 
-    while (radio_receive(&packet))
-    {
-        switch (packet.type)
-        {
-            case PACKET_TRANSACTION:
-                ledger_import_transaction(&packet.tx);
-                break;
-
-            case PACKET_LEDGER_SYNC:
-                ledger_merge_remote(packet.ledger_blob, packet.ledger_length);
-                break;
-
-            case PACKET_HEARTBEAT:
-                // Update neighbor table
-                radio_update_neighbor(packet.src_id);
-                break;
-
-            default:
-                // Unknown packet type; ignore safely
-                break;
-        }
-    }
+    if (!ledger_tx_decode(payload, len, &tx))
+        return;
+
+    (void)ledger_apply_tx(&tx);
+}
+
+void mesh_on_heartbeat_message(const uint8_t *payload, uint8_t len)
+{
+    (void)payload;
+    (void)len;
+}
+
+void mesh_on_group_savings_message(const uint8_t *payload, uint8_t len)
+{
+    (void)payload;
+    (void)len;
+}
+
+void mesh_on_trust_score_message(const uint8_t *payload, uint8_t len)
+{
+    (void)payload;
+    (void)len;
+}
+
+/* ---------------------------------------------------------
+   Local transactions
+--------------------------------------------------------- */
+/**
+ * Sign a transaction this device originates, store it and broadcast
+ * it to the mesh. tx has everything but the Lamport value and the
+ * signature (ledger_create_transaction()). Neighbors that miss the
+ * broadcast pick it up from the next sync round.
+ */
+bool seed_submit_transaction(ledger_tx_t *tx)
+{
+    uint8_t  rec[LEDGER_RECORD_MAX_BYTES];
+    uint16_t len;
+
+    if (!ledger_sign_tx(tx) || !ledger_apply_tx(tx))
+        return false;
+
+    len = ledger_tx_encode(tx, rec);
+    if (len <= UINT8_MAX && mesh_send_transaction_broadcast(rec, (uint8_t)len))
+        sched_post_event(tx_task, EV_KICK);
+
+    if (ledger_has_pending_writes())
+        sched_post_event(storage_task, EV_KICK);
+    return true;
 }
 
 /* ---------------------------------------------------------
@@ -86,7 +192,11 @@ static void handle_incoming_packets(void)
 --------------------------------------------------------- */
 static void handle_user_input(void)
 {
-    button_event_t ev = input_buttons_read();
+    ledger_tx_t tx;
+
+    buttons_update();
+
+    button_event_t ev = buttons_read_event();
 
     if (ev == BUTTON_NONE) return;
 
@@ -102,7 +212,8 @@ static void handle_user_input(void)
 
         case BUTTON_SELECT:
             // Example action: create a small-value test transaction
-            ledger_create_transaction("LOCAL_USER", "DEMO_RECEIVER", 1);
+            if (ledger_create_transaction("LOCAL_USER", "DEMO_RECEIVER", DEMO_AMOUNT, &tx))
+                (void)seed_submit_transaction(&tx);
             break;
 
         default:
@@ -111,61 +222,203 @@ static void handle_user_input(void)
 }
 
 /* ---------------------------------------------------------
-   Background sync behaviors
+   Interrupt hooks (ISR context)
 --------------------------------------------------------- */
-static void periodic_tasks(uint32_t now)
+static void on_radio_rx_isr(void)
 {
-    // Attempt ledger sync with neighbors
-    if (now - last_sync_time >= SYNC_INTERVAL_MS)
-    {
-        uint8_t buffer[LEDGER_EXPORT_MAX];
-        uint16_t length = ledger_export(buffer, sizeof(buffer));
-        radio_broadcast_ledger(buffer, length);
-        last_sync_time = now;
-    }
+    sched_post_event(rx_task, EV_RADIO_RX);
+}
 
-    // Heartbeat message for neighbor discovery
-    if (now - last_heartbeat_time >= HEARTBEAT_INTERVAL)
-    {
-        radio_send_heartbeat();
-        last_heartbeat_time = now;
-    }
+static void on_button_edge_isr(void)
+{
+    sched_post_event(button_task, EV_BUTTON_EDGE);
+}
+
+static void on_tx_queued(void)
+{
+    sched_post_event(tx_task, EV_KICK);
+}
+
+static void on_relay_held(void)
+{
+    sched_post_event(gossip_task, EV_KICK);
+}
+
+// Run again after delay_ms, or wait for an event if there is nothing due
+static void rearm(sched_task_t task, uint32_t delay_ms)
+{
+    if (delay_ms == SCHED_NEVER)
+        sched_timer_cancel(task);
+    else
+        sched_timer_start(task, delay_ms);
 }
 
 /* ---------------------------------------------------------
-   Main loop
+   Tasks
 --------------------------------------------------------- */
-void main_loop(void)
+static void task_radio_rx(uint32_t events, uint32_t now)
 {
-    system_init();
+    (void)events;
+    (void)now;
 
-    while (1)
-    {
-        uint32_t now = timekeeping_ms();
+    // Hands every queued frame to mesh_protocol without copying it
+    radio_poll_receive();
 
-        // Power-aware sleep/wake behavior
-        power_manager_tick();
+    // Replies the frames produced (sync ranges, summaries) go out now
+    (void)mesh_flush_pending();
 
-        // Process mesh traffic
-        handle_incoming_packets();
+    // Frames may have started a reassembly or dirtied the ledger
+    sched_post_event(frag_task, EV_KICK);
+    if (ledger_has_pending_writes())
+        sched_post_event(storage_task, EV_KICK);
+}
 
-        // Button polling on interval
-        if (now - last_button_poll >= BUTTON_CHECK_MS)
-        {
-            handle_user_input();
-            last_button_poll = now;
-        }
+static void task_buttons(uint32_t events, uint32_t now)
+{
+    (void)events;
+    (void)now;
+
+    handle_user_input();
+
+    // Keep polling only while debounce or a held press needs it
+    if (buttons_busy())
+        sched_timer_start(button_task, BUTTON_CHECK_MS);
+    if (ledger_has_pending_writes())
+        sched_post_event(storage_task, EV_KICK);
+}
+
+static void task_radio_tx(uint32_t events, uint32_t now)
+{
+    (void)events;
+    (void)now;
+
+    rearm(tx_task, mesh_tx_queue_process());
+}
+
+// Relays waiting out their gossip backoff
+static void task_gossip(uint32_t events, uint32_t now)
+{
+    (void)events;
+
+    // The wheel runs us up to SCHED_COALESCE_MS early, so backoffs ending
+    // in that window go now; a shorter rearm would just re-expire at once
+    uint32_t wait = mesh_gossip_tick(now + SCHED_COALESCE_MS);
 
-        // Background work
-        periodic_tasks(now);
+    rearm(gossip_task, (wait == SCHED_NEVER) ? SCHED_NEVER : wait + SCHED_COALESCE_MS);
+}
+
+// Send pending fragments, NACK stalled reassemblies
+static void task_fragments(uint32_t events, uint32_t now)
+{
+    (void)events;
+
+    rearm(frag_task, mesh_fragment_tick(now));
+}
+
+// Ledger sync with neighbors: push records stored since the last round
+// as a snapshot split into fragments (a new one starts only after the
+// previous transfer ends), and let mesh_sync advertise our summary and
+// chase the ranges it is pulling. Runs again at whichever is due first.
+static void task_sync(uint32_t events, uint32_t now)
+{
+    (void)events;
 
-        // Save ledger state if changed
-        if (ledger_has_pending_writes())
+    if (!mesh_fragment_tx_busy())
+    {
+        uint8_t buffer[LEDGER_EXPORT_MAX];
+        uint32_t length = 0;
+
+        if (ledger_export_snapshot(buffer, sizeof(buffer), &length) &&
+            mesh_fragment_send(MESH_FRAGMENT_BROADCAST, buffer, (uint16_t)length))
         {
-            ledger_save_to_storage();
+            sched_post_event(frag_task, EV_KICK);
         }
+    }
+
+    uint32_t wait = mesh_sync_tick(now);
+    (void)mesh_flush_pending();
+
+    sched_timer_start(sync_task, (wait < SYNC_INTERVAL_MS) ? wait : SYNC_INTERVAL_MS);
+}
 
-        // Small sleep to reduce CPU load (device may deep-sleep)
-        power_manager_delay(MAIN_LOOP_TICK_MS);
+// Heartbeat message for neighbor discovery; it also carries our routes,
+// and goes out at once with anything batched behind it
+static void task_heartbeat(uint32_t events, uint32_t now)
+{
+    (void)events;
+    (void)now;
+
+    mesh_send_heartbeat();
+    (void)mesh_flush_pending();
+    neighbor_table_prune();
+    route_table_prune();
+    sched_timer_start(heartbeat_task, HEARTBEAT_INTERVAL);
+}
+
+// Power-aware sleep/wake behavior
+static void task_power(uint32_t events, uint32_t now)
+{
+    (void)events;
+    (void)now;
+
+    power_update();
+    sched_timer_start(power_task, POWER_CHECK_MS);
+}
+
+// Save ledger state if changed, then reclaim settled history one step
+// (one erase or checkpoint) per run, yielding to other tasks in between
+static void task_storage(uint32_t events, uint32_t now)
+{
+    (void)events;
+    (void)now;
+
+    if (ledger_has_pending_writes())
+    {
+        ledger_save_to_storage();
     }
+
+    bool more = ledger_storage_compact_step() || storage_compact_step();
+    sched_timer_start(storage_task, more ? 0 : STORAGE_IDLE_MS);
+}
+
+static void scheduler_init(void)
+{
+    sched_init();
+
+    rx_task        = sched_add_task(task_radio_rx,  PRIO_RADIO_RX);
+    button_task    = sched_add_task(task_buttons,   PRIO_BUTTONS);
+    tx_task        = sched_add_task(task_radio_tx,  PRIO_RADIO_TX);
+    gossip_task    = sched_add_task(task_gossip,    PRIO_GOSSIP);
+    frag_task      = sched_add_task(task_fragments, PRIO_FRAGMENTS);
+    heartbeat_task = sched_add_task(task_heartbeat, PRIO_HEARTBEAT);
+    sync_task      = sched_add_task(task_sync,      PRIO_SYNC);
+    power_task     = sched_add_task(task_power,     PRIO_POWER);
+    storage_task   = sched_add_task(task_storage,   PRIO_STORAGE);
+
+    sched_timer_start(heartbeat_task, HEARTBEAT_INTERVAL);
+    sched_timer_start(sync_task,      SYNC_INTERVAL_MS);
+    sched_timer_start(power_task,     0);
+    sched_timer_start(storage_task,   0);
+
+    radio_set_rx_notify(on_radio_rx_isr);
+    buttons_set_notify(on_button_edge_isr);
+    mesh_tx_queue_set_notify(on_tx_queued);
+    mesh_gossip_set_notify(on_relay_held);
+
+    // Frames that arrived during init
+    if (radio_rx_pending())
+        sched_post_event(rx_task, EV_RADIO_RX);
+}
+
+/* ---------------------------------------------------------
+   Main loop
+--------------------------------------------------------- */
+void main_loop(void)
+{
+    system_init();
+    scheduler_init();
+
+    // Never returns: run tasks as events and deadlines come due,
+    // sleep in between
+    sched_run();
 }
@@ -3,10 +3,14 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "ledger_manager.h"
 
 void seed_main_loop(void);
 void seed_initialize_system(void);
 void seed_process_events(void);
 void seed_sleep_cycle(void);
 
+void main_loop(void);
+bool seed_submit_transaction(ledger_tx_t *tx);
+
 #endif
@@ -0,0 +1,107 @@
+/**
+ * packet_pool.c
+ * ---------------------------------------------------------
+ * Seed Device Firmware — Shared Packet Buffer Pool
+ *
+ * Purpose:
+ *   - Fixed set of frame-sized buffers shared by the radio
+ *     driver, the mesh stack and the ledger handlers.
+ *   - A received frame is written into a pool buffer once and
+ *     then passed up by pointer; forwarding queues the same
+ *     buffer for transmit instead of copying it.
+ *
+ * Design Goals:
+ *   - No heap: PACKET_POOL_SLOTS buffers are reserved at build
+ *     time and handed out from a free list in O(1).
+ *   - Reference counted, so a buffer can sit in the TX queue
+ *     while the RX path is still reading it; the last release
+ *     returns it to the pool.
+ *   - High-water statistics to size PACKET_POOL_SLOTS from
+ *     field data.
+ *
+ * NOTE:
+ *   All calls are made from main-loop context.
+ * ---------------------------------------------------------
+ */
+
+#include "packet_pool.h"
+#include <string.h>
+
+#define POOL_SLOT_NONE  0xFF
+
+// ---------------------------------------------------------------------------
+// Internal Static State
+// ---------------------------------------------------------------------------
+
+static packet_buf_t        pool[PACKET_POOL_SLOTS];
+static uint8_t             free_head = POOL_SLOT_NONE;
+static packet_pool_stats_t stats;
+
+// ---------------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------------
+
+void packet_pool_init(void)
+{
+    memset(&stats, 0, sizeof(stats));
+
+    for (uint8_t i = 0; i < PACKET_POOL_SLOTS; i++) {
+        pool[i].refcount  = 0;
+        pool[i].next_free = (i + 1 < PACKET_POOL_SLOTS) ? (uint8_t)(i + 1) : POOL_SLOT_NONE;
+    }
+    free_head = 0;
+}
+
+/**
+ * Take a buffer with one reference held by the caller, or NULL if the
+ * pool is exhausted. Contents are not cleared.
+ */
+packet_buf_t *packet_pool_alloc(void)
+{
+    if (free_head == POOL_SLOT_NONE) {
+        stats.alloc_failures++;
+        return NULL;
+    }
+
+    packet_buf_t *buf = &pool[free_head];
+    free_head = buf->next_free;
+
+    buf->refcount   = 1;
+    buf->offset     = 0;
+    buf->len        = 0;
+    buf->rssi       = 0;
+    buf->rx_time_ms = 0;
+
+    stats.allocs++;
+    stats.in_use++;
+    if (stats.in_use > stats.high_water)
+        stats.high_water = stats.in_use;
+
+    return buf;
+}
+
+void packet_buf_retain(packet_buf_t *buf)
+{
+    if (buf != NULL && buf->refcount > 0 && buf->refcount < UINT8_MAX)
+        buf->refcount++;
+}
+
+// Drop one reference; the last one returns the buffer to the pool
+void packet_buf_release(packet_buf_t *buf)
+{
+    if (buf == NULL || buf->refcount == 0)
+        return;
+
+    if (--buf->refcount > 0)
+        return;
+
+    buf->next_free = free_head;
+    free_head = (uint8_t)(buf - pool);
+    stats.in_use--;
+}
+
+void packet_pool_get_stats(packet_pool_stats_t *out)
+{
+    if (out != NULL)
+        *out = stats;
+}
@@ -0,0 +1,63 @@
+#ifndef PACKET_POOL_H
+#define PACKET_POOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "radio_config.h"
+#include "radio_airtime.h"
+
+// Frames the radio ISR can hold before the main loop drains them; power
+// of two. Each one pins a buffer (see radio_rx_ring.h).
+#ifndef RX_RING_SLOTS
+#define RX_RING_SLOTS          8
+#endif
+
+// Buffers layers may keep after the receive call returns: relays in
+// gossip backoff (MESH_GOSSIP_PENDING) plus relays queued for TX, which
+// the TX queue caps at what is left of this
+#ifndef PACKET_POOL_HELD
+#define PACKET_POOL_HELD       12
+#endif
+
+// Number of packet buffers: the RX ring, the frame being handled and
+// every holder, so held frames can never starve the ring. Override the
+// parts above to fit the RAM budget.
+#ifndef PACKET_POOL_SLOTS
+#define PACKET_POOL_SLOTS      (RX_RING_SLOTS + 1 + PACKET_POOL_HELD)
+#endif
+
+// One full radio frame: payload plus version/type/length/CRC
+#define PACKET_BUF_SIZE        (MAX_PACKET_SIZE + RADIO_FRAME_OVERHEAD)
+
+// Bytes kept free in front of the payload for the radio frame header, so
+// a buffer can be framed and sent in place
+#define PACKET_BUF_HEADROOM    4
+
+// A received or outgoing frame. Layers pass the pointer around and take
+// a reference while they hold it; data[offset .. offset+len) is the part
+// the current layer cares about.
+typedef struct {
+    uint8_t  data[PACKET_BUF_SIZE];
+    uint16_t offset;
+    uint16_t len;
+    uint32_t rx_time_ms;         // arrival time, set by the RX interrupt
+    int8_t   rssi;
+    int8_t   snr_x4;             // packet SNR in 0.25 dB steps
+    uint8_t  refcount;           // 0 = on the free list
+    uint8_t  next_free;
+} packet_buf_t;
+
+typedef struct {
+    uint32_t allocs;
+    uint32_t alloc_failures;     // pool empty when a buffer was needed
+    uint8_t  in_use;
+    uint8_t  high_water;         // most buffers ever in use at once
+} packet_pool_stats_t;
+
+void          packet_pool_init(void);
+packet_buf_t *packet_pool_alloc(void);
+void          packet_buf_retain(packet_buf_t *buf);
+void          packet_buf_release(packet_buf_t *buf);
+void          packet_pool_get_stats(packet_pool_stats_t *out);
+
+#endif
@@ -8,12 +8,10 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "timekeeping.h"
 
 // ---- Dependencies (implemented in other modules) --------------------
 
-// timekeeping.c
-extern uint32_t tk_millis(void);              // returns ms since boot
-
 // battery_sensor.c
 extern uint16_t battery_read_mv(void);        // battery voltage in millivolts
 extern bool     battery_is_charging(void);    // true if charging (e.g. solar / crank)
@@ -23,6 +21,10 @@ extern bool     battery_is_present(void);     // basic sanity check
 extern void lora_enter_sleep(void);
 extern void lora_wake(void);
 
+// lptimer.c (low-power wake timer, keeps running in sleep)
+extern void lptimer_set_compare(uint32_t delay_ms);
+extern void lptimer_stop(void);
+
 // e_ink_display.c
 extern void e_ink_enter_sleep(void);
 extern void e_ink_wake(void);
@@ -85,7 +87,7 @@ static void pm_set_state(power_state_t new_state)
     if (g_power.state == new_state) return;
 
     g_power.state = new_state;
-    g_power.last_state_change_ms = tk_millis();
+    g_power.last_state_change_ms = time_now_ms();
 
     switch (new_state) {
         case POWER_STATE_ACTIVE:
@@ -118,7 +120,7 @@ static void pm_set_state(power_state_t new_state)
 
 static void pm_decide_state(void)
 {
-    uint32_t now = tk_millis();
+    uint32_t now = time_now_ms();
 
     // Battery / hardware sanity
     if (!battery_is_present()) {
@@ -169,7 +171,7 @@ static void pm_decide_state(void)
 
 void power_init(void)
 {
-    uint32_t now = tk_millis();
+    uint32_t now = time_now_ms();
     g_power.battery_mv           = 0;
     g_power.battery_pct          = 0;
     g_power.charging             = false;
@@ -193,7 +195,7 @@ void power_update(void)
 // Mark that some user / system activity happened (button press, transaction, etc.)
 void power_mark_activity(void)
 {
-    g_power.last_activity_ms = tk_millis();
+    g_power.last_activity_ms = time_now_ms();
 
     // Being active cancels any "deep sleep soon" plan
     if (g_power.state == POWER_STATE_IDLE ||
@@ -214,7 +216,7 @@ bool power_request_radio_burst(uint32_t duration_ms)
         return false;
     }
 
-    uint32_t now = tk_millis();
+    uint32_t now = time_now_ms();
     g_power.radio_burst_requested = true;
     g_power.radio_burst_end_ms    = now + duration_ms;
     pm_set_state(POWER_STATE_ACTIVE);
@@ -242,3 +244,22 @@ bool power_is_charging(void)
 {
     return g_power.charging;
 }
+
+// Sleep until deadline_ms (0xFFFFFFFF: no deadline) or the next interrupt
+// (radio DIO, button, timer). Called by the scheduler with interrupts
+// masked; WFI still wakes on a pending one, which is taken once the
+// caller unmasks. Host builds return at once.
+void power_sleep_until(uint32_t deadline_ms)
+{
+#if defined(__arm__) && !defined(SEED_HOST_SIM)
+    if (deadline_ms != 0xFFFFFFFFu) {
+        uint32_t now = time_now_ms();
+        if ((int32_t)(deadline_ms - now) <= 0) return;
+        lptimer_set_compare(deadline_ms - now);
+    }
+    __asm__ volatile ("wfi");
+    lptimer_stop();
+#else
+    (void)deadline_ms;
+#endif
+}
@@ -5,9 +5,11 @@
 #include <stdbool.h>
 
 void power_init(void);
+void power_update(void);
 void power_enter_low_power_mode(void);
 void power_exit_low_power_mode(void);
 uint16_t power_get_battery_level(void);
 bool power_is_charging(void);
+void power_sleep_until(uint32_t deadline_ms);
 
 #endif
@@ -0,0 +1,157 @@
+/**
+ * radio_airtime.c
+ * ---------------------------------------------------------
+ * Seed Device Firmware — Airtime / Duty-Cycle Accounting
+ *
+ * Purpose:
+ *   - Computes LoRa time-on-air for a frame from the PHY
+ *     settings in radio_config.h (SF, bandwidth, coding rate,
+ *     preamble).
+ *   - Enforces DUTY_CYCLE_LIMIT_PERCENT per channel with a
+ *     token bucket that refills continuously and holds at most
+ *     one hour of allowance, approximating a sliding hour.
+ *   - Enforces MIN_TX_INTERVAL_MS between transmissions.
+ *
+ * Design Goals:
+ *   - Transmissions are refused up front instead of failing at
+ *     random once the regulatory cap is reached.
+ *   - Upper layers (mesh_tx_queue.c) can see the remaining
+ *     budget and decide what is worth sending.
+ *   - Integer-only math; no floating point on the MCU.
+ * ---------------------------------------------------------
+ */
+
+#include "radio_airtime.h"
+#include "radio_config.h"
+#include "timekeeping.h"
+#include <string.h>
+
+// ---------------------------------------------------------------------------
+// Internal Static State
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    uint32_t tokens_us;        // airtime still available
+    uint32_t last_refill_ms;
+} airtime_bucket_t;
+
+static airtime_bucket_t buckets[MAX_MESH_CHANNELS];
+static uint32_t         last_tx_ms = 0;
+static bool             any_tx     = false;
+
+// ---------------------------------------------------------------------------
+// Time-on-Air (Semtech SX127x/SX126x datasheet formula)
+// ---------------------------------------------------------------------------
+
+static uint32_t bandwidth_hz(void)
+{
+    switch (LORA_BANDWIDTH_125KHZ) {
+        case 1:  return 250000;
+        case 2:  return 500000;
+        default: return 125000;
+    }
+}
+
+/**
+ * Time-on-air in microseconds for a frame of frame_len bytes, with an
+ * explicit header and payload CRC enabled.
+ */
+uint32_t airtime_time_on_air_us(uint16_t frame_len)
+{
+    const int32_t sf = LORA_SPREADING_FACTOR;
+    const int32_t cr = LORA_CODING_RATE;                 // 1 → 4/5 ... 4 → 4/8
+
+    uint32_t t_sym_us = (uint32_t)(((uint64_t)1 << sf) * 1000000ULL / bandwidth_hz());
+
+    // Low data rate optimisation is mandatory above 16 ms symbols
+    int32_t de = (t_sym_us >= 16000) ? 1 : 0;
+
+    int32_t num = 8 * (int32_t)frame_len - 4 * sf + 28 + 16;
+    int32_t den = 4 * (sf - 2 * de);
+    int32_t payload_sym = 8;
+
+    if (num > 0)
+        payload_sym += ((num + den - 1) / den) * (cr + 4);
+
+    // Preamble is (n + 4.25) symbols
+    uint32_t preamble_us = ((4U * LORA_PREAMBLE_LENGTH + 17U) * t_sym_us) / 4U;
+
+    return preamble_us + (uint32_t)payload_sym * t_sym_us;
+}
+
+// ---------------------------------------------------------------------------
+// Token Bucket
+// ---------------------------------------------------------------------------
+
+static void refill(airtime_bucket_t *b, uint32_t now)
+{
+    uint32_t elapsed = now - b->last_refill_ms;
+    b->last_refill_ms = now;
+
+    // A full hour idle refills the whole budget; clamp to avoid overflow
+    if (elapsed >= 3600000UL) {
+        b->tokens_us = AIRTIME_HOURLY_BUDGET_US;
+        return;
+    }
+
+    // DUTY_CYCLE_LIMIT_PERCENT of each elapsed millisecond, in µs
+    uint32_t earned = elapsed * 10UL * DUTY_CYCLE_LIMIT_PERCENT;
+
+    if (b->tokens_us + earned > AIRTIME_HOURLY_BUDGET_US)
+        b->tokens_us = AIRTIME_HOURLY_BUDGET_US;
+    else
+        b->tokens_us += earned;
+}
+
+void airtime_init(void)
+{
+    uint32_t now = time_now_ms();
+
+    for (uint8_t ch = 0; ch < MAX_MESH_CHANNELS; ch++) {
+        buckets[ch].tokens_us      = AIRTIME_HOURLY_BUDGET_US;
+        buckets[ch].last_refill_ms = now;
+    }
+    any_tx = false;
+}
+
+uint32_t airtime_remaining_us(uint8_t channel)
+{
+    if (channel >= MAX_MESH_CHANNELS)
+        return 0;
+
+    refill(&buckets[channel], time_now_ms());
+    return buckets[channel].tokens_us;
+}
+
+/**
+ * True if a frame of frame_len bytes fits in the channel's remaining
+ * budget and the minimum gap since the last transmission has passed.
+ */
+bool airtime_can_send(uint8_t channel, uint16_t frame_len)
+{
+    if (channel >= MAX_MESH_CHANNELS)
+        return false;
+
+    uint32_t now = time_now_ms();
+
+    if (any_tx && (now - last_tx_ms) < MIN_TX_INTERVAL_MS)
+        return false;
+
+    refill(&buckets[channel], now);
+    return buckets[channel].tokens_us >= airtime_time_on_air_us(frame_len);
+}
+
+/**
+ * Charge a transmission against the channel. Returns false (and
+ * charges nothing) if it would exceed the duty-cycle limit.
+ */
+bool airtime_consume(uint8_t channel, uint16_t frame_len)
+{
+    if (!airtime_can_send(channel, frame_len))
+        return false;
+
+    buckets[channel].tokens_us -= airtime_time_on_air_us(frame_len);
+    last_tx_ms = time_now_ms();
+    any_tx = true;
+    return true;
+}
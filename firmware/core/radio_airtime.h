@@ -0,0 +1,20 @@
+#ifndef RADIO_AIRTIME_H
+#define RADIO_AIRTIME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "radio_config.h"
+
+// Bytes radio_interface adds around every payload (version, type, length, CRC)
+#define RADIO_FRAME_OVERHEAD       6
+
+// Airtime each channel may use per rolling hour, in microseconds
+#define AIRTIME_HOURLY_BUDGET_US   (3600000UL * 10UL * DUTY_CYCLE_LIMIT_PERCENT)
+
+void     airtime_init(void);
+uint32_t airtime_time_on_air_us(uint16_t frame_len);
+uint32_t airtime_remaining_us(uint8_t channel);
+bool     airtime_can_send(uint8_t channel, uint16_t frame_len);
+bool     airtime_consume(uint8_t channel, uint16_t frame_len);
+
+#endif
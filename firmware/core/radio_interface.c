@@ -9,6 +9,9 @@
  *   - Handles radio initialization, configuration, TX/RX
  *     operations, power-optimized modes, and basic integrity
  *     checks.
+ *   - Receives in the DIO (RX-done) interrupt: each frame is
+ *     read out of the FIFO straight away into radio_rx_ring.c
+ *     and checked later from the main loop.
  *
  * Design Goals:
  *   - Offline-first mesh communication with no dependency
@@ -28,8 +31,14 @@
 
 #include "radio_interface.h"
 #include "radio_config.h"
+#include "radio_airtime.h"
 #include "device_config.h"
 #include "crc16.h"
+#include "radio_rx_ring.h"
+#include "timekeeping.h"
+#ifdef SEED_HOST_SIM
+#include "radio_sim.h"
+#endif
 #include <string.h>
 #include <stdio.h>
 
@@ -38,6 +47,33 @@
 // ---------------------------------------------------------------------------
 static bool radio_initialized = false;
 static radio_status_t last_status = RADIO_STATUS_IDLE;
+static uint8_t current_channel = DEFAULT_TX_CHANNEL;
+static radio_rx_callback_t rx_callback = NULL;
+static radio_rx_notify_t rx_notify = NULL;
+
+// ---------------------------------------------------------------------------
+// SX1276 LoRa-mode registers and the values radio_init() programs
+// ---------------------------------------------------------------------------
+#define REG_FREQ_MSB            0x06
+#define REG_FREQ_MID            0x07
+#define REG_FREQ_LSB            0x08
+#define REG_OUTPUT_POWER        0x09     // RegPaConfig
+#define REG_MODEM_CONFIG_1      0x1D     // bandwidth, coding rate, header mode
+#define REG_MODEM_CONFIG_2      0x1E     // spreading factor, payload CRC
+
+// Frf = f * 2^19 / 32 MHz crystal
+#define RADIO_FRF               ((uint32_t)(((uint64_t)LORA_FREQUENCY_HZ << 19) / 32000000ULL))
+#define RADIO_FREQ_MSB          ((uint8_t)(RADIO_FRF >> 16))
+#define RADIO_FREQ_MID          ((uint8_t)(RADIO_FRF >> 8))
+#define RADIO_FREQ_LSB          ((uint8_t)RADIO_FRF)
+
+// Bw 0x7 = 125 kHz (+1 per doubling), CR 4/(4+n), explicit header;
+// payload CRC on, as radio_airtime.c assumes
+#define RADIO_MODEM_CONFIG_1    ((uint8_t)(((0x7 + LORA_BANDWIDTH_125KHZ) << 4) | (LORA_CODING_RATE << 1)))
+#define RADIO_MODEM_CONFIG_2    ((uint8_t)((LORA_SPREADING_FACTOR << 4) | 0x04))
+
+// PA_BOOST output: Pout = 2 + OutputPower dBm
+#define RADIO_TX_POWER          ((uint8_t)(0x80 | ((LORA_TX_POWER_DBM - 2) & 0x0F)))
 
 // ---------------------------------------------------------------------------
 // Hardware Abstractions (to be implemented with real board)
@@ -51,30 +87,58 @@ static void hw_reset_radio()
 static void hw_radio_write_register(uint16_t reg, uint8_t value)
 {
     // TODO: implement SPI write
+    (void)reg;
+    (void)value;
 }
 
-static uint8_t hw_radio_read_register(uint16_t reg)
+static void hw_radio_send_raw(const uint8_t *data, uint16_t len)
 {
-    // TODO: implement SPI read
-    return 0;
+#ifdef SEED_HOST_SIM
+    radio_sim_transmit(data, len);
+#else
+    // TODO: push bytes into radio FIFO and trigger TX
+    (void)data;
+    (void)len;
+#endif
 }
 
-static void hw_radio_send_raw(uint8_t *data, uint16_t len)
+static uint16_t hw_radio_receive_raw(uint8_t *buffer, uint16_t max_len)
 {
-    // TODO: push bytes into radio FIFO and trigger TX
+#ifdef SEED_HOST_SIM
+    return radio_sim_read_fifo(buffer, max_len);
+#else
+    // TODO: read bytes from radio RX FIFO (NULL buffer: discard them)
+    (void)buffer;
+    (void)max_len;
+    return 0;
+#endif
 }
 
-static uint16_t hw_radio_receive_raw(uint8_t *buffer, uint16_t max_len)
+static int8_t hw_radio_read_rssi(void)
 {
-    // TODO: read bytes from radio RX FIFO
+#ifdef SEED_HOST_SIM
+    return radio_sim_packet_rssi();
+#else
+    // TODO: read packet RSSI register
     return 0;
+#endif
+}
+
+static int8_t hw_radio_read_snr(void)
+{
+#ifdef SEED_HOST_SIM
+    return radio_sim_packet_snr();
+#else
+    // TODO: read packet SNR (GetPacketStatus, 0.25 dB steps)
+    return RADIO_SNR_UNKNOWN;
+#endif
 }
 
 // ---------------------------------------------------------------------------
 // Radio Initialization
 // ---------------------------------------------------------------------------
 
-radio_status_t radio_init()
+void radio_init()
 {
     hw_reset_radio();
 
@@ -83,16 +147,16 @@ radio_status_t radio_init()
     hw_radio_write_register(REG_FREQ_MID, RADIO_FREQ_MID);
     hw_radio_write_register(REG_FREQ_LSB, RADIO_FREQ_LSB);
 
-    hw_radio_write_register(REG_SPREADING_FACTOR, RADIO_SF);
-    hw_radio_write_register(REG_BANDWIDTH, RADIO_BW);
-    hw_radio_write_register(REG_CODING_RATE, RADIO_CR);
+    hw_radio_write_register(REG_MODEM_CONFIG_1, RADIO_MODEM_CONFIG_1);
+    hw_radio_write_register(REG_MODEM_CONFIG_2, RADIO_MODEM_CONFIG_2);
 
     hw_radio_write_register(REG_OUTPUT_POWER, RADIO_TX_POWER);
 
+    airtime_init();
+    rx_ring_init();
+
     radio_initialized = true;
     last_status = RADIO_STATUS_IDLE;
-
-    return RADIO_STATUS_OK;
 }
 
 // ---------------------------------------------------------------------------
@@ -128,7 +192,7 @@ radio_status_t radio_init()
 
 static uint16_t build_packet(
     uint8_t msg_type,
-    uint8_t *payload,
+    const uint8_t *payload,
     uint16_t payload_len,
     uint8_t *out_buffer)
 {
@@ -151,55 +215,280 @@ static uint16_t build_packet(
 // Transmit
 // ---------------------------------------------------------------------------
 
-radio_status_t radio_send(uint8_t msg_type, uint8_t *data, uint16_t len)
+bool radio_send(uint8_t msg_type, const uint8_t *data, uint16_t len)
 {
-    if (!radio_initialized)
-        return RADIO_ERR_NOT_INITIALIZED;
+    if (!radio_initialized || len + RADIO_FRAME_OVERHEAD > PACKET_BUF_SIZE)
+        return false;
 
-    uint8_t packet[MAX_RADIO_PACKET_SIZE];
+    uint8_t packet[PACKET_BUF_SIZE];
     uint16_t packet_len = build_packet(msg_type, data, len, packet);
 
+    // Refuse rather than exceed the regulatory duty cycle
+    if (!airtime_consume(current_channel, packet_len))
+        return false;
+
     hw_radio_send_raw(packet, packet_len);
     last_status = RADIO_STATUS_TX;
 
-    return RADIO_STATUS_OK;
+    return true;
+}
+
+/**
+ * Transmit buf->data[offset .. offset+len) without copying it. The frame
+ * header goes into the headroom in front of the payload and the CRC right
+ * after it, so a received buffer can be forwarded as-is.
+ */
+bool radio_send_buf(uint8_t msg_type, packet_buf_t *buf)
+{
+    if (!radio_initialized || buf == NULL)
+        return false;
+
+    if (buf->offset < PACKET_BUF_HEADROOM ||
+        buf->offset + buf->len + 2 > PACKET_BUF_SIZE)
+        return false;
+
+    uint8_t *frame = &buf->data[buf->offset - PACKET_BUF_HEADROOM];
+    uint16_t frame_len = buf->len + RADIO_FRAME_OVERHEAD;
+
+    if (!airtime_consume(current_channel, frame_len))
+        return false;
+
+    frame[0] = PROTOCOL_VERSION;
+    frame[1] = msg_type;
+    frame[2] = (buf->len >> 8) & 0xFF;
+    frame[3] = (buf->len & 0xFF);
+
+    uint16_t crc = crc16_compute(frame, buf->len + 4);
+    frame[4 + buf->len] = (crc >> 8) & 0xFF;
+    frame[5 + buf->len] = (crc & 0xFF);
+
+    hw_radio_send_raw(frame, frame_len);
+    last_status = RADIO_STATUS_TX;
+
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Channel Selection
+// ---------------------------------------------------------------------------
+
+void radio_set_channel(uint8_t channel_index)
+{
+    if (channel_index >= MAX_MESH_CHANNELS)
+        return;
+
+    // TODO: program the channel's frequency registers
+    current_channel = channel_index;
+}
+
+uint8_t radio_get_channel()
+{
+    return current_channel;
 }
 
 // ---------------------------------------------------------------------------
 // Receive
 // ---------------------------------------------------------------------------
 
-radio_status_t radio_receive(radio_packet_t *out_packet)
+/**
+ * RX-done (DIO) interrupt handler. Moves the frame out of the radio FIFO
+ * into a spare ring buffer with its RSSI and arrival time; validation is
+ * left to the main loop so the ISR stays short.
+ */
+void radio_dio_isr(void)
+{
+    packet_buf_t *buf = rx_ring_isr_take_buffer();
+
+    if (buf == NULL) {
+        // Main loop is behind: free the FIFO for the next frame
+        (void)hw_radio_receive_raw(NULL, 0);
+        rx_ring_isr_drop();
+        return;
+    }
+
+    buf->offset     = 0;
+    buf->len        = hw_radio_receive_raw(buf->data, PACKET_BUF_SIZE);
+    buf->rssi       = hw_radio_read_rssi();
+    buf->snr_x4     = hw_radio_read_snr();
+    buf->rx_time_ms = time_now_ms();
+
+    rx_ring_isr_push(buf);
+
+    if (rx_notify)
+        rx_notify();
+}
+
+// Called from the DIO interrupt after each queued frame, e.g. to wake
+// the task that drains the ring. Must be ISR-safe.
+void radio_set_rx_notify(radio_rx_notify_t fn)
+{
+    rx_notify = fn;
+}
+
+// True while frames queued by the ISR are waiting for the main loop
+bool radio_rx_pending(void)
+{
+    return rx_ring_pending();
+}
+
+/**
+ * Zero-copy receive: the next frame the ISR queued, checked in place.
+ * Frames that fail the length or CRC check are dropped here. On success
+ * the caller owns one reference and data[offset .. offset+len) is the
+ * payload. NULL once nothing valid is waiting.
+ */
+packet_buf_t *radio_receive_buf(void)
 {
+    packet_buf_t *buf;
+
     if (!radio_initialized)
-        return RADIO_ERR_NOT_INITIALIZED;
+        return NULL;
+
+    while ((buf = rx_ring_pop()) != NULL) {
+        uint8_t *frame = buf->data;
+        uint16_t len = buf->len;
+
+        rx_ring_refill();
+
+        // Shorter than header plus CRC: the length bytes are not there
+        if (len < 6) {
+            packet_buf_release(buf);
+            continue;
+        }
+
+        uint16_t plen = (frame[2] << 8) | frame[3];
+        if (plen + 6 != len ||
+            ((frame[len-2] << 8) | frame[len-1]) != crc16_compute(frame, len-2)) {
+            packet_buf_release(buf);
+            continue;
+        }
+
+        buf->offset = PACKET_BUF_HEADROOM;
+        buf->len    = plen;
+
+        last_status = RADIO_STATUS_RX;
+        return buf;
+    }
+
+    return NULL;
+}
+
+void radio_set_receive_callback(radio_rx_callback_t cb)
+{
+    rx_callback = cb;
+}
+
+/**
+ * Hand every frame the ISR queued to the registered receiver
+ * (mesh_protocol.c). The receiver borrows the buffer; anything it queued
+ * for forwarding holds its own reference.
+ */
+void radio_poll_receive(void)
+{
+    packet_buf_t *buf;
+
+    while ((buf = radio_receive_buf()) != NULL) {
+        if (rx_callback != NULL)
+            rx_callback(buf);
+        packet_buf_release(buf);
+    }
+
+    // Buffers the receiver kept leave the ring short; top it up again
+    rx_ring_refill();
+}
 
-    uint8_t buffer[MAX_RADIO_PACKET_SIZE];
-    uint16_t len = hw_radio_receive_raw(buffer, MAX_RADIO_PACKET_SIZE);
+// ---------------------------------------------------------------------------
+// Link Quality Estimation
+// ---------------------------------------------------------------------------
+
+// Weakest decodable SNR at the configured spreading factor (-7.5 dB at
+// SF7, 2.5 dB lower per step), in 0.25 dB steps
+#define LINK_SNR_FLOOR_X4       (-30 - 10 * (LORA_SPREADING_FACTOR - 7))
 
-    if (len < 6)
-        return RADIO_ERR_BAD_PACKET;
+// Sensitivity at 125 kHz, used when no SNR was reported
+#define LINK_RSSI_FLOOR_DBM     (-123 - 3 * (LORA_SPREADING_FACTOR - 7))
 
-    uint8_t version = buffer[0];
-    uint8_t type    = buffer[1];
-    uint16_t plen   = (buffer[2] << 8) | buffer[3];
+// Margin over the floor (dB) where the signal-based delivery guess is
+// 0% and 100%
+#define LINK_MARGIN_ZERO_DB     (-2)
+#define LINK_MARGIN_FULL_DB     6
 
-    if (plen + 6 != len)
-        return RADIO_ERR_BAD_LENGTH;
+// Weight of the signal-based guess, in delivery outcomes
+#define LINK_PRIOR_WEIGHT       4
+
+// Below this delivery ratio (x256) a link is unusable
+#define LINK_DELIVERY_MIN_X256  16
+
+void radio_link_add_signal(radio_link_history_t *h, int8_t rssi, int8_t snr_x4)
+{
+    h->rssi[h->next]   = rssi;
+    h->snr_x4[h->next] = snr_x4;
+    h->next = (uint8_t)((h->next + 1) % RADIO_LINK_SAMPLES);
+    if (h->samples < RADIO_LINK_SAMPLES)
+        h->samples++;
+}
+
+// One expected frame (e.g. a neighbor's heartbeat) that did or did not arrive
+void radio_link_add_outcome(radio_link_history_t *h, bool delivered)
+{
+    h->delivered = (uint16_t)((h->delivered << 1) | (delivered ? 1 : 0));
+    if (h->outcomes < RADIO_LINK_OUTCOMES)
+        h->outcomes++;
+}
+
+// Delivery guess (x256) from the average SNR margin, or RSSI margin
+// if the radio reported no SNR
+static int32_t link_signal_prior(const radio_link_history_t *h)
+{
+    int32_t snr_sum = 0, rssi_sum = 0;
+    uint8_t snr_n = 0;
+
+    if (h->samples == 0)
+        return 0;
+
+    for (uint8_t i = 0; i < h->samples; i++) {
+        rssi_sum += h->rssi[i];
+        if (h->snr_x4[i] != RADIO_SNR_UNKNOWN) {
+            snr_sum += h->snr_x4[i];
+            snr_n++;
+        }
+    }
+
+    int32_t margin_x4 = snr_n ? snr_sum / snr_n - LINK_SNR_FLOOR_X4
+                              : (rssi_sum / h->samples - LINK_RSSI_FLOOR_DBM) * 4;
+    int32_t prior = (margin_x4 - LINK_MARGIN_ZERO_DB * 4) * 256 /
+                    ((LINK_MARGIN_FULL_DB - LINK_MARGIN_ZERO_DB) * 4);
+
+    return prior < 0 ? 0 : (prior > 256 ? 256 : prior);
+}
+
+/**
+ * ETX estimate for one link. The delivery ratio is the share of
+ * expected frames that arrived, blended with a guess from signal
+ * margin so a link heard only a few times is not taken as perfect.
+ * Heartbeats carry no reverse-direction ratio, so the link is assumed
+ * symmetric: ETX = 1 / d².
+ */
+void radio_compute_link_quality(const radio_link_history_t *h, radio_link_estimate_t *out)
+{
+    uint16_t mask = (h->outcomes >= 16) ? 0xFFFF : (uint16_t)((1u << h->outcomes) - 1);
+    int32_t  ok   = __builtin_popcount(h->delivered & mask);
+    int32_t  d    = (ok * 256 + link_signal_prior(h) * LINK_PRIOR_WEIGHT) /
+                    (h->outcomes + LINK_PRIOR_WEIGHT);
 
-    uint16_t received_crc = (buffer[len-2] << 8) | buffer[len-1];
-    uint16_t computed_crc = crc16_compute(buffer, len-2);
+    out->delivery_x256 = (uint8_t)(d > 255 ? 255 : d);
 
-    if (received_crc != computed_crc)
-        return RADIO_ERR_CRC_MISMATCH;
+    if (d < LINK_DELIVERY_MIN_X256) {
+        out->etx_x16 = RADIO_ETX_INFINITE;
+        out->quality = 0;
+        return;
+    }
 
-    out_packet->version = version;
-    out_packet->msg_type = type;
-    out_packet->payload_len = plen;
-    memcpy(out_packet->payload, &buffer[4], plen);
+    uint32_t etx = (16UL << 16) / (uint32_t)(d * d);
+    out->etx_x16 = (uint16_t)(etx >= RADIO_ETX_INFINITE ? RADIO_ETX_INFINITE - 1 : etx);
 
-    last_status = RADIO_STATUS_RX;
-    return RADIO_STATUS_OK;
+    uint32_t q = 4096UL / out->etx_x16;
+    out->quality = (uint8_t)(q > 255 ? 255 : q);
 }
 
 // ---------------------------------------------------------------------------
@@ -3,17 +3,60 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "packet_pool.h"
+
+typedef enum {
+    RADIO_STATUS_IDLE = 0,
+    RADIO_STATUS_TX,
+    RADIO_STATUS_RX,
+    RADIO_STATUS_SLEEP
+} radio_status_t;
+
+// Borrows buf for the duration of the call; retain it to keep it longer
+typedef void (*radio_rx_callback_t)(packet_buf_t *buf);
+
+// Runs in interrupt context once a received frame is queued
+typedef void (*radio_rx_notify_t)(void);
+
+// Link history, kept per neighbor by mesh_neighbor_table.c
+#define RADIO_LINK_SAMPLES     8          // RSSI/SNR samples kept
+#define RADIO_LINK_OUTCOMES    16         // delivery outcomes kept
+#define RADIO_SNR_UNKNOWN      INT8_MIN
+#define RADIO_ETX_INFINITE     0xFFFF
 
 typedef struct {
-    uint8_t *data;
-    uint16_t length;
-    uint8_t rssi;
-} radio_packet_t;
+    int8_t   rssi[RADIO_LINK_SAMPLES];    // dBm
+    int8_t   snr_x4[RADIO_LINK_SAMPLES];  // 0.25 dB steps, or RADIO_SNR_UNKNOWN
+    uint8_t  next;                        // ring position of the next sample
+    uint8_t  samples;                     // valid samples
+    uint16_t delivered;                   // bit per expected frame, newest in bit 0
+    uint8_t  outcomes;                    // valid bits in delivered
+} radio_link_history_t;
+
+typedef struct {
+    uint16_t etx_x16;                     // expected transmissions ×16, 16 = perfect
+    uint8_t  quality;                     // 0 = unusable .. 255
+    uint8_t  delivery_x256;               // estimated one-way delivery ratio
+} radio_link_estimate_t;
 
 void radio_init(void);
-bool radio_send(const uint8_t *data, uint16_t length);
-bool radio_receive(radio_packet_t *packet);
+bool radio_send(uint8_t msg_type, const uint8_t *data, uint16_t len);
+bool radio_send_buf(uint8_t msg_type, packet_buf_t *buf);
+packet_buf_t *radio_receive_buf(void);
+void radio_set_receive_callback(radio_rx_callback_t cb);
+void radio_poll_receive(void);
+bool radio_rx_pending(void);
+void radio_dio_isr(void);
+void radio_set_rx_notify(radio_rx_notify_t fn);
 void radio_set_frequency(uint32_t freq_hz);
 void radio_set_power(uint8_t power_level);
+uint8_t radio_get_channel(void);
+void radio_sleep(void);
+void radio_wake(void);
+radio_status_t radio_get_status(void);
+
+void radio_link_add_signal(radio_link_history_t *h, int8_t rssi, int8_t snr_x4);
+void radio_link_add_outcome(radio_link_history_t *h, bool delivered);
+void radio_compute_link_quality(const radio_link_history_t *h, radio_link_estimate_t *out);
 
 #endif
@@ -0,0 +1,143 @@
+/**
+ * radio_rx_ring.c
+ * ---------------------------------------------------------
+ * Seed Device Firmware — Radio RX Ring (ISR → main loop)
+ *
+ * Purpose:
+ *   - Lets the radio's RX-done (DIO) interrupt move each frame
+ *     out of the FIFO immediately, so a burst of sync
+ *     responses is not lost while the main loop sleeps.
+ *   - Hands the frames to the main loop in arrival order.
+ *
+ * Design:
+ *   - Two single-producer/single-consumer rings of packet_pool
+ *     buffers, no locks and no interrupt masking:
+ *       spare: main loop → ISR   (empty buffers to fill)
+ *       ready: ISR → main loop   (received frames)
+ *   - The pool itself is main-loop only, so the main loop keeps
+ *     the spare ring topped up and the ISR never allocates.
+ *   - At most RX_RING_SLOTS buffers are in either ring at once,
+ *     so the ready ring cannot overflow; when no spare buffer
+ *     is left the ISR discards the frame and counts the drop.
+ *
+ * NOTE:
+ *   Each ring index is written by one side only. The barrier
+ *   orders the slot write before the index update; on a
+ *   single-core MCU that is all the ISR/main hand-off needs.
+ * ---------------------------------------------------------
+ */
+
+#include "radio_rx_ring.h"
+#include <string.h>
+
+#define RING_MASK       (RX_RING_SLOTS - 1)
+#define RING_PUBLISH()  __sync_synchronize()
+
+// ---------------------------------------------------------------------------
+// Internal Static State
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    packet_buf_t    *slot[RX_RING_SLOTS];
+    volatile uint8_t head;     // written by the producer only
+    volatile uint8_t tail;     // written by the consumer only
+} buf_ring_t;
+
+static buf_ring_t      spare;
+static buf_ring_t      ready;
+static rx_ring_stats_t stats;
+
+// ---------------------------------------------------------------------------
+// Internal Helpers
+// ---------------------------------------------------------------------------
+
+static uint8_t ring_count(const buf_ring_t *r)
+{
+    return (uint8_t)(r->head - r->tail);
+}
+
+static void ring_put(buf_ring_t *r, packet_buf_t *buf)
+{
+    r->slot[r->head & RING_MASK] = buf;
+    RING_PUBLISH();
+    r->head++;
+}
+
+static packet_buf_t *ring_get(buf_ring_t *r)
+{
+    if (r->head == r->tail)
+        return NULL;
+
+    packet_buf_t *buf = r->slot[r->tail & RING_MASK];
+    RING_PUBLISH();
+    r->tail++;
+    return buf;
+}
+
+// ---------------------------------------------------------------------------
+// Main-Loop Side
+// ---------------------------------------------------------------------------
+
+void rx_ring_init(void)
+{
+    memset(&spare, 0, sizeof(spare));
+    memset(&ready, 0, sizeof(ready));
+    memset(&stats, 0, sizeof(stats));
+
+    rx_ring_refill();
+}
+
+/**
+ * Give the ISR buffers to receive into, up to RX_RING_SLOTS in flight.
+ * Call after draining; a short pool only means fewer spares for now.
+ */
+void rx_ring_refill(void)
+{
+    while (ring_count(&spare) + ring_count(&ready) < RX_RING_SLOTS) {
+        packet_buf_t *buf = packet_pool_alloc();
+        if (buf == NULL)
+            break;
+        ring_put(&spare, buf);
+    }
+}
+
+// Oldest received frame, or NULL. The caller owns the reference.
+packet_buf_t *rx_ring_pop(void)
+{
+    return ring_get(&ready);
+}
+
+bool rx_ring_pending(void)
+{
+    return ready.head != ready.tail;
+}
+
+void rx_ring_get_stats(rx_ring_stats_t *out)
+{
+    if (out != NULL)
+        *out = stats;
+}
+
+// ---------------------------------------------------------------------------
+// ISR Side
+// ---------------------------------------------------------------------------
+
+// An empty buffer to receive into, or NULL if the main loop is behind
+packet_buf_t *rx_ring_isr_take_buffer(void)
+{
+    return ring_get(&spare);
+}
+
+void rx_ring_isr_push(packet_buf_t *buf)
+{
+    ring_put(&ready, buf);
+
+    stats.frames_received++;
+    if (ring_count(&ready) > stats.high_water)
+        stats.high_water = ring_count(&ready);
+}
+
+void rx_ring_isr_drop(void)
+{
+    stats.dropped_no_buffer++;
+}
@@ -0,0 +1,31 @@
+#ifndef RADIO_RX_RING_H
+#define RADIO_RX_RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "packet_pool.h"
+
+// RX_RING_SLOTS is set in packet_pool.h, which sizes the pool from it
+#if RX_RING_SLOTS & (RX_RING_SLOTS - 1)
+#error "RX_RING_SLOTS must be a power of two"
+#endif
+
+typedef struct {
+    uint32_t frames_received;     // pushed by the ISR
+    uint32_t dropped_no_buffer;   // frame arrived with no spare buffer
+    uint8_t  high_water;          // most frames waiting at once
+} rx_ring_stats_t;
+
+// Main-loop side
+void          rx_ring_init(void);
+void          rx_ring_refill(void);
+packet_buf_t *rx_ring_pop(void);
+bool          rx_ring_pending(void);
+void          rx_ring_get_stats(rx_ring_stats_t *out);
+
+// ISR side
+packet_buf_t *rx_ring_isr_take_buffer(void);
+void          rx_ring_isr_push(packet_buf_t *buf);
+void          rx_ring_isr_drop(void);
+
+#endif
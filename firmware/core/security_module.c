@@ -20,9 +20,14 @@
 #include <stddef.h>
 #include <string.h>
 
+#include "security_module.h"
 #include "security_config.h"     // high-level security settings (key sizes, flags)
 #include "power_config.h"        // for safe shutdown on wipe, if needed
 #include "device_config.h"       // device_id, region info, etc.
+#include "verify_cache.h"        // remembered signature verdicts
+#include "mesh_dedup.h"          // mesh replay / duplicate filter
+#include "storage_manager.h"     // emergency wipe of the key/value and record store
+#include "ledger_storage.h"      // emergency wipe of the ledger
 
 /* These are implemented elsewhere in firmware or drivers */
 extern bool secure_element_read_device_keys(uint8_t *pub_key_out,
@@ -31,12 +36,12 @@ extern bool secure_element_sign(const uint8_t *msg,
                                 size_t msg_len,
                                 uint8_t *sig_out,
                                 size_t *sig_len_inout);
+extern bool secure_element_verify(const uint8_t *msg,
+                                  size_t msg_len,
+                                  const uint8_t *sig,
+                                  size_t sig_len);
 extern bool secure_element_random_bytes(uint8_t *buf, size_t len);
 
-extern void storage_secure_wipe_ledger(void);
-extern void storage_secure_wipe_user_data(void);
-extern void storage_secure_wipe_keys_shadow(void);
-
 /* -------------------------------------------------------------------------- */
 /*  Types and global state                                                    */
 /* -------------------------------------------------------------------------- */
@@ -45,22 +50,6 @@ extern void storage_secure_wipe_keys_shadow(void);
 #define SEED_PRIVATE_KEY_SIZE  64u    /* Stored only inside secure element */
 #define SEED_SIGNATURE_MAX     64u    /* Max signature length for our scheme */
 
-typedef enum {
-    SECURITY_OK = 0,
-    SECURITY_ERR_INIT = -1,
-    SECURITY_ERR_KEY_LOAD = -2,
-    SECURITY_ERR_SIGN = -3,
-    SECURITY_ERR_VERIFY = -4,
-    SECURITY_ERR_ENCRYPT = -5,
-    SECURITY_ERR_DECRYPT = -6,
-} security_status_t;
-
-typedef enum {
-    SECURITY_EVENT_TAMPER_PHYSICAL = 1,
-    SECURITY_EVENT_TAMPER_FIRMWARE = 2,
-    SECURITY_EVENT_FORCED_EMERGENCY_WIPE = 3,
-} security_event_t;
-
 typedef struct {
     char     device_id[DEVICE_ID_MAX_LEN];             /* from device_config.h */
     uint8_t  public_key[SEED_PUBLIC_KEY_SIZE];         /* used to identify device to mesh */
@@ -119,8 +108,10 @@ security_status_t security_init(void)
 {
     memset(&g_sec_state, 0, sizeof(g_sec_state));
 
-    /* Load device ID from static configuration */
-    (void)device_config_get_id(g_sec_state.device_id, sizeof(g_sec_state.device_id));
+    /* Load device ID from static configuration (fixed width, not
+     * NUL-terminated when it fills the field) */
+    memcpy(g_sec_state.device_id, DEVICE_SERIAL_NUMBER,
+           strnlen(DEVICE_SERIAL_NUMBER, sizeof(g_sec_state.device_id)));
 
     /* Load keys from secure element (public + private placeholder) */
     if (!secure_element_read_device_keys(g_sec_state.public_key,
@@ -139,6 +130,20 @@ security_status_t security_init(void)
     /* Clear tamper flag at boot; hardware tamper lines would set this later */
     g_sec_state.tamper_detected = false;
 
+    /* Fresh per-boot keys for the signature verdict cache and the mesh
+     * duplicate filter, so peers cannot precompute entries that collide
+     * with them.
+     */
+    uint8_t cache_key[VERIFY_CACHE_KEY_LEN];
+    (void)secure_element_random_bytes(cache_key, sizeof(cache_key));
+    verify_cache_init(cache_key);
+
+    uint8_t dedup_key[MESH_DEDUP_KEY_LEN];
+    (void)secure_element_random_bytes(dedup_key, sizeof(dedup_key));
+    mesh_dedup_init(dedup_key);
+    secure_memzero(cache_key, sizeof(cache_key));
+    secure_memzero(dedup_key, sizeof(dedup_key));
+
     /* Immediately zero out the private key shadow in RAM.
      * Real signing operations should use the secure element directly.
      */
@@ -183,6 +188,69 @@ security_status_t security_sign_message(const uint8_t *msg,
     return SECURITY_OK;
 }
 
+/**
+ * @brief Fixed-size signature for data the device signs for itself
+ *        (ledger checkpoints). Shorter scheme output is zero-padded.
+ *
+ * Goes straight to the secure element, which holds the key whether or
+ * not security_init() has loaded the public half yet: storage mounts
+ * and verifies its checkpoint early in boot.
+ */
+bool security_sign(const uint8_t *msg, uint16_t len, uint8_t *sig_out)
+{
+    size_t sig_len = SEED_SIGNATURE_MAX;
+
+    if (msg == NULL || sig_out == NULL) {
+        return false;
+    }
+
+    memset(sig_out, 0, SEED_SIGNATURE_MAX);
+    return secure_element_sign(msg, len, sig_out, &sig_len);
+}
+
+bool security_verify(const uint8_t *msg, uint16_t len, const uint8_t *sig)
+{
+    if (msg == NULL || sig == NULL) {
+        return false;
+    }
+
+    return secure_element_verify(msg, len, sig, SEED_SIGNATURE_MAX);
+}
+
+/**
+ * @brief Sign a mesh frame body in place: the signature is appended
+ *        after data[0 .. *len) and *len grows by SEED_SIGNATURE_MAX.
+ *
+ * Fails if the signed frame would not fit max_len.
+ */
+bool security_sign_packet(uint8_t *data, uint8_t *len, uint8_t max_len)
+{
+    if (data == NULL || len == NULL || *len + SEED_SIGNATURE_MAX > max_len) {
+        return false;
+    }
+
+    if (!security_sign(data, *len, &data[*len])) {
+        return false;
+    }
+
+    *len = (uint8_t)(*len + SEED_SIGNATURE_MAX);
+    return true;
+}
+
+/**
+ * @brief Check a body signed by security_sign_packet(); len includes
+ *        the trailing signature.
+ */
+bool security_verify_packet(const uint8_t *data, uint8_t len)
+{
+    if (data == NULL || len < SEED_SIGNATURE_MAX) {
+        return false;
+    }
+
+    return security_verify(data, (uint16_t)(len - SEED_SIGNATURE_MAX),
+                           &data[len - SEED_SIGNATURE_MAX]);
+}
+
 /**
  * @brief Very simple placeholder "encryption" API.
  *
@@ -293,13 +361,15 @@ void security_emergency_wipe(void)
     /* Flag so future boots know an emergency wipe occurred. */
     g_sec_state.tamper_detected = true;
 
-    /* Wipe application-level data first. */
-    storage_secure_wipe_ledger();
-    storage_secure_wipe_user_data();
-    storage_secure_wipe_keys_shadow();
+    /* Wipe application-level data first. The storage manager region
+     * also holds the user key/value data and any key shadows.
+     */
+    (void)ledger_storage_secure_erase();
+    (void)storage_emergency_wipe();
 
     /* Zero any in-RAM sensitive material. */
     secure_memzero(&g_sec_state, sizeof(g_sec_state));
+    verify_cache_clear();
 
     /* In a real device, we might:
      *  - force a reboot
@@ -3,11 +3,49 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
-void security_init(void);
+typedef enum {
+    SECURITY_OK = 0,
+    SECURITY_ERR_INIT = -1,
+    SECURITY_ERR_KEY_LOAD = -2,
+    SECURITY_ERR_SIGN = -3,
+    SECURITY_ERR_VERIFY = -4,
+    SECURITY_ERR_ENCRYPT = -5,
+    SECURITY_ERR_DECRYPT = -6,
+} security_status_t;
+
+typedef enum {
+    SECURITY_EVENT_TAMPER_PHYSICAL = 1,
+    SECURITY_EVENT_TAMPER_FIRMWARE = 2,
+    SECURITY_EVENT_FORCED_EMERGENCY_WIPE = 3,
+} security_event_t;
+
+security_status_t security_init(void);
 bool security_generate_keypair(void);
+const uint8_t *security_get_public_key(void);
+
+// Fixed-size (SIG_LEN) device signatures, e.g. over ledger checkpoints
 bool security_sign(const uint8_t *msg, uint16_t len, uint8_t *sig_out);
 bool security_verify(const uint8_t *msg, uint16_t len, const uint8_t *sig);
+
+// Mesh frame bodies: the signature is appended after the signed bytes
+bool security_sign_packet(uint8_t *data, uint8_t *len, uint8_t max_len);
+bool security_verify_packet(const uint8_t *data, uint8_t len);
+
+security_status_t security_sign_message(const uint8_t *msg, size_t msg_len,
+                                        uint8_t *sig_out, size_t *sig_len_inout);
+security_status_t security_encrypt_blob(const uint8_t *plaintext, size_t plaintext_len,
+                                        uint8_t *ciphertext_out, size_t *ciphertext_len_inout);
+security_status_t security_decrypt_blob(const uint8_t *ciphertext, size_t ciphertext_len,
+                                        uint8_t *plaintext_out, size_t *plaintext_len_inout);
+
+void security_handle_event(security_event_t event);
+void security_emergency_wipe(void);
 bool security_wipe_all_keys(void);
 
+bool security_is_tampered(void);
+bool security_boot_was_secure(void);
+uint32_t security_get_boot_counter(void);
+
 #endif
@@ -28,12 +28,28 @@
  *      – SPI flash chips
  *      – Secure Element sidecar storage
  *
+ *  On-Flash Layout (log-structured):
+ *      [ log segments × SEGMENT_COUNT ][ checkpoint slots ][ tx index ]
+ *      Each segment and checkpoint slot starts with a header carrying a
+ *      sequence number; boot scans them and resumes from the newest
+ *      valid one. No header is rewritten per record.
+ *
+ *  Compaction:
+ *      A checkpoint records how many log records it covers. Once the ring
+ *      runs low on free segments, storage_compact_step() reclaims the
+ *      oldest segment if a checkpoint covers all of it, one erase block
+ *      per call. Erasing the segment's header block is the commit point.
+ *
+ *  bench/storage_manager_bench.c measures write amplification and
+ *  erase wear on the flash simulator and checks torn-write recovery.
+ *
  * ============================================================================
  */
 
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
+#include <stddef.h>
 #include "storage_manager.h"
 #include "security_module.h"
 #include "safe_memory.h"
@@ -43,10 +59,39 @@
  *  CONFIGURATION CONSTANTS
  * ------------------------------------------------------------------------- */
 
-#define MAX_LEDGER_RECORDS        2048
-#define LEDGER_PAGE_SIZE_BYTES    512
-#define STORAGE_MAGIC_HEADER      0x53534431   // "SSD1" = Seed Storage v1
+#define RECORD_MAX_BYTES          512          // largest payload one record can carry
+#define STORAGE_MAGIC_HEADER      0x53534432   // "SSD2" = Seed Storage v2 (log-structured)
 #define CHECKPOINT_INTERVAL       20           // Write checkpoint every 20 txs
+#define CHECKPOINT_REGION_BYTES   16384        // Max size of one ledger checkpoint
+
+// Erase-block size of the flash behind hal_storage_*. Every region below
+// starts on a block boundary so it can be erased without touching others.
+#define STORAGE_BLOCK_BYTES       4096
+
+// Log area: a ring of segments, each opened by erasing it and writing a
+// header with the next sequence number. Records are length-prefixed and
+// packed back to back into erased flash, so nothing is rewritten in place.
+#define SEGMENT_BLOCKS            8
+#define SEGMENT_BYTES             (SEGMENT_BLOCKS * STORAGE_BLOCK_BYTES)
+#define SEGMENT_COUNT             34
+#define SPARSE_STEP               16           // records between RAM offset hints
+#define SPARSE_SLOTS              32           // caps a segment at 512 records
+#define COMPACT_FREE_SEGMENTS     4            // reclaim when fewer are free
+
+// Checkpoint area: a ring of slots; each checkpoint goes to the next one
+#define CHECKPOINT_SLOT_BLOCKS    5            // header + CHECKPOINT_REGION_BYTES
+#define CHECKPOINT_SLOT_BYTES     (CHECKPOINT_SLOT_BLOCKS * STORAGE_BLOCK_BYTES)
+#define CHECKPOINT_SLOT_COUNT     4
+
+// Reserved region for the ledger's transaction-ID hash index. Slots are
+// programmed in place from the erased state, so inserts never need an
+// erase; the region is only erased when the index is rebuilt.
+#define TX_INDEX_REGION_BYTES     135168       // 128 KB of slots + header sector
+
+#define LOG_REGION_ADDR           0
+#define CHECKPOINT_REGION_ADDR    (LOG_REGION_ADDR + SEGMENT_COUNT * SEGMENT_BYTES)
+#define TX_INDEX_REGION_ADDR      (CHECKPOINT_REGION_ADDR + CHECKPOINT_SLOT_COUNT * CHECKPOINT_SLOT_BYTES)
+#define STORAGE_LAYOUT_BYTES      (TX_INDEX_REGION_ADDR + TX_INDEX_REGION_BYTES)
 
 /* ---------------------------------------------------------------------------
  *  DATA STRUCTURES
@@ -54,105 +99,362 @@
 
 typedef struct {
     uint32_t magic;         // detects corruption
-    uint32_t version;       // storage schema version
-    uint32_t record_count;  // number of valid ledger entries
+    uint32_t sequence;      // increases by one per opened segment
+    uint32_t first_record;  // logical index of the segment's first slot
+    uint16_t crc;           // integrity check of header
+} segment_header_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t sequence;      // increases by one per checkpoint written
+    uint32_t size;          // payload bytes following the header
+    uint32_t record_count;  // log records this checkpoint covers
+    uint16_t data_crc;
     uint16_t crc;           // integrity check of header
-} storage_header_t;
+} checkpoint_header_t;
 
+// Precedes each record's payload; an erased length ends the segment
 typedef struct {
-    uint8_t encrypted_data[LEDGER_PAGE_SIZE_BYTES];
-    uint16_t crc;
-} storage_page_t;
+    uint16_t length;        // payload bytes that follow
+    uint16_t crc;           // over the payload
+} record_header_t;
+
+#define RECORD_ERASED_LENGTH      0xFFFF
+#define SEGMENT_DATA_BYTES        (SEGMENT_BYTES - sizeof(segment_header_t))
+#define SEGMENT_MAX_RECORDS       (SPARSE_STEP * SPARSE_SLOTS)
+
+// RAM copy of each segment header, rebuilt at mount
+typedef struct {
+    bool     valid;
+    bool     sealed;        // no more appends: full or a torn length
+    uint8_t  clean_blocks;  // free segments: leading blocks known erased
+    uint16_t records;
+    uint16_t used;          // bytes used after the header
+    uint32_t sequence;
+    uint32_t first_record;
+    uint16_t sparse[SPARSE_SLOTS];   // offset of every SPARSE_STEP-th record
+} segment_info_t;
 
 /* ---------------------------------------------------------------------------
  *  STATIC STATE
  * ------------------------------------------------------------------------- */
 
-static storage_header_t header_cache;
+static segment_info_t segments[SEGMENT_COUNT];
+static uint8_t  head_segment = 0;          // segment currently being filled
+static uint8_t  tail_segment = 0;          // oldest live segment
+static uint32_t record_count = 0;
+static uint32_t checkpoint_sequence = 0;   // newest valid checkpoint (0 = none)
+static uint8_t  checkpoint_slot = 0;
+static uint32_t checkpoint_covers = 0;     // records covered by that checkpoint
 static uint32_t tx_since_last_checkpoint = 0;
+static storage_stats_t stats;
 
 /* ---------------------------------------------------------------------------
  *  HARDWARE ABSTRACTION LAYER (DEVICE-SPECIFIC IMPLEMENTATION)
  *
- *  These functions must be implemented per hardware target. For the MVP,
- *  they may be file-backed or simulated.
+ *  These functions must be implemented per hardware target. For host
+ *  builds, drivers/flash_sim.c provides them on a simulated chip.
  * ------------------------------------------------------------------------- */
 
 bool hal_storage_read(uint32_t addr, void *buffer, uint32_t size);
 bool hal_storage_write(uint32_t addr, const void *buffer, uint32_t size);
 bool hal_storage_erase(void);
+bool hal_storage_erase_region(uint32_t addr, uint32_t size);
 uint32_t hal_storage_total_size(void);
 
 /* ---------------------------------------------------------------------------
  *  INTERNAL FUNCTIONS
  * ------------------------------------------------------------------------- */
 
-static bool validate_header(storage_header_t *hdr) {
-    uint16_t computed_crc = crc16_compute((uint8_t *)hdr, sizeof(storage_header_t) - sizeof(uint16_t));
-    return (computed_crc == hdr->crc && hdr->magic == STORAGE_MAGIC_HEADER);
+static bool flash_write(uint32_t addr, const void *buffer, uint32_t size) {
+    if (!hal_storage_write(addr, buffer, size)) {
+        return false;
+    }
+    stats.flash_bytes_written += size;
+    return true;
 }
 
-static void update_header_crc(storage_header_t *hdr) {
-    hdr->crc = crc16_compute((uint8_t *)hdr, sizeof(storage_header_t) - sizeof(uint16_t));
+static bool flash_erase(uint32_t addr, uint32_t size) {
+    if (!hal_storage_erase_region(addr, size)) {
+        return false;
+    }
+    stats.flash_bytes_erased += size;
+    return true;
 }
 
-/* ---------------------------------------------------------------------------
- *  INITIALIZATION
- * ------------------------------------------------------------------------- */
+static uint16_t segment_header_crc(const segment_header_t *hdr) {
+    return crc16_compute((const uint8_t *)hdr, offsetof(segment_header_t, crc));
+}
 
-bool storage_init() {
-    if (!hal_storage_read(0, &header_cache, sizeof(storage_header_t))) {
+static uint16_t checkpoint_header_crc(const checkpoint_header_t *hdr) {
+    return crc16_compute((const uint8_t *)hdr, offsetof(checkpoint_header_t, crc));
+}
+
+static uint32_t segment_addr(uint8_t segment) {
+    return LOG_REGION_ADDR + (uint32_t)segment * SEGMENT_BYTES;
+}
+
+static uint32_t data_addr(uint8_t segment, uint32_t offset) {
+    return segment_addr(segment) + sizeof(segment_header_t) + offset;
+}
+
+static uint32_t checkpoint_slot_addr(uint8_t slot) {
+    return CHECKPOINT_REGION_ADDR + (uint32_t)slot * CHECKPOINT_SLOT_BYTES;
+}
+
+/**
+ * Erase a segment and stamp it with the next sequence number. The
+ * header is the commit point: a power cut before it leaves the
+ * segment looking free.
+ */
+static bool open_segment(uint8_t segment, uint32_t sequence, uint32_t first_record) {
+    segments[segment].valid = false;
+
+    // Blocks already erased by the compactor are not erased again
+    uint32_t clean = segments[segment].clean_blocks * STORAGE_BLOCK_BYTES;
+    if (clean < SEGMENT_BYTES &&
+        !flash_erase(segment_addr(segment) + clean, SEGMENT_BYTES - clean)) {
         return false;
     }
 
-    if (!validate_header(&header_cache)) {
-        // Storage is empty or corrupted — reinitialize.
-        memset(&header_cache, 0, sizeof(header_cache));
-        header_cache.magic = STORAGE_MAGIC_HEADER;
-        header_cache.version = 1;
-        header_cache.record_count = 0;
-        update_header_crc(&header_cache);
+    segment_header_t hdr;
+    memset(&hdr, 0xFF, sizeof(hdr));
+    hdr.magic = STORAGE_MAGIC_HEADER;
+    hdr.sequence = sequence;
+    hdr.first_record = first_record;
+    hdr.crc = segment_header_crc(&hdr);
 
-        return hal_storage_write(0, &header_cache, sizeof(header_cache));
+    if (!flash_write(segment_addr(segment), &hdr, sizeof(hdr))) {
+        return false;
     }
 
+    memset(&segments[segment], 0, sizeof(segments[segment]));
+    segments[segment].valid = true;
+    segments[segment].sequence = sequence;
+    segments[segment].first_record = first_record;
+    head_segment = segment;
+    stats.segments_opened++;
     return true;
 }
 
+static bool record_fits(const segment_info_t *seg, uint32_t length) {
+    return !seg->sealed && seg->records < SEGMENT_MAX_RECORDS &&
+           seg->used + sizeof(record_header_t) + length <= SEGMENT_DATA_BYTES;
+}
+
+/**
+ * Walk a segment's length prefixes to count its records and rebuild
+ * the offset hints. A record whose payload was torn still occupies
+ * its space (its CRC rejects it on read), so the log resumes after
+ * it. A torn length cannot be skipped, so it seals the segment.
+ */
+static void scan_segment(uint8_t segment) {
+    segment_info_t *seg = &segments[segment];
+    record_header_t rec;
+
+    seg->records = 0;
+    seg->used = 0;
+    seg->sealed = false;
+
+    while (seg->records < SEGMENT_MAX_RECORDS &&
+           seg->used + sizeof(rec) <= SEGMENT_DATA_BYTES) {
+        if (!hal_storage_read(data_addr(segment, seg->used), &rec, sizeof(rec)) ||
+            rec.length == RECORD_ERASED_LENGTH) {
+            return;
+        }
+        if (rec.length > RECORD_MAX_BYTES ||
+            seg->used + sizeof(rec) + rec.length > SEGMENT_DATA_BYTES) {
+            seg->sealed = true;
+            return;
+        }
+
+        if (seg->records % SPARSE_STEP == 0) {
+            seg->sparse[seg->records / SPARSE_STEP] = seg->used;
+        }
+        seg->records++;
+        seg->used += sizeof(rec) + rec.length;
+    }
+}
+
+static void mount_checkpoints(void) {
+    checkpoint_header_t hdr;
+
+    checkpoint_sequence = 0;
+    checkpoint_slot = 0;
+    checkpoint_covers = 0;
+
+    for (uint8_t slot = 0; slot < CHECKPOINT_SLOT_COUNT; slot++) {
+        if (!hal_storage_read(checkpoint_slot_addr(slot), &hdr, sizeof(hdr))) {
+            continue;
+        }
+        if (hdr.magic != STORAGE_MAGIC_HEADER || checkpoint_header_crc(&hdr) != hdr.crc) {
+            continue;
+        }
+        if (hdr.sequence > checkpoint_sequence) {
+            checkpoint_sequence = hdr.sequence;
+            checkpoint_slot = slot;
+            checkpoint_covers = hdr.record_count;
+        }
+    }
+}
+
+/**
+ * Rebuild the RAM segment table from the on-flash headers and resume
+ * appending after the newest one.
+ */
+static bool mount(void) {
+    segment_header_t hdr;
+    bool found = false;
+    uint32_t newest = 0;
+    uint32_t oldest = 0;
+
+    for (uint8_t s = 0; s < SEGMENT_COUNT; s++) {
+        memset(&segments[s], 0, sizeof(segments[s]));
+
+        if (!hal_storage_read(segment_addr(s), &hdr, sizeof(hdr))) {
+            return false;
+        }
+        if (hdr.magic != STORAGE_MAGIC_HEADER || segment_header_crc(&hdr) != hdr.crc) {
+            continue;
+        }
+
+        segments[s].valid = true;
+        segments[s].sequence = hdr.sequence;
+        segments[s].first_record = hdr.first_record;
+
+        if (!found || hdr.sequence > newest) {
+            newest = hdr.sequence;
+            head_segment = s;
+        }
+        if (!found || hdr.sequence < oldest) {
+            oldest = hdr.sequence;
+            tail_segment = s;
+        }
+        found = true;
+    }
+
+    mount_checkpoints();
+
+    if (!found) {
+        // Empty or foreign flash — start a new log
+        record_count = 0;
+        tail_segment = 0;
+        return open_segment(0, 1, 0);
+    }
+
+    for (uint8_t s = 0; s < SEGMENT_COUNT; s++) {
+        if (segments[s].valid) {
+            scan_segment(s);
+        }
+    }
+
+    record_count = segments[head_segment].first_record + segments[head_segment].records;
+    return true;
+}
+
+/**
+ * Find a logical record: jump to the nearest offset hint of its
+ * segment, then hop over at most SPARSE_STEP - 1 length prefixes.
+ */
+static bool locate_record(uint32_t index, uint8_t *segment_out, uint32_t *offset_out) {
+    for (uint8_t s = 0; s < SEGMENT_COUNT; s++) {
+        const segment_info_t *seg = &segments[s];
+        if (!seg->valid) continue;
+
+        uint32_t n = index - seg->first_record;
+        if (index < seg->first_record || n >= seg->records) continue;
+
+        uint32_t offset = seg->sparse[n / SPARSE_STEP];
+        record_header_t rec;
+
+        for (uint32_t hop = 0; hop < n % SPARSE_STEP; hop++) {
+            if (!hal_storage_read(data_addr(s, offset), &rec, sizeof(rec)) ||
+                rec.length > RECORD_MAX_BYTES) {
+                return false;
+            }
+            offset += sizeof(rec) + rec.length;
+        }
+
+        *segment_out = s;
+        *offset_out = offset;
+        return true;
+    }
+    return false;
+}
+
 /* ---------------------------------------------------------------------------
- *  LEDGER OPERATIONS
+ *  INITIALIZATION
  * ------------------------------------------------------------------------- */
 
-bool storage_append_record(const uint8_t *encrypted_record) {
-    if (header_cache.record_count >= MAX_LEDGER_RECORDS) {
-        return false;  // storage full — future versions will implement compaction
+bool storage_init() {
+    if (hal_storage_total_size() < STORAGE_LAYOUT_BYTES) {
+        return false;
     }
 
-    storage_page_t page = {0};
-    memcpy(page.encrypted_data, encrypted_record, LEDGER_PAGE_SIZE_BYTES);
-    page.crc = crc16_compute(page.encrypted_data, LEDGER_PAGE_SIZE_BYTES);
+    memset(&stats, 0, sizeof(stats));
+    tx_since_last_checkpoint = 0;
+    return mount();
+}
 
-    uint32_t addr = sizeof(storage_header_t)
-                    + header_cache.record_count * sizeof(storage_page_t);
+/* ---------------------------------------------------------------------------
+ *  LEDGER OPERATIONS
+ * ------------------------------------------------------------------------- */
 
-    if (!hal_storage_write(addr, &page, sizeof(storage_page_t))) {
+bool storage_append_record(const uint8_t *data, uint16_t length) {
+    if (data == NULL || length == 0 || length > RECORD_MAX_BYTES) {
         return false;
     }
 
-    header_cache.record_count++;
-    update_header_crc(&header_cache);
-    hal_storage_write(0, &header_cache, sizeof(header_cache));
+    if (!record_fits(&segments[head_segment], length)) {
+        uint8_t next = (uint8_t)((head_segment + 1) % SEGMENT_COUNT);
+
+        if (segments[next].valid) {
+            return false;  // ring full — compaction has not caught up
+        }
+        if (!open_segment(next, segments[head_segment].sequence + 1, record_count)) {
+            return false;
+        }
+    }
+
+    segment_info_t *seg = &segments[head_segment];
+    record_header_t rec;
+    rec.length = length;
+    rec.crc = crc16_compute(data, length);
+
+    // The space and index are consumed even if the program fails part-way
+    uint32_t addr = data_addr(head_segment, seg->used);
+    if (seg->records % SPARSE_STEP == 0) {
+        seg->sparse[seg->records / SPARSE_STEP] = seg->used;
+    }
+    seg->records++;
+    seg->used += sizeof(rec) + length;
+    record_count++;
+
+    // Length first: a cut before the payload leaves a CRC failure
+    if (!flash_write(addr, &rec, sizeof(rec)) ||
+        !flash_write(addr + sizeof(rec), data, length)) {
+        seg->sealed = true;
+        return false;
+    }
 
+    stats.records_appended++;
+    stats.payload_bytes += length;
     tx_since_last_checkpoint++;
 
     return true;
 }
 
+uint32_t storage_record_count() {
+    return record_count;
+}
+
 /* ---------------------------------------------------------------------------
  *  CHECKPOINTING
  *
  *  A checkpoint is a compressed snapshot of the ledger state that speeds up
- *  boot and ensures recovery after unexpected shutdown.
+ *  boot and ensures recovery after unexpected shutdown. Each one goes to
+ *  the next slot of the checkpoint ring, so the previous checkpoint stays
+ *  intact until the new one is committed by its header.
  * ------------------------------------------------------------------------- */
 
 bool storage_needs_checkpoint() {
@@ -160,43 +462,215 @@ bool storage_needs_checkpoint() {
 }
 
 bool storage_write_checkpoint(const uint8_t *data, uint32_t size) {
-    // In Version 1, checkpoint is appended after ledger pages.
-    uint32_t addr =
-        sizeof(storage_header_t) +
-        MAX_LEDGER_RECORDS * sizeof(storage_page_t);
+    if (size > CHECKPOINT_REGION_BYTES) {
+        return false;
+    }
+
+    uint8_t slot = (checkpoint_sequence == 0)
+                   ? 0
+                   : (uint8_t)((checkpoint_slot + 1) % CHECKPOINT_SLOT_COUNT);
+    uint32_t addr = checkpoint_slot_addr(slot);
 
-    bool ok = hal_storage_write(addr, data, size);
-    if (ok) tx_since_last_checkpoint = 0;
+    if (!flash_erase(addr, CHECKPOINT_SLOT_BYTES)) {
+        return false;
+    }
 
-    return ok;
+    // Payload first, header last: the header commits the checkpoint
+    if (!flash_write(addr + sizeof(checkpoint_header_t), data, size)) {
+        return false;
+    }
+
+    checkpoint_header_t hdr;
+    memset(&hdr, 0xFF, sizeof(hdr));
+    hdr.magic = STORAGE_MAGIC_HEADER;
+    hdr.sequence = checkpoint_sequence + 1;
+    hdr.size = size;
+    hdr.record_count = record_count;
+    hdr.data_crc = crc16_compute(data, (uint16_t)size);
+    hdr.crc = checkpoint_header_crc(&hdr);
+
+    if (!flash_write(addr, &hdr, sizeof(hdr))) {
+        return false;
+    }
+
+    checkpoint_sequence = hdr.sequence;
+    checkpoint_slot = slot;
+    checkpoint_covers = record_count;
+    tx_since_last_checkpoint = 0;
+    stats.checkpoints_written++;
+    stats.payload_bytes += size;
+
+    return true;
+}
+
+/**
+ * Read the newest committed checkpoint. Fails if none exists or its
+ * payload does not match the CRC in its header.
+ */
+bool storage_read_checkpoint(uint8_t *buffer, uint32_t buffer_len, uint32_t *size_out) {
+    if (checkpoint_sequence == 0) {
+        return false;
+    }
+
+    checkpoint_header_t hdr;
+    uint32_t addr = checkpoint_slot_addr(checkpoint_slot);
+
+    if (!hal_storage_read(addr, &hdr, sizeof(hdr))) {
+        return false;
+    }
+    if (hdr.size > buffer_len || hdr.size > CHECKPOINT_REGION_BYTES) {
+        return false;
+    }
+    if (!hal_storage_read(addr + sizeof(hdr), buffer, hdr.size)) {
+        return false;
+    }
+    if (crc16_compute(buffer, (uint16_t)hdr.size) != hdr.data_crc) {
+        return false;
+    }
+
+    if (size_out) *size_out = hdr.size;
+    return true;
 }
 
 /* ---------------------------------------------------------------------------
  *  RETRIEVAL
  * ------------------------------------------------------------------------- */
 
-bool storage_get_record(uint32_t index, uint8_t *out_record) {
-    if (index >= header_cache.record_count) {
+bool storage_get_record(uint32_t index, uint8_t *out_record, uint16_t buffer_len, uint16_t *length_out) {
+    if (index >= record_count) {
+        return false;
+    }
+
+    uint8_t segment;
+    uint32_t offset;
+    if (!locate_record(index, &segment, &offset)) {
         return false;
     }
 
-    storage_page_t page;
-    uint32_t addr = sizeof(storage_header_t) + index * sizeof(storage_page_t);
+    record_header_t rec;
+    if (!hal_storage_read(data_addr(segment, offset), &rec, sizeof(rec)) ||
+        rec.length > RECORD_MAX_BYTES || rec.length > buffer_len) {
+        return false;
+    }
 
-    if (!hal_storage_read(addr, &page, sizeof(storage_page_t))) {
+    if (!hal_storage_read(data_addr(segment, offset) + sizeof(rec), out_record, rec.length)) {
         return false;
     }
 
     // Verify CRC before returning
-    uint16_t computed_crc = crc16_compute(page.encrypted_data, LEDGER_PAGE_SIZE_BYTES);
-    if (computed_crc != page.crc) {
+    if (crc16_compute(out_record, rec.length) != rec.crc) {
         return false;  // corruption detected
     }
 
-    memcpy(out_record, page.encrypted_data, LEDGER_PAGE_SIZE_BYTES);
+    if (length_out != NULL) {
+        *length_out = rec.length;
+    }
+    return true;
+}
+
+/* ---------------------------------------------------------------------------
+ *  TRANSACTION INDEX REGION
+ *
+ *  Raw access to the reserved index area. The layout inside the region is
+ *  owned by ledger_tx_index.c; this module only bounds-checks offsets.
+ * ------------------------------------------------------------------------- */
+
+uint32_t storage_tx_index_region_size() {
+    return TX_INDEX_REGION_BYTES;
+}
+
+bool storage_tx_index_read(uint32_t offset, void *buffer, uint32_t size) {
+    if (offset + size > TX_INDEX_REGION_BYTES) {
+        return false;
+    }
+    return hal_storage_read(TX_INDEX_REGION_ADDR + offset, buffer, size);
+}
+
+bool storage_tx_index_write(uint32_t offset, const void *buffer, uint32_t size) {
+    if (offset + size > TX_INDEX_REGION_BYTES) {
+        return false;
+    }
+    return flash_write(TX_INDEX_REGION_ADDR + offset, buffer, size);
+}
+
+bool storage_tx_index_erase() {
+    return flash_erase(TX_INDEX_REGION_ADDR, TX_INDEX_REGION_BYTES);
+}
+
+/* ---------------------------------------------------------------------------
+ *  COMPACTION
+ *
+ *  Called once per main loop tick. Each call does at most one block
+ *  erase, so it never stalls the UI or radio. Every intermediate state
+ *  is recoverable: a segment whose header block is erased is free at
+ *  the next mount, and its remaining blocks are erased again before
+ *  reuse.
+ * ------------------------------------------------------------------------- */
+
+static uint8_t free_segment_count(void) {
+    uint8_t free_count = 0;
+    for (uint8_t s = 0; s < SEGMENT_COUNT; s++) {
+        if (!segments[s].valid) free_count++;
+    }
+    return free_count;
+}
+
+/**
+ * Returns true if flash work was done.
+ */
+bool storage_compact_step() {
+    // Finish pre-erasing a reclaimed segment first
+    for (uint8_t s = 0; s < SEGMENT_COUNT; s++) {
+        if (segments[s].valid || segments[s].clean_blocks == 0 ||
+            segments[s].clean_blocks >= SEGMENT_BLOCKS) {
+            continue;
+        }
+
+        uint32_t addr = segment_addr(s) + segments[s].clean_blocks * STORAGE_BLOCK_BYTES;
+        if (!flash_erase(addr, STORAGE_BLOCK_BYTES)) {
+            return false;
+        }
+        segments[s].clean_blocks++;
+        return true;
+    }
+
+    if (free_segment_count() >= COMPACT_FREE_SEGMENTS || tail_segment == head_segment) {
+        return false;
+    }
+
+    // Only history that a checkpoint has folded in may go
+    const segment_info_t *tail = &segments[tail_segment];
+    if (tail->first_record + tail->records > checkpoint_covers) {
+        return false;
+    }
+
+    if (!flash_erase(segment_addr(tail_segment), STORAGE_BLOCK_BYTES)) {
+        return false;
+    }
+
+    segments[tail_segment].valid = false;
+    segments[tail_segment].clean_blocks = 1;
+    tail_segment = (uint8_t)((tail_segment + 1) % SEGMENT_COUNT);
+    stats.segments_reclaimed++;
     return true;
 }
 
+uint32_t storage_first_record() {
+    return segments[tail_segment].first_record;
+}
+
+/* ---------------------------------------------------------------------------
+ *  STATISTICS
+ *
+ *  Write amplification = (flash_bytes_written / payload_bytes). Erased
+ *  bytes are reported separately since erases, not programs, wear the
+ *  chip out.
+ * ------------------------------------------------------------------------- */
+
+void storage_get_stats(storage_stats_t *out) {
+    *out = stats;
+}
+
 /* ---------------------------------------------------------------------------
  *  EMERGENCY WIPE
  * ------------------------------------------------------------------------- */
@@ -207,14 +681,16 @@ bool storage_emergency_wipe() {
         return false;
     }
 
-    // Reinitialize header
-    memset(&header_cache, 0, sizeof(header_cache));
-    header_cache.magic = STORAGE_MAGIC_HEADER;
-    header_cache.version = 1;
-    header_cache.record_count = 0;
-    update_header_crc(&header_cache);
+    // Start a fresh log
+    memset(segments, 0, sizeof(segments));
+    record_count = 0;
+    tail_segment = 0;
+    checkpoint_sequence = 0;
+    checkpoint_slot = 0;
+    checkpoint_covers = 0;
+    tx_since_last_checkpoint = 0;
 
-    return hal_storage_write(0, &header_cache, sizeof(header_cache));
+    return open_segment(0, 1, 0);
 }
 
 /* ---------------------------------------------------------------------------
@@ -223,7 +699,9 @@ bool storage_emergency_wipe() {
  *  This module:
  *    - Stores encrypted ledger records safely
  *    - Detects corruption with CRC
-    - Ensures durability in low-power environments
+ *    - Never rewrites a programmed byte; wear is spread by rotating
+ *      segments and checkpoint slots
+ *    - Ensures durability in low-power environments
  *    - Provides fast recovery via checkpoints
  *    - Supports tamper-triggered secure wipe
  *    - Abstracts hardware specifics for portability
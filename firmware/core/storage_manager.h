@@ -4,9 +4,37 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+typedef struct {
+    uint32_t records_appended;
+    uint32_t checkpoints_written;
+    uint32_t segments_opened;
+    uint32_t segments_reclaimed;
+    uint64_t payload_bytes;         // bytes handed in by callers
+    uint64_t flash_bytes_written;   // bytes programmed, including headers
+    uint64_t flash_bytes_erased;
+} storage_stats_t;
+
 bool storage_init(void);
 bool storage_write(const char *key, const uint8_t *data, uint16_t length);
 bool storage_read(const char *key, uint8_t *buffer, uint16_t buffer_len);
 bool storage_delete(const char *key);
 
+bool storage_append_record(const uint8_t *data, uint16_t length);
+bool storage_get_record(uint32_t index, uint8_t *out_record, uint16_t buffer_len, uint16_t *length_out);
+uint32_t storage_record_count(void);
+uint32_t storage_first_record(void);
+bool storage_compact_step(void);
+
+bool storage_needs_checkpoint(void);
+bool storage_write_checkpoint(const uint8_t *data, uint32_t size);
+bool storage_read_checkpoint(uint8_t *buffer, uint32_t buffer_len, uint32_t *size_out);
+
+uint32_t storage_tx_index_region_size(void);
+bool storage_tx_index_read(uint32_t offset, void *buffer, uint32_t size);
+bool storage_tx_index_write(uint32_t offset, const void *buffer, uint32_t size);
+bool storage_tx_index_erase(void);
+
+bool storage_emergency_wipe(void);
+void storage_get_stats(storage_stats_t *out);
+
 #endif
@@ -0,0 +1,187 @@
+/**
+ * verify_cache.c
+ * ---------------------------------------------------------
+ * Seed Device Firmware — Signature Verification Cache
+ *
+ * Purpose:
+ *   - Remembers recent signature verdicts so a packet or
+ *     transaction is verified once, not once per layer
+ *     (radio RX, mesh RX handler, ledger validation) and not
+ *     again for every gossip copy that reaches us.
+ *   - Checks a group of signatures in one call, verifying
+ *     each cache miss exactly once.
+ *
+ * Design Goals:
+ *   - Keys cover signer, message and signature, so a bad
+ *     signature can never reuse the verdict of a good one and
+ *     a forged copy cannot poison the cache for the real one.
+ *   - Keys are a 64-bit SipHash-2-4 under a per-boot random
+ *     key, so peers cannot craft collisions with entries.
+ *   - Fixed RAM; a linear scan of 32 entries is far cheaper
+ *     than one Ed25519 verification.
+ * ---------------------------------------------------------
+ */
+
+#include "verify_cache.h"
+#include "siphash.h"
+#include <string.h>
+
+// ---------------------------------------------------------------------------
+// Internal Static State
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    uint64_t tag;              // 0 = empty slot
+    uint32_t last_used;
+    bool     valid;
+} verify_entry_t;
+
+static verify_entry_t       entries[VERIFY_CACHE_ENTRIES];
+static uint32_t             use_clock = 0;
+static uint64_t             sip_k0 = 0;
+static uint64_t             sip_k1 = 0;
+static verify_cache_stats_t stats;
+
+// ---------------------------------------------------------------------------
+// Internal Helpers
+// ---------------------------------------------------------------------------
+
+// Each field is length-prefixed so moving bytes between them changes the key
+static void sip_field(siphash_t *s, const uint8_t *p, size_t len)
+{
+    uint8_t n[4] = {
+        (uint8_t)len, (uint8_t)(len >> 8), (uint8_t)(len >> 16), (uint8_t)(len >> 24)
+    };
+
+    siphash_update(s, n, sizeof(n));
+    if (p != NULL)
+        siphash_update(s, p, len);
+}
+
+static uint64_t item_tag(const verify_item_t *item)
+{
+    siphash_t s;
+
+    siphash_init(&s, sip_k0, sip_k1);
+    sip_field(&s, item->signer, item->signer ? item->signer_len : 0);
+    sip_field(&s, item->msg,    item->msg    ? item->msg_len    : 0);
+    sip_field(&s, item->sig,    item->sig    ? item->sig_len    : 0);
+
+    uint64_t tag = siphash_final(&s);
+    return (tag == 0) ? 1 : tag;
+}
+
+static verify_entry_t *find_entry(uint64_t tag)
+{
+    for (uint8_t i = 0; i < VERIFY_CACHE_ENTRIES; i++)
+        if (entries[i].tag == tag)
+            return &entries[i];
+    return NULL;
+}
+
+static bool lookup(uint64_t tag, bool *valid)
+{
+    verify_entry_t *e = find_entry(tag);
+
+    if (e == NULL) {
+        stats.misses++;
+        return false;
+    }
+
+    e->last_used = ++use_clock;
+    *valid = e->valid;
+    stats.hits++;
+    return true;
+}
+
+static void store(uint64_t tag, bool valid)
+{
+    verify_entry_t *e = find_entry(tag);
+
+    if (e == NULL) {
+        e = &entries[0];
+        for (uint8_t i = 0; i < VERIFY_CACHE_ENTRIES && e->tag != 0; i++) {
+            if (entries[i].tag == 0 || entries[i].last_used < e->last_used)
+                e = &entries[i];
+        }
+        if (e->tag != 0)
+            stats.evictions++;
+        e->tag = tag;
+    }
+
+    e->valid     = valid;
+    e->last_used = ++use_clock;
+}
+
+// ---------------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------------
+
+/**
+ * Start with an empty cache under a fresh hash key. Call once per
+ * boot with random bytes from the secure element.
+ */
+void verify_cache_init(const uint8_t key[VERIFY_CACHE_KEY_LEN])
+{
+    siphash_key_load(key, &sip_k0, &sip_k1);
+
+    verify_cache_clear();
+    memset(&stats, 0, sizeof(stats));
+}
+
+// Drop every verdict, e.g. after a key rotation or emergency wipe
+void verify_cache_clear(void)
+{
+    memset(entries, 0, sizeof(entries));
+    use_clock = 0;
+}
+
+/**
+ * Verdict for one signature: from the cache if known, otherwise from
+ * the call site's verifier, which is then remembered.
+ */
+bool verify_cache_check(const verify_item_t *item, verify_fn_t verify, void *ctx)
+{
+    if (item == NULL || verify == NULL)
+        return false;
+
+    uint64_t tag = item_tag(item);
+    bool valid = false;
+
+    if (lookup(tag, &valid))
+        return valid;
+
+    valid = verify(item, ctx);
+    store(tag, valid);
+    return valid;
+}
+
+/**
+ * Check many signatures. Cached verdicts are used as-is and every miss
+ * is verified once by the single verifier, so a forgery costs its own
+ * check and nothing more. The signature schemes behind security_verify()
+ * have no batch equation to amortize, so there is nothing to gain from
+ * verifying items together.
+ * Returns the number of valid items; per-item verdicts go to valid_out.
+ */
+size_t verify_cache_check_batch(const verify_item_t *items, size_t count, bool *valid_out,
+                                verify_fn_t verify, void *ctx)
+{
+    size_t valid_count = 0;
+
+    if (items == NULL || valid_out == NULL || verify == NULL)
+        return 0;
+
+    for (size_t i = 0; i < count; i++) {
+        valid_out[i] = verify_cache_check(&items[i], verify, ctx);
+        valid_count += valid_out[i];
+    }
+
+    return valid_count;
+}
+
+void verify_cache_get_stats(verify_cache_stats_t *out)
+{
+    if (out != NULL)
+        *out = stats;
+}
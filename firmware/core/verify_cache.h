@@ -0,0 +1,38 @@
+#ifndef VERIFY_CACHE_H
+#define VERIFY_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define VERIFY_CACHE_ENTRIES   32    // verdicts kept, least recently used evicted
+#define VERIFY_BATCH_MAX       32    // signatures checked per import chunk
+#define VERIFY_CACHE_KEY_LEN   16
+
+// One signature check: who signed, what, and the signature bytes
+typedef struct {
+    const uint8_t *signer;      // public key or signer ID; may be part of msg
+    size_t         signer_len;
+    const uint8_t *msg;
+    size_t         msg_len;
+    const uint8_t *sig;         // may be NULL if carried inside msg
+    size_t         sig_len;
+} verify_item_t;
+
+// Single verifier behind a call site; ctx is passed through unchanged
+typedef bool (*verify_fn_t)(const verify_item_t *item, void *ctx);
+
+typedef struct {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+} verify_cache_stats_t;
+
+void   verify_cache_init(const uint8_t key[VERIFY_CACHE_KEY_LEN]);
+void   verify_cache_clear(void);
+bool   verify_cache_check(const verify_item_t *item, verify_fn_t verify, void *ctx);
+size_t verify_cache_check_batch(const verify_item_t *items, size_t count, bool *valid_out,
+                                verify_fn_t verify, void *ctx);
+void   verify_cache_get_stats(verify_cache_stats_t *out);
+
+#endif
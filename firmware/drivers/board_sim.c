@@ -0,0 +1,40 @@
+/*
+ * board_sim.c
+ * -----------------------------------------
+ * Seed Device Firmware — Host Board Stand-ins
+ *
+ * Purpose:
+ *   Provides the board HAL power_manager.c links against on a Linux
+ *   dev box, so the full node image runs in mesh_sim.c:
+ *   - a battery that stays full and never charges
+ *   - LoRa and e-ink sleep/wake as no-ops (radio_sim.c models the
+ *     radio and keeps it listening)
+ *
+ * Host builds only: compile with -DSEED_HOST_SIM.
+ */
+
+#ifdef SEED_HOST_SIM
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define BOARD_SIM_BATTERY_MV   4000u
+
+/* -------------------------------------------------------
+ *  Battery (battery_sensor.c)
+ * ------------------------------------------------------- */
+
+uint16_t battery_read_mv(void)     { return BOARD_SIM_BATTERY_MV; }
+bool     battery_is_charging(void) { return false; }
+bool     battery_is_present(void)  { return true; }
+
+/* -------------------------------------------------------
+ *  Radio and display power (lora_driver.c, e_ink_display.c)
+ * ------------------------------------------------------- */
+
+void lora_enter_sleep(void)  { }
+void lora_wake(void)         { }
+void e_ink_enter_sleep(void) { }
+void e_ink_wake(void)        { }
+
+#endif // SEED_HOST_SIM
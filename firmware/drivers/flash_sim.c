@@ -0,0 +1,641 @@
+/*
+ * flash_sim.c
+ * -----------------------------------------
+ * Seed Device Firmware — Host Flash Simulator
+ *
+ * Purpose:
+ *   Emulates a NOR or NAND flash chip in an mmap'd file (or anonymous
+ *   memory) so the storage and ledger layers can be run, benchmarked
+ *   and torture-tested on a Linux dev box at native speed.
+ *
+ * Model:
+ *   - Page (program) and sector (erase) granularity from the config
+ *   - Erase sets bytes to 0xFF; program can only clear bits. A program
+ *     that needs a 0→1 transition is ANDed in like real NOR, or
+ *     rejected when cfg.strict is set; either way it is counted.
+ *   - NAND pages accept at most nand_max_page_programs per erase
+ *   - Per-sector erase counters, persisted in the file trailer, with
+ *     an endurance limit after which erases fail
+ *   - Modelled busy time and charge per operation (nothing sleeps)
+ *   - Power loss injected mid-program or mid-erase, with a torn byte
+ *     at the cut point
+ *   - Bytes are stored complemented, so erased flash is zero: a fresh
+ *     anonymous mapping needs no fill, and whole-sector erases hand
+ *     their pages back. A node only costs RAM for sectors it has
+ *     programmed, which keeps 1000-node mesh_sim runs in memory.
+ *
+ * Also implements hal_storage_* (storage_manager.c) and
+ * storage_driver_* (ledger_storage.c) over fixed partitions, see
+ * flash_sim.h. Ledger checkpoints are kept A/B so one always survives
+ * a torn write. Host builds only: compile with -DSEED_HOST_SIM.
+ */
+
+#ifdef SEED_HOST_SIM
+
+#include "flash_sim.h"
+#include "storage_driver.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* -------------------------------------------------------
+ *  Internal State
+ * ------------------------------------------------------- */
+
+#define FLASH_SIM_MAGIC      0x464C5332UL   // "FLS2": data stored complemented
+
+// Stored after the data area so wear survives restarts
+typedef struct {
+    uint32_t magic;
+    uint32_t page_size;
+    uint32_t sector_size;
+    uint32_t sector_count;
+} flash_sim_trailer_t;
+
+static flash_sim_config_t cfg;
+static flash_sim_stats_t  stats;
+
+static uint8_t  *mem          = NULL;   // data area
+static size_t    map_len      = 0;
+static int       map_fd       = -1;
+static uint32_t *erase_counts = NULL;   // lives in the mapping
+static uint8_t  *page_programs = NULL;  // NAND only, RAM
+
+static bool      powered      = true;
+static uint32_t  loss_ops     = 0;      // 0 = not armed
+static uint32_t  loss_bytes   = 0;
+static uint32_t  rng_state    = 0x2545F491UL;
+
+/* -------------------------------------------------------
+ *  Helpers
+ * ------------------------------------------------------- */
+
+static uint32_t total_size(void)
+{
+    return cfg.sector_size * cfg.sector_count;
+}
+
+static bool in_range(uint32_t addr, uint32_t size)
+{
+    return mem != NULL && addr <= total_size() && size <= total_size() - addr;
+}
+
+static uint32_t next_random(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static void charge(uint32_t us, uint16_t ma)
+{
+    stats.busy_us   += us;
+    stats.charge_nc += (uint64_t)us * ma;
+}
+
+/*
+ * Counts down an armed power loss. Returns the number of bytes of this
+ * operation that complete, or size if it is not the interrupted one.
+ */
+static uint32_t power_loss_cut(uint32_t size)
+{
+    if (loss_ops == 0 || --loss_ops != 0)
+        return size;
+
+    powered = false;
+    stats.power_losses++;
+    return (loss_bytes < size) ? loss_bytes : size;
+}
+
+static void update_wear_range(void)
+{
+    uint32_t lo = UINT32_MAX, hi = 0;
+
+    for (uint32_t s = 0; s < cfg.sector_count; s++) {
+        if (erase_counts[s] < lo) lo = erase_counts[s];
+        if (erase_counts[s] > hi) hi = erase_counts[s];
+    }
+    stats.min_erase_count = lo;
+    stats.max_erase_count = hi;
+}
+
+/* -------------------------------------------------------
+ *  Setup
+ * ------------------------------------------------------- */
+
+/**
+ * 4 MB SPI NOR (W25Q32 class): 256 B pages, 4 KB sectors.
+ */
+void flash_sim_default_config(flash_sim_config_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->type                   = FLASH_SIM_NOR;
+    out->page_size              = 256;
+    out->sector_size            = 4096;
+    out->sector_count           = 1024;
+    out->nand_max_page_programs = 4;
+    out->endurance_cycles       = 100000;
+    out->strict                 = false;
+
+    out->read_setup_us          = 1;
+    out->read_ns_per_byte       = 80;      // ~100 Mbit/s quad read
+    out->program_us_per_page    = 700;
+    out->erase_us_per_sector    = 45000;
+    out->read_ma                = 15;
+    out->program_ma             = 20;
+    out->erase_ma               = 20;
+}
+
+bool flash_sim_open(const char *path, const flash_sim_config_t *config)
+{
+    flash_sim_close();
+
+    if (config->page_size == 0 || config->sector_size % config->page_size != 0 ||
+        config->sector_count == 0)
+        return false;
+
+    cfg = *config;
+
+    size_t data_len = (size_t)total_size();
+    map_len = data_len + sizeof(flash_sim_trailer_t) + cfg.sector_count * sizeof(uint32_t);
+
+    bool fresh = true;
+
+    if (path == NULL) {
+        mem = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    } else {
+        map_fd = open(path, O_RDWR | O_CREAT, 0644);
+        if (map_fd < 0)
+            return false;
+
+        struct stat st;
+        if (fstat(map_fd, &st) == 0 && (size_t)st.st_size == map_len)
+            fresh = false;
+
+        if (ftruncate(map_fd, (off_t)map_len) != 0) {
+            close(map_fd);
+            map_fd = -1;
+            return false;
+        }
+        mem = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_SHARED, map_fd, 0);
+    }
+
+    if (mem == MAP_FAILED) {
+        mem = NULL;
+        flash_sim_close();
+        return false;
+    }
+
+    flash_sim_trailer_t *trailer = (flash_sim_trailer_t *)(mem + data_len);
+    erase_counts = (uint32_t *)(trailer + 1);
+
+    // Reuse an existing image only if it was made with the same geometry
+    if (!fresh && (trailer->magic != FLASH_SIM_MAGIC ||
+                   trailer->page_size != cfg.page_size ||
+                   trailer->sector_size != cfg.sector_size ||
+                   trailer->sector_count != cfg.sector_count))
+        fresh = true;
+
+    if (fresh) {
+        // An anonymous mapping already reads as erased
+        if (map_fd >= 0) {
+            memset(mem, 0x00, data_len);
+            memset(erase_counts, 0, cfg.sector_count * sizeof(uint32_t));
+        }
+        trailer->magic        = FLASH_SIM_MAGIC;
+        trailer->page_size    = cfg.page_size;
+        trailer->sector_size  = cfg.sector_size;
+        trailer->sector_count = cfg.sector_count;
+    }
+
+    if (cfg.type == FLASH_SIM_NAND)
+        page_programs = calloc(data_len / cfg.page_size, 1);
+
+    powered  = true;
+    loss_ops = 0;
+    flash_sim_reset_stats();
+    return true;
+}
+
+void flash_sim_close(void)
+{
+    if (mem != NULL) {
+        if (map_fd >= 0)
+            msync(mem, map_len, MS_SYNC);
+        munmap(mem, map_len);
+    }
+    if (map_fd >= 0)
+        close(map_fd);
+
+    free(page_programs);
+
+    mem           = NULL;
+    map_fd        = -1;
+    map_len       = 0;
+    erase_counts  = NULL;
+    page_programs = NULL;
+}
+
+// HAL entry points may run before anyone opened a chip explicitly
+static bool ensure_open(void)
+{
+    if (mem != NULL)
+        return true;
+
+    flash_sim_config_t def;
+    flash_sim_default_config(&def);
+    return flash_sim_open(NULL, &def);
+}
+
+uint32_t flash_sim_size(void)
+{
+    return (mem != NULL) ? total_size() : 0;
+}
+
+/* -------------------------------------------------------
+ *  Operations
+ * ------------------------------------------------------- */
+
+bool flash_sim_read(uint32_t addr, void *buffer, uint32_t size)
+{
+    if (!powered || !in_range(addr, size))
+        return false;
+
+    uint8_t *dst = (uint8_t *)buffer;
+    for (uint32_t i = 0; i < size; i++)
+        dst[i] = (uint8_t)~mem[addr + i];
+
+    stats.reads++;
+    stats.bytes_read += size;
+    charge(cfg.read_setup_us + (uint32_t)(((uint64_t)size * cfg.read_ns_per_byte) / 1000U),
+           cfg.read_ma);
+    return true;
+}
+
+bool flash_sim_program(uint32_t addr, const void *data, uint32_t size)
+{
+    if (!powered || !in_range(addr, size))
+        return false;
+    if (size == 0)
+        return true;
+
+    const uint8_t *src = (const uint8_t *)data;
+
+    bool needs_erase = false;
+    for (uint32_t i = 0; i < size; i++) {
+        if ((uint8_t)(mem[addr + i] & src[i]) != 0) {
+            needs_erase = true;
+            break;
+        }
+    }
+
+    if (needs_erase) {
+        stats.program_violations++;
+        if (cfg.strict)
+            return false;
+    }
+
+    uint32_t first_page = addr / cfg.page_size;
+    uint32_t last_page  = (addr + size - 1) / cfg.page_size;
+
+    if (page_programs != NULL) {
+        bool over = false;
+        for (uint32_t p = first_page; p <= last_page; p++)
+            if (page_programs[p] >= cfg.nand_max_page_programs)
+                over = true;
+
+        if (over) {
+            stats.nop_violations++;
+            if (cfg.strict)
+                return false;
+        }
+        for (uint32_t p = first_page; p <= last_page; p++)
+            if (page_programs[p] < UINT8_MAX)
+                page_programs[p]++;
+    }
+
+    uint32_t done = power_loss_cut(size);
+
+    for (uint32_t i = 0; i < done; i++)
+        mem[addr + i] |= (uint8_t)~src[i];
+
+    // The byte being programmed when power dropped gets some of its bits
+    if (done < size)
+        mem[addr + done] |= (uint8_t)~(src[done] | next_random());
+
+    stats.programs++;
+    stats.bytes_programmed += done;
+    charge((last_page - first_page + 1) * cfg.program_us_per_page, cfg.program_ma);
+
+    return done == size;
+}
+
+bool flash_sim_erase_sector(uint32_t sector)
+{
+    if (!powered || mem == NULL || sector >= cfg.sector_count)
+        return false;
+
+    if (erase_counts[sector] >= cfg.endurance_cycles) {
+        stats.worn_out_erases++;
+        return false;
+    }
+
+    uint32_t base = sector * cfg.sector_size;
+    uint32_t done = power_loss_cut(cfg.sector_size);
+
+    // An interrupted erase leaves the rest of the sector as it was.
+    // A whole anonymous sector goes back as zero pages.
+    uint32_t host_page = (uint32_t)sysconf(_SC_PAGESIZE);
+    bool dropped = map_fd < 0 && done == cfg.sector_size &&
+                   base % host_page == 0 && done % host_page == 0 &&
+                   madvise(mem + base, done, MADV_DONTNEED) == 0;
+    if (!dropped)
+        memset(mem + base, 0x00, done);
+
+    erase_counts[sector]++;
+    if (page_programs != NULL && done == cfg.sector_size)
+        memset(page_programs + base / cfg.page_size, 0, cfg.sector_size / cfg.page_size);
+
+    stats.erases++;
+    charge(cfg.erase_us_per_sector, cfg.erase_ma);
+    update_wear_range();
+
+    return done == cfg.sector_size;
+}
+
+bool flash_sim_erase_range(uint32_t addr, uint32_t size)
+{
+    if (!in_range(addr, size))
+        return false;
+
+    if (addr % cfg.sector_size != 0 || size % cfg.sector_size != 0) {
+        stats.misaligned_erases++;
+        return false;
+    }
+
+    for (uint32_t s = addr / cfg.sector_size; s < (addr + size) / cfg.sector_size; s++)
+        if (!flash_sim_erase_sector(s))
+            return false;
+
+    return true;
+}
+
+/* -------------------------------------------------------
+ *  Fault Injection
+ * ------------------------------------------------------- */
+
+void flash_sim_arm_power_loss(uint32_t ops_until, uint32_t bytes_into_op)
+{
+    loss_ops   = ops_until;
+    loss_bytes = bytes_into_op;
+}
+
+void flash_sim_power_cycle(void)
+{
+    if (mem != NULL && map_fd >= 0)
+        msync(mem, map_len, MS_SYNC);
+
+    powered  = true;
+    loss_ops = 0;
+}
+
+bool flash_sim_powered(void)
+{
+    return powered;
+}
+
+/* -------------------------------------------------------
+ *  Statistics
+ * ------------------------------------------------------- */
+
+uint32_t flash_sim_erase_count(uint32_t sector)
+{
+    if (mem == NULL || sector >= cfg.sector_count)
+        return 0;
+    return erase_counts[sector];
+}
+
+void flash_sim_get_stats(flash_sim_stats_t *out)
+{
+    *out = stats;
+}
+
+void flash_sim_reset_stats(void)
+{
+    memset(&stats, 0, sizeof(stats));
+    if (mem != NULL)
+        update_wear_range();
+}
+
+/* -------------------------------------------------------
+ *  HAL: storage_manager.c (hal_storage_*)
+ * ------------------------------------------------------- */
+
+bool hal_storage_read(uint32_t addr, void *buffer, uint32_t size)
+{
+    if (!ensure_open() || addr > FLASH_SIM_HAL_SIZE || size > FLASH_SIM_HAL_SIZE - addr)
+        return false;
+    return flash_sim_read(FLASH_SIM_HAL_BASE + addr, buffer, size);
+}
+
+bool hal_storage_write(uint32_t addr, const void *buffer, uint32_t size)
+{
+    if (!ensure_open() || addr > FLASH_SIM_HAL_SIZE || size > FLASH_SIM_HAL_SIZE - addr)
+        return false;
+    return flash_sim_program(FLASH_SIM_HAL_BASE + addr, buffer, size);
+}
+
+bool hal_storage_erase(void)
+{
+    return ensure_open() && flash_sim_erase_range(FLASH_SIM_HAL_BASE, FLASH_SIM_HAL_SIZE);
+}
+
+bool hal_storage_erase_region(uint32_t addr, uint32_t size)
+{
+    if (!ensure_open() || addr > FLASH_SIM_HAL_SIZE || size > FLASH_SIM_HAL_SIZE - addr)
+        return false;
+    return flash_sim_erase_range(FLASH_SIM_HAL_BASE + addr, size);
+}
+
+uint32_t hal_storage_total_size(void)
+{
+    return FLASH_SIM_HAL_SIZE;
+}
+
+/* -------------------------------------------------------
+ *  HAL: ledger_storage.c (storage_driver_*)
+ * ------------------------------------------------------- */
+
+bool storage_driver_read(uint32_t addr, uint8_t *buffer, uint32_t size)
+{
+    if (!ensure_open() || addr > FLASH_SIM_LEDGER_SIZE || size > FLASH_SIM_LEDGER_SIZE - addr)
+        return false;
+    return flash_sim_read(FLASH_SIM_LEDGER_BASE + addr, buffer, size);
+}
+
+bool storage_driver_write(uint32_t addr, const uint8_t *data, uint32_t size)
+{
+    if (!ensure_open() || addr > FLASH_SIM_LEDGER_SIZE || size > FLASH_SIM_LEDGER_SIZE - addr)
+        return false;
+    return flash_sim_program(FLASH_SIM_LEDGER_BASE + addr, data, size);
+}
+
+bool storage_driver_erase(uint32_t addr, uint32_t size)
+{
+    if (!ensure_open() || addr > FLASH_SIM_LEDGER_SIZE || size > FLASH_SIM_LEDGER_SIZE - addr)
+        return false;
+    return flash_sim_erase_range(FLASH_SIM_LEDGER_BASE + addr, size);
+}
+
+/*
+ * Checkpoints alternate between two slots, each with a small header
+ * written after the payload. A torn write therefore leaves the other
+ * slot's checkpoint as the newest valid one.
+ */
+#define CHECKPOINT_SLOT_SIZE    (FLASH_SIM_CHECKPOINT_SIZE / 2)
+#define CHECKPOINT_MAGIC        0x43503031UL   // "CP01"
+
+typedef struct {
+    uint32_t magic;
+    uint32_t sequence;
+    uint32_t size;
+    uint32_t checksum;     // FNV-1a of the payload
+} checkpoint_slot_header_t;
+
+#define CHECKSUM_SEED 2166136261u
+
+static uint32_t payload_checksum_update(uint32_t h, const uint8_t *data, uint32_t size)
+{
+    for (uint32_t i = 0; i < size; i++) {
+        h ^= data[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static uint32_t payload_checksum(const uint8_t *data, uint32_t size)
+{
+    return payload_checksum_update(CHECKSUM_SEED, data, size);
+}
+
+// Checksum a stored payload in small pieces so verifying a slot needs no
+// slot-sized buffer
+static bool stored_payload_checksum(uint32_t addr, uint32_t size, uint32_t *out)
+{
+    uint8_t chunk[256];
+    uint32_t h = CHECKSUM_SEED;
+
+    while (size > 0) {
+        uint32_t n = size < sizeof(chunk) ? size : sizeof(chunk);
+        if (!flash_sim_read(addr, chunk, n))
+            return false;
+        h = payload_checksum_update(h, chunk, n);
+        addr += n;
+        size -= n;
+    }
+    *out = h;
+    return true;
+}
+
+static uint32_t checkpoint_slot_addr(uint8_t slot)
+{
+    return FLASH_SIM_CHECKPOINT_BASE + slot * CHECKPOINT_SLOT_SIZE;
+}
+
+static bool read_slot_header(uint8_t slot, checkpoint_slot_header_t *hdr)
+{
+    return flash_sim_read(checkpoint_slot_addr(slot), hdr, sizeof(*hdr)) &&
+           hdr->magic == CHECKPOINT_MAGIC &&
+           hdr->size <= CHECKPOINT_SLOT_SIZE - sizeof(*hdr);
+}
+
+// Newest slot whose payload matches its header, or -1
+static int newest_checkpoint_slot(uint32_t *sequence_out)
+{
+    checkpoint_slot_header_t hdr;
+    uint32_t checksum;
+    int best = -1;
+    uint32_t best_seq = 0;
+
+    for (uint8_t slot = 0; slot < 2; slot++) {
+        if (!read_slot_header(slot, &hdr))
+            continue;
+        if (!stored_payload_checksum(checkpoint_slot_addr(slot) + sizeof(hdr),
+                                     hdr.size, &checksum) ||
+            checksum != hdr.checksum)
+            continue;
+        if (best < 0 || hdr.sequence > best_seq) {
+            best = slot;
+            best_seq = hdr.sequence;
+        }
+    }
+
+    if (sequence_out)
+        *sequence_out = best_seq;
+    return best;
+}
+
+bool storage_driver_read_checkpoint(uint8_t *buffer, uint32_t size)
+{
+    checkpoint_slot_header_t hdr;
+
+    if (!ensure_open())
+        return false;
+
+    int slot = newest_checkpoint_slot(NULL);
+    if (slot < 0 || !read_slot_header((uint8_t)slot, &hdr) || hdr.size < size)
+        return false;
+
+    return flash_sim_read(checkpoint_slot_addr((uint8_t)slot) + sizeof(hdr), buffer, size);
+}
+
+bool storage_driver_write_checkpoint(const uint8_t *data, uint32_t size)
+{
+    checkpoint_slot_header_t hdr;
+    uint32_t sequence = 0;
+
+    if (!ensure_open() || size > CHECKPOINT_SLOT_SIZE - sizeof(hdr))
+        return false;
+
+    int newest = newest_checkpoint_slot(&sequence);
+    uint8_t slot = (newest == 0) ? 1 : 0;
+    uint32_t addr = checkpoint_slot_addr(slot);
+
+    uint32_t span = ((sizeof(hdr) + size + cfg.sector_size - 1) / cfg.sector_size) * cfg.sector_size;
+    if (!flash_sim_erase_range(addr, span))
+        return false;
+
+    if (!flash_sim_program(addr + sizeof(hdr), data, size))
+        return false;
+
+    hdr.magic    = CHECKPOINT_MAGIC;
+    hdr.sequence = sequence + 1;
+    hdr.size     = size;
+    hdr.checksum = payload_checksum(data, size);
+
+    return flash_sim_program(addr, &hdr, sizeof(hdr));
+}
+
+/**
+ * Erases every sector the region touches; the ledger region is
+ * sector-aligned, so this never reaches past it.
+ */
+bool storage_driver_secure_wipe_region(uint32_t addr, uint32_t size)
+{
+    if (!ensure_open() || addr > FLASH_SIM_LEDGER_SIZE || size > FLASH_SIM_LEDGER_SIZE - addr)
+        return false;
+
+    uint32_t start = (addr / cfg.sector_size) * cfg.sector_size;
+    uint32_t end   = ((addr + size + cfg.sector_size - 1) / cfg.sector_size) * cfg.sector_size;
+
+    return flash_sim_erase_range(FLASH_SIM_LEDGER_BASE + start, end - start);
+}
+
+#endif // SEED_HOST_SIM
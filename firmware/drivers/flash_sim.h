@@ -0,0 +1,86 @@
+#ifndef FLASH_SIM_H
+#define FLASH_SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Host-only flash emulator (build with -DSEED_HOST_SIM).
+ * Also provides the hal_storage_* and storage_driver_* HALs on top
+ * of two partitions of the simulated chip.
+ */
+
+typedef enum {
+    FLASH_SIM_NOR = 0,     // byte-programmable, any number of partial programs
+    FLASH_SIM_NAND         // at most nand_max_page_programs per page per erase
+} flash_sim_type_t;
+
+typedef struct {
+    flash_sim_type_t type;
+    uint32_t page_size;              // program unit (bytes)
+    uint32_t sector_size;            // erase unit (bytes), multiple of page_size
+    uint32_t sector_count;
+    uint8_t  nand_max_page_programs; // NAND "NOP" limit
+    uint32_t endurance_cycles;       // erases before a sector fails
+    bool     strict;                 // reject 0→1 programs instead of ANDing
+
+    // Timing (µs) and supply current (mA) per operation
+    uint32_t read_setup_us;
+    uint32_t read_ns_per_byte;
+    uint32_t program_us_per_page;
+    uint32_t erase_us_per_sector;
+    uint16_t read_ma;
+    uint16_t program_ma;
+    uint16_t erase_ma;
+} flash_sim_config_t;
+
+typedef struct {
+    uint32_t reads;
+    uint32_t programs;
+    uint32_t erases;
+    uint64_t bytes_read;
+    uint64_t bytes_programmed;
+    uint64_t busy_us;              // modelled device time
+    uint64_t charge_nc;            // modelled charge (mA · µs)
+    uint32_t program_violations;   // programs that needed a 0→1 transition
+    uint32_t nop_violations;       // NAND page programmed too many times
+    uint32_t misaligned_erases;
+    uint32_t worn_out_erases;      // erase refused: endurance exceeded
+    uint32_t power_losses;
+    uint32_t min_erase_count;
+    uint32_t max_erase_count;
+} flash_sim_stats_t;
+
+// Partitions used by the HAL bindings
+#define FLASH_SIM_HAL_BASE            0x000000UL   // storage_manager.c
+#define FLASH_SIM_HAL_SIZE            0x200000UL
+#define FLASH_SIM_LEDGER_BASE         0x200000UL   // ledger_storage.c records
+#define FLASH_SIM_LEDGER_SIZE         0x0F0000UL
+#define FLASH_SIM_CHECKPOINT_BASE     0x2F0000UL   // ledger_storage.c checkpoint
+#define FLASH_SIM_CHECKPOINT_SIZE     0x010000UL
+
+void flash_sim_default_config(flash_sim_config_t *cfg);
+
+// path == NULL maps anonymous memory; otherwise the file persists
+// contents and wear counters across runs.
+bool flash_sim_open(const char *path, const flash_sim_config_t *cfg);
+void flash_sim_close(void);
+
+bool flash_sim_read(uint32_t addr, void *buffer, uint32_t size);
+bool flash_sim_program(uint32_t addr, const void *data, uint32_t size);
+bool flash_sim_erase_sector(uint32_t sector);
+bool flash_sim_erase_range(uint32_t addr, uint32_t size);
+uint32_t flash_sim_size(void);
+
+// The Nth program/erase from now (1 = next) is cut after
+// bytes_into_op bytes; the chip then refuses all I/O until
+// flash_sim_power_cycle().
+void flash_sim_arm_power_loss(uint32_t ops_until, uint32_t bytes_into_op);
+void flash_sim_power_cycle(void);
+bool flash_sim_powered(void);
+
+uint32_t flash_sim_erase_count(uint32_t sector);
+void flash_sim_get_stats(flash_sim_stats_t *out);
+void flash_sim_reset_stats(void);
+
+#endif
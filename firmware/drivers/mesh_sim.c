@@ -0,0 +1,951 @@
+/*
+ * mesh_sim.c
+ * -----------------------------------------
+ * Seed Device Firmware — Host Mesh Network Simulator
+ *
+ * Purpose:
+ *   Runs N virtual Seed nodes, each executing the real firmware image
+ *   (mesh, sync, TX queue, neighbor table, ledger), over one virtual
+ *   clock and a shared LoRa channel. Measures sync convergence time,
+ *   airtime per transaction and delivery ratio much faster than real
+ *   time: nothing sleeps, the clock jumps from event to event.
+ *
+ * Model:
+ *   - Nodes placed uniformly at random in a square. Link budget from
+ *     log-distance path loss plus per-link log-normal shadowing,
+ *     drawn once and symmetric; links below sensitivity do not exist.
+ *   - Time-on-air from radio_airtime.c, so the PHY settings in
+ *     radio_config.h apply. A node transmits one frame at a time and
+ *     cannot receive while transmitting (half duplex).
+ *   - A frame is lost at a receiver if any frame overlapping it in
+ *     time arrives there within capture_db of its power.
+ *   - Each node is a coroutine on its own stack. It runs until its
+ *     scheduler goes idle (mesh_sim_node_idle), and is resumed at its
+ *     next timer deadline, on frame reception or when it originates
+ *     a transaction.
+ *
+ * Node image:
+ *   All firmware modules keep their state in file-scope statics. The
+ *   firmware is linked into one relocatable object whose .data and
+ *   .bss are renamed to a single section; the simulator keeps one
+ *   copy of that section per node and swaps it in before running a
+ *   node, so the modules need no changes to be instantiated N times:
+ *
+ *     cc -O2 -DSEED_HOST_SIM -DLEDGER_CREDIT_LIMIT=1000.0f -fno-common -fno-pie \
+ *        -c <firmware>.c
+ *     ld -r -o seed_node.o <firmware>.o
+ *     objcopy --rename-section .data=seed_node_state \
+ *             --rename-section .bss=seed_node_state,alloc,load,contents,data \
+ *             seed_node.o
+ *     cc -O2 -no-pie -DSEED_HOST_SIM -DMESH_SIM_MAIN mesh_sim.c seed_node.o \
+ *        -lm -o mesh_sim
+ *
+ *   The firmware list is every .c under core/, mesh/, ledger/, utils/
+ *   and drivers/ except this file and the target-only ones (the real
+ *   LoRa, e-ink, battery and fingerprint drivers, mesh_rx_handler.c,
+ *   ledger_validation.c, tiny_json_parser.c).
+ *   radio_sim.c, flash_sim.c, secure_element_sim.c and board_sim.c
+ *   stand in for the hardware. simulations/radio_mesh/run_mesh_sim.sh
+ *   does all of this and runs the sweep in radio_mesh_overview.md.
+ *
+ * Host builds only: compile with -DSEED_HOST_SIM.
+ */
+
+#ifdef SEED_HOST_SIM
+
+#include "mesh_sim.h"
+#include "radio_airtime.h"
+#include "radio_sim.h"
+#include "packet_pool.h"
+#include "timekeeping.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <ucontext.h>
+
+/* -------------------------------------------------------
+ *  Internal State
+ * ------------------------------------------------------- */
+
+#define SIM_NODE_NONE            0xFFFF
+#define SIM_FRAME_NONE           0xFFFFFFFFu
+#define SIM_NEVER                0xFFFFFFFFu
+
+// How often a node's ledger is checked for tracked transactions, and
+// how long a transaction is followed before it counts as not converged
+#define SIM_CHECK_INTERVAL_US    1000000ULL
+#define SIM_TRACK_TIMEOUT_US     (3600ULL * 1000000ULL)
+
+// Firmware state of the linked node image (absent in other host builds)
+extern char __start_seed_node_state[] __attribute__((weak));
+extern char __stop_seed_node_state[] __attribute__((weak));
+
+typedef enum {
+    SIM_EV_BOOT = 0,
+    SIM_EV_WAKE,
+    SIM_EV_TX_END,
+    SIM_EV_ORIGINATE
+} sim_event_type_t;
+
+typedef struct {
+    uint64_t at_us;
+    uint64_t order;              // FIFO among events at the same time
+    uint32_t arg;
+    uint16_t node;
+    uint8_t  type;
+} sim_event_t;
+
+typedef struct {
+    uint16_t node;
+    int8_t   rssi;
+} sim_link_t;
+
+typedef struct {
+    double      x, y;
+    uint32_t    component;
+    sim_link_t *links;           // nodes that can hear this one
+    uint16_t    link_count;
+    ucontext_t  ctx;
+    void       *stack;
+    uint8_t    *state;           // this node's copy of the firmware statics
+    uint32_t    wake_gen;        // invalidates WAKE events once resumed
+    uint64_t    radio_free_us;   // end of this node's last transmission
+    uint32_t    frames;          // its live frames, newest first
+    uint64_t    next_check_us;
+    uint32_t    checked_stamp;   // ledger_stamp at the last full check
+    uint32_t    next_seq;
+    bool        booted;
+    bool        halted;          // boot() returned
+} sim_node_t;
+
+typedef struct {
+    uint64_t start_us;
+    uint64_t end_us;
+    uint16_t sender;
+    uint16_t len;
+    bool     live;               // slot holds a frame; indices stay stable
+    uint32_t next_of_sender;     // sender's next older live frame
+    uint8_t  data[PACKET_BUF_SIZE];
+} sim_frame_t;
+
+typedef struct {
+    uint64_t created_us;
+    uint32_t seq;
+    uint16_t origin;
+    uint16_t have;
+    uint16_t target;             // nodes in the origin's component
+} sim_tracked_tx_t;
+
+static mesh_sim_config_t   cfg;
+static mesh_sim_node_ops_t ops;
+static mesh_sim_stats_t    stats;
+
+static sim_node_t  *nodes           = NULL;
+static uint32_t    *component_size  = NULL;
+static uint64_t     now_us          = 0;
+static uint64_t     rng_state       = 0;
+
+static sim_event_t *events          = NULL;   // binary min-heap
+static uint32_t     event_count     = 0;
+static uint32_t     event_cap       = 0;
+static uint64_t     event_order     = 0;
+
+static sim_frame_t *frames          = NULL;   // on air or recently ended
+static uint32_t     frame_count     = 0;      // slots ever used
+static uint32_t     frame_cap       = 0;
+static uint32_t    *frame_free      = NULL;   // stack of released slots
+static uint32_t     frame_free_count = 0;
+static uint64_t     max_airtime_us  = 0;
+
+static sim_tracked_tx_t *tracked    = NULL;
+static uint32_t    *active          = NULL;   // tracked, not yet converged
+static uint32_t     active_count    = 0;
+static uint8_t     *seen            = NULL;   // node × tracked bitmap
+static uint32_t     seen_stride     = 0;
+
+static ucontext_t   sim_ctx;
+static size_t       state_bytes     = 0;
+static uint8_t     *boot_state      = NULL;   // image statics before any node ran
+static uint16_t     loaded          = SIM_NODE_NONE;
+static uint16_t     running         = SIM_NODE_NONE;
+
+/* -------------------------------------------------------
+ *  Random Numbers (xorshift64*, deterministic per seed)
+ * ------------------------------------------------------- */
+
+static uint64_t rng_next(void)
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 2685821657736338717ULL;
+}
+
+// Uniform in (0, 1]
+static double rng_unit(void)
+{
+    return (double)((rng_next() >> 11) + 1) / 9007199254740992.0;
+}
+
+static double rng_gauss(void)
+{
+    return sqrt(-2.0 * log(rng_unit())) * cos(2.0 * M_PI * rng_unit());
+}
+
+static uint64_t rng_exp_us(uint32_t mean_s)
+{
+    return (uint64_t)(-log(rng_unit()) * (double)mean_s * 1e6);
+}
+
+/* -------------------------------------------------------
+ *  Event Queue
+ * ------------------------------------------------------- */
+
+static bool event_before(const sim_event_t *a, const sim_event_t *b)
+{
+    return a->at_us != b->at_us ? a->at_us < b->at_us : a->order < b->order;
+}
+
+static void event_push(uint64_t at_us, sim_event_type_t type, uint16_t node, uint32_t arg)
+{
+    if (event_count == event_cap) {
+        event_cap = event_cap ? event_cap * 2 : 1024;
+        events = realloc(events, event_cap * sizeof(*events));
+    }
+
+    sim_event_t ev = { at_us, event_order++, arg, node, (uint8_t)type };
+    uint32_t i = event_count++;
+
+    while (i > 0 && event_before(&ev, &events[(i - 1) / 2])) {
+        events[i] = events[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    events[i] = ev;
+}
+
+static sim_event_t event_pop(void)
+{
+    sim_event_t top  = events[0];
+    sim_event_t last = events[--event_count];
+    uint32_t i = 0;
+
+    for (;;) {
+        uint32_t c = 2 * i + 1;
+        if (c >= event_count)
+            break;
+        if (c + 1 < event_count && event_before(&events[c + 1], &events[c]))
+            c++;
+        if (!event_before(&events[c], &last))
+            break;
+        events[i] = events[c];
+        i = c;
+    }
+    if (event_count > 0)
+        events[i] = last;
+    return top;
+}
+
+/* -------------------------------------------------------
+ *  Topology
+ * ------------------------------------------------------- */
+
+static void link_add(uint16_t from, uint16_t to, int8_t rssi)
+{
+    sim_node_t *n = &nodes[from];
+
+    n->links = realloc(n->links, (n->link_count + 1u) * sizeof(sim_link_t));
+    n->links[n->link_count].node = to;
+    n->links[n->link_count].rssi = rssi;
+    n->link_count++;
+}
+
+static void build_topology(void)
+{
+    for (uint16_t i = 0; i < cfg.node_count; i++) {
+        nodes[i].x = rng_unit() * cfg.area_m;
+        nodes[i].y = rng_unit() * cfg.area_m;
+    }
+
+    for (uint16_t a = 0; a < cfg.node_count; a++) {
+        for (uint16_t b = a + 1; b < cfg.node_count; b++) {
+            double d = hypot(nodes[a].x - nodes[b].x, nodes[a].y - nodes[b].y);
+            if (d < 1.0)
+                d = 1.0;
+
+            double loss = cfg.path_loss_db_1m
+                        + cfg.path_loss_exp_x10 * log10(d)
+                        + cfg.shadowing_sigma_db * rng_gauss();
+            double rssi = cfg.tx_power_dbm - loss;
+
+            if (rssi < cfg.sensitivity_dbm)
+                continue;
+            if (rssi > 0)
+                rssi = 0;
+
+            link_add(a, b, (int8_t)lround(rssi));
+            link_add(b, a, (int8_t)lround(rssi));
+        }
+    }
+
+    // Connected components bound what each transaction can reach
+    uint16_t *queue = malloc(cfg.node_count * sizeof(uint16_t));
+    uint32_t comp = 0;
+
+    for (uint16_t i = 0; i < cfg.node_count; i++)
+        nodes[i].component = SIM_NEVER;
+
+    for (uint16_t i = 0; i < cfg.node_count; i++) {
+        if (nodes[i].component != SIM_NEVER)
+            continue;
+
+        uint32_t head = 0, tail = 0;
+        queue[tail++] = i;
+        nodes[i].component = comp;
+        component_size[comp] = 0;
+
+        while (head < tail) {
+            sim_node_t *n = &nodes[queue[head++]];
+            component_size[comp]++;
+
+            for (uint16_t l = 0; l < n->link_count; l++) {
+                sim_node_t *m = &nodes[n->links[l].node];
+                if (m->component == SIM_NEVER) {
+                    m->component = comp;
+                    queue[tail++] = n->links[l].node;
+                }
+            }
+        }
+        comp++;
+    }
+    free(queue);
+}
+
+/* -------------------------------------------------------
+ *  Node Contexts
+ * ------------------------------------------------------- */
+
+// Swap the firmware statics of node k into the image
+static void load_node(uint16_t k)
+{
+    if (loaded == k)
+        return;
+
+    if (loaded != SIM_NODE_NONE)
+        memcpy(nodes[loaded].state, __start_seed_node_state, state_bytes);
+    memcpy(__start_seed_node_state, nodes[k].state, state_bytes);
+
+    loaded = k;
+    stats.context_switches++;
+}
+
+static void node_entry(int k)
+{
+    ops.boot((uint16_t)k);
+
+    // Firmware returned: the node is dead from here on
+    nodes[k].halted = true;
+    for (;;)
+        swapcontext(&nodes[k].ctx, &sim_ctx);
+}
+
+static void track_check(uint16_t k);
+
+// Run node k until its scheduler goes idle again
+static void resume_node(uint16_t k)
+{
+    sim_node_t *n = &nodes[k];
+    if (n->halted)
+        return;
+
+    load_node(k);
+    n->wake_gen++;
+    running = k;
+    swapcontext(&sim_ctx, &n->ctx);
+    running = SIM_NODE_NONE;
+
+    if (now_us >= n->next_check_us) {
+        n->next_check_us = now_us + SIM_CHECK_INTERVAL_US;
+        track_check(k);
+    }
+}
+
+/* -------------------------------------------------------
+ *  Transaction Tracking
+ * ------------------------------------------------------- */
+
+static bool seen_get(uint16_t node, uint32_t t)
+{
+    return seen[node * seen_stride + t / 8] & (1u << (t % 8));
+}
+
+static void seen_set(uint16_t node, uint32_t t)
+{
+    seen[node * seen_stride + t / 8] |= (uint8_t)(1u << (t % 8));
+}
+
+static void track_retire(uint32_t a)
+{
+    active[a] = active[--active_count];
+}
+
+// Record which tracked transactions node k (already loaded) now holds.
+// A ledger that has not changed since the last check holds nothing new.
+static void track_check(uint16_t k)
+{
+    if (ops.ledger_stamp != NULL && nodes[k].booted) {
+        uint32_t stamp = ops.ledger_stamp(k);
+        if (stamp == nodes[k].checked_stamp)
+            return;
+        nodes[k].checked_stamp = stamp;
+    }
+
+    for (uint32_t a = 0; a < active_count; ) {
+        uint32_t t = active[a];
+        sim_tracked_tx_t *tx = &tracked[t];
+
+        if (now_us - tx->created_us > SIM_TRACK_TIMEOUT_US) {
+            track_retire(a);
+            continue;
+        }
+
+        if (!seen_get(k, t) &&
+            nodes[k].component == nodes[tx->origin].component &&
+            ops.has(k, tx->origin, tx->seq)) {
+            seen_set(k, t);
+            tx->have++;
+            stats.tx_deliveries++;
+
+            if (tx->have == tx->target) {
+                uint64_t ms = (now_us - tx->created_us) / 1000;
+                stats.tx_converged++;
+                stats.convergence_ms_sum += ms;
+                if (ms > stats.convergence_ms_max)
+                    stats.convergence_ms_max = (uint32_t)ms;
+                track_retire(a);
+                continue;
+            }
+        }
+        a++;
+    }
+}
+
+static void track_new(uint16_t origin, uint32_t seq)
+{
+    if (stats.tx_tracked >= cfg.max_tracked_tx)
+        return;
+
+    uint32_t t = stats.tx_tracked++;
+    tracked[t].created_us = now_us;
+    tracked[t].seq        = seq;
+    tracked[t].origin     = origin;
+    tracked[t].have       = 1;
+    tracked[t].target     = (uint16_t)component_size[nodes[origin].component];
+    seen_set(origin, t);
+
+    stats.tx_delivery_targets += tracked[t].target - 1u;
+    if (tracked[t].target == 1)
+        stats.tx_converged++;
+    else
+        active[active_count++] = t;
+}
+
+/* -------------------------------------------------------
+ *  Channel
+ * ------------------------------------------------------- */
+
+static bool frames_overlap(const sim_frame_t *a, const sim_frame_t *b)
+{
+    return a->start_us < b->end_us && b->start_us < a->end_us;
+}
+
+// Did node k send a frame, other than frames[index], overlapping it?
+static bool node_sent_during(uint16_t k, uint32_t index)
+{
+    for (uint32_t i = nodes[k].frames; i != SIM_FRAME_NONE; i = frames[i].next_of_sender) {
+        if (i != index && frames_overlap(&frames[index], &frames[i]))
+            return true;
+    }
+    return false;
+}
+
+// Does frames[index] survive at receiver r? Only r's own neighbors can
+// interfere there, so the cost follows node degree, not network size.
+static bool frame_received(uint32_t index, uint16_t r, int8_t rssi)
+{
+    const sim_node_t *n = &nodes[r];
+
+    if (node_sent_during(r, index)) {
+        stats.lost_half_duplex++;
+        return false;
+    }
+
+    // Links are symmetric, so r's link to a neighbor carries the level
+    // that neighbor is heard at
+    for (uint16_t l = 0; l < n->link_count; l++) {
+        if (rssi - n->links[l].rssi < cfg.capture_db &&
+            node_sent_during(n->links[l].node, index)) {
+            stats.lost_collision++;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Release frames that can no longer overlap anything still to end
+static void frames_prune(void)
+{
+    for (uint32_t i = 0; i < frame_count; i++) {
+        if (frames[i].live && frames[i].end_us + max_airtime_us < now_us) {
+            uint32_t *link = &nodes[frames[i].sender].frames;
+
+            while (*link != i)
+                link = &frames[*link].next_of_sender;
+            *link = frames[i].next_of_sender;
+
+            frames[i].live = false;
+            frame_free[frame_free_count++] = i;
+        }
+    }
+}
+
+static void frame_end(uint32_t index)
+{
+    sim_frame_t f = frames[index];
+    uint16_t    s = f.sender;
+
+    for (uint16_t l = 0; l < nodes[s].link_count; l++) {
+        uint16_t r    = nodes[s].links[l].node;
+        int8_t   rssi = nodes[s].links[l].rssi;
+
+        if (!nodes[r].booted || nodes[r].halted)
+            continue;
+        if (!frame_received(index, r, rssi))
+            continue;
+
+        stats.receptions++;
+        load_node(r);
+        (void)radio_sim_deliver(f.data, f.len, rssi);
+        resume_node(r);
+    }
+
+    frames_prune();
+}
+
+/* -------------------------------------------------------
+ *  Hooks Called by the Node Image
+ * ------------------------------------------------------- */
+
+// Clock HAL: every node reads the virtual clock
+uint32_t time_now_ms(void)        { return (uint32_t)(now_us / 1000); }
+uint64_t timekeeping_millis(void) { return now_us / 1000; }
+
+uint16_t mesh_sim_current_node(void)
+{
+    return running;
+}
+
+// Scheduler idle hook: park the node until its deadline or an event
+void mesh_sim_node_idle(uint32_t deadline_ms)
+{
+    uint16_t    k = running;
+    sim_node_t *n = &nodes[k];
+
+    if (deadline_ms != SIM_NEVER) {
+        int32_t  delta = (int32_t)(deadline_ms - time_now_ms());
+        uint64_t at    = now_us + (delta > 0 ? (uint64_t)delta * 1000 : 0);
+        event_push(at, SIM_EV_WAKE, k, n->wake_gen);
+    }
+
+    swapcontext(&n->ctx, &sim_ctx);
+}
+
+// radio_sim TX hook: the frame goes on air once the node's radio is free
+void mesh_sim_transmit(const uint8_t *frame, uint16_t len)
+{
+    uint16_t k = running;
+
+    if (k == SIM_NODE_NONE || len > PACKET_BUF_SIZE)
+        return;
+
+    uint32_t slot;
+    if (frame_free_count > 0) {
+        slot = frame_free[--frame_free_count];
+    } else {
+        if (frame_count == frame_cap) {
+            frame_cap  = frame_cap ? frame_cap * 2 : 64;
+            frames     = realloc(frames, frame_cap * sizeof(*frames));
+            frame_free = realloc(frame_free, frame_cap * sizeof(*frame_free));
+        }
+        slot = frame_count++;
+    }
+
+    sim_node_t  *n   = &nodes[k];
+    uint32_t     toa = airtime_time_on_air_us(len);
+    sim_frame_t *f   = &frames[slot];
+
+    f->start_us = (n->radio_free_us > now_us) ? n->radio_free_us : now_us;
+    f->end_us   = f->start_us + toa;
+    f->sender   = k;
+    f->len      = len;
+    f->live     = true;
+    memcpy(f->data, frame, len);
+
+    f->next_of_sender = n->frames;
+    n->frames         = slot;
+
+    n->radio_free_us = f->end_us;
+    stats.frames_sent++;
+    stats.airtime_us += toa;
+
+    event_push(f->end_us, SIM_EV_TX_END, k, slot);
+}
+
+/* -------------------------------------------------------
+ *  Public API
+ * ------------------------------------------------------- */
+
+void mesh_sim_default_config(mesh_sim_config_t *c)
+{
+    memset(c, 0, sizeof(*c));
+    c->node_count         = 100;
+    c->area_m             = 2000;
+    c->seed               = 1;
+    c->tx_power_dbm       = 14;
+    c->sensitivity_dbm    = -123;
+    c->path_loss_db_1m    = 40;
+    c->path_loss_exp_x10  = 30;
+    c->shadowing_sigma_db = 6;
+    c->capture_db         = 6;
+    c->tx_mean_interval_s = 3600;
+    c->boot_spread_ms     = 10000;
+    c->max_tracked_tx     = 256;
+    c->stack_size         = 256 * 1024;
+}
+
+bool mesh_sim_init(const mesh_sim_config_t *c, const mesh_sim_node_ops_t *node_ops)
+{
+    if (c == NULL || node_ops == NULL || node_ops->boot == NULL ||
+        c->node_count == 0 || c->node_count == SIM_NODE_NONE)
+        return false;
+
+    // Without a renamed node image every node would share one state
+    state_bytes = (size_t)(__stop_seed_node_state - __start_seed_node_state);
+    if (__start_seed_node_state == NULL || (state_bytes == 0 && c->node_count > 1))
+        return false;
+
+    mesh_sim_free();
+
+    // After a run the image holds the last loaded node's statics, so keep
+    // the initial ones from the first init for every later run to boot from
+    if (boot_state == NULL) {
+        boot_state = malloc(state_bytes ? state_bytes : 1);
+        if (boot_state == NULL)
+            return false;
+        memcpy(boot_state, __start_seed_node_state, state_bytes);
+    }
+
+    cfg = *c;
+    ops = *node_ops;
+    memset(&stats, 0, sizeof(stats));
+    stats.node_state_bytes = (uint32_t)state_bytes;
+
+    now_us         = 0;
+    rng_state      = 0x9E3779B97F4A7C15ULL ^ cfg.seed;
+    max_airtime_us = airtime_time_on_air_us(PACKET_BUF_SIZE);
+
+    nodes          = calloc(cfg.node_count, sizeof(sim_node_t));
+    component_size = calloc(cfg.node_count, sizeof(uint32_t));
+    tracked        = calloc(cfg.max_tracked_tx + 1u, sizeof(sim_tracked_tx_t));
+    active         = calloc(cfg.max_tracked_tx + 1u, sizeof(uint32_t));
+    seen_stride    = (cfg.max_tracked_tx + 7u) / 8u;
+    seen           = calloc((size_t)cfg.node_count * seen_stride + 1u, 1);
+
+    build_topology();
+
+    for (uint16_t k = 0; k < cfg.node_count; k++) {
+        sim_node_t *n = &nodes[k];
+
+        n->frames = SIM_FRAME_NONE;
+
+        // Every node boots from the image's initial statics
+        n->state = malloc(state_bytes ? state_bytes : 1);
+        memcpy(n->state, boot_state, state_bytes);
+        n->stack = malloc(cfg.stack_size);
+
+        getcontext(&n->ctx);
+        n->ctx.uc_stack.ss_sp   = n->stack;
+        n->ctx.uc_stack.ss_size = cfg.stack_size;
+        n->ctx.uc_link          = NULL;
+        makecontext(&n->ctx, (void (*)(void))node_entry, 1, (int)k);
+
+        uint64_t boot_at = cfg.boot_spread_ms
+                         ? (rng_next() % cfg.boot_spread_ms) * 1000ULL : 0;
+        event_push(boot_at, SIM_EV_BOOT, k, 0);
+
+        if (ops.originate != NULL && cfg.tx_mean_interval_s > 0)
+            event_push(boot_at + rng_exp_us(cfg.tx_mean_interval_s), SIM_EV_ORIGINATE, k, 0);
+    }
+    return true;
+}
+
+/**
+ * Advance the virtual clock by duration_ms, processing every event in
+ * that window. May be called repeatedly to run in stages.
+ */
+void mesh_sim_run(uint64_t duration_ms)
+{
+    uint64_t end_us = now_us + duration_ms * 1000ULL;
+
+    while (event_count > 0 && events[0].at_us <= end_us) {
+        sim_event_t ev = event_pop();
+        sim_node_t *n  = &nodes[ev.node];
+
+        now_us = ev.at_us;
+        stats.events++;
+
+        switch (ev.type) {
+            case SIM_EV_BOOT:
+                n->booted = true;
+                resume_node(ev.node);
+                break;
+
+            case SIM_EV_WAKE:
+                if (ev.arg == n->wake_gen)
+                    resume_node(ev.node);
+                break;
+
+            case SIM_EV_TX_END:
+                frame_end(ev.arg);
+                break;
+
+            case SIM_EV_ORIGINATE:
+                if (!n->halted) {
+                    uint32_t seq = n->next_seq++;
+
+                    load_node(ev.node);
+                    stats.tx_created++;
+                    if (ops.originate(ev.node, seq))
+                        track_new(ev.node, seq);
+                    resume_node(ev.node);
+                }
+                event_push(now_us + rng_exp_us(cfg.tx_mean_interval_s),
+                           SIM_EV_ORIGINATE, ev.node, 0);
+                break;
+        }
+    }
+
+    now_us = end_us;
+    stats.sim_time_ms = now_us / 1000;
+}
+
+void mesh_sim_get_stats(mesh_sim_stats_t *out)
+{
+    if (out != NULL)
+        *out = stats;
+}
+
+void mesh_sim_for_each_node(void (*fn)(uint16_t node, void *ctx), void *ctx)
+{
+    if (nodes == NULL || fn == NULL)
+        return;
+
+    for (uint16_t k = 0; k < cfg.node_count; k++) {
+        load_node(k);
+        fn(k, ctx);
+    }
+}
+
+void mesh_sim_free(void)
+{
+    if (nodes != NULL) {
+        for (uint16_t k = 0; k < cfg.node_count; k++) {
+            free(nodes[k].links);
+            free(nodes[k].stack);
+            free(nodes[k].state);
+        }
+    }
+    free(nodes);
+    free(component_size);
+    free(events);
+    free(frames);
+    free(frame_free);
+    free(tracked);
+    free(active);
+    free(seen);
+
+    nodes = NULL;
+    component_size = NULL;
+    events = NULL;
+    frames = NULL;
+    frame_free = NULL;
+    tracked = NULL;
+    active = NULL;
+    seen = NULL;
+    event_count = event_cap = 0;
+    frame_count = frame_cap = frame_free_count = 0;
+    active_count = 0;
+    loaded = running = SIM_NODE_NONE;
+}
+
+/* -------------------------------------------------------
+ *  Standalone Runner (-DMESH_SIM_MAIN)
+ * ------------------------------------------------------- */
+
+#ifdef MESH_SIM_MAIN
+
+#include "event_scheduler.h"
+#include "flash_sim.h"
+#include "secure_element_sim.h"
+#include "ledger_manager.h"
+#include "ledger_storage.h"
+#include "main_loop.h"
+#include "mesh_dedup.h"
+#include "mesh_gossip.h"
+
+#include <stdio.h>
+#include <time.h>
+
+static uint16_t sim_nodes;
+
+static void sim_tx_id(char *out, size_t size, uint16_t origin, uint32_t seq)
+{
+    snprintf(out, size, "sim-%u-%lu", (unsigned)origin, (unsigned long)seq);
+}
+
+static void sim_node_boot(uint16_t node)
+{
+    flash_sim_config_t flash;
+
+    flash_sim_default_config(&flash);
+    (void)flash_sim_open(NULL, &flash);
+    secure_element_sim_set_identity(node);
+
+    radio_sim_set_tx_hook(mesh_sim_transmit);
+    sched_set_idle_hook(mesh_sim_node_idle);
+    main_loop();
+}
+
+static bool sim_node_originate(uint16_t node, uint32_t seq)
+{
+    ledger_tx_t tx;
+
+    memset(&tx, 0, sizeof(tx));
+    sim_tx_id(tx.tx_id, sizeof(tx.tx_id), node, seq);
+    snprintf(tx.sender, sizeof(tx.sender), "node-%u", (unsigned)node);
+    snprintf(tx.receiver, sizeof(tx.receiver), "node-%u", (unsigned)((node + 1u) % sim_nodes));
+    snprintf(tx.device_id, sizeof(tx.device_id), "sim-%u", (unsigned)node);
+    tx.amount = 1.0f;
+
+    return seed_submit_transaction(&tx);
+}
+
+static bool sim_node_has(uint16_t node, uint16_t origin, uint32_t seq)
+{
+    char id[TX_ID_LEN];
+
+    (void)node;
+    sim_tx_id(id, sizeof(id), origin, seq);
+    return ledger_storage_transaction_exists(id);
+}
+
+// Every store, merge or compaction programs flash
+static uint32_t sim_node_ledger_stamp(uint16_t node)
+{
+    (void)node;
+    return ledger_storage_get_bytes_written();
+}
+
+// Relay and duplicate counts summed over every node
+typedef struct {
+    uint64_t relayed;
+    uint64_t lookups;
+    uint64_t duplicates;
+} sim_relay_totals_t;
+
+static void sim_node_add_relays(uint16_t node, void *ctx)
+{
+    sim_relay_totals_t *t = ctx;
+    mesh_gossip_stats_t gossip;
+    mesh_dedup_stats_t  dedup;
+
+    (void)node;
+    mesh_gossip_get_stats(&gossip);
+    mesh_dedup_get_stats(&dedup);
+    t->relayed    += gossip.relayed;
+    t->lookups    += dedup.lookups;
+    t->duplicates += dedup.duplicates;
+}
+
+/*
+ * usage: mesh_sim [-s seed] [days] [node counts...]
+ * Defaults to one simulated day at 10, 25 and 100 nodes, at the
+ * same node density (the area grows with the node count). The seed
+ * picks the placement, shadowing and workload (default 1).
+ */
+int main(int argc, char **argv)
+{
+    static const uint16_t default_counts[] = { 10, 25, 100 };
+    const mesh_sim_node_ops_t node_ops = { sim_node_boot, sim_node_originate, sim_node_has,
+                                           sim_node_ledger_stamp };
+    uint32_t seed = 1;
+
+    if (argc > 2 && strcmp(argv[1], "-s") == 0) {
+        seed  = (uint32_t)strtoul(argv[2], NULL, 0);
+        argc -= 2;
+        argv += 2;
+    }
+
+    double days = (argc > 1) ? atof(argv[1]) : 1.0;
+    int    runs = (argc > 2) ? argc - 2 : 3;
+
+    printf("%6s %9s %8s %10s %10s %9s %9s %9s %9s %10s %10s %8s\n",
+           "nodes", "sim_h", "wall_s", "speedup", "frames", "relays", "dup_%", "coll_%",
+           "deliv_%", "conv_%", "conv_avg_s", "air_ms/tx");
+
+    for (int i = 0; i < runs; i++) {
+        mesh_sim_config_t c;
+        mesh_sim_stats_t  s;
+
+        mesh_sim_default_config(&c);
+        c.seed       = seed;
+        c.node_count = (argc > 2) ? (uint16_t)atoi(argv[i + 2]) : default_counts[i];
+        c.area_m     = (uint32_t)(sqrt(c.node_count / 25.0) * 1000.0);   // 25 nodes/km²
+        sim_nodes    = c.node_count;
+
+        if (!mesh_sim_init(&c, &node_ops)) {
+            fprintf(stderr, "mesh_sim: node image not linked (see mesh_sim.c)\n");
+            return 1;
+        }
+
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        mesh_sim_run((uint64_t)(days * 86400000.0));
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        mesh_sim_get_stats(&s);
+
+        sim_relay_totals_t relays = { 0, 0, 0 };
+        mesh_sim_for_each_node(sim_node_add_relays, &relays);
+
+        double wall   = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+        double heard  = (double)s.receptions + s.lost_collision + s.lost_half_duplex;
+
+        printf("%6u %9.1f %8.1f %9.0fx %10u %9lu %9.2f %9.2f %9.2f %10.2f %10.1f %8.1f\n",
+               (unsigned)c.node_count, s.sim_time_ms / 3600000.0, wall,
+               wall > 0 ? (s.sim_time_ms / 1000.0) / wall : 0.0,
+               s.frames_sent, (unsigned long)relays.relayed,
+               relays.lookups ? 100.0 * relays.duplicates / relays.lookups : 0.0,
+               heard > 0 ? 100.0 * s.lost_collision / heard : 0.0,
+               s.tx_delivery_targets ? 100.0 * s.tx_deliveries / s.tx_delivery_targets : 100.0,
+               s.tx_tracked ? 100.0 * s.tx_converged / s.tx_tracked : 0.0,
+               s.tx_converged ? s.convergence_ms_sum / 1000.0 / s.tx_converged : 0.0,
+               s.tx_created ? s.airtime_us / 1000.0 / s.tx_created : 0.0);
+
+        mesh_sim_free();
+    }
+    return 0;
+}
+
+#endif // MESH_SIM_MAIN
+
+#endif // SEED_HOST_SIM
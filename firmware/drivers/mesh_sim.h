@@ -0,0 +1,90 @@
+#ifndef MESH_SIM_H
+#define MESH_SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Host-only discrete-event mesh simulator (build with -DSEED_HOST_SIM).
+ * Runs N copies of the real firmware image as virtual nodes on one
+ * virtual clock and a shared LoRa channel. See mesh_sim.c for how the
+ * node image is built.
+ */
+
+// Firmware entry points the simulator calls with the node's state loaded
+typedef struct {
+    // Runs on the node's own stack and is not expected to return;
+    // normally sets the hooks below and enters main_loop()
+    void (*boot)(uint16_t node);
+
+    // Create transaction `seq` originated by this node
+    bool (*originate)(uint16_t node, uint32_t seq);
+
+    // Whether this node's ledger holds transaction `seq` of `origin`
+    bool (*has)(uint16_t node, uint16_t origin, uint32_t seq);
+
+    // Optional: a value that changes whenever the node's ledger does.
+    // Tracked transactions are only looked up again once it moves.
+    uint32_t (*ledger_stamp)(uint16_t node);
+} mesh_sim_node_ops_t;
+
+typedef struct {
+    uint16_t node_count;
+    uint32_t area_m;              // nodes placed uniformly in an area_m square
+    uint32_t seed;
+
+    // Channel: log-distance path loss with per-link log-normal shadowing
+    int16_t  tx_power_dbm;
+    int16_t  sensitivity_dbm;     // weakest frame that can be decoded
+    uint16_t path_loss_db_1m;
+    uint16_t path_loss_exp_x10;   // 30 = exponent 3.0
+    uint8_t  shadowing_sigma_db;
+    uint8_t  capture_db;          // margin to survive an overlapping frame
+
+    // Workload
+    uint32_t tx_mean_interval_s;  // per node, exponentially distributed
+    uint32_t boot_spread_ms;      // nodes power up at random within this
+    uint32_t max_tracked_tx;      // transactions followed for convergence
+    uint32_t stack_size;          // per-node firmware stack
+} mesh_sim_config_t;
+
+typedef struct {
+    uint64_t sim_time_ms;
+    uint64_t events;
+    uint64_t context_switches;
+    uint32_t node_state_bytes;    // firmware state swapped per node
+
+    // Channel
+    uint32_t frames_sent;
+    uint64_t airtime_us;
+    uint64_t receptions;          // frame decoded by a neighbor
+    uint64_t lost_collision;
+    uint64_t lost_half_duplex;    // neighbor was transmitting itself
+
+    // Transactions
+    uint32_t tx_created;
+    uint32_t tx_tracked;
+    uint32_t tx_converged;        // reached every node in origin's component
+    uint64_t tx_deliveries;       // (tx, node) pairs delivered
+    uint64_t tx_delivery_targets; // (tx, node) pairs reachable
+    uint64_t convergence_ms_sum;
+    uint32_t convergence_ms_max;
+} mesh_sim_stats_t;
+
+void mesh_sim_default_config(mesh_sim_config_t *cfg);
+bool mesh_sim_init(const mesh_sim_config_t *cfg, const mesh_sim_node_ops_t *ops);
+void mesh_sim_run(uint64_t duration_ms);
+void mesh_sim_get_stats(mesh_sim_stats_t *out);
+
+// Call fn with each node's firmware state loaded, e.g. to read module
+// statistics after a run (before mesh_sim_free)
+void mesh_sim_for_each_node(void (*fn)(uint16_t node, void *ctx), void *ctx);
+
+void mesh_sim_free(void);
+
+// Hooks for the node image: scheduler idle hook and radio_sim TX hook
+void     mesh_sim_node_idle(uint32_t deadline_ms);
+void     mesh_sim_transmit(const uint8_t *frame, uint16_t len);
+uint16_t mesh_sim_current_node(void);
+
+#endif
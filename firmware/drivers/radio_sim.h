@@ -0,0 +1,35 @@
+#ifndef RADIO_SIM_H
+#define RADIO_SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Host-only LoRa receiver emulator (build with -DSEED_HOST_SIM).
+ * Injected frames land in a one-frame FIFO and raise the DIO
+ * interrupt, i.e. call radio_dio_isr() there and then, the way the
+ * real interrupt preempts the main loop.
+ */
+
+typedef struct {
+    uint32_t injected;         // frames put on the air
+    uint32_t transmitted;      // frames the firmware sent
+    int32_t  last_rssi;
+} radio_sim_stats_t;
+
+// Receives every frame the firmware transmits, framed as on air
+typedef void (*radio_sim_tx_hook_t)(const uint8_t *frame, uint16_t len);
+
+void     radio_sim_reset(void);
+bool     radio_sim_inject(uint8_t msg_type, const uint8_t *payload, uint16_t len, int8_t rssi);
+bool     radio_sim_deliver(const uint8_t *frame, uint16_t len, int8_t rssi);
+void     radio_sim_set_tx_hook(radio_sim_tx_hook_t hook);
+void     radio_sim_get_stats(radio_sim_stats_t *out);
+
+// Used by radio_interface.c's hardware hooks
+uint16_t radio_sim_read_fifo(uint8_t *buffer, uint16_t max_len);
+int8_t   radio_sim_packet_rssi(void);
+int8_t   radio_sim_packet_snr(void);
+void     radio_sim_transmit(const uint8_t *frame, uint16_t len);
+
+#endif
@@ -0,0 +1,122 @@
+/*
+ * secure_element_sim.c
+ * -----------------------------------------
+ * Seed Device Firmware — Host Secure Element Simulator
+ *
+ * Purpose:
+ *   Provides the secure_element_* HAL on a Linux dev box so storage,
+ *   ledger and mesh code that signs or verifies can run in host
+ *   benchmarks and in mesh_sim.c.
+ *
+ * Model:
+ *   - A signature is eight SipHash-2-4 tags of the message, one per
+ *     8-byte lane, under a fixed simulation key
+ *   - Random bytes come from a xorshift generator seeded per identity,
+ *     so runs are reproducible
+ *
+ * Host builds only: compile with -DSEED_HOST_SIM.
+ */
+
+#ifdef SEED_HOST_SIM
+
+#include "secure_element_sim.h"
+#include "siphash.h"
+
+#include <string.h>
+
+/* -------------------------------------------------------
+ *  Internal State
+ * ------------------------------------------------------- */
+
+#define SE_SIM_K0   0x5365656453696d31ULL   // "SeedSim1"
+#define SE_SIM_K1   0x5369676e4b657931ULL   // "SignKey1"
+
+static uint32_t identity = 0;
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+static secure_element_sim_stats_t stats;
+
+static void tag_message(const uint8_t *msg, size_t msg_len, uint8_t *sig)
+{
+    for (uint8_t lane = 0; lane < SECURE_ELEMENT_SIM_SIG_LEN / 8; lane++) {
+        uint64_t t = siphash24(SE_SIM_K0 ^ lane, SE_SIM_K1, msg, msg_len);
+        memcpy(sig + lane * 8, &t, 8);
+    }
+}
+
+/* -------------------------------------------------------
+ *  Public API
+ * ------------------------------------------------------- */
+
+void secure_element_sim_set_identity(uint32_t node_id)
+{
+    identity  = node_id;
+    rng_state = 0x9E3779B97F4A7C15ULL ^ ((uint64_t)node_id * 0xBF58476D1CE4E5B9ULL);
+    memset(&stats, 0, sizeof(stats));
+}
+
+void secure_element_sim_get_stats(secure_element_sim_stats_t *out)
+{
+    if (out != NULL)
+        *out = stats;
+}
+
+/* -------------------------------------------------------
+ *  Secure Element HAL
+ * ------------------------------------------------------- */
+
+bool secure_element_read_device_keys(uint8_t *pub_key_out, uint8_t *priv_key_placeholder_out)
+{
+    if (pub_key_out != NULL) {
+        uint8_t id[4] = { (uint8_t)(identity >> 24), (uint8_t)(identity >> 16),
+                          (uint8_t)(identity >> 8), (uint8_t)identity };
+        uint8_t full[SECURE_ELEMENT_SIM_SIG_LEN];
+        tag_message(id, sizeof(id), full);
+        memcpy(pub_key_out, full, 32);
+    }
+    if (priv_key_placeholder_out != NULL)
+        memset(priv_key_placeholder_out, 0, 64);
+    return true;
+}
+
+bool secure_element_sign(const uint8_t *msg, size_t msg_len, uint8_t *sig_out, size_t *sig_len_inout)
+{
+    if ((msg == NULL && msg_len > 0) || sig_out == NULL || sig_len_inout == NULL ||
+        *sig_len_inout < SECURE_ELEMENT_SIM_SIG_LEN)
+        return false;
+
+    tag_message(msg, msg_len, sig_out);
+    *sig_len_inout = SECURE_ELEMENT_SIM_SIG_LEN;
+    stats.signs++;
+    return true;
+}
+
+bool secure_element_verify(const uint8_t *msg, size_t msg_len, const uint8_t *sig, size_t sig_len)
+{
+    uint8_t expect[SECURE_ELEMENT_SIM_SIG_LEN];
+
+    stats.verifies++;
+    if ((msg == NULL && msg_len > 0) || sig == NULL || sig_len < SECURE_ELEMENT_SIM_SIG_LEN) {
+        stats.verify_failures++;
+        return false;
+    }
+
+    tag_message(msg, msg_len, expect);
+    if (memcmp(expect, sig, SECURE_ELEMENT_SIM_SIG_LEN) != 0) {
+        stats.verify_failures++;
+        return false;
+    }
+    return true;
+}
+
+bool secure_element_random_bytes(uint8_t *buf, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        rng_state ^= rng_state << 13;
+        rng_state ^= rng_state >> 7;
+        rng_state ^= rng_state << 17;
+        buf[i] = (uint8_t)(rng_state >> 24);
+    }
+    return true;
+}
+
+#endif // SEED_HOST_SIM
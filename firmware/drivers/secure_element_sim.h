@@ -0,0 +1,33 @@
+#ifndef SECURE_ELEMENT_SIM_H
+#define SECURE_ELEMENT_SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Host-only secure element emulator (build with -DSEED_HOST_SIM).
+ * Signatures are SipHash tags under one simulation-wide key, so any
+ * simulated node can check any other's, the way a public-key check
+ * would. They are NOT signatures; this only exercises the code paths.
+ */
+
+#define SECURE_ELEMENT_SIM_SIG_LEN   64
+
+typedef struct {
+    uint32_t signs;
+    uint32_t verifies;
+    uint32_t verify_failures;
+} secure_element_sim_stats_t;
+
+// Stable per-node identity for the device key readout
+void secure_element_sim_set_identity(uint32_t node_id);
+void secure_element_sim_get_stats(secure_element_sim_stats_t *out);
+
+// The secure element HAL security_module.c links against
+bool secure_element_read_device_keys(uint8_t *pub_key_out, uint8_t *priv_key_placeholder_out);
+bool secure_element_sign(const uint8_t *msg, size_t msg_len, uint8_t *sig_out, size_t *sig_len_inout);
+bool secure_element_verify(const uint8_t *msg, size_t msg_len, const uint8_t *sig, size_t sig_len);
+bool secure_element_random_bytes(uint8_t *buf, size_t len);
+
+#endif
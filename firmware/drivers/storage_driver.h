@@ -0,0 +1,14 @@
+#ifndef STORAGE_DRIVER_H
+#define STORAGE_DRIVER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+bool     storage_driver_read(uint32_t addr, uint8_t *buffer, uint32_t size);
+bool     storage_driver_write(uint32_t addr, const uint8_t *data, uint32_t size);
+bool     storage_driver_read_checkpoint(uint8_t *buffer, uint32_t size);
+bool     storage_driver_write_checkpoint(const uint8_t *data, uint32_t size);
+bool     storage_driver_erase(uint32_t addr, uint32_t size);
+bool     storage_driver_secure_wipe_region(uint32_t addr, uint32_t size);
+
+#endif
@@ -24,8 +24,6 @@
 #include "ledger_validation.h"
 #include "ledger_storage.h"
 #include "device_config.h"
-#include "tiny_json_parser.h"
-#include "safe_memory.h"
 
 #include <stdint.h>
 #include <string.h>
@@ -34,11 +32,76 @@
  * INTERNAL HELPER STRUCTURES
  * -------------------------------------------------------------*/
 
+/* Incoming transactions are merged in batches of at most this many.
+ * RAM use is bounded by the batch, not by the ledger size. Imports
+ * arrive in chunks of one signature batch (VERIFY_BATCH_MAX), so a
+ * larger batch would only sit idle. */
+#define CONFLICT_MAX_BATCH      32u
+#define DISPLACED_FIFO_LEN      (CONFLICT_MAX_BATCH + 1u)
+
 typedef struct {
-    transaction_t tx;
+    ledger_tx_t tx;
     uint8_t valid;
 } merge_entry_t;
 
+/* tx_id → batch[] position, open addressing with linear probing.
+ * Twice the batch size keeps probe chains short. */
+#define MERGE_HASH_SLOTS   (2u * CONFLICT_MAX_BATCH)
+#define MERGE_HASH_EMPTY   0xFFFFu
+
+static uint16_t merge_hash[MERGE_HASH_SLOTS];
+
+static merge_entry_t batch[CONFLICT_MAX_BATCH];
+
+/* Log positions of local records replaced by a winning incoming version */
+static uint32_t superseded[CONFLICT_MAX_BATCH];
+
+/* Old records (and their stored validity) read ahead of the write
+ * cursor during a suffix rewrite. The write cursor can only run ahead
+ * of the read cursor by the number of batch entries inserted so far,
+ * so this never exceeds the batch. */
+static merge_entry_t displaced[DISPLACED_FIFO_LEN];
+
+static conflict_merge_stats_t last_stats;
+
+
+/* -------------------------------------------------------------
+ * merge_hash_*()
+ *
+ * Hashed tx_id lookup used to de-duplicate the incoming batch,
+ * instead of a linear strcmp scan over every staged entry.
+ * -------------------------------------------------------------*/
+static uint32_t merge_hash_tx_id(const char *tx_id)
+{
+    uint32_t h = 2166136261u;   /* FNV-1a */
+    for (uint32_t i = 0; i < TX_ID_LEN && tx_id[i] != '\0'; i++) {
+        h ^= (uint8_t)tx_id[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void merge_hash_reset(void)
+{
+    memset(merge_hash, 0xFF, sizeof(merge_hash));
+}
+
+/* Returns the slot holding tx_id, or the empty slot where it belongs. */
+static uint16_t *merge_hash_slot(const merge_entry_t *entries, const char *tx_id)
+{
+    uint32_t pos = merge_hash_tx_id(tx_id) % MERGE_HASH_SLOTS;
+
+    for (uint32_t probe = 0; probe < MERGE_HASH_SLOTS; probe++) {
+        uint16_t *slot = &merge_hash[(pos + probe) % MERGE_HASH_SLOTS];
+
+        if (*slot == MERGE_HASH_EMPTY ||
+            strncmp(entries[*slot].tx.tx_id, tx_id, TX_ID_LEN) == 0) {
+            return slot;
+        }
+    }
+    return NULL;
+}
+
 
 /* -------------------------------------------------------------
  * compare_transactions()
@@ -46,16 +109,22 @@ typedef struct {
  * Deterministic ordering rule:
  *   1. Sort by Lamport timestamp (ascending)
  *   2. If equal, sort by device_id (ASCII lexical order)
+ *   3. If still equal, sort by tx_id, so two versions of one
+ *      device's transaction still have a fixed order
  *
  * This ensures all devices apply transactions in identical order.
  * -------------------------------------------------------------*/
-static int compare_transactions(const transaction_t *a, const transaction_t *b)
+static int compare_transactions(const ledger_tx_t *a, const ledger_tx_t *b)
 {
     if (a->lamport < b->lamport) return -1;
     if (a->lamport > b->lamport) return  1;
 
     /* tie-breaker: device ID string comparison */
-    return strcmp(a->device_id, b->device_id);
+    int comp = strncmp(a->device_id, b->device_id, DEVICE_ID_LEN);
+    if (comp != 0) {
+        return comp;
+    }
+    return strncmp(a->tx_id, b->tx_id, TX_ID_LEN);
 }
 
 
@@ -69,8 +138,8 @@ static int compare_transactions(const transaction_t *a, const transaction_t *b)
  *
  * Prevents tampering, replay attacks, inconsistent histories.
  * -------------------------------------------------------------*/
-static transaction_t resolve_duplicate(const transaction_t *local,
-                                       const transaction_t *incoming)
+static ledger_tx_t resolve_duplicate(const ledger_tx_t *local,
+                                       const ledger_tx_t *incoming)
 {
     int comp = compare_transactions(local, incoming);
 
@@ -87,28 +156,35 @@ static transaction_t resolve_duplicate(const transaction_t *local,
 /* -------------------------------------------------------------
  * merge_transaction()
  *
- * Adds an incoming transaction into the ledger buffer.
+ * Adds an incoming transaction into the batch buffer.
  * Handles:
- *   - Duplicate detection
+ *   - Duplicate detection within the batch
  *   - Deterministic conflict resolution
  *   - Idempotency (safe repeat imports)
  * -------------------------------------------------------------*/
 static void merge_transaction(merge_entry_t *entries,
                               uint32_t *count,
-                              const transaction_t *incoming)
+                              const ledger_tx_t *incoming)
 {
-    for (uint32_t i = 0; i < *count; i++) {
-        if (strcmp(entries[i].tx.tx_id, incoming->tx_id) == 0) {
+    uint16_t *slot = merge_hash_slot(entries, incoming->tx_id);
+    if (slot == NULL) {
+        return;
+    }
 
-            /* found matching ID, resolve duplicate */
-            entries[i].tx = resolve_duplicate(&entries[i].tx, incoming);
-            return;
-        }
+    if (*slot != MERGE_HASH_EMPTY) {
+        /* found matching ID, resolve duplicate */
+        entries[*slot].tx = resolve_duplicate(&entries[*slot].tx, incoming);
+        return;
+    }
+
+    if (*count >= CONFLICT_MAX_BATCH) {
+        return;
     }
 
     /* New transaction — add to buffer */
-    safe_memcpy(&entries[*count].tx, incoming, sizeof(transaction_t));
+    entries[*count].tx = *incoming;
     entries[*count].valid = 1;
+    *slot = (uint16_t)*count;
     (*count)++;
 }
 
@@ -116,8 +192,9 @@ static void merge_transaction(merge_entry_t *entries,
 /* -------------------------------------------------------------
  * sort_entries()
  *
- * Basic insertion sort — chosen because the number of incoming
- * transactions per sync cycle is small.
+ * Basic insertion sort — only the incoming batch is sorted, and
+ * it is bounded by CONFLICT_MAX_BATCH. The on-flash log is
+ * already in deterministic order.
  *
  * Ensures consistency across all devices.
  * -------------------------------------------------------------*/
@@ -136,54 +213,347 @@ static void sort_entries(merge_entry_t *entries, uint32_t count)
 }
 
 
+/* -------------------------------------------------------------
+ * stage_batch()
+ *
+ * De-duplicates a chunk of incoming transactions against each
+ * other and against the stored log (via the tx_id index, which
+ * also answers for compacted history), drops malformed or badly
+ * signed ones, and returns how many remain in batch[]. Funds are
+ * not checked here: they depend on where each transaction lands
+ * in the log, which merge_suffix() decides.
+ *
+ * If an incoming version beats a stored one with the same ID,
+ * the stored record's log position is remembered so the merge
+ * skips it.
+ * -------------------------------------------------------------*/
+static uint32_t stage_batch(const ledger_tx_t *incoming,
+                            uint32_t count,
+                            uint32_t *superseded_count)
+{
+    uint32_t staged = 0;
+    uint32_t kept = 0;
+
+    merge_hash_reset();
+    for (uint32_t i = 0; i < count; i++) {
+        merge_transaction(batch, &staged, &incoming[i]);
+    }
+
+    *superseded_count = 0;
+    for (uint32_t i = 0; i < staged; i++) {
+        ledger_tx_t local;
+        uint32_t local_index = 0;
+        bool stored = ledger_storage_find_tx_index(batch[i].tx.tx_id, &local_index) &&
+                      ledger_storage_load_tx(local_index, &local);
+
+        /* Same rule as resolve_duplicate(): local wins ties */
+        if (stored && compare_transactions(&local, &batch[i].tx) >= 0) {
+            continue;
+        }
+        /* Settled by compaction, or too late to go in front of it */
+        if (!stored && ledger_storage_tx_known(&batch[i].tx)) {
+            continue;
+        }
+        if (!ledger_validate_tx(&batch[i].tx) ||
+            !ledger_validation_check_signature(&batch[i].tx)) {
+            continue;
+        }
+        if (stored) {
+            superseded[(*superseded_count)++] = local_index;
+        }
+
+        batch[kept++] = batch[i];
+    }
+
+    return kept;
+}
+
+
+/* -------------------------------------------------------------
+ * find_insert_position()
+ *
+ * Binary search over the ordered log for the first record that
+ * sorts after `first`. Everything before it is untouched by the
+ * merge. O(log n) record reads. Compacted history is settled, so
+ * the search never goes below the log base.
+ * -------------------------------------------------------------*/
+static uint32_t find_insert_position(const ledger_tx_t *first,
+                                     uint32_t log_count)
+{
+    uint32_t lo = ledger_storage_get_base_index();
+    uint32_t hi = log_count;
+
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        ledger_tx_t probe;
+
+        if (!ledger_storage_load_tx(mid, &probe)) {
+            return mid;   /* unreadable record: rewrite from here */
+        }
+
+        if (compare_transactions(&probe, first) <= 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static bool is_superseded(uint32_t index, uint32_t superseded_count)
+{
+    for (uint32_t i = 0; i < superseded_count; i++) {
+        if (superseded[i] == index) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/* -------------------------------------------------------------
+ * merge_suffix()
+ *
+ * Streams the sorted batch against the on-flash log starting at
+ * the first divergence point. A read cursor walks the old log and
+ * a write cursor emits the merged order; old records about to be
+ * overwritten are parked in the displaced FIFO first.
+ *
+ * Balances are first rolled back to the log prefix in front of
+ * the divergence point, then every record from there on is
+ * revalidated in Lamport order, as the full rebuild used to do.
+ * An incoming transaction its sender cannot cover at its place
+ * is dropped, like an overspend on the apply path; stored ones
+ * keep their slot and are only marked invalid.
+ * Once the batch is drained and both cursors line up again, the
+ * remaining log is already in place: it is only rewritten where
+ * a record's validity flipped.
+ * -------------------------------------------------------------*/
+static void merge_suffix(uint32_t staged, uint32_t superseded_count)
+{
+    uint32_t old_count = ledger_storage_get_tx_count();
+    uint32_t start = find_insert_position(&batch[0].tx, old_count);
+    ledger_tx_t tx;
+    bool valid;
+
+    for (uint32_t i = 0; i < superseded_count; i++) {
+        if (superseded[i] < start) {
+            start = superseded[i];
+        }
+    }
+
+    if (last_stats.rewrite_from > start) {
+        last_stats.rewrite_from = start;
+    }
+
+    for (uint32_t i = start; i < old_count; i++) {
+        if (ledger_storage_load_tx_status(i, &tx, &valid) && valid) {
+            ledger_storage_adjust_balance(NULL, &tx);
+        }
+    }
+
+    uint32_t r = start;         /* next old record to read */
+    uint32_t w = start;         /* next log position to write */
+    uint32_t b = 0;             /* next batch entry */
+    uint32_t head = 0;
+    uint32_t queued = 0;
+    bool aligned = false;
+
+    while (b < staged || queued > 0 || r < old_count) {
+        if (b == staged && queued == 0 && r == w) {
+            aligned = true;
+            break;
+        }
+
+        /* Park every old record the write cursor is about to cover,
+         * and keep at least one buffered for comparison. */
+        while (r < old_count && (r <= w || queued == 0)) {
+            merge_entry_t *slot = &displaced[(head + queued) % DISPLACED_FIFO_LEN];
+
+            if (!is_superseded(r, superseded_count) &&
+                ledger_storage_load_tx_status(r, &slot->tx, &valid)) {
+                slot->valid = valid;
+                queued++;
+            }
+            r++;
+        }
+
+        if (b == staged && queued == 0) {
+            break;
+        }
+
+        bool from_batch;
+        if (queued == 0) {
+            from_batch = true;
+        } else if (b == staged) {
+            from_batch = false;
+        } else {
+            from_batch = compare_transactions(&batch[b].tx, &displaced[head].tx) < 0;
+        }
+
+        merge_entry_t *next = from_batch ? &batch[b] : &displaced[head];
+        valid = ledger_check_double_spend(&next->tx);
+
+        if (from_batch && !valid) {
+            b++;
+            continue;
+        }
+        if (!ledger_storage_rewrite_tx(w, &next->tx, valid)) {
+            break;
+        }
+        if (valid) {
+            ledger_storage_adjust_balance(&next->tx, NULL);
+        }
+
+        if (from_batch) {
+            last_stats.accepted++;
+            b++;
+        } else {
+            if (valid != (next->valid != 0)) {
+                last_stats.revalidated++;
+            }
+            head = (head + 1) % DISPLACED_FIFO_LEN;
+            queued--;
+        }
+
+        w++;
+        last_stats.records_written++;
+    }
+
+    /* The rest of the log is already in place. Its records still
+     * count toward balances, and one is rewritten in place only if
+     * its verdict changed. After a failed write nothing is
+     * revalidated: balances just follow what is left on flash. */
+    for (uint32_t i = w; i < old_count; i++) {
+        bool was_valid;
+
+        if (!ledger_storage_load_tx_status(i, &tx, &was_valid)) {
+            continue;
+        }
+
+        valid = aligned ? ledger_check_double_spend(&tx) : was_valid;
+        if (valid != was_valid) {
+            if (ledger_storage_rewrite_tx(i, &tx, valid)) {
+                last_stats.revalidated++;
+                last_stats.records_written++;
+            } else {
+                valid = was_valid;
+            }
+        }
+        if (valid) {
+            ledger_storage_adjust_balance(&tx, NULL);
+        }
+    }
+}
+
+
+/* -------------------------------------------------------------
+ * append_batch()
+ *
+ * The sorted batch lands entirely behind the stored log: nothing
+ * moves and nothing stored changes verdict, so the batch is just
+ * appended in order, group-committed like any import. Each entry
+ * is funds-checked against balances that include the ones staged
+ * before it; uncovered ones are dropped.
+ * -------------------------------------------------------------*/
+static void append_batch(uint32_t staged)
+{
+    bool grouped = ledger_storage_begin_batch();
+    uint32_t appended = 0;
+
+    for (uint32_t i = 0; i < staged; i++) {
+        if (!ledger_check_double_spend(&batch[i].tx)) {
+            continue;
+        }
+        if (!ledger_storage_store_tx(&batch[i].tx)) {
+            break;
+        }
+        appended++;
+    }
+
+    /* A failed group is rolled back as a whole */
+    if (grouped && !ledger_storage_commit_batch()) {
+        appended = 0;
+    }
+
+    last_stats.accepted        += appended;
+    last_stats.records_written += appended;
+}
+
+
 /* -------------------------------------------------------------
  * conflict_resolution_run()
  *
- * HIGH-LEVEL WORKFLOW:
+ * HIGH-LEVEL WORKFLOW (per batch of CONFLICT_MAX_BATCH):
  *
- *   1. Load all local transactions
- *   2. Merge all incoming transactions
- *   3. Sort deterministically using Lamport + device_id rules
- *   4. Re-validate transactions in global order
- *   5. Write merged ledger back to storage
+ *   1. De-duplicate incoming against itself and the stored log
+ *   2. Check format and sort the batch deterministically using
+ *      Lamport + device_id rules
+ *   3. Binary-search the log for the first divergence point
+ *   4. Stream-merge the batch into the log from that point,
+ *      stopping as soon as the old suffix is back in place
+ *   5. Re-validate funds from that point on in global order
+ *
+ * The common case — incoming transactions newer than anything
+ * stored — is a pure append (append_batch()), one group commit
+ * per batch. Only a late, low-Lamport arrival
+ * forces a (bounded) suffix rewrite; the rest of the suffix is
+ * read to revalidate it but only rewritten where a verdict
+ * flips.
  *
  * This process is deterministic, offline-first, and guarantees
  * every Seed device reaches the **same final ledger state**.
  * -------------------------------------------------------------*/
-void conflict_resolution_run(const transaction_t *incoming,
+void conflict_resolution_run(const ledger_tx_t *incoming,
                              uint32_t incoming_count)
 {
-    /* 1. Load existing ledger into RAM buffer */
-    transaction_t local[MAX_LEDGER_ENTRIES];
-    uint32_t local_count = ledger_storage_load_all(local);
+    uint32_t bytes_before = ledger_storage_get_bytes_written();
 
-    merge_entry_t merged[MAX_LEDGER_ENTRIES];
-    uint32_t merged_count = 0;
+    memset(&last_stats, 0, sizeof(last_stats));
+    last_stats.incoming     = incoming_count;
+    last_stats.rewrite_from = ledger_storage_get_tx_count();
 
-    /* Insert local entries */
-    for (uint32_t i = 0; i < local_count; i++) {
-        safe_memcpy(&merged[merged_count].tx, &local[i], sizeof(transaction_t));
-        merged[merged_count].valid = 1;
-        merged_count++;
-    }
+    for (uint32_t offset = 0; offset < incoming_count; offset += CONFLICT_MAX_BATCH) {
+        uint32_t chunk = incoming_count - offset;
+        if (chunk > CONFLICT_MAX_BATCH) {
+            chunk = CONFLICT_MAX_BATCH;
+        }
 
-    /* 2. Merge incoming entries */
-    for (uint32_t i = 0; i < incoming_count; i++) {
-        merge_transaction(merged, &merged_count, &incoming[i]);
-    }
+        uint32_t superseded_count = 0;
+        uint32_t staged = stage_batch(&incoming[offset], chunk, &superseded_count);
+        if (staged == 0) {
+            continue;
+        }
 
-    /* 3. Sort deterministically */
-    sort_entries(merged, merged_count);
+        sort_entries(batch, staged);
 
-    /* 4. Revalidate in deterministic order */
-    for (uint32_t i = 0; i < merged_count; i++) {
-        merged[i].valid = ledger_validate_transaction(&merged[i].tx);
+        if (superseded_count == 0 &&
+            batch[0].tx.lamport > ledger_storage_get_max_lamport()) {
+            append_batch(staged);
+        } else {
+            merge_suffix(staged, superseded_count);
+        }
     }
 
-    /* 5. Save final consistent ledger back to storage */
-    ledger_storage_clear();
-    for (uint32_t i = 0; i < merged_count; i++) {
-        ledger_storage_write(&merged[i].tx, merged[i].valid);
+    /* Re-checkpoint if a record below the last checkpoint moved */
+    ledger_storage_end_rewrite();
+
+    last_stats.flash_bytes_written = ledger_storage_get_bytes_written() - bytes_before;
+}
+
+
+/* -------------------------------------------------------------
+ * conflict_resolution_get_last_stats()
+ *
+ * Exposes what the last merge cost in flash writes so tests and
+ * field diagnostics can track wear per sync.
+ * bench/conflict_resolution_bench.c reports it for appends,
+ * late arrivals at several depths and re-imports.
+ * -------------------------------------------------------------*/
+void conflict_resolution_get_last_stats(conflict_merge_stats_t *out)
+{
+    if (out) {
+        *out = last_stats;
     }
 }
 
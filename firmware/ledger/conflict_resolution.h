@@ -4,7 +4,18 @@
 #include <stdbool.h>
 #include "ledger_manager.h"
 
+typedef struct {
+    uint32_t incoming;             // transactions offered to the merge
+    uint32_t accepted;             // new or winning versions written
+    uint32_t rewrite_from;         // first log index touched
+    uint32_t records_written;      // records programmed (new + moved)
+    uint32_t revalidated;          // stored records whose validity flipped
+    uint32_t flash_bytes_written;  // records, tx_id index and any re-checkpoint
+} conflict_merge_stats_t;
+
 bool conflict_resolve(const ledger_tx_t *a, const ledger_tx_t *b);
 uint32_t conflict_compare(const ledger_tx_t *a, const ledger_tx_t *b);
+void conflict_resolution_run(const ledger_tx_t *incoming, uint32_t incoming_count);
+void conflict_resolution_get_last_stats(conflict_merge_stats_t *out);
 
 #endif
@@ -0,0 +1,159 @@
+/*************************************************************
+ * File: ledger_balance_index.c
+ * Layer: Firmware → Ledger Engine → Storage
+ * Description:
+ *    Per-account running balance index for Seed’s ledger.
+ *    Responsible for:
+ *        - O(1) balance lookups for validation and the UI
+ *        - Incremental updates on every persisted transaction
+ *        - A flat image that is stored inside ledger checkpoints
+ *
+ * NOTE:
+ *    The index is a cache of the append-only log, never the
+ *    source of truth. ledger_storage.c rebuilds it on boot from
+ *    the last checkpoint plus the tail of the log.
+ *************************************************************/
+
+#include "ledger_balance_index.h"
+#include <string.h>
+
+/**********************
+ * INTERNAL STATE
+ **********************/
+
+// Open-addressing table (linear probing), kept in the same layout
+// that is written to flash so checkpointing is a plain copy.
+static balance_index_image_t g_index;
+
+/*******************************************************
+ *  INTERNAL HELPERS
+ *******************************************************/
+
+// FNV-1a over the account ID string
+static uint32_t hash_account(const char *account_id)
+{
+    uint32_t h = 2166136261u;
+
+    for (uint32_t i = 0; i < SENDER_ID_LEN && account_id[i] != '\0'; i++) {
+        h ^= (uint8_t)account_id[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static balance_index_entry_t *find_entry(const char *account_id, bool create)
+{
+    const uint32_t mask = BALANCE_INDEX_MAX_ACCOUNTS - 1;
+    uint32_t pos = hash_account(account_id) & mask;
+
+    for (uint32_t probe = 0; probe < BALANCE_INDEX_MAX_ACCOUNTS; probe++) {
+        balance_index_entry_t *e = &g_index.entries[(pos + probe) & mask];
+
+        if (e->account_id[0] == '\0') {
+            if (!create)
+                return NULL;
+
+            // Keep the load factor bounded so probes stay short
+            if (g_index.used >= BALANCE_INDEX_MAX_LOAD) {
+                g_index.overflowed = 1;
+                return NULL;
+            }
+
+            strncpy(e->account_id, account_id, SENDER_ID_LEN - 1);
+            e->balance = 0.0f;
+            g_index.used++;
+            return e;
+        }
+
+        if (strncmp(e->account_id, account_id, SENDER_ID_LEN) == 0)
+            return e;
+    }
+
+    return NULL;
+}
+
+/*******************************************************
+ *  PUBLIC API IMPLEMENTATION
+ *******************************************************/
+
+void balance_index_reset(void)
+{
+    memset(&g_index, 0, sizeof(g_index));
+}
+
+void balance_index_apply(const ledger_tx_t *tx)
+{
+    if (tx == NULL)
+        return;
+
+    balance_index_entry_t *from = find_entry(tx->sender, true);
+    if (from)
+        from->balance -= tx->amount;
+
+    balance_index_entry_t *to = find_entry(tx->receiver, true);
+    if (to)
+        to->balance += tx->amount;
+}
+
+// Undo a previously applied transaction (superseded during a merge)
+void balance_index_revert(const ledger_tx_t *tx)
+{
+    if (tx == NULL)
+        return;
+
+    balance_index_entry_t *from = find_entry(tx->sender, true);
+    if (from)
+        from->balance += tx->amount;
+
+    balance_index_entry_t *to = find_entry(tx->receiver, true);
+    if (to)
+        to->balance -= tx->amount;
+}
+
+/**
+ * Returns false only when the index cannot answer authoritatively
+ * (the account is missing and the table has dropped accounts), in
+ * which case the caller must fall back to scanning the log.
+ */
+bool balance_index_lookup(const char *account_id, float *out_balance)
+{
+    if (account_id == NULL || out_balance == NULL)
+        return false;
+
+    const balance_index_entry_t *e = find_entry(account_id, false);
+    if (e) {
+        *out_balance = e->balance;
+        return true;
+    }
+
+    if (g_index.overflowed)
+        return false;
+
+    // Never seen in the log → zero balance
+    *out_balance = 0.0f;
+    return true;
+}
+
+/*******************************************************
+ * CHECKPOINT SUPPORT
+ *******************************************************/
+
+const balance_index_image_t *balance_index_image(void)
+{
+    return &g_index;
+}
+
+bool balance_index_restore(const balance_index_image_t *image)
+{
+    if (image == NULL || image->used > BALANCE_INDEX_MAX_ACCOUNTS) {
+        balance_index_reset();
+        return false;
+    }
+
+    memcpy(&g_index, image, sizeof(g_index));
+    return true;
+}
+
+/*************************************************************
+ * END FILE: ledger_balance_index.c
+ *************************************************************/
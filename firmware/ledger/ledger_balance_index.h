@@ -0,0 +1,29 @@
+#ifndef LEDGER_BALANCE_INDEX_H
+#define LEDGER_BALANCE_INDEX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ledger_manager.h"
+
+#define BALANCE_INDEX_MAX_ACCOUNTS   256   // must be a power of two
+#define BALANCE_INDEX_MAX_LOAD       ((BALANCE_INDEX_MAX_ACCOUNTS * 3) / 4)
+
+typedef struct {
+    char  account_id[SENDER_ID_LEN];   // empty string = free slot
+    float balance;
+} balance_index_entry_t;
+
+typedef struct {
+    uint32_t              used;
+    uint32_t              overflowed;  // non-zero once an account was dropped
+    balance_index_entry_t entries[BALANCE_INDEX_MAX_ACCOUNTS];
+} balance_index_image_t;
+
+void balance_index_reset(void);
+void balance_index_apply(const ledger_tx_t *tx);
+void balance_index_revert(const ledger_tx_t *tx);
+bool balance_index_lookup(const char *account_id, float *out_balance);
+const balance_index_image_t *balance_index_image(void);
+bool balance_index_restore(const balance_index_image_t *image);
+
+#endif
@@ -4,8 +4,8 @@
  * High-level ledger orchestration for Seed devices.
  * --------------------------------------------------
  * This module:
- *  - Owns the in-memory view of the ledger (balances + tx metadata)
- *  - Coordinates validation, application, and persistence of transactions
+ *  - Keeps the device's Lamport clock and signs the transactions it creates
+ *  - Coordinates validation and persistence of transactions (ledger_storage)
  *  - Exposes a small API for the rest of the firmware (UI, mesh, etc.)
  *
  * NOTE: This is “investor-ready” / prototype-level code:
@@ -16,51 +16,37 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <string.h>
 
 #include "ledger_manager.h"
 #include "ledger_storage.h"        // on-flash storage read/write
-#include "ledger_validation.h"     // balance checks, signature checks, etc.
+#include "ledger_validation.h"     // format and signature checks
+#include "ledger_record_codec.h"   // wire / snapshot record format
 #include "security_module.h"       // device keys, signatures
-#include "timekeeping.h"           // monotonic time / logical clock
 #include "crc16.h"                 // integrity checks for snapshots
+#include "verify_cache.h"          // signature verdict cache
+#include "conflict_resolution.h"   // ordered merge of late arrivals
 
 /* --------------------------------------------------------------------------
  *  Internal types
  * --------------------------------------------------------------------------*/
 
-/**
- * Simple in-memory representation of a transaction.
- * In the real implementation this should match the protocol / JSON schema.
- */
-typedef struct {
-    uint8_t  tx_id[LEDGER_TX_ID_LEN];     // unique transaction id (binary or hash)
-    char     sender[LEDGER_ID_STR_LEN];
-    char     receiver[LEDGER_ID_STR_LEN];
-    int32_t  amount_cents;                // store in smallest currency unit
-    uint32_t lamport;                     // logical clock from originating device
-    char     device_id[LEDGER_ID_STR_LEN];
-    uint8_t  prev_hash[LEDGER_HASH_LEN];  // optional: hash of previous tx / checkpoint
-    uint8_t  signature[LEDGER_SIG_LEN];   // detached signature
-    uint8_t  flags;                       // bit flags: pending / valid / invalid
-} ledger_tx_t;
+// Transactions applied before the ledger asks for a checkpoint
+#define LEDGER_SAVE_AFTER_TX     32
 
 /**
- * Aggregate state of the ledger in RAM.
- * This is the “truth” that UI and mesh layer read from.
+ * Aggregate state of the ledger in RAM. The transactions themselves
+ * live in ledger_storage; this is what the manager adds on top.
  */
 typedef struct {
-    uint32_t  last_applied_index;         // last applied tx index in storage
     uint32_t  logical_clock;              // local Lamport clock
-    int64_t   cached_balance_cents;       // cached balance for this device_id
+    uint32_t  unsaved;                    // applied since the last checkpoint
+    uint32_t  exported_through;           // log index the next snapshot starts at
+    uint32_t  created;                    // local transactions, for tx IDs
     bool      loaded;                     // has the ledger been loaded from flash?
 } ledger_state_t;
 
-/* Bit flags for ledger_tx_t.flags */
-#define LEDGER_FLAG_PENDING   (1u << 0)
-#define LEDGER_FLAG_VALID     (1u << 1)
-#define LEDGER_FLAG_INVALID   (1u << 2)
-
 /* --------------------------------------------------------------------------
  *  Static state
  * --------------------------------------------------------------------------*/
@@ -84,19 +70,13 @@ static uint32_t ledger_bump_clock(uint32_t external_clock_hint)
     return g_ledger_state.logical_clock;
 }
 
-/**
- * Update cached balance based on a newly-applied transaction.
- * This is a micro-optimization so we don’t recompute from scratch on every query.
- */
-static void ledger_update_cached_balance(const ledger_tx_t *tx,
-                                         const char *my_device_id)
+// (lamport, tx_id) order, the order every node sorts a range in
+static int ledger_tx_cmp(const ledger_tx_t *a, const ledger_tx_t *b)
 {
-    if (strncmp(tx->sender, my_device_id, LEDGER_ID_STR_LEN) == 0) {
-        g_ledger_state.cached_balance_cents -= tx->amount_cents;
-    }
-    if (strncmp(tx->receiver, my_device_id, LEDGER_ID_STR_LEN) == 0) {
-        g_ledger_state.cached_balance_cents += tx->amount_cents;
+    if (a->lamport != b->lamport) {
+        return (a->lamport < b->lamport) ? -1 : 1;
     }
+    return strncmp(a->tx_id, b->tx_id, TX_ID_LEN);
 }
 
 /* --------------------------------------------------------------------------
@@ -106,211 +86,323 @@ static void ledger_update_cached_balance(const ledger_tx_t *tx,
 void ledger_init(void)
 {
     memset(&g_ledger_state, 0, sizeof(g_ledger_state));
+}
 
-    // Load persisted metadata (last index, cached balance, logical clock)
-    ledger_meta_t meta;
-    if (ledger_storage_load_meta(&meta)) {
-        g_ledger_state.last_applied_index   = meta.last_applied_index;
-        g_ledger_state.logical_clock        = meta.logical_clock;
-        g_ledger_state.cached_balance_cents = meta.cached_balance_cents;
-        g_ledger_state.loaded               = true;
-    } else {
-        // Fresh device or corrupted meta → start from zero
-        g_ledger_state.last_applied_index   = 0;
-        g_ledger_state.logical_clock        = 0;
-        g_ledger_state.cached_balance_cents = 0;
-        g_ledger_state.loaded               = true;
-
-        // Persist default meta immediately
-        ledger_meta_t new_meta = {
-            .last_applied_index   = 0,
-            .logical_clock        = 0,
-            .cached_balance_cents = 0
-        };
-        ledger_storage_store_meta(&new_meta);
+/**
+ * Mount the on-flash ledger and pick the clock up where it left off.
+ * Everything already stored counts as exported.
+ */
+bool ledger_load_from_storage(void)
+{
+    if (!ledger_storage_init()) {
+        return false;
     }
+
+    g_ledger_state.logical_clock    = ledger_storage_get_max_lamport();
+    g_ledger_state.exported_through = ledger_storage_get_tx_count();
+    g_ledger_state.loaded           = true;
+    return true;
 }
 
 /**
- * Return the locally cached balance for this device.
- * NOTE: this is a single “owner” balance; multi-account support can extend this.
+ * Return the balance of any account, served from the storage layer's
+ * balance index instead of replaying the ledger.
  */
-int64_t ledger_get_cached_balance_cents(void)
+uint32_t ledger_get_balance(const char *user)
 {
-    return g_ledger_state.cached_balance_cents;
+    float balance = 0.0f;
+
+    if (!user || !ledger_storage_get_balance(user, &balance) || balance <= 0.0f) {
+        return 0;
+    }
+    return (uint32_t)balance;
 }
 
 /**
- * Build a new transaction object ready to be validated and stored.
- * The caller provides sender/receiver/amount; we attach clock + device id + signature.
+ * Fill in a new transaction from this device. The ID is the device ID
+ * plus a local counter; ledger_sign_tx() adds clock and signature.
  */
-bool ledger_build_transaction(const char *sender,
-                              const char *receiver,
-                              int32_t amount_cents,
-                              const char *device_id,
-                              ledger_tx_t *out_tx)
+bool ledger_create_transaction(const char *sender,
+                               const char *receiver,
+                               float amount,
+                               ledger_tx_t *out)
 {
-    if (!sender || !receiver || !device_id || !out_tx) {
+    if (!sender || !receiver || !out) {
         return false;
     }
-    if (amount_cents <= 0) {
+    if (amount <= 0.0f) {
         return false; // Seed does not support zero/negative transfers
     }
 
-    memset(out_tx, 0, sizeof(*out_tx));
+    memset(out, 0, sizeof(*out));
 
-    // Generate transaction id (using security module / RNG / hash)
-    if (!security_generate_tx_id(out_tx->tx_id, sizeof(out_tx->tx_id))) {
-        return false;
+    // Device ID: the start of the device's public key, in hex
+    const uint8_t *key = security_get_public_key();
+    for (uint32_t i = 0; i < (DEVICE_ID_LEN - 1) / 2; i++) {
+        snprintf(&out->device_id[2 * i], 3, "%02x", key[i]);
     }
 
-    // Copy identifiers
-    strncpy(out_tx->sender,   sender,   LEDGER_ID_STR_LEN - 1);
-    strncpy(out_tx->receiver, receiver, LEDGER_ID_STR_LEN - 1);
-    strncpy(out_tx->device_id, device_id, LEDGER_ID_STR_LEN - 1);
+    snprintf(out->tx_id, sizeof(out->tx_id), "%s-%lu",
+             out->device_id, (unsigned long)g_ledger_state.created++);
+    strncpy(out->sender,   sender,   SENDER_ID_LEN - 1);
+    strncpy(out->receiver, receiver, RECEIVER_ID_LEN - 1);
+    out->amount = amount;
 
-    // Attach amount and Lamport clock
-    out_tx->amount_cents = amount_cents;
-    out_tx->lamport      = ledger_bump_clock(0);
-
-    // Fetch previous hash / checkpoint from storage (optional chaining)
-    ledger_storage_get_latest_hash(out_tx->prev_hash, sizeof(out_tx->prev_hash));
+    return true;
+}
 
-    // Sign transaction using the device’s private key
-    if (!security_sign_transaction((const uint8_t *)out_tx,
-                                   sizeof(*out_tx) - LEDGER_SIG_LEN,
-                                   out_tx->signature,
-                                   sizeof(out_tx->signature))) {
+/**
+ * Stamp a local transaction with the next Lamport value and sign every
+ * byte in front of the signature with the device key. Unused bytes of
+ * the ID fields must be zero: receivers rebuild them that way.
+ */
+bool ledger_sign_tx(ledger_tx_t *tx)
+{
+    if (!tx) {
         return false;
     }
 
-    // Mark pending until fully validated and persisted
-    out_tx->flags = LEDGER_FLAG_PENDING;
+    tx->lamport = ledger_bump_clock(0);
+    return security_sign((const uint8_t *)tx, offsetof(ledger_tx_t, signature),
+                         tx->signature);
+}
 
-    return true;
+/**
+ * Account for what a merge stored: pull the clock past it and count
+ * it toward the next checkpoint. Returns how many were stored.
+ */
+static uint32_t ledger_note_merge(void)
+{
+    conflict_merge_stats_t stats;
+
+    conflict_resolution_get_last_stats(&stats);
+    if (ledger_storage_get_max_lamport() > g_ledger_state.logical_clock) {
+        g_ledger_state.logical_clock = ledger_storage_get_max_lamport();
+    }
+    g_ledger_state.unsaved += stats.accepted;
+    return stats.accepted;
 }
 
 /**
- * Validate and apply a transaction:
- *  - signature check
+ * Validate and store one transaction:
  *  - basic format checks
- *  - balance / double-spend checks
+ *  - signature check (through the verdict cache)
+ *  - replay / duplicate detection
+ *  - funds check against the balance index
  *  - persistence to flash
- *  - update of in-memory state
+ *
+ * The log is kept in (lamport, device_id) order. A transaction newer
+ * than everything stored is checked and appended; a late one is merged
+ * into place (conflict_resolution.c), which funds-checks it there.
  */
-ledger_apply_result_t ledger_apply_transaction(const ledger_tx_t *tx,
-                                               const char *my_device_id)
+bool ledger_apply_tx(const ledger_tx_t *tx)
 {
-    if (!tx || !my_device_id) {
-        return LEDGER_APPLY_ERROR_FORMAT;
+    if (!ledger_validate_tx(tx)) {
+        return false;
     }
-
-    // 1. Signature and basic format validation
     if (!ledger_validation_check_signature(tx)) {
-        return LEDGER_APPLY_INVALID_SIGNATURE;
+        return false;
     }
-    if (!ledger_validation_check_format(tx)) {
-        return LEDGER_APPLY_ERROR_FORMAT;
+    if (ledger_storage_tx_known(tx)) {
+        return false;
     }
 
-    // 2. Replay / duplicate detection
-    if (ledger_storage_transaction_exists(tx->tx_id)) {
-        return LEDGER_APPLY_DUPLICATE;
+    if (tx->lamport <= ledger_storage_get_max_lamport()) {
+        conflict_resolution_run(tx, 1);
+        return ledger_note_merge() > 0;
     }
 
-    // 3. Balance & double-spend checks (using a temporary simulated state)
-    ledger_balance_ctx_t balance_ctx;
-    ledger_storage_build_balance_context(&balance_ctx, tx->sender);
-
-    if (!ledger_validation_check_sufficient_funds(&balance_ctx, tx->amount_cents)) {
-        return LEDGER_APPLY_INSUFFICIENT_FUNDS;
+    if (!ledger_check_double_spend(tx)) {
+        return false;
     }
 
-    // 4. Persist transaction to storage
-    uint32_t new_index = 0;
-    if (!ledger_storage_append_transaction(tx, &new_index)) {
-        return LEDGER_APPLY_STORAGE_ERROR;
+    // Remote clocks pull ours forward, so our next tx orders after this one
+    if (tx->lamport > g_ledger_state.logical_clock) {
+        g_ledger_state.logical_clock = tx->lamport;
     }
 
-    // 5. Update meta (index, clock, cached balance)
-    g_ledger_state.last_applied_index = new_index;
-    ledger_update_cached_balance(tx, my_device_id);
-
-    ledger_meta_t meta = {
-        .last_applied_index   = g_ledger_state.last_applied_index,
-        .logical_clock        = g_ledger_state.logical_clock,
-        .cached_balance_cents = g_ledger_state.cached_balance_cents
-    };
-    ledger_storage_store_meta(&meta);
+    if (!ledger_storage_store_tx(tx)) {
+        return false;
+    }
 
-    return LEDGER_APPLY_OK;
+    g_ledger_state.unsaved++;
+    return true;
 }
 
 /**
- * Import a batch of transactions from mesh / USB / kiosk, reconcile, and apply.
+ * Import a batch of transactions from mesh / USB / kiosk and apply them.
  * This is the high-level "offline sync" entry point from the mesh stack.
+ * Returns how many were new and stored.
  */
-uint32_t ledger_import_batch(const ledger_tx_t *txs,
-                             uint32_t count,
-                             const char *my_device_id)
+uint32_t ledger_import_batch(const ledger_tx_t *txs, uint32_t count)
 {
-    if (!txs || count == 0 || !my_device_id) {
+    if (!txs || count == 0) {
         return 0;
     }
 
-    // 1. Pre-filter duplicates and obviously malformed txs
-    //    (in a real implementation, we might also sort by lamport/device_id here).
+    // One cache-full at a time: verify the signatures, then merge.
+    // The merge's per-tx signature check is a cache hit, and appends are
+    // group-committed. A larger window would evict its own verdicts.
     uint32_t applied = 0;
 
-    for (uint32_t i = 0; i < count; i++) {
-        const ledger_tx_t *tx = &txs[i];
+    for (uint32_t i = 0; i < count; i += VERIFY_BATCH_MAX) {
+        uint32_t n = count - i < VERIFY_BATCH_MAX ? count - i : VERIFY_BATCH_MAX;
 
-        // Update local Lamport clock based on incoming tx
-        ledger_bump_clock(tx->lamport);
+        (void)ledger_validation_check_signatures(&txs[i], n);
+        conflict_resolution_run(&txs[i], n);
+        applied += ledger_note_merge();
+    }
+
+    return applied;
+}
 
-        // Skip if already stored
-        if (ledger_storage_transaction_exists(tx->tx_id)) {
+/**
+ * Totals for the sync summary: highest Lamport value, and how many
+ * transactions are still stored (compacted history is not).
+ */
+void ledger_get_summary(uint32_t *last_lamport, uint32_t *tx_count)
+{
+    if (last_lamport) {
+        *last_lamport = ledger_storage_get_max_lamport();
+    }
+    if (tx_count) {
+        *tx_count = ledger_storage_get_tx_count() - ledger_storage_get_base_index();
+    }
+}
+
+/**
+ * The first transactions with Lamport >= from_lamport, in (lamport,
+ * tx_id) order, up to the smaller of max_count and max_out. The log
+ * is in Lamport order but breaks ties by device_id, so the first
+ * record is found by binary search and the rest is one pass keeping
+ * the lowest so far, which ends once Lamport passes a full page.
+ */
+uint32_t ledger_get_tx_batch(uint32_t from_lamport,
+                             uint32_t max_count,
+                             ledger_tx_t *out,
+                             uint32_t max_out)
+{
+    uint32_t limit = (max_count < max_out) ? max_count : max_out;
+    uint32_t n     = 0;
+    uint32_t lo    = ledger_storage_get_base_index();
+    uint32_t end   = ledger_storage_get_tx_count();
+    uint32_t hi    = end;
+    ledger_tx_t tx;
+
+    if (!out || limit == 0) {
+        return 0;
+    }
+
+    // Everything below lo is older than from_lamport. An unreadable
+    // probe ends the search; the pass below skips what it cannot read.
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+
+        if (!ledger_storage_load_tx(mid, &tx)) {
+            break;
+        }
+        if (tx.lamport < from_lamport) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    for (uint32_t i = lo; i < end; i++) {
+        if (!ledger_storage_load_tx(i, &tx) || tx.lamport < from_lamport) {
+            continue;
+        }
+        if (n == limit && tx.lamport > out[n - 1].lamport) {
+            break;
+        }
+        if (n == limit && ledger_tx_cmp(&tx, &out[n - 1]) >= 0) {
             continue;
         }
 
-        // Conflict resolution will be primarily handled by ordering rules
-        // inside ledger_validation / mesh-protocol sync. For now, we just
-        // run the normal apply path:
-        ledger_apply_result_t res = ledger_apply_transaction(tx, my_device_id);
-        if (res == LEDGER_APPLY_OK) {
-            applied++;
-        } else {
-            // TODO: track invalid / orphaned txs for diagnostics
+        uint32_t at = (n < limit) ? n++ : n - 1;
+        while (at > 0 && ledger_tx_cmp(&tx, &out[at - 1]) < 0) {
+            out[at] = out[at - 1];
+            at--;
         }
+        out[at] = tx;
     }
 
-    return applied;
+    return n;
+}
+
+/**
+ * Encode a transaction as one all-literal ledger record, with the full
+ * Lamport value in its delta field. out needs LEDGER_RECORD_MAX_BYTES.
+ */
+uint16_t ledger_tx_encode(const ledger_tx_t *tx, uint8_t *out)
+{
+    ledger_record_ctx_t ctx;
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.lamport_delta = (int32_t)tx->lamport;
+    ctx.sender_ref    = LEDGER_RECORD_NO_REF;
+    ctx.receiver_ref  = LEDGER_RECORD_NO_REF;
+    ctx.device_ref    = LEDGER_RECORD_NO_REF;
+    return ledger_record_encode(tx, &ctx, out);
+}
+
+// Inverse of ledger_tx_encode(); records that reference other records
+// only make sense inside a storage segment and are refused
+bool ledger_tx_decode(const uint8_t *data, uint16_t len, ledger_tx_t *tx_out)
+{
+    ledger_record_ctx_t ctx;
+
+    if (!ledger_record_decode(data, len, tx_out, &ctx) ||
+        ctx.sender_at == 0 || ctx.receiver_at == 0 || ctx.device_at == 0) {
+        return false;
+    }
+
+    tx_out->lamport = (uint32_t)ctx.lamport_delta;
+    return true;
 }
 
 /**
- * Export a compact snapshot of the ledger for sync.
- * This might be all transactions, or a rolling window, depending on design.
+ * Export the transactions stored since the last snapshot, as records
+ * back to back plus a CRC. Returns false if there is nothing new, so
+ * a quiet ledger sends nothing. What does not fit goes in the next one.
  */
 bool ledger_export_snapshot(uint8_t *buffer,
                             uint32_t buffer_size,
                             uint32_t *out_len)
 {
+    uint8_t     rec[LEDGER_RECORD_MAX_BYTES];
+    ledger_tx_t tx;
+    uint32_t    written = 0;
+    uint32_t    next    = g_ledger_state.exported_through;
+    uint32_t    end     = ledger_storage_get_tx_count();
+
     if (!buffer || !out_len) {
         return false;
     }
+    if (next < ledger_storage_get_base_index()) {
+        next = ledger_storage_get_base_index();
+    }
+
+    for (; next < end; next++) {
+        if (!ledger_storage_load_tx(next, &tx)) {
+            continue;
+        }
+
+        uint16_t len = ledger_tx_encode(&tx, rec);
+        if (written + len + sizeof(uint16_t) > buffer_size) {
+            break;
+        }
+        memcpy(buffer + written, rec, len);
+        written += len;
+    }
 
-    // Delegate to storage module to serialize a snapshot range.
-    // For now, we export the full ledger; later this can be incremental.
-    uint32_t written = 0;
-    if (!ledger_storage_stream_all(buffer, buffer_size, &written)) {
+    g_ledger_state.exported_through = next;
+    if (written == 0) {
         return false;
     }
 
     // Append a CRC to detect corruption in transit
     uint16_t crc = crc16_compute(buffer, written);
-    if (written + sizeof(crc) > buffer_size) {
-        return false;
-    }
     memcpy(buffer + written, &crc, sizeof(crc));
     written += sizeof(crc);
 
@@ -319,42 +411,54 @@ bool ledger_export_snapshot(uint8_t *buffer,
 }
 
 /**
- * Import a snapshot (e.g., from a kiosk, phone, or trusted Seed hub).
- * This is used for “fast sync” when a device has been offline for a long time.
+ * Apply a snapshot from a neighbor (ledger_export_snapshot() format).
+ * Each record is checked like any received transaction.
  */
-bool ledger_import_snapshot(const uint8_t *buffer,
-                            uint32_t length,
-                            const char *my_device_id)
+bool ledger_merge_remote(const uint8_t *data, uint16_t length)
 {
-    if (!buffer || length < sizeof(uint16_t) || !my_device_id) {
+    ledger_tx_t txs[LEDGER_EXPORT_MAX / 80];
+    uint32_t    count = 0;
+
+    if (!data || length < sizeof(uint16_t)) {
         return false;
     }
 
     // Verify CRC
-    uint32_t data_len = length - sizeof(uint16_t);
+    uint16_t data_len = (uint16_t)(length - sizeof(uint16_t));
     uint16_t expected_crc;
-    memcpy(&expected_crc, buffer + data_len, sizeof(expected_crc));
-
-    uint16_t actual_crc = crc16_compute(buffer, data_len);
-    if (actual_crc != expected_crc) {
+    memcpy(&expected_crc, data + data_len, sizeof(expected_crc));
+    if (crc16_compute(data, data_len) != expected_crc) {
         return false; // corrupted snapshot
     }
 
-    // Reset local ledger and reload from snapshot via storage layer
-    if (!ledger_storage_replace_from_snapshot(buffer, data_len)) {
-        return false;
+    for (uint16_t p = 0; p < data_len; p += (uint16_t)(data[p] + 1U)) {
+        if (p + data[p] + 1U > data_len ||
+            count == sizeof(txs) / sizeof(txs[0]) ||
+            !ledger_tx_decode(data + p, (uint16_t)(data[p] + 1U), &txs[count])) {
+            break;
+        }
+        count++;
     }
 
-    // Rebuild meta & cached balance
-    ledger_meta_t meta;
-    if (!ledger_storage_load_meta(&meta)) {
-        return false;
-    }
+    return ledger_import_batch(txs, count) > 0;
+}
 
-    g_ledger_state.last_applied_index   = meta.last_applied_index;
-    g_ledger_state.logical_clock        = meta.logical_clock;
-    g_ledger_state.cached_balance_cents = meta.cached_balance_cents;
-    g_ledger_state.loaded               = true;
+/**
+ * True once enough has been applied since the last checkpoint that the
+ * storage task should write one (ledger_save_to_storage()).
+ */
+bool ledger_has_pending_writes(void)
+{
+    return g_ledger_state.unsaved >= LEDGER_SAVE_AFTER_TX;
+}
 
-    return true;
+/**
+ * Write a checkpoint, so a reboot replays only what came after it.
+ * Records are already durable; this only bounds boot time.
+ */
+void ledger_save_to_storage(void)
+{
+    if (ledger_storage_checkpoint()) {
+        g_ledger_state.unsaved = 0;
+    }
 }
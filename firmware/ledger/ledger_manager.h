@@ -4,19 +4,46 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#define TX_ID_LEN        40
+#define SENDER_ID_LEN    32
+#define RECEIVER_ID_LEN  32
+#define SIG_LEN          64
+#define DEVICE_ID_LEN    16
+
+// Largest snapshot ledger_export_snapshot() builds for one sync round
+#define LEDGER_EXPORT_MAX   512
+
 typedef struct {
-    char tx_id[40];
-    char sender[32];
-    char receiver[32];
+    char tx_id[TX_ID_LEN];
+    char sender[SENDER_ID_LEN];
+    char receiver[RECEIVER_ID_LEN];
     float amount;
     uint32_t lamport;
-    char device_id[16];
+    char device_id[DEVICE_ID_LEN];
+    uint8_t signature[SIG_LEN];
 } ledger_tx_t;
 
 void ledger_init(void);
+bool ledger_load_from_storage(void);
+bool ledger_create_transaction(const char *sender, const char *receiver, float amount,
+                               ledger_tx_t *out);
+bool ledger_sign_tx(ledger_tx_t *tx);
 bool ledger_apply_tx(const ledger_tx_t *tx);
-void ledger_export(uint8_t *buffer, uint16_t *length_out);
-bool ledger_import(const uint8_t *buffer, uint16_t length);
+uint32_t ledger_import_batch(const ledger_tx_t *txs, uint32_t count);
 uint32_t ledger_get_balance(const char *user);
 
+// Sync views: totals, and stored transactions in (lamport, tx_id) order
+void ledger_get_summary(uint32_t *last_lamport, uint32_t *tx_count);
+uint32_t ledger_get_tx_batch(uint32_t from_lamport, uint32_t max_count,
+                             ledger_tx_t *out, uint32_t max_out);
+
+// One transaction on the wire: a standalone ledger record
+uint16_t ledger_tx_encode(const ledger_tx_t *tx, uint8_t *out);
+bool ledger_tx_decode(const uint8_t *data, uint16_t len, ledger_tx_t *tx_out);
+
+bool ledger_export_snapshot(uint8_t *buffer, uint32_t buffer_size, uint32_t *out_len);
+bool ledger_merge_remote(const uint8_t *data, uint16_t length);
+bool ledger_has_pending_writes(void);
+void ledger_save_to_storage(void);
+
 #endif
@@ -0,0 +1,303 @@
+/*************************************************************
+ * File: ledger_record_codec.c
+ * Layer: Firmware → Ledger Engine → Storage
+ * Description:
+ *    Compact, versioned on-flash encoding of one transaction.
+ *    Replaces the fixed 256-byte record with a length-prefixed
+ *    one that is typically 90–120 bytes.
+ *
+ * Record layout (LEDGER_RECORD_FORMAT 2):
+ *    [len(1)]            bytes that follow; 0xFF = erased flash
+ *    [flags(1)]          REF_SENDER | REF_RECEIVER | REF_DEVICE | HEX_TX_ID | GROUP_CONT | VOID
+ *    [index delta]       zigzag varint, usually 0 (plain append)
+ *    [lamport delta]     zigzag varint vs. the segment's base lamport
+ *    [amount(4)]
+ *    [sender]            ref: 2-byte segment offset | literal: n + bytes
+ *    [receiver]          same
+ *    [device_id]         same; the Lamport tie-breaker, so it must round-trip
+ *    [tx_id]             n + bytes; lowercase hex packed two per byte
+ *    [signature(SIG_LEN)]
+ *    [crc16(2)]          over flags .. signature
+ *
+ * NOTE:
+ *    Device IDs repeat heavily within a savings group, so the
+ *    storage layer interns them per segment: the first use is
+ *    written literally and later records point at it. This file
+ *    only encodes what it is told; it never touches flash.
+ *************************************************************/
+
+#include "ledger_record_codec.h"
+#include "crc16.h"
+#include <string.h>
+
+#define FLAG_REF_SENDER      0x01
+#define FLAG_REF_RECEIVER    0x02
+#define FLAG_HEX_TX_ID       0x04
+#define FLAG_GROUP_CONT      0x08    // more records of the same commit group follow
+#define FLAG_REF_DEVICE      0x10
+#define FLAG_VOID            0x20    // failed revalidation at its place: no balance effect
+
+_Static_assert(LEDGER_RECORD_MAX_BYTES <= LEDGER_RECORD_ERASED_LEN,
+               "record length must fit the 1-byte prefix");
+
+/*******************************************************
+ *  INTERNAL HELPERS
+ *******************************************************/
+
+static uint32_t zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t unzigzag(uint32_t v)
+{
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static uint8_t put_varint(uint8_t *out, uint32_t v)
+{
+    uint8_t n = 0;
+
+    while (v >= 0x80) {
+        out[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+static bool get_varint(const uint8_t *in, uint16_t len, uint16_t *pos, uint32_t *out)
+{
+    uint32_t v = 0;
+
+    for (uint8_t shift = 0; shift < 35; shift += 7) {
+        if (*pos >= len)
+            return false;
+
+        uint8_t b = in[(*pos)++];
+        v |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            *out = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+// Lowercase hex of even length round-trips exactly through packing
+static bool is_packable_hex(const char *s, uint8_t n)
+{
+    if (n == 0 || (n & 1))
+        return false;
+
+    for (uint8_t i = 0; i < n; i++)
+        if (hex_value(s[i]) < 0)
+            return false;
+    return true;
+}
+
+static uint16_t put_literal(uint8_t *out, uint16_t p, const char *id, uint8_t max_len)
+{
+    uint8_t n = ledger_record_id_len(id, max_len);
+
+    out[p++] = n;
+    memcpy(out + p, id, n);
+    return (uint16_t)(p + n);
+}
+
+static bool get_literal(const uint8_t *in, uint16_t len, uint16_t *pos, char *id, uint8_t max_len)
+{
+    if (*pos >= len)
+        return false;
+
+    uint8_t n = in[(*pos)++];
+    if (n > max_len || *pos + n > len)
+        return false;
+
+    memcpy(id, in + *pos, n);
+    *pos += n;
+    return true;
+}
+
+/*******************************************************
+ *  PUBLIC API IMPLEMENTATION
+ *******************************************************/
+
+/**
+ * Significant length of a fixed-size ID field: trailing NULs are
+ * dropped and restored on decode.
+ */
+uint8_t ledger_record_id_len(const char *id, uint8_t max_len)
+{
+    uint8_t n = max_len;
+
+    while (n > 0 && id[n - 1] == '\0')
+        n--;
+    return n;
+}
+
+/**
+ * Encode into out (at least LEDGER_RECORD_MAX_BYTES). Returns the
+ * total record size including the length prefix and CRC.
+ */
+uint16_t ledger_record_encode(const ledger_tx_t *tx, const ledger_record_ctx_t *ctx, uint8_t *out)
+{
+    uint16_t p = 2;
+    uint8_t flags = (ctx->continues ? FLAG_GROUP_CONT : 0) | (ctx->is_void ? FLAG_VOID : 0);
+
+    p += put_varint(out + p, zigzag(ctx->index_delta));
+    p += put_varint(out + p, zigzag(ctx->lamport_delta));
+
+    memcpy(out + p, &tx->amount, sizeof(float));
+    p += sizeof(float);
+
+    if (ctx->sender_ref != LEDGER_RECORD_NO_REF) {
+        flags |= FLAG_REF_SENDER;
+        out[p++] = (uint8_t)(ctx->sender_ref & 0xFF);
+        out[p++] = (uint8_t)(ctx->sender_ref >> 8);
+    } else {
+        p = put_literal(out, p, tx->sender, SENDER_ID_LEN);
+    }
+
+    if (ctx->receiver_ref != LEDGER_RECORD_NO_REF) {
+        flags |= FLAG_REF_RECEIVER;
+        out[p++] = (uint8_t)(ctx->receiver_ref & 0xFF);
+        out[p++] = (uint8_t)(ctx->receiver_ref >> 8);
+    } else {
+        p = put_literal(out, p, tx->receiver, RECEIVER_ID_LEN);
+    }
+
+    if (ctx->device_ref != LEDGER_RECORD_NO_REF) {
+        flags |= FLAG_REF_DEVICE;
+        out[p++] = (uint8_t)(ctx->device_ref & 0xFF);
+        out[p++] = (uint8_t)(ctx->device_ref >> 8);
+    } else {
+        p = put_literal(out, p, tx->device_id, DEVICE_ID_LEN);
+    }
+
+    uint8_t id_len = ledger_record_id_len((const char *)tx->tx_id, TX_ID_LEN);
+    if (is_packable_hex((const char *)tx->tx_id, id_len)) {
+        flags |= FLAG_HEX_TX_ID;
+        out[p++] = id_len / 2;
+        for (uint8_t i = 0; i < id_len; i += 2)
+            out[p++] = (uint8_t)((hex_value(tx->tx_id[i]) << 4) | hex_value(tx->tx_id[i + 1]));
+    } else {
+        p = put_literal(out, p, (const char *)tx->tx_id, TX_ID_LEN);
+    }
+
+    memcpy(out + p, tx->signature, SIG_LEN);
+    p += SIG_LEN;
+
+    out[1] = flags;
+    uint16_t crc = crc16_compute(out + 1, (uint16_t)(p - 1));
+    out[p++] = (uint8_t)(crc & 0xFF);
+    out[p++] = (uint8_t)(crc >> 8);
+
+    out[0] = (uint8_t)(p - 1);
+    return p;
+}
+
+/**
+ * Decode a whole record (length prefix included). Referenced IDs are
+ * left empty with their offsets in ctx_out for the caller to resolve.
+ */
+bool ledger_record_decode(const uint8_t *rec, uint16_t len, ledger_tx_t *tx_out,
+                          ledger_record_ctx_t *ctx_out)
+{
+    static const char hex[] = "0123456789abcdef";
+    uint32_t v;
+
+    if (len < 4 || rec[0] != len - 1)
+        return false;
+
+    uint16_t body = (uint16_t)(len - 2);
+    uint16_t crc  = (uint16_t)(rec[body] | (rec[body + 1] << 8));
+    if (crc16_compute(rec + 1, (uint16_t)(body - 1)) != crc)
+        return false;
+
+    memset(tx_out, 0, sizeof(*tx_out));
+    memset(ctx_out, 0, sizeof(*ctx_out));
+
+    uint8_t  flags = rec[1];
+    uint16_t p = 2;
+
+    ctx_out->continues = (flags & FLAG_GROUP_CONT) != 0;
+    ctx_out->is_void   = (flags & FLAG_VOID) != 0;
+
+    if (!get_varint(rec, body, &p, &v)) return false;
+    ctx_out->index_delta = unzigzag(v);
+    if (!get_varint(rec, body, &p, &v)) return false;
+    ctx_out->lamport_delta = unzigzag(v);
+
+    if (p + sizeof(float) > body) return false;
+    memcpy(&tx_out->amount, rec + p, sizeof(float));
+    p += sizeof(float);
+
+    if (flags & FLAG_REF_SENDER) {
+        if (p + 2 > body) return false;
+        ctx_out->sender_ref = (uint16_t)(rec[p] | (rec[p + 1] << 8));
+        p += 2;
+    } else {
+        ctx_out->sender_at = (uint8_t)p;
+        if (!get_literal(rec, body, &p, tx_out->sender, SENDER_ID_LEN)) return false;
+    }
+
+    if (flags & FLAG_REF_RECEIVER) {
+        if (p + 2 > body) return false;
+        ctx_out->receiver_ref = (uint16_t)(rec[p] | (rec[p + 1] << 8));
+        p += 2;
+    } else {
+        ctx_out->receiver_at = (uint8_t)p;
+        if (!get_literal(rec, body, &p, tx_out->receiver, RECEIVER_ID_LEN)) return false;
+    }
+
+    if (flags & FLAG_REF_DEVICE) {
+        if (p + 2 > body) return false;
+        ctx_out->device_ref = (uint16_t)(rec[p] | (rec[p + 1] << 8));
+        p += 2;
+    } else {
+        ctx_out->device_at = (uint8_t)p;
+        if (!get_literal(rec, body, &p, tx_out->device_id, DEVICE_ID_LEN)) return false;
+    }
+
+    if (flags & FLAG_HEX_TX_ID) {
+        if (p >= body) return false;
+        uint8_t n = rec[p++];
+        if (n * 2 > TX_ID_LEN || p + n > body) return false;
+        for (uint8_t i = 0; i < n; i++) {
+            tx_out->tx_id[2 * i]     = hex[rec[p + i] >> 4];
+            tx_out->tx_id[2 * i + 1] = hex[rec[p + i] & 0x0F];
+        }
+        p += n;
+    } else if (!get_literal(rec, body, &p, (char *)tx_out->tx_id, TX_ID_LEN)) {
+        return false;
+    }
+
+    if (p + SIG_LEN != body) return false;
+    memcpy(tx_out->signature, rec + p, SIG_LEN);
+
+    return true;
+}
+
+/**
+ * Turn the last record of a group into its commit point: clear the
+ * continuation flag and re-seal the CRC. Only valid before the record
+ * is programmed.
+ */
+void ledger_record_end_group(uint8_t *rec, uint16_t len)
+{
+    uint16_t body = (uint16_t)(len - 2);
+
+    rec[1] &= (uint8_t)~FLAG_GROUP_CONT;
+
+    uint16_t crc = crc16_compute(rec + 1, (uint16_t)(body - 1));
+    rec[body]     = (uint8_t)(crc & 0xFF);
+    rec[body + 1] = (uint8_t)(crc >> 8);
+}
@@ -0,0 +1,36 @@
+#ifndef LEDGER_RECORD_CODEC_H
+#define LEDGER_RECORD_CODEC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ledger_manager.h"
+
+#define LEDGER_RECORD_FORMAT       2
+// Worst case, every field literal: len, flags, 2 varints, amount, IDs, signature, CRC
+#define LEDGER_RECORD_MAX_BYTES \
+    (1 + 1 + 5 + 5 + 4 + (1 + SENDER_ID_LEN) + (1 + RECEIVER_ID_LEN) + (1 + DEVICE_ID_LEN) + \
+     (1 + TX_ID_LEN) + SIG_LEN + 2)
+#define LEDGER_RECORD_NO_REF       0       // ID stored literally in the record
+#define LEDGER_RECORD_ERASED_LEN   0xFF    // length byte of unwritten flash
+
+// Per-record context the storage layer supplies (encode) or resolves (decode)
+typedef struct {
+    int32_t  index_delta;      // log index - (previous record's index + 1)
+    int32_t  lamport_delta;    // lamport - segment base lamport
+    uint16_t sender_ref;       // segment offset of an earlier literal, or NO_REF
+    uint16_t receiver_ref;
+    uint16_t device_ref;
+    uint8_t  sender_at;        // decode: literal position in the record, 0 if ref
+    uint8_t  receiver_at;
+    uint8_t  device_at;
+    bool     continues;        // part of a group whose last record is the commit point
+    bool     is_void;          // kept in the log, but invalid at its place in Lamport order
+} ledger_record_ctx_t;
+
+uint8_t  ledger_record_id_len(const char *id, uint8_t max_len);
+uint16_t ledger_record_encode(const ledger_tx_t *tx, const ledger_record_ctx_t *ctx, uint8_t *out);
+bool     ledger_record_decode(const uint8_t *rec, uint16_t len, ledger_tx_t *tx_out,
+                              ledger_record_ctx_t *ctx_out);
+void     ledger_record_end_group(uint8_t *rec, uint16_t len);
+
+#endif
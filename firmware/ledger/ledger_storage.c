@@ -7,81 +7,1037 @@
  *        - Storing, loading, and indexing ledger transactions
  *        - Flash-safe writes (append-only)
  *        - Checkpoint snapshots
+ *        - Group commit of imported batches
+ *        - Incremental compaction of settled history
  *        - CRC integrity validation
  *        - Secure erase operations
  *
  * NOTE:
  *    This file is hardware-agnostic. Hardware-specific flash I/O
  *    must be provided in storage_driver.c (HAL abstraction).
+ *
+ *    bench/ledger_validation_bench.c times duplicate checks and
+ *    balance lookups against a log walk and checks replays;
+ *    bench/ledger_group_commit_bench.c measures group commit and
+ *    its power-loss recovery.
  *************************************************************/
 
 #include "ledger_storage.h"
+#include "ledger_balance_index.h"
+#include "ledger_tx_index.h"
+#include "ledger_record_codec.h"
 #include "storage_driver.h"
+#include "security_module.h"
 #include "crc16.h"
+#include <stdio.h>
 #include <string.h>
+#include <stddef.h>
 
-#define MAX_TX_RECORDS          2048
-#define TX_RECORD_SIZE_BYTES    256       // fixed-size encoding
 #define CHECKPOINT_INTERVAL     100       // snapshot every 100 writes
 
+// Records are packed back to back into a ring of segments. Each
+// segment starts with a header; the oldest segment is erased once a
+// checkpoint covers it, which moves the log's base forward.
+#define LEDGER_ERASE_BLOCK_BYTES   4096
+#define LEDGER_SEGMENT_BLOCKS      8
+#define LEDGER_SEGMENT_BYTES       (LEDGER_SEGMENT_BLOCKS * LEDGER_ERASE_BLOCK_BYTES)
+#define LEDGER_SEGMENT_COUNT       30        // 960 KB record area
+#define LEDGER_SEGMENT_MAGIC       0x4C534732   // "LSG2"
+#define LEDGER_COMPACT_FREE_SEGS   4         // compact when fewer are free
+#define LEDGER_RELOCATE_SEGS       1         // free segments only relocation may open
+
+#define LEDGER_SPARSE_STEP         16        // records between RAM offset hints
+#define LEDGER_SPARSE_SLOTS        32        // so at most 512 records per segment
+#define LEDGER_MAX_RUNS            16
+#define LEDGER_RUN_RESERVE         4         // coalesce when idle and fewer run slots are free
+#define LEDGER_COMPACT_RUNS        2         // run slots only compaction copies may take
+#define LEDGER_REWRITE_JOIN_MAX    256       // old records a merge copies to stay one run
+#define LEDGER_INTERN_SLOTS        32        // power of two
+
+// Replay set for compacted history: two generations of tx_id tags
+#define LEDGER_SETTLED_SLOTS       2048      // per generation, power of two
+#define LEDGER_SETTLED_CAPACITY    ((LEDGER_SETTLED_SLOTS * 3) / 4)
+#define LEDGER_SETTLE_STEP         64        // records folded per compaction step
+
+// Group commit: a batch is staged in RAM and programmed in chunks of
+// at most this size. Only its last record commits it.
+#define LEDGER_BATCH_BYTES         4096
+#define LEDGER_SEGMENT_GROUP_CONT  0x01      // header flag: continues an open group
+
 /**********************
  * INTERNAL STRUCTURES
  **********************/
 typedef struct {
-    uint8_t  data[TX_RECORD_SIZE_BYTES];
+    uint32_t magic;
+    uint8_t  format;          // LEDGER_RECORD_FORMAT
+    uint8_t  flags;           // LEDGER_SEGMENT_GROUP_CONT
+    uint8_t  reserved[2];
+    uint32_t first_ordinal;   // physical sequence number of the first record
+    uint32_t first_index;     // index delta base for the first record
+    uint32_t base_lamport;    // lamport delta base for every record
     uint16_t crc;
-} tx_persist_record_t;
+} ledger_segment_header_t;
+
+#define SEGMENT_DATA_BYTES  (LEDGER_SEGMENT_BYTES - sizeof(ledger_segment_header_t))
+
+typedef enum {
+    SEGMENT_DIRTY = 0,        // free, contents unknown
+    SEGMENT_CLEAN,            // free and fully erased
+    SEGMENT_LIVE
+} segment_state_t;
+
+typedef struct {
+    uint8_t  state;
+    uint8_t  clean_blocks;    // dirty segments: leading blocks known erased
+    bool     sealed;          // full, or a program failed part-way
+    uint8_t  flags;           // header flags
+    uint16_t records;         // physical records, including superseded ones
+    uint16_t used;            // bytes used after the header
+    uint32_t first_ordinal;
+    uint32_t first_index;
+    uint32_t base_lamport;
+    uint16_t sparse[LEDGER_SPARSE_SLOTS];  // offset of every SPARSE_STEP-th record
+} segment_info_t;
+
+/*
+ * Log index → physical record map. A run is a stretch of consecutive
+ * log indices stored as consecutive physical records. Appends extend
+ * the last run; a suffix rewrite (conflict merge) starts a new run and
+ * trims the old one. Compaction drops runs with the tail, and copies
+ * adjacent runs into one when the table runs low, so it stays a
+ * handful of entries.
+ */
+typedef struct {
+    uint32_t index;
+    uint32_t ordinal;
+    uint32_t count;
+} log_run_t;
+
+// Head segment's device IDs → offset of their literal copy
+typedef struct {
+    uint32_t hash;
+    uint16_t offset;          // 0 = empty (offset 0 is never a literal)
+} intern_entry_t;
+
+/*
+ * What is left of compacted records. Their records and tx_id index
+ * slots are gone; the highest Lamport value folded in is the replay
+ * watermark: every compacted transaction is at or below it, so a
+ * transaction there is refused whatever its ID. The tag set answers
+ * ID-only lookups and is bounded: when the current generation fills,
+ * the older one is dropped, so it covers the newest
+ * LEDGER_SETTLED_CAPACITY..2x compacted transactions. Both are signed
+ * with the checkpoint and survive index rebuilds.
+ */
+typedef struct {
+    uint32_t through;         // every log index below this has been folded in
+    uint32_t lamport;         // highest Lamport folded in: the watermark
+    uint16_t used[2];
+    uint8_t  current;         // generation that takes new tags
+    uint8_t  reserved[3];
+    uint32_t tags[2][LEDGER_SETTLED_SLOTS];   // 0 = empty slot
+} settled_set_t;
 
-static uint32_t tx_count = 0;   // number of valid stored transactions
+typedef struct {
+    ledger_checkpoint_t   meta;
+    balance_index_image_t balances;   // per-account balances at meta.tx_count
+    settled_set_t         settled;    // live copy: updated by compaction
+    uint8_t               signature[SIG_LEN];
+    uint16_t              crc;
+} checkpoint_image_t;
+
+static uint32_t tx_count = 0;   // log index one past the newest record
+static uint32_t base_index = 0; // oldest record still on flash
+static uint32_t max_lamport = 0; // highest lamport ever stored, compacted history included
+
+static segment_info_t segments[LEDGER_SEGMENT_COUNT];
+static uint8_t  head_segment = 0;
+static uint8_t  tail_segment = 0;
+static uint32_t next_ordinal = 0;
+static uint32_t head_last_index = 0;   // index of the head's newest record
+
+static log_run_t      runs[LEDGER_MAX_RUNS];
+static uint8_t        run_count = 0;
+static intern_entry_t intern[LEDGER_INTERN_SLOTS];
+
+// tx_count covered by the newest checkpoint that verified on flash
+static uint32_t checkpoint_covers = 0;
+static uint32_t checkpoint_settled = 0;   // settled.through of that checkpoint
+static bool     checkpoint_ok = false;
+
+// Checkpoint image is several KB; keep it off the stack. Its settled
+// set is also the live one.
+static checkpoint_image_t checkpoint_image;
+static settled_set_t *const settled = &checkpoint_image.settled;
+
+static uint32_t flash_bytes_written = 0;   // lifetime total, for wear accounting
+static uint32_t rewrite_low = UINT32_MAX;   // lowest index written since the rewrite began
+static bool     relocating = false;         // relocate_from_tail() is writing
+static bool     coalescing = false;         // coalesce_runs() is writing
+
+typedef enum {
+    BATCH_NONE = 0,
+    BATCH_OPEN,
+    BATCH_FAILED              // aborted by a storage error; commit reports it
+} batch_state_t;
+
+// Records of the open batch: appended to the head in RAM, mapped at commit
+typedef struct {
+    uint8_t  state;
+    bool     flushed;         // some records already programmed
+    uint16_t count;
+    uint16_t staged_bytes;    // bytes in batch_buf, not yet programmed
+    uint16_t staged_offset;   // head offset batch_buf belongs at
+    uint16_t last_len;        // size of the newest record in batch_buf
+    uint32_t first_index;
+    uint32_t first_ordinal;
+    uint32_t saved_last_index;
+    uint32_t tags[LEDGER_STORAGE_BATCH_MAX_TX];   // tx_id hashes, for duplicate checks
+} batch_t;
+
+static batch_t batch;
+static uint8_t batch_buf[LEDGER_BATCH_BYTES];
 
 /*******************************************************
  *  INTERNAL HELPERS
  *******************************************************/
 
-static void encode_transaction(const ledger_tx_t *tx, uint8_t *out)
+static uint32_t segment_address(uint8_t segment)
+{
+    return (uint32_t)segment * LEDGER_SEGMENT_BYTES;
+}
+
+static uint32_t data_address(uint8_t segment, uint16_t offset)
+{
+    return segment_address(segment) + sizeof(ledger_segment_header_t) + offset;
+}
+
+static uint16_t segment_header_crc(const ledger_segment_header_t *hdr)
+{
+    return crc16_compute((const uint8_t*)hdr, offsetof(ledger_segment_header_t, crc));
+}
+
+static bool is_erased(const uint8_t *p, uint32_t size)
+{
+    for (uint32_t i = 0; i < size; i++)
+        if (p[i] != 0xFF)
+            return false;
+    return true;
+}
+
+/* ---------- log index → physical record ---------- */
+
+static bool run_lookup(uint32_t index, uint32_t *ordinal)
+{
+    for (uint8_t i = 0; i < run_count; i++) {
+        if (index >= runs[i].index && index - runs[i].index < runs[i].count) {
+            *ordinal = runs[i].ordinal + (index - runs[i].index);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void run_remove(uint8_t i)
+{
+    memmove(&runs[i], &runs[i + 1], (run_count - i - 1) * sizeof(log_run_t));
+    run_count--;
+}
+
+static void run_insert(uint8_t i, uint32_t index, uint32_t ordinal, uint32_t count)
+{
+    memmove(&runs[i + 1], &runs[i], (run_count - i) * sizeof(log_run_t));
+    runs[i].index   = index;
+    runs[i].ordinal = ordinal;
+    runs[i].count   = count;
+    run_count++;
+}
+
+/**
+ * Whether mapping index to ordinal leaves spare run slots free. It
+ * takes one slot if it splits a run and one unless it extends a run,
+ * and gives one back if it empties a run.
+ */
+static bool run_has_room(uint32_t index, uint32_t ordinal, uint8_t spare)
+{
+    int need = 1;
+
+    for (uint8_t i = 0; i < run_count; i++) {
+        const log_run_t *r = &runs[i];
+
+        if (index >= r->index && index - r->index < r->count) {
+            if (r->count == 1)
+                need--;
+            else if (index != r->index && index - r->index != r->count - 1)
+                need++;
+        }
+        if (r->index + r->count == index && r->ordinal + r->count == ordinal)
+            need--;
+    }
+    return run_count + need + spare <= LEDGER_MAX_RUNS;
+}
+
+// Writes outside compaction leave the last LEDGER_COMPACT_RUNS slots
+// to the copies that give slots back
+static uint8_t run_spare(void)
+{
+    return (relocating || coalescing) ? 0 : LEDGER_COMPACT_RUNS;
+}
+
+/**
+ * Point a log index at a physical record, superseding whatever it
+ * mapped to before. Caller checks run_has_room() first.
+ */
+static void run_map(uint32_t index, uint32_t ordinal)
+{
+    for (uint8_t i = 0; i < run_count; i++) {
+        log_run_t *r = &runs[i];
+        if (index < r->index || index - r->index >= r->count)
+            continue;
+
+        uint32_t left  = index - r->index;
+        uint32_t right = r->count - left - 1;
+
+        if (left == 0 && right == 0) {
+            run_remove(i);
+        } else if (left == 0) {
+            r->index++;
+            r->ordinal++;
+            r->count--;
+        } else if (right == 0) {
+            r->count--;
+        } else {
+            r->count = left;
+            run_insert(i + 1, index + 1, r->ordinal + left + 1, right);
+        }
+        break;
+    }
+
+    uint8_t at = 0;
+    for (uint8_t i = 0; i < run_count; i++) {
+        if (runs[i].index + runs[i].count == index && runs[i].ordinal + runs[i].count == ordinal) {
+            runs[i].count++;
+            return;
+        }
+        if (runs[i].index < index)
+            at = i + 1;
+    }
+    run_insert(at, index, ordinal, 1);
+}
+
+/**
+ * Byte offset of a physical record inside its segment: jump to the
+ * nearest sparse hint, then hop over at most SPARSE_STEP-1 length
+ * prefixes.
+ */
+static bool locate_ordinal(uint32_t ordinal, uint8_t *segment_out, uint16_t *offset_out)
+{
+    for (uint8_t s = 0; s < LEDGER_SEGMENT_COUNT; s++) {
+        const segment_info_t *seg = &segments[s];
+
+        if (seg->state != SEGMENT_LIVE ||
+            ordinal < seg->first_ordinal || ordinal - seg->first_ordinal >= seg->records)
+            continue;
+
+        uint32_t n = ordinal - seg->first_ordinal;
+        uint16_t offset = seg->sparse[n / LEDGER_SPARSE_STEP];
+
+        for (uint32_t hop = 0; hop < n % LEDGER_SPARSE_STEP; hop++) {
+            uint8_t len;
+            if (!storage_driver_read(data_address(s, offset), &len, 1) ||
+                len == LEDGER_RECORD_ERASED_LEN)
+                return false;
+            offset += 1 + len;
+        }
+
+        *segment_out = s;
+        *offset_out  = offset;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Read from the head segment's data area, serving bytes that are still
+ * staged in the batch buffer from RAM.
+ */
+static bool read_head(uint16_t offset, uint8_t *out, uint16_t len)
+{
+    if (batch.staged_bytes > 0 && offset >= batch.staged_offset) {
+        uint16_t at = offset - batch.staged_offset;
+        if (at + len > batch.staged_bytes)
+            return false;
+        memcpy(out, batch_buf + at, len);
+        return true;
+    }
+    return storage_driver_read(data_address(head_segment, offset), out, len);
+}
+
+/* ---------- device-ID interning ---------- */
+
+static uint32_t id_hash(const char *id, uint8_t n)
+{
+    uint32_t h = 2166136261u ^ n;
+
+    for (uint8_t i = 0; i < n; i++) {
+        h ^= (uint8_t)id[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Hash of a tx_id for in-batch and settled-history duplicate checks
+static uint32_t tx_id_tag(const char *tx_id)
+{
+    uint32_t h = id_hash(tx_id, ledger_record_id_len(tx_id, TX_ID_LEN));
+    return h ? h : 1;   // 0 marks an empty settled slot
+}
+
+/* ---------- settled replay set ---------- */
+
+static bool settled_contains(uint32_t tag)
+{
+    for (uint8_t g = 0; g < 2; g++) {
+        for (uint32_t probe = 0; probe < LEDGER_SETTLED_SLOTS; probe++) {
+            uint32_t t = settled->tags[g][(tag + probe) & (LEDGER_SETTLED_SLOTS - 1)];
+            if (t == 0)
+                break;
+            if (t == tag)
+                return true;
+        }
+    }
+    return false;
+}
+
+static void settled_add(const ledger_tx_t *tx)
+{
+    uint32_t tag = tx_id_tag(tx->tx_id);
+
+    if (tx->lamport > settled->lamport)
+        settled->lamport = tx->lamport;
+    if (settled_contains(tag))
+        return;
+
+    if (settled->used[settled->current] >= LEDGER_SETTLED_CAPACITY) {
+        // Drop the older generation; it becomes the current one
+        settled->current ^= 1;
+        memset(settled->tags[settled->current], 0, sizeof(settled->tags[0]));
+        settled->used[settled->current] = 0;
+    }
+
+    uint32_t *gen = settled->tags[settled->current];
+    for (uint32_t probe = 0; ; probe++) {
+        uint32_t *slot = &gen[(tag + probe) & (LEDGER_SETTLED_SLOTS - 1)];
+        if (*slot == 0) {
+            *slot = tag;
+            settled->used[settled->current]++;
+            return;
+        }
+    }
+}
+
+static void settled_reset(void)
+{
+    memset(settled, 0, sizeof(*settled));
+}
+
+static void intern_reset(void)
+{
+    memset(intern, 0, sizeof(intern));
+}
+
+static void intern_add(const char *id, uint8_t max_len, uint16_t offset)
+{
+    uint8_t  n = ledger_record_id_len(id, max_len);
+    uint32_t h = id_hash(id, n);
+
+    for (uint8_t probe = 0; probe < LEDGER_INTERN_SLOTS; probe++) {
+        intern_entry_t *e = &intern[(h + probe) & (LEDGER_INTERN_SLOTS - 1)];
+        if (e->offset == 0) {
+            e->hash   = h;
+            e->offset = offset;
+            return;
+        }
+        if (e->hash == h)
+            return;
+    }
+}
+
+/**
+ * Offset of an earlier literal of this ID in the head segment, or
+ * NO_REF. Hash hits are confirmed against flash.
+ */
+static uint16_t intern_find(const char *id, uint8_t max_len)
+{
+    uint8_t  n = ledger_record_id_len(id, max_len);
+    uint32_t h = id_hash(id, n);
+    uint8_t  literal[1 + 64];
+
+    if (n == 0 || n >= sizeof(literal))
+        return LEDGER_RECORD_NO_REF;
+
+    for (uint8_t probe = 0; probe < LEDGER_INTERN_SLOTS; probe++) {
+        const intern_entry_t *e = &intern[(h + probe) & (LEDGER_INTERN_SLOTS - 1)];
+        if (e->offset == 0)
+            break;
+        if (e->hash != h)
+            continue;
+
+        if (read_head(e->offset, literal, (uint16_t)(1 + n)) &&
+            literal[0] == n && memcmp(literal + 1, id, n) == 0)
+            return e->offset;
+        break;
+    }
+    return LEDGER_RECORD_NO_REF;
+}
+
+static bool resolve_id(uint8_t segment, uint16_t ref, char *id, uint8_t max_len)
+{
+    uint8_t literal[1 + 64];
+
+    if (!storage_driver_read(data_address(segment, ref), literal, 1) ||
+        literal[0] > max_len || literal[0] >= sizeof(literal))
+        return false;
+    if (!storage_driver_read(data_address(segment, ref) + 1, literal + 1, literal[0]))
+        return false;
+
+    memcpy(id, literal + 1, literal[0]);
+    return true;
+}
+
+/* ---------- segments ---------- */
+
+/**
+ * Erase what is left of a free segment, at most one block per call
+ * unless finish is set. Blocks that already read back erased are
+ * skipped, so a reboot does not wear clean segments again.
+ */
+static bool clean_segment(uint8_t segment, bool finish)
+{
+    uint8_t block_buf[64];
+    segment_info_t *seg = &segments[segment];
+
+    while (seg->clean_blocks < LEDGER_SEGMENT_BLOCKS) {
+        uint32_t block = segment_address(segment) + seg->clean_blocks * LEDGER_ERASE_BLOCK_BYTES;
+        bool erased = true;
+
+        for (uint32_t off = 0; erased && off < LEDGER_ERASE_BLOCK_BYTES; off += sizeof(block_buf)) {
+            if (!storage_driver_read(block + off, block_buf, sizeof(block_buf)))
+                return false;
+            erased = is_erased(block_buf, sizeof(block_buf));
+        }
+
+        if (!erased && !storage_driver_erase(block, LEDGER_ERASE_BLOCK_BYTES))
+            return false;
+
+        seg->clean_blocks++;
+        if (!erased && !finish)
+            break;
+    }
+
+    if (seg->clean_blocks >= LEDGER_SEGMENT_BLOCKS)
+        seg->state = SEGMENT_CLEAN;
+    return true;
+}
+
+static uint8_t free_segment_count(void)
+{
+    uint8_t n = 0;
+
+    for (uint8_t s = 0; s < LEDGER_SEGMENT_COUNT; s++)
+        if (segments[s].state != SEGMENT_LIVE)
+            n++;
+    return n;
+}
+
+static bool head_accepts(uint16_t len)
+{
+    const segment_info_t *seg = &segments[head_segment];
+
+    return seg->state == SEGMENT_LIVE && !seg->sealed &&
+           seg->records < LEDGER_SPARSE_STEP * LEDGER_SPARSE_SLOTS &&
+           seg->used + len <= SEGMENT_DATA_BYTES;
+}
+
+/**
+ * Seal the head and open the next segment of the ring. Fails only when
+ * the ring has no free segment left, i.e. compaction fell behind. The
+ * last LEDGER_RELOCATE_SEGS are kept for relocate_from_tail(): once
+ * merges fill the ring, the tail can only go if its live records have
+ * somewhere to move.
+ */
+static bool open_next_segment(uint32_t first_index, uint32_t base_lamport, bool continues)
+{
+    uint8_t next = (uint8_t)((head_segment + 1) % LEDGER_SEGMENT_COUNT);
+    segment_info_t *seg = &segments[next];
+
+    if (seg->state == SEGMENT_LIVE)
+        return false;
+    if (!relocating && free_segment_count() <= LEDGER_RELOCATE_SEGS)
+        return false;
+    if (seg->state == SEGMENT_DIRTY && !clean_segment(next, true))
+        return false;
+
+    ledger_segment_header_t hdr;
+    memset(&hdr, 0xFF, sizeof(hdr));
+    hdr.magic         = LEDGER_SEGMENT_MAGIC;
+    hdr.format        = LEDGER_RECORD_FORMAT;
+    hdr.flags         = continues ? LEDGER_SEGMENT_GROUP_CONT : 0;
+    hdr.first_ordinal = next_ordinal;
+    hdr.first_index   = first_index;
+    hdr.base_lamport  = base_lamport;
+    hdr.crc           = segment_header_crc(&hdr);
+
+    // Header first: a torn header just leaves the segment free
+    seg->state        = SEGMENT_DIRTY;
+    seg->clean_blocks = 0;
+    if (!storage_driver_write(segment_address(next), (uint8_t*)&hdr, sizeof(hdr)))
+        return false;
+
+    segments[head_segment].sealed = true;
+
+    memset(seg, 0, sizeof(*seg));
+    seg->state         = SEGMENT_LIVE;
+    seg->first_ordinal = next_ordinal;
+    seg->first_index   = first_index;
+    seg->base_lamport  = base_lamport;
+    seg->flags         = hdr.flags;
+
+    head_segment    = next;
+    head_last_index = first_index - 1;
+    intern_reset();
+    flash_bytes_written += sizeof(hdr);
+    return true;
+}
+
+/**
+ * Program the staged part of the batch in one write. A failure seals
+ * the head; the caller aborts the batch.
+ */
+static bool flush_batch(void)
+{
+    if (batch.staged_bytes == 0)
+        return true;
+
+    if (!storage_driver_write(data_address(head_segment, batch.staged_offset),
+                              batch_buf, batch.staged_bytes)) {
+        segments[head_segment].sealed = true;
+        return false;
+    }
+
+    flash_bytes_written += batch.staged_bytes;
+    batch.staged_bytes = 0;
+    batch.flushed = true;
+    return true;
+}
+
+/**
+ * Encode a transaction against the current head segment, opening a
+ * new one if it does not fit. Returns the record size, 0 on failure.
+ */
+static uint16_t encode_for_head(uint32_t index, const ledger_tx_t *tx, bool valid, uint8_t *out)
+{
+    for (uint8_t attempt = 0; attempt < 2; attempt++) {
+        const segment_info_t *seg = &segments[head_segment];
+        ledger_record_ctx_t ctx;
+
+        if (seg->state == SEGMENT_LIVE) {
+            memset(&ctx, 0, sizeof(ctx));
+            ctx.index_delta   = (int32_t)(index - (head_last_index + 1));
+            ctx.lamport_delta = (int32_t)(tx->lamport - seg->base_lamport);
+            ctx.sender_ref    = intern_find(tx->sender, SENDER_ID_LEN);
+            ctx.receiver_ref  = intern_find(tx->receiver, RECEIVER_ID_LEN);
+            ctx.device_ref    = intern_find(tx->device_id, DEVICE_ID_LEN);
+            ctx.continues     = (batch.state == BATCH_OPEN);
+            ctx.is_void       = !valid;
+
+            uint16_t len = ledger_record_encode(tx, &ctx, out);
+            if (head_accepts(len))
+                return len;
+        }
+
+        // A batch spilling over flushes first and flags the new segment
+        bool continues = (batch.state == BATCH_OPEN && batch.count > 0);
+        if (continues && !flush_batch())
+            return 0;
+        if (!open_next_segment(index, tx->lamport, continues))
+            return 0;
+    }
+    return 0;
+}
+
+/**
+ * Append a record for a log index (tx_count for a new transaction,
+ * lower for a suffix rewrite) and point the index at it. A failed
+ * program consumes its space and seals the segment, so the next
+ * record never lands behind a torn length byte. Inside a batch the
+ * record is only staged; ledger_storage_commit_batch() maps it.
+ * A record written as not valid keeps its place but moves no funds.
+ */
+static bool write_record(uint32_t index, const ledger_tx_t *tx, bool valid)
+{
+    uint8_t rec[LEDGER_RECORD_MAX_BYTES];
+    ledger_record_ctx_t ctx;
+
+    if (!run_has_room(index, next_ordinal, run_spare()))
+        return false;
+    // Once relocation has opened the reserved segment, only it writes
+    // until the tail is dropped
+    if (!relocating && free_segment_count() < LEDGER_RELOCATE_SEGS)
+        return false;
+
+    uint16_t len = encode_for_head(index, tx, valid, rec);
+    if (len == 0)
+        return false;
+
+    if (batch.state == BATCH_OPEN && batch.staged_bytes + len > LEDGER_BATCH_BYTES) {
+        if (!flush_batch())
+            return false;
+        len = encode_for_head(index, tx, valid, rec);   // literals may have moved to flash
+        if (len == 0)
+            return false;
+    }
+
+    segment_info_t *seg = &segments[head_segment];
+    uint16_t offset  = seg->used;
+    uint32_t ordinal = next_ordinal++;
+
+    if (seg->records % LEDGER_SPARSE_STEP == 0)
+        seg->sparse[seg->records / LEDGER_SPARSE_STEP] = offset;
+    seg->records++;
+    seg->used += len;
+
+    if (batch.state == BATCH_OPEN) {
+        if (batch.staged_bytes == 0)
+            batch.staged_offset = offset;
+        if (batch.count == 0)
+            batch.first_ordinal = ordinal;
+        memcpy(batch_buf + batch.staged_bytes, rec, len);
+        batch.staged_bytes += len;
+        batch.last_len = len;
+    } else if (!storage_driver_write(data_address(head_segment, offset), rec, len)) {
+        seg->sealed = true;
+        return false;
+    } else {
+        flash_bytes_written += len;
+    }
+
+    // Remember literals so later records can point at them
+    ledger_tx_t decoded;
+    if (ledger_record_decode(rec, len, &decoded, &ctx)) {
+        if (ctx.sender_at)
+            intern_add(tx->sender, SENDER_ID_LEN, offset + ctx.sender_at);
+        if (ctx.receiver_at)
+            intern_add(tx->receiver, RECEIVER_ID_LEN, offset + ctx.receiver_at);
+        if (ctx.device_at)
+            intern_add(tx->device_id, DEVICE_ID_LEN, offset + ctx.device_at);
+    }
+
+    head_last_index = index;
+    if (tx->lamport > max_lamport)
+        max_lamport = tx->lamport;
+    if (batch.state == BATCH_OPEN) {
+        batch.count++;
+        return true;
+    }
+
+    run_map(index, ordinal);
+    if (index == tx_count)
+        tx_count++;
+    return true;
+}
+
+static bool read_record(uint32_t index, ledger_tx_t *tx_out, bool *valid_out)
+{
+    uint8_t  rec[LEDGER_RECORD_MAX_BYTES];
+    uint32_t ordinal;
+    uint8_t  segment;
+    uint16_t offset;
+    ledger_record_ctx_t ctx;
+
+    if (!run_lookup(index, &ordinal) || !locate_ordinal(ordinal, &segment, &offset))
+        return false;
+
+    if (!storage_driver_read(data_address(segment, offset), rec, 1) ||
+        rec[0] == LEDGER_RECORD_ERASED_LEN || 1U + rec[0] > sizeof(rec))
+        return false;
+
+    uint16_t len = (uint16_t)(1 + rec[0]);
+    if (!storage_driver_read(data_address(segment, offset) + 1, rec + 1, rec[0]))
+        return false;
+
+    if (!ledger_record_decode(rec, len, tx_out, &ctx))
+        return false;   // corruption detected
+
+    tx_out->lamport = segments[segment].base_lamport + (uint32_t)ctx.lamport_delta;
+
+    if (ctx.sender_ref != LEDGER_RECORD_NO_REF &&
+        !resolve_id(segment, ctx.sender_ref, tx_out->sender, SENDER_ID_LEN))
+        return false;
+    if (ctx.receiver_ref != LEDGER_RECORD_NO_REF &&
+        !resolve_id(segment, ctx.receiver_ref, tx_out->receiver, RECEIVER_ID_LEN))
+        return false;
+    if (ctx.device_ref != LEDGER_RECORD_NO_REF &&
+        !resolve_id(segment, ctx.device_ref, tx_out->device_id, DEVICE_ID_LEN))
+        return false;
+
+    if (valid_out)
+        *valid_out = !ctx.is_void;
+    return true;
+}
+
+// Signed part of a checkpoint: metadata and balances
+static uint16_t checkpoint_signed_len(void)
+{
+    return (uint16_t)offsetof(checkpoint_image_t, signature);
+}
+
+static uint16_t compute_checkpoint_crc(const checkpoint_image_t *image)
+{
+    uint16_t crc = 0xFFFF;
+    const uint8_t *p = (const uint8_t*)image;
+
+    for (uint32_t i = 0; i < offsetof(checkpoint_image_t, crc); i++)
+        crc = crc16_update(crc, p[i]);
+
+    return crc;
+}
+
+static bool read_checkpoint_image(void)
+{
+    if (!storage_driver_read_checkpoint((uint8_t*)&checkpoint_image, sizeof(checkpoint_image)))
+        return false;
+
+    if (compute_checkpoint_crc(&checkpoint_image) != checkpoint_image.crc)
+        return false;
+
+    // Compacted history exists only in this snapshot, so it must be ours
+    return security_verify((const uint8_t*)&checkpoint_image, checkpoint_signed_len(),
+                           checkpoint_image.signature);
+}
+
+// Records of a group seen at mount whose commit record is still ahead
+typedef struct {
+    uint32_t count;
+    uint32_t first_index;
+    uint32_t first_ordinal;
+} pending_group_t;
+
+static void commit_group(pending_group_t *group)
+{
+    for (uint32_t k = 0; k < group->count; k++)
+        run_map(group->first_index + k, group->first_ordinal + k);
+
+    tx_count += group->count;
+    group->count = 0;
+}
+
+/**
+ * Replay one live segment's records into the run table. Stops at the
+ * first erased length byte, or seals the segment at the first record
+ * that fails its CRC (nothing after a torn length can be trusted).
+ * Group records are held back until their commit record; a group
+ * still open at the end of the segment carries over only if the next
+ * segment says it continues it, otherwise it is rolled back.
+ */
+static void mount_segment(uint8_t s, bool is_head, bool next_continues, pending_group_t *group)
+{
+    segment_info_t *seg = &segments[s];
+    uint8_t rec[LEDGER_RECORD_MAX_BYTES];
+    ledger_tx_t tx;
+    ledger_record_ctx_t ctx;
+    uint32_t last = seg->first_index - 1;
+
+    while (seg->records < LEDGER_SPARSE_STEP * LEDGER_SPARSE_SLOTS &&
+           seg->used < SEGMENT_DATA_BYTES) {
+        if (!storage_driver_read(data_address(s, seg->used), rec, 1) ||
+            rec[0] == LEDGER_RECORD_ERASED_LEN)
+            break;
+
+        uint16_t len = (uint16_t)(1 + rec[0]);
+        bool ok = len <= sizeof(rec) && seg->used + len <= SEGMENT_DATA_BYTES &&
+                  storage_driver_read(data_address(s, seg->used) + 1, rec + 1, rec[0]) &&
+                  ledger_record_decode(rec, len, &tx, &ctx);
+
+        // Group records are plain appends, one after another
+        uint32_t index = ok ? last + 1 + (uint32_t)ctx.index_delta : 0;
+        uint32_t next  = tx_count + group->count;
+        uint32_t ordinal = seg->first_ordinal + seg->records;
+        if (!ok || index > next || (group->count > 0 && index != next) ||
+            (ctx.continues && index != next) || !run_has_room(index, ordinal, 0)) {
+            seg->sealed = true;
+            break;
+        }
+
+        if (seg->records % LEDGER_SPARSE_STEP == 0)
+            seg->sparse[seg->records / LEDGER_SPARSE_STEP] = seg->used;
+
+        if (is_head) {
+            if (ctx.sender_at)
+                intern_add(tx.sender, SENDER_ID_LEN, seg->used + ctx.sender_at);
+            if (ctx.receiver_at)
+                intern_add(tx.receiver, RECEIVER_ID_LEN, seg->used + ctx.receiver_at);
+            if (ctx.device_at)
+                intern_add(tx.device_id, DEVICE_ID_LEN, seg->used + ctx.device_at);
+        }
+
+        uint32_t lamport = seg->base_lamport + (uint32_t)ctx.lamport_delta;
+        if (lamport > max_lamport)
+            max_lamport = lamport;
+
+        if (ctx.continues) {
+            if (group->count == 0) {
+                group->first_index   = index;
+                group->first_ordinal = ordinal;
+            }
+            group->count++;
+        } else {
+            commit_group(group);
+            run_map(index, ordinal);
+            if (index == tx_count)
+                tx_count++;
+        }
+
+        last = index;
+        seg->records++;
+        seg->used += len;
+    }
+
+    if (group->count > 0 && (seg->sealed || is_head || !next_continues)) {
+        // Uncommitted batch: its records stay on flash but are never
+        // mapped, and nothing may be appended behind them
+        group->count = 0;
+        seg->sealed = true;
+    }
+
+    next_ordinal = seg->first_ordinal + seg->records;
+    if (is_head)
+        head_last_index = last;
+}
+
+/**
+ * Find the live segments, then replay them oldest first to rebuild
+ * the index → record map. Free segments are marked dirty and cleaned
+ * lazily by the compactor.
+ */
+static void mount_segments(void)
 {
-    // Simple JSON-free binary encoding
-    // Layout example:
-    // [lamport(4)][amount(4)][sender(32)][receiver(32)][tx_id(36)][signature(64)][padding…]
+    ledger_segment_header_t hdr;
+    bool found = false;
 
-    memset(out, 0, TX_RECORD_SIZE_BYTES);
+    run_count = 0;
+    max_lamport = 0;
+    intern_reset();
 
-    uint32_t offset = 0;
+    for (uint8_t s = 0; s < LEDGER_SEGMENT_COUNT; s++) {
+        memset(&segments[s], 0, sizeof(segments[s]));
+        segments[s].state = SEGMENT_DIRTY;
 
-    memcpy(out + offset, &tx->lamport, sizeof(uint32_t));
-    offset += 4;
+        if (!storage_driver_read(segment_address(s), (uint8_t*)&hdr, sizeof(hdr)) ||
+            hdr.magic != LEDGER_SEGMENT_MAGIC ||
+            hdr.format != LEDGER_RECORD_FORMAT ||
+            hdr.crc != segment_header_crc(&hdr))
+            continue;
 
-    memcpy(out + offset, &tx->amount, sizeof(float));
-    offset += 4;
+        segments[s].state         = SEGMENT_LIVE;
+        segments[s].first_ordinal = hdr.first_ordinal;
+        segments[s].first_index   = hdr.first_index;
+        segments[s].base_lamport  = hdr.base_lamport;
+        segments[s].flags         = hdr.flags;
 
-    memcpy(out + offset, tx->sender, SENDER_ID_LEN);
-    offset += SENDER_ID_LEN;
+        if (!found || hdr.first_ordinal > segments[head_segment].first_ordinal)
+            head_segment = s;
+        if (!found || hdr.first_ordinal < segments[tail_segment].first_ordinal)
+            tail_segment = s;
+        found = true;
+    }
 
-    memcpy(out + offset, tx->receiver, RECEIVER_ID_LEN);
-    offset += RECEIVER_ID_LEN;
+    next_ordinal = 0;
 
-    memcpy(out + offset, tx->tx_id, TX_ID_LEN);
-    offset += TX_ID_LEN;
+    if (!found) {
+        // Empty log: the first append opens segment 0
+        head_segment = LEDGER_SEGMENT_COUNT - 1;
+        tail_segment = 0;
+        base_index   = 0;
+        tx_count     = 0;
+        return;
+    }
+
+    // Live segments are contiguous in the ring, oldest at the tail
+    pending_group_t group = { 0 };
+
+    tx_count = segments[tail_segment].first_index;
+    for (uint8_t i = 0; i < LEDGER_SEGMENT_COUNT; i++) {
+        uint8_t s    = (uint8_t)((tail_segment + i) % LEDGER_SEGMENT_COUNT);
+        uint8_t next = (uint8_t)((s + 1) % LEDGER_SEGMENT_COUNT);
+        if (segments[s].state != SEGMENT_LIVE)
+            break;
+
+        bool next_continues = segments[next].state == SEGMENT_LIVE &&
+                              (segments[next].flags & LEDGER_SEGMENT_GROUP_CONT);
+        mount_segment(s, s == head_segment, next_continues, &group);
+        if (s == head_segment)
+            break;
+    }
 
-    memcpy(out + offset, tx->signature, SIG_LEN);
+    base_index = (run_count > 0) ? runs[0].index : tx_count;
 }
 
-static void decode_transaction(const uint8_t *in, ledger_tx_t *tx_out)
+/**
+ * Rebuild the balance index from the last checkpoint plus the tail
+ * of the log. Falls back to a full replay if the checkpoint is
+ * missing, corrupt, or ahead of the records actually on flash.
+ */
+static void rebuild_balance_index(void)
 {
-    uint32_t offset = 0;
+    uint32_t replay_from = base_index;
+
+    checkpoint_ok = read_checkpoint_image() &&
+                    checkpoint_image.meta.tx_count >= base_index &&
+                    checkpoint_image.meta.tx_count <= tx_count;
 
-    memcpy(&tx_out->lamport, in + offset, 4); offset += 4;
-    memcpy(&tx_out->amount,  in + offset, 4); offset += 4;
+    if (checkpoint_ok && balance_index_restore(&checkpoint_image.balances)) {
+        replay_from = checkpoint_image.meta.tx_count;
+        checkpoint_covers = replay_from;
+        checkpoint_settled = settled->through;
+        if (checkpoint_image.meta.lamport > max_lamport)
+            max_lamport = checkpoint_image.meta.lamport;
+    } else {
+        // Without a snapshot, history below base_index is lost to the
+        // balances and the replay set; replay what is left so the
+        // ledger stays usable.
+        checkpoint_ok = false;
+        checkpoint_settled = 0;
+        balance_index_reset();
+        settled_reset();
+    }
 
-    memcpy(tx_out->sender,   in + offset, SENDER_ID_LEN);   offset += SENDER_ID_LEN;
-    memcpy(tx_out->receiver, in + offset, RECEIVER_ID_LEN); offset += RECEIVER_ID_LEN;
-    memcpy(tx_out->tx_id,    in + offset, TX_ID_LEN);       offset += TX_ID_LEN;
-    memcpy(tx_out->signature,in + offset, SIG_LEN);
+    ledger_tx_t tx;
+    bool valid;
+    for (uint32_t i = replay_from; i < tx_count; i++) {
+        if (read_record(i, &tx, &valid) && valid)
+            balance_index_apply(&tx);
+    }
 }
 
-static uint16_t compute_crc(const uint8_t *data)
+/**
+ * Stage one transaction of the open batch. A storage error aborts
+ * the whole batch; later stores fail until it is committed.
+ */
+static bool stage_tx(const ledger_tx_t *tx)
 {
-    return crc16_compute(data, TX_RECORD_SIZE_BYTES);
+    if (batch.state != BATCH_OPEN || batch.count >= LEDGER_STORAGE_BATCH_MAX_TX)
+        return false;
+
+    if (!write_record(tx_count + batch.count, tx, true)) {
+        ledger_storage_abort_batch();
+        batch.state = BATCH_FAILED;
+        return false;
+    }
+
+    batch.tags[batch.count - 1] = tx_id_tag(tx->tx_id);
+    balance_index_apply(tx);
+    return true;
 }
 
 /*******************************************************
@@ -90,25 +1046,26 @@ static uint16_t compute_crc(const uint8_t *data)
 
 bool ledger_storage_init(void)
 {
-    tx_count = storage_driver_scan_records(MAX_TX_RECORDS);
+    memset(&batch, 0, sizeof(batch));
+    mount_segments();
+    rebuild_balance_index();
+    tx_index_init();
     return true;
 }
 
 bool ledger_storage_store_tx(const ledger_tx_t *tx)
 {
-    if (tx_count >= MAX_TX_RECORDS)
-        return false;
-
-    tx_persist_record_t record;
-    encode_transaction(tx, record.data);
-    record.crc = compute_crc(record.data);
+    if (batch.state != BATCH_NONE)
+        return stage_tx(tx);
 
-    uint32_t address = tx_count * sizeof(tx_persist_record_t);
-
-    if (!storage_driver_write(address, (uint8_t*)&record, sizeof(record)))
+    if (!write_record(tx_count, tx, true))
         return false;
 
-    tx_count++;
+    balance_index_apply(tx);
+
+    // A failed index insert is repaired by a lazy rebuild, so the
+    // record itself stays committed.
+    (void)tx_index_insert(tx->tx_id, tx_count - 1);
 
     // Create periodic checkpoint
     if (tx_count % CHECKPOINT_INTERVAL == 0)
@@ -119,21 +1076,22 @@ bool ledger_storage_store_tx(const ledger_tx_t *tx)
 
 bool ledger_storage_load_tx(uint32_t index, ledger_tx_t *tx_out)
 {
-    if (index >= tx_count)
+    if (tx_out == NULL || index < base_index || index >= tx_count)
         return false;
 
-    tx_persist_record_t record;
-    uint32_t address = index * sizeof(tx_persist_record_t);
+    return read_record(index, tx_out, NULL);
+}
 
-    if (!storage_driver_read(address, (uint8_t*)&record, sizeof(record)))
+/**
+ * Like ledger_storage_load_tx(), and also reports whether the record
+ * counts toward balances (a merge can leave one in place as invalid).
+ */
+bool ledger_storage_load_tx_status(uint32_t index, ledger_tx_t *tx_out, bool *valid_out)
+{
+    if (tx_out == NULL || valid_out == NULL || index < base_index || index >= tx_count)
         return false;
 
-    uint16_t calc_crc = compute_crc(record.data);
-    if (calc_crc != record.crc)
-        return false;  // corruption detected
-
-    decode_transaction(record.data, tx_out);
-    return true;
+    return read_record(index, tx_out, valid_out);
 }
 
 uint32_t ledger_storage_get_tx_count(void)
@@ -141,25 +1099,599 @@ uint32_t ledger_storage_get_tx_count(void)
     return tx_count;
 }
 
+uint32_t ledger_storage_get_max_lamport(void)
+{
+    return max_lamport;
+}
+
+/**
+ * Index of the oldest record still stored. Everything below it has
+ * been compacted into the checkpoint and can no longer be loaded.
+ */
+uint32_t ledger_storage_get_base_index(void)
+{
+    return base_index;
+}
+
+/**
+ * tx_id → log index through the tx_id index, falling back to a walk
+ * of the stored log when the index cannot answer. Returns HIT or MISS,
+ * or UNAVAILABLE if neither could rule the ID out.
+ */
+static tx_index_result_t lookup_tx(const char *tx_id, uint32_t *index_out)
+{
+    tx_index_result_t result = tx_index_lookup(tx_id, index_out);
+    if (result != TX_INDEX_UNAVAILABLE)
+        return result;
+
+    ledger_tx_t tx;
+    result = TX_INDEX_MISS;
+
+    for (uint32_t i = base_index; i < tx_count; i++) {
+        if (!read_record(i, &tx, NULL)) {
+            result = TX_INDEX_UNAVAILABLE;
+            continue;
+        }
+        if (strncmp(tx.tx_id, tx_id, TX_ID_LEN) == 0) {
+            if (index_out)
+                *index_out = i;
+            return TX_INDEX_HIT;
+        }
+    }
+    return result;
+}
+
+/**
+ * Duplicate check via the on-flash tx_id index: one slot read when
+ * the ID is new, slot + confirm read when it already exists. Fails
+ * closed: if neither the index nor the log can rule the ID out, it is
+ * reported as existing, so the sender retries rather than a replay
+ * getting through. Compacted history is only checked against the
+ * bounded settled set; ledger_storage_tx_known() covers all of it.
+ */
+bool ledger_storage_transaction_exists(const char *tx_id)
+{
+    if (tx_id == NULL)
+        return false;
+
+    uint32_t tag = tx_id_tag(tx_id);
+
+    if (batch.state == BATCH_OPEN) {
+        for (uint16_t i = 0; i < batch.count; i++)
+            if (batch.tags[i] == tag)
+                return true;
+    }
+
+    return lookup_tx(tx_id, NULL) != TX_INDEX_MISS || settled_contains(tag);
+}
+
+/**
+ * Duplicate check for a whole transaction, authoritative for compacted
+ * history too: anything at or below the settled watermark is refused.
+ * It is either settled already or too late to be placed in front of
+ * history that is no longer on flash.
+ */
+bool ledger_storage_tx_known(const ledger_tx_t *tx)
+{
+    if (tx == NULL)
+        return false;
+
+    if (settled->through > 0 && tx->lamport <= settled->lamport)
+        return true;
+
+    return ledger_storage_transaction_exists(tx->tx_id);
+}
+
+bool ledger_storage_find_tx(const char *tx_id, ledger_tx_t *tx_out)
+{
+    uint32_t index = 0;
+
+    if (tx_id == NULL || tx_out == NULL)
+        return false;
+
+    if (lookup_tx(tx_id, &index) != TX_INDEX_HIT)
+        return false;
+
+    return ledger_storage_load_tx(index, tx_out);
+}
+
+bool ledger_storage_find_tx_index(const char *tx_id, uint32_t *index_out)
+{
+    if (tx_id == NULL || index_out == NULL)
+        return false;
+
+    return lookup_tx(tx_id, index_out) == TX_INDEX_HIT;
+}
+
+/*******************************************************
+ * SUFFIX REWRITE (used by conflict resolution)
+ *
+ * Positional writes that let a merge rewrite the log from
+ * its first divergence point instead of clearing it. These
+ * do NOT touch the balance index: the merge revalidates
+ * the rewritten suffix in order and reports each balance
+ * effect via ledger_storage_adjust_balance().
+ *******************************************************/
+
+/**
+ * Merge adjacent runs by copying their records to the head in index
+ * order. If a run ends at next, the runs up to it are merged, so a
+ * write at next (a merge's next record) extends the copy. Otherwise
+ * it picks the fewest records that free a slot for good: the last two
+ * runs (appends then extend the copy), or any three in a row (the
+ * next append starts a run of its own). Copies in one go, since a
+ * write landing in between would split the copy again.
+ */
+static bool coalesce_runs(uint32_t next)
+{
+    uint32_t best_cost = UINT32_MAX;
+    uint8_t  first = 0, width = 0;
+    ledger_tx_t tx;
+    bool valid;
+
+    for (uint8_t i = 1; i < run_count; i++) {
+        if (runs[i].index + runs[i].count == next) {
+            first = (i >= 2) ? i - 2 : 0;
+            width = i - first + 1;
+            break;
+        }
+    }
+
+    if (width == 0 && run_count >= 2) {
+        first = run_count - 2;
+        width = 2;
+        best_cost = runs[first].count + runs[first + 1].count;
+
+        for (uint8_t i = 0; i + 3 <= run_count; i++) {
+            uint32_t cost = runs[i].count + runs[i + 1].count + runs[i + 2].count;
+            if (cost < best_cost) {
+                best_cost = cost;
+                first = i;
+                width = 3;
+            }
+        }
+    }
+    if (width == 0)
+        return false;
+
+    uint32_t from = runs[first].index;
+    uint32_t to   = runs[first + width - 1].index + runs[first + width - 1].count;
+
+    bool ok = true;
+
+    coalescing = true;
+    for (uint32_t index = from; index < to && ok; index++)
+        ok = read_record(index, &tx, &valid) && write_record(index, &tx, valid);
+    coalescing = false;
+    return ok;
+}
+
+/**
+ * Write tx at a log position, appending or replacing what is there.
+ * valid = false keeps the record but takes it out of every balance.
+ * The tx_id index gains the new position before the record is
+ * written: until then it cannot confirm, and after a crash it is
+ * already indexed. Slots left at old positions simply stop confirming.
+ */
+bool ledger_storage_rewrite_tx(uint32_t index, const ledger_tx_t *tx, bool valid)
+{
+    if (tx == NULL || index > tx_count || index < base_index || batch.state != BATCH_NONE)
+        return false;
+
+    // A long merge can use up run slots before compaction runs again
+    if (!run_has_room(index, next_ordinal, LEDGER_COMPACT_RUNS))
+        (void)coalesce_runs(index);
+
+    // A failed insert drops the index for a lazy rebuild
+    (void)tx_index_insert(tx->tx_id, index);
+
+    if (!write_record(index, tx, valid))
+        return false;
+
+    // Already settled positions must still catch a replay once compacted
+    if (index < settled->through)
+        settled_add(tx);
+
+    if (index < rewrite_low)
+        rewrite_low = index;
+
+    return true;
+}
+
+void ledger_storage_adjust_balance(const ledger_tx_t *added, const ledger_tx_t *removed)
+{
+    if (added)
+        balance_index_apply(added);
+    if (removed)
+        balance_index_revert(removed);
+}
+
+/**
+ * A merge splits the run it starts in, and if it lines up with the old
+ * log before the end, the rest stays a run of its own. While the last
+ * two runs are short, copy them to the head so the suffix is one run
+ * again and merges do not use up the run table.
+ */
+static bool join_last_runs(void)
+{
+    if (run_count < 2 || tx_count - runs[run_count - 2].index > LEDGER_REWRITE_JOIN_MAX)
+        return true;
+
+    ledger_tx_t tx;
+    bool valid;
+
+    for (uint32_t index = runs[run_count - 2].index; index < tx_count; index++) {
+        if (!read_record(index, &tx, &valid) || !write_record(index, &tx, valid))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Close a rewrite. The last checkpoint's balances no longer match the
+ * log prefix it claims if a record below it moved, so take a new one.
+ */
+bool ledger_storage_end_rewrite(void)
+{
+    uint32_t low = rewrite_low;
+
+    rewrite_low = UINT32_MAX;
+    if (low < tx_count)
+        (void)join_last_runs();
+    if (low >= checkpoint_covers)
+        return true;
+
+    return ledger_storage_checkpoint();
+}
+
+/*******************************************************
+ * GROUP COMMIT (used by batch import)
+ *
+ * Transactions stored between begin and commit are staged
+ * in RAM and programmed together, a few KB per write. Every
+ * record but the last carries a continuation flag, so the
+ * last one is the commit point: on mount a group without it
+ * is rolled back as a whole. Balances update as each
+ * transaction is staged so funds checks see the batch; the
+ * tx_id index is written once the group is durable.
+ *******************************************************/
+
+bool ledger_storage_begin_batch(void)
+{
+    if (batch.state != BATCH_NONE || !run_has_room(tx_count, next_ordinal, LEDGER_COMPACT_RUNS))
+        return false;
+
+    memset(&batch, 0, sizeof(batch));
+    batch.state            = BATCH_OPEN;
+    batch.first_index      = tx_count;
+    batch.saved_last_index = head_last_index;
+    return true;
+}
+
+/**
+ * Program what is left of the batch with its commit record last, then
+ * publish it. Returns false if the batch was aborted or could not be
+ * made durable; the ledger is then as it was before begin.
+ */
+bool ledger_storage_commit_batch(void)
+{
+    if (batch.state == BATCH_FAILED) {
+        batch.state = BATCH_NONE;
+        return false;
+    }
+    if (batch.state != BATCH_OPEN)
+        return false;
+
+    if (batch.count == 0) {
+        batch.state = BATCH_NONE;
+        return true;
+    }
+
+    ledger_record_end_group(batch_buf + batch.staged_bytes - batch.last_len, batch.last_len);
+    if (!flush_batch()) {
+        ledger_storage_abort_batch();
+        return false;
+    }
+
+    uint32_t before = tx_count;
+    pending_group_t group = { batch.count, batch.first_index, batch.first_ordinal };
+
+    batch.state = BATCH_NONE;
+    commit_group(&group);
+
+    // Index from flash now that the records are durable
+    ledger_tx_t tx;
+    for (uint32_t i = before; i < tx_count; i++) {
+        if (read_record(i, &tx, NULL))
+            (void)tx_index_insert(tx.tx_id, i);
+    }
+
+    if (before / CHECKPOINT_INTERVAL != tx_count / CHECKPOINT_INTERVAL)
+        ledger_storage_checkpoint();
+
+    return true;
+}
+
+/**
+ * Drop the open batch. Staged bytes are simply forgotten; if part of
+ * it reached flash the head is sealed so no later record can commit
+ * it. Balances are rebuilt from the checkpoint and the log.
+ */
+void ledger_storage_abort_batch(void)
+{
+    if (batch.state != BATCH_OPEN) {
+        batch.state = BATCH_NONE;
+        return;
+    }
+
+    segment_info_t *seg = &segments[head_segment];
+
+    if (batch.flushed) {
+        seg->sealed = true;
+    } else if (batch.count > 0) {
+        // Everything is still in RAM and in this segment: take it back
+        seg->records -= batch.count;
+        seg->used     = batch.staged_offset;
+        next_ordinal -= batch.count;
+    }
+
+    head_last_index = batch.saved_last_index;
+    intern_reset();
+    memset(&batch, 0, sizeof(batch));
+    rebuild_balance_index();
+}
+
+// Record area, checkpoints and the tx_id index together
+uint32_t ledger_storage_get_bytes_written(void)
+{
+    return flash_bytes_written + tx_index_get_bytes_written();
+}
+
+/**
+ * O(1) balance lookup via the balance index. Only scans the log if
+ * the index ran out of slots and does not know this account.
+ */
+bool ledger_storage_get_balance(const char *account_id, float *out_balance)
+{
+    if (account_id == NULL || out_balance == NULL)
+        return false;
+
+    if (balance_index_lookup(account_id, out_balance))
+        return true;
+
+    float balance = 0.0f;
+    ledger_tx_t tx;
+    bool valid;
+
+    for (uint32_t i = base_index; i < tx_count; i++) {
+        if (!read_record(i, &tx, &valid) || !valid)
+            continue;
+        if (strncmp(tx.sender, account_id, SENDER_ID_LEN) == 0)
+            balance -= tx.amount;
+        if (strncmp(tx.receiver, account_id, SENDER_ID_LEN) == 0)
+            balance += tx.amount;
+    }
+
+    *out_balance = balance;
+    return true;
+}
+
 /*******************************************************
  * CHECKPOINT SYSTEM
  *******************************************************/
 
 bool ledger_storage_checkpoint(void)
 {
-    ledger_checkpoint_t snapshot;
+    // Balances already include staged transactions that tx_count does not
+    if (batch.state != BATCH_NONE)
+        return false;
 
     // Build checkpoint metadata
-    snapshot.tx_count  = tx_count;
-    snapshot.lamport   = ledger_state_get_lamport();
-    snapshot.group_bal = ledger_state_get_group_balances();
+    checkpoint_image.meta.tx_count = tx_count;
+    checkpoint_image.meta.lamport  = max_lamport;
+
+    // Balances as of tx_count, so boot only replays records after it
+    memcpy(&checkpoint_image.balances, balance_index_image(), sizeof(checkpoint_image.balances));
+
+    if (!security_sign((const uint8_t*)&checkpoint_image, checkpoint_signed_len(),
+                       checkpoint_image.signature))
+        return false;
+
+    checkpoint_image.crc = compute_checkpoint_crc(&checkpoint_image);
+
+    if (!storage_driver_write_checkpoint((uint8_t*)&checkpoint_image, sizeof(checkpoint_image)))
+        return false;
 
-    return storage_driver_write_checkpoint((uint8_t*)&snapshot, sizeof(snapshot));
+    flash_bytes_written += sizeof(checkpoint_image);
+    checkpoint_covers = tx_count;
+    checkpoint_settled = settled->through;
+    checkpoint_ok = true;
+    return true;
 }
 
 bool ledger_storage_restore_checkpoint(ledger_checkpoint_t *out)
 {
-    return storage_driver_read_checkpoint((uint8_t*)out, sizeof(*out));
+    if (!read_checkpoint_image())
+        return false;
+
+    *out = checkpoint_image.meta;
+    return true;
+}
+
+/*******************************************************
+ * COMPACTION
+ *
+ * Bounded work per call (one block erase, one checkpoint or
+ * a few record reads), run from the main loop. Crash-safe at
+ * every step:
+ *   - the tail's tx_ids are folded into the settled set, and
+ *     the checkpoint covering the segment and carrying that
+ *     set is written (A/B in the driver), before the segment
+ *     is touched;
+ *   - erasing the segment's header block drops it atomically;
+ *   - leftover blocks are erased lazily, before reuse.
+ *******************************************************/
+
+/**
+ * Split the mapped indices by where they live: the highest index
+ * still stored in the tail segment and the lowest stored anywhere
+ * else. The tail can only go once every index it holds sits below
+ * the rest of the log.
+ */
+static bool tail_index_span(uint32_t *tail_max, uint32_t *other_min)
+{
+    uint32_t lo = segments[tail_segment].first_ordinal;
+    uint32_t hi = lo + segments[tail_segment].records;
+    bool any = false;
+
+    *other_min = tx_count;
+
+    for (uint8_t i = 0; i < run_count; i++) {
+        const log_run_t *r = &runs[i];
+        uint32_t a = (r->ordinal > lo) ? r->ordinal : lo;
+        uint32_t b = (r->ordinal + r->count < hi) ? r->ordinal + r->count : hi;
+
+        if (a < b) {
+            uint32_t top = r->index + (b - r->ordinal) - 1;
+            if (!any || top > *tail_max)
+                *tail_max = top;
+            any = true;
+            if (a > r->ordinal && r->index < *other_min)
+                *other_min = r->index;
+            if (b < r->ordinal + r->count && top + 1 < *other_min)
+                *other_min = top + 1;
+        } else if (r->index < *other_min) {
+            *other_min = r->index;
+        }
+    }
+    return any;
+}
+
+// Forget the tail's records once its header block is gone
+static void trim_tail_runs(void)
+{
+    uint32_t hi = segments[tail_segment].first_ordinal + segments[tail_segment].records;
+
+    for (uint8_t i = 0; i < run_count; ) {
+        log_run_t *r = &runs[i];
+
+        if (r->ordinal + r->count <= hi) {
+            run_remove(i);
+            continue;
+        }
+        if (r->ordinal < hi) {
+            uint32_t cut = hi - r->ordinal;
+            r->index   += cut;
+            r->ordinal += cut;
+            r->count   -= cut;
+        }
+        i++;
+    }
+}
+
+/**
+ * Copy tail records that a rewrite left interleaved with newer ones
+ * to the head, a few per call, so the tail becomes droppable.
+ */
+static bool relocate_from_tail(uint32_t other_min)
+{
+    uint32_t lo = segments[tail_segment].first_ordinal;
+    uint32_t hi = lo + segments[tail_segment].records;
+    ledger_tx_t tx;
+    bool valid;
+
+    for (uint8_t moved = 0; moved < LEDGER_SPARSE_STEP; moved++) {
+        bool found = false;
+        uint32_t index = 0;
+
+        for (uint8_t i = 0; i < run_count && !found; i++) {
+            const log_run_t *r = &runs[i];
+            for (uint32_t k = 0; k < r->count; k++) {
+                if (r->ordinal + k >= lo && r->ordinal + k < hi && r->index + k >= other_min) {
+                    index = r->index + k;
+                    found = true;
+                    break;
+                }
+            }
+        }
+
+        if (!found)
+            return moved > 0;
+
+        relocating = true;
+        bool ok = read_record(index, &tx, &valid) && write_record(index, &tx, valid);
+        relocating = false;
+        if (!ok)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Fold the tx_ids of records up to and including last into the
+ * settled set, LEDGER_SETTLE_STEP records per call.
+ */
+static bool settle_records(uint32_t last)
+{
+    ledger_tx_t tx;
+    uint32_t i = (settled->through > base_index) ? settled->through : base_index;
+
+    for (uint8_t n = 0; n < LEDGER_SETTLE_STEP && i <= last; n++, i++) {
+        // An unreadable record has no tx_id left to remember
+        if (read_record(i, &tx, NULL))
+            settled_add(&tx);
+    }
+
+    settled->through = i;
+    return true;
+}
+
+/**
+ * Returns true if it did flash work this call.
+ */
+bool ledger_storage_compact_step(void)
+{
+    if (batch.state != BATCH_NONE)
+        return false;
+
+    for (uint8_t s = 0; s < LEDGER_SEGMENT_COUNT; s++) {
+        if (segments[s].state == SEGMENT_DIRTY)
+            return clean_segment(s, false);
+    }
+
+    // Merges take run slots that otherwise only come back with the
+    // tail. Coalesce when idle, or first if the table is nearly full;
+    // with the ring full that copy fails, and dropping the tail frees
+    // both.
+    if (run_count + 2 + LEDGER_COMPACT_RUNS > LEDGER_MAX_RUNS && coalesce_runs(UINT32_MAX))
+        return true;
+
+    if (free_segment_count() >= LEDGER_COMPACT_FREE_SEGS || tail_segment == head_segment)
+        return (run_count + 2 + LEDGER_RUN_RESERVE > LEDGER_MAX_RUNS) && coalesce_runs(UINT32_MAX);
+
+    uint32_t tail_max = 0, other_min = 0;
+    if (tail_index_span(&tail_max, &other_min)) {
+        if (tail_max >= other_min)
+            return relocate_from_tail(other_min);
+
+        // Fold the oldest segment into a signed snapshot of balances
+        // and settled tx_ids first
+        if (settled->through <= tail_max)
+            return settle_records(tail_max);
+        if (!checkpoint_ok || checkpoint_covers <= tail_max || checkpoint_settled <= tail_max)
+            return ledger_storage_checkpoint();
+    }
+
+    if (!storage_driver_erase(segment_address(tail_segment), LEDGER_ERASE_BLOCK_BYTES))
+        return false;
+
+    trim_tail_runs();
+    segments[tail_segment].state        = SEGMENT_DIRTY;
+    segments[tail_segment].clean_blocks = 1;
+
+    tail_segment = (uint8_t)((tail_segment + 1) % LEDGER_SEGMENT_COUNT);
+    base_index   = (run_count > 0) ? runs[0].index : tx_count;
+    return true;
 }
 
 /*******************************************************
@@ -168,11 +1700,31 @@ bool ledger_storage_restore_checkpoint(ledger_checkpoint_t *out)
 
 bool ledger_storage_secure_erase(void)
 {
-    bool ok = storage_driver_secure_wipe_region(0, MAX_TX_RECORDS * sizeof(tx_persist_record_t));
+    bool ok = storage_driver_secure_wipe_region(0, LEDGER_SEGMENT_COUNT * LEDGER_SEGMENT_BYTES);
 
     if (!ok) return false;
 
+    for (uint8_t s = 0; s < LEDGER_SEGMENT_COUNT; s++) {
+        memset(&segments[s], 0, sizeof(segments[s]));
+        segments[s].state        = SEGMENT_CLEAN;
+        segments[s].clean_blocks = LEDGER_SEGMENT_BLOCKS;
+    }
+    head_segment = LEDGER_SEGMENT_COUNT - 1;
+    tail_segment = 0;
+    next_ordinal = 0;
+    run_count    = 0;
+    intern_reset();
+    memset(&batch, 0, sizeof(batch));
+    base_index   = 0;
+    checkpoint_covers = 0;
+    checkpoint_settled = 0;
+    checkpoint_ok = false;
+    settled_reset();
+
     tx_count = 0;
+    max_lamport = 0;
+    balance_index_reset();
+    tx_index_reset();
     return true;
 }
 
@@ -183,7 +1735,7 @@ void ledger_storage_debug_dump(void)
 {
     ledger_tx_t tx;
 
-    for (uint32_t i = 0; i < tx_count; i++) {
+    for (uint32_t i = base_index; i < tx_count; i++) {
         if (ledger_storage_load_tx(i, &tx)) {
             printf("TX %lu | %s -> %s | %.2f | lamport=%u\n",
                 (unsigned long)i,
@@ -5,8 +5,37 @@
 #include <stdbool.h>
 #include "ledger_manager.h"
 
-void ledger_storage_init(void);
-bool ledger_storage_write(const ledger_tx_t *tx);
-bool ledger_storage_load_all(void (*callback)(const ledger_tx_t *tx));
+#define LEDGER_STORAGE_BATCH_MAX_TX   128   // transactions per group commit
+
+// Metadata carried by the signed checkpoint
+typedef struct {
+    uint32_t tx_count;        // log prefix the snapshot covers
+    uint32_t lamport;         // highest lamport in that prefix
+} ledger_checkpoint_t;
+
+bool ledger_storage_init(void);
+bool ledger_storage_store_tx(const ledger_tx_t *tx);
+bool ledger_storage_load_tx(uint32_t index, ledger_tx_t *tx_out);
+bool ledger_storage_load_tx_status(uint32_t index, ledger_tx_t *tx_out, bool *valid_out);
+uint32_t ledger_storage_get_tx_count(void);
+uint32_t ledger_storage_get_base_index(void);
+uint32_t ledger_storage_get_max_lamport(void);
+bool ledger_storage_compact_step(void);
+bool ledger_storage_transaction_exists(const char *tx_id);
+bool ledger_storage_tx_known(const ledger_tx_t *tx);
+bool ledger_storage_find_tx(const char *tx_id, ledger_tx_t *tx_out);
+bool ledger_storage_find_tx_index(const char *tx_id, uint32_t *index_out);
+bool ledger_storage_rewrite_tx(uint32_t index, const ledger_tx_t *tx, bool valid);
+void ledger_storage_adjust_balance(const ledger_tx_t *added, const ledger_tx_t *removed);
+bool ledger_storage_end_rewrite(void);
+bool ledger_storage_begin_batch(void);
+bool ledger_storage_commit_batch(void);
+void ledger_storage_abort_batch(void);
+uint32_t ledger_storage_get_bytes_written(void);
+bool ledger_storage_get_balance(const char *account_id, float *out_balance);
+bool ledger_storage_checkpoint(void);
+bool ledger_storage_restore_checkpoint(ledger_checkpoint_t *out);
+bool ledger_storage_secure_erase(void);
+void ledger_storage_debug_dump(void);
 
 #endif
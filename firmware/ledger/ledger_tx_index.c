@@ -0,0 +1,316 @@
+/*************************************************************
+ * File: ledger_tx_index.c
+ * Layer: Firmware → Ledger Engine → Storage
+ * Description:
+ *    On-flash hash index from transaction ID to log position.
+ *    Responsible for:
+ *        - Duplicate / replay detection without scanning the log
+ *        - tx_id → record lookups for causal-ancestor checks
+ *        - Lazy rebuild after a crash or when chains grow too long
+ *
+ * Layout (inside storage_manager's reserved index region):
+ *    [header(16)][slot 0][slot 1]...[slot N-1]
+ *    Each slot is {tag, record_index}. Erased flash (0xFF) is an
+ *    empty slot, so inserts program a slot in place and never
+ *    need an erase. Open addressing with linear probing.
+ *
+ * NOTE:
+ *    Tags are 32-bit hashes, so every tag hit is confirmed by
+ *    reading the record itself. A miss (the common case for new
+ *    transactions) costs a single slot read. Slots of records
+ *    compacted below the log base are dead: they never confirm,
+ *    and the next rebuild drops them. So are the old slots of
+ *    records a merge moved; the move inserts the new position
+ *    rather than dropping the index. Replays of compacted
+ *    history are caught by ledger_storage's settled Lamport
+ *    watermark, which lives in the checkpoint and does not
+ *    depend on this index.
+ *************************************************************/
+
+#include "ledger_tx_index.h"
+#include "ledger_storage.h"
+#include "storage_manager.h"
+#include "crc16.h"
+#include <string.h>
+#include <stddef.h>
+
+#define TX_INDEX_MAGIC          0x54584931   // "TXI1"
+#define TX_INDEX_SLOT_COUNT     16384        // power of two, ~2x a full record ring
+#define TX_INDEX_SLOTS_OFFSET   16
+#define TX_INDEX_EMPTY_TAG      0xFFFFFFFFu
+// Longest probe an insert may take. Dead slots pile up as the log is
+// compacted; an insert that would go further schedules a rebuild, so
+// lookups never need to look further either.
+#define TX_INDEX_MAX_PROBE      64
+
+/**********************
+ * INTERNAL STRUCTURES
+ **********************/
+typedef struct {
+    uint32_t magic;
+    uint32_t slot_count;
+    uint32_t reserved;
+    uint16_t crc;
+} tx_index_header_t;
+
+typedef struct {
+    uint32_t tag;            // hash of tx_id; TX_INDEX_EMPTY_TAG = free
+    uint32_t record_index;   // position in the ledger log
+} tx_index_slot_t;
+
+static bool index_ready = false;   // header checked and tail repaired
+static uint32_t bytes_written = 0; // slots and headers programmed, for wear accounting
+
+/*******************************************************
+ *  INTERNAL HELPERS
+ *******************************************************/
+
+// FNV-1a over the tx_id, folded away from the erased-flash value
+static uint32_t tx_id_tag(const char *tx_id)
+{
+    uint32_t h = 2166136261u;
+
+    for (uint32_t i = 0; i < TX_ID_LEN && tx_id[i] != '\0'; i++) {
+        h ^= (uint8_t)tx_id[i];
+        h *= 16777619u;
+    }
+    return (h == TX_INDEX_EMPTY_TAG) ? (h - 1) : h;
+}
+
+static bool read_slot(uint32_t pos, tx_index_slot_t *slot)
+{
+    return storage_tx_index_read(TX_INDEX_SLOTS_OFFSET + pos * sizeof(tx_index_slot_t),
+                                 slot, sizeof(*slot));
+}
+
+static bool write_slot(uint32_t pos, const tx_index_slot_t *slot)
+{
+    if (!storage_tx_index_write(TX_INDEX_SLOTS_OFFSET + pos * sizeof(tx_index_slot_t),
+                                slot, sizeof(*slot)))
+        return false;
+
+    bytes_written += sizeof(*slot);
+    return true;
+}
+
+static tx_index_result_t confirm_record(uint32_t record_index, const char *tx_id)
+{
+    ledger_tx_t tx;
+
+    // Dead slot: compacted away, or left past the end by a crash
+    if (record_index < ledger_storage_get_base_index() ||
+        record_index >= ledger_storage_get_tx_count())
+        return TX_INDEX_MISS;
+
+    if (!ledger_storage_load_tx(record_index, &tx))
+        return TX_INDEX_UNAVAILABLE;
+
+    return (strncmp(tx.tx_id, tx_id, TX_ID_LEN) == 0) ? TX_INDEX_HIT : TX_INDEX_MISS;
+}
+
+static uint16_t header_crc(const tx_index_header_t *hdr)
+{
+    return crc16_compute((const uint8_t*)hdr, offsetof(tx_index_header_t, crc));
+}
+
+/**
+ * Insert without the readiness check. Idempotent: if the exact
+ * (tag, record_index) pair is already on the probe chain, nothing
+ * is written.
+ */
+static bool insert_raw(const char *tx_id, uint32_t record_index)
+{
+    const uint32_t mask = TX_INDEX_SLOT_COUNT - 1;
+    uint32_t tag = tx_id_tag(tx_id);
+    uint32_t pos = tag & mask;
+
+    for (uint32_t probe = 0; probe < TX_INDEX_MAX_PROBE; probe++) {
+        tx_index_slot_t slot;
+        uint32_t at = (pos + probe) & mask;
+
+        if (!read_slot(at, &slot))
+            return false;
+
+        if (slot.tag == TX_INDEX_EMPTY_TAG) {
+            slot.tag          = tag;
+            slot.record_index = record_index;
+            return write_slot(at, &slot);
+        }
+
+        if (slot.tag == tag && slot.record_index == record_index)
+            return true;
+    }
+
+    return false;   // chain too long: time to drop dead slots
+}
+
+/**
+ * Full rebuild: erase the region, index every record, then write the
+ * header last. A crash part-way leaves no header, so the next boot
+ * simply rebuilds again.
+ */
+static bool rebuild(void)
+{
+    if (!storage_tx_index_erase())
+        return false;
+
+    uint32_t count = ledger_storage_get_tx_count();
+    ledger_tx_t tx;
+
+    for (uint32_t i = ledger_storage_get_base_index(); i < count; i++) {
+        if (ledger_storage_load_tx(i, &tx) && !insert_raw(tx.tx_id, i))
+            return false;
+    }
+
+    tx_index_header_t hdr;
+    memset(&hdr, 0xFF, sizeof(hdr));
+    hdr.magic      = TX_INDEX_MAGIC;
+    hdr.slot_count = TX_INDEX_SLOT_COUNT;
+    hdr.reserved   = 0;
+    hdr.crc        = header_crc(&hdr);
+
+    if (!storage_tx_index_write(0, &hdr, sizeof(hdr)))
+        return false;
+
+    bytes_written += sizeof(hdr);
+    return true;
+}
+
+/**
+ * Records are indexed right after they are written, so a crash can
+ * only leave a short unindexed tail. Walk back from the newest record
+ * until we hit one that is already indexed.
+ */
+static bool repair_tail(void)
+{
+    uint32_t count = ledger_storage_get_tx_count();
+    uint32_t base  = ledger_storage_get_base_index();
+    ledger_tx_t tx;
+
+    for (uint32_t i = count; i > base; i--) {
+        uint32_t found = 0;
+
+        if (!ledger_storage_load_tx(i - 1, &tx))
+            continue;
+
+        if (tx_index_find(tx.tx_id, &found) && found == i - 1)
+            break;
+
+        if (!insert_raw(tx.tx_id, i - 1))
+            return false;
+    }
+
+    return true;
+}
+
+static bool ensure_ready(void)
+{
+    if (index_ready)
+        return true;
+
+    tx_index_header_t hdr;
+    bool header_ok =
+        storage_tx_index_read(0, &hdr, sizeof(hdr)) &&
+        hdr.magic == TX_INDEX_MAGIC &&
+        hdr.slot_count == TX_INDEX_SLOT_COUNT &&
+        hdr.crc == header_crc(&hdr);
+
+    // Mark ready first: repair_tail() looks records up through the index
+    index_ready = true;
+
+    if (!(header_ok ? repair_tail() : rebuild()))
+        index_ready = false;
+
+    return index_ready;
+}
+
+/*******************************************************
+ *  PUBLIC API IMPLEMENTATION
+ *******************************************************/
+
+void tx_index_init(void)
+{
+    // Validation and repair are deferred to the first lookup so boot
+    // stays fast when the device has nothing to sync.
+    index_ready = false;
+}
+
+bool tx_index_insert(const char *tx_id, uint32_t record_index)
+{
+    if (tx_id == NULL || !ensure_ready())
+        return false;
+
+    if (!insert_raw(tx_id, record_index)) {
+        // Index is too full of dead slots (or no longer matches the
+        // log); force a rebuild next time
+        tx_index_reset();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Look a tx_id up. TX_INDEX_UNAVAILABLE means the index could not be
+ * read or rebuilt, or a candidate record could not be confirmed: the
+ * caller must not take it as a miss.
+ */
+tx_index_result_t tx_index_lookup(const char *tx_id, uint32_t *out_record_index)
+{
+    if (tx_id == NULL)
+        return TX_INDEX_MISS;
+    if (!ensure_ready())
+        return TX_INDEX_UNAVAILABLE;
+
+    const uint32_t mask = TX_INDEX_SLOT_COUNT - 1;
+    uint32_t tag = tx_id_tag(tx_id);
+    uint32_t pos = tag & mask;
+    tx_index_result_t result = TX_INDEX_MISS;
+
+    for (uint32_t probe = 0; probe < TX_INDEX_MAX_PROBE; probe++) {
+        tx_index_slot_t slot;
+
+        if (!read_slot((pos + probe) & mask, &slot))
+            return TX_INDEX_UNAVAILABLE;
+
+        if (slot.tag == TX_INDEX_EMPTY_TAG)
+            return result;
+
+        if (slot.tag != tag)
+            continue;
+
+        tx_index_result_t confirmed = confirm_record(slot.record_index, tx_id);
+        if (confirmed == TX_INDEX_HIT) {
+            if (out_record_index)
+                *out_record_index = slot.record_index;
+            return TX_INDEX_HIT;
+        }
+        if (confirmed == TX_INDEX_UNAVAILABLE)
+            result = TX_INDEX_UNAVAILABLE;   // keep looking for a sure hit
+    }
+
+    return result;
+}
+
+bool tx_index_find(const char *tx_id, uint32_t *out_record_index)
+{
+    return tx_index_lookup(tx_id, out_record_index) == TX_INDEX_HIT;
+}
+
+uint32_t tx_index_get_bytes_written(void)
+{
+    return bytes_written;
+}
+
+/**
+ * Drop the on-flash index. Must be called whenever the log is erased;
+ * the next lookup rebuilds it.
+ */
+bool tx_index_reset(void)
+{
+    index_ready = false;
+    return storage_tx_index_erase();
+}
+
+/*************************************************************
+ * END FILE: ledger_tx_index.c
+ *************************************************************/
@@ -0,0 +1,20 @@
+#ifndef LEDGER_TX_INDEX_H
+#define LEDGER_TX_INDEX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+    TX_INDEX_MISS = 0,
+    TX_INDEX_HIT,
+    TX_INDEX_UNAVAILABLE      // index or record unreadable: no answer
+} tx_index_result_t;
+
+void tx_index_init(void);
+bool tx_index_insert(const char *tx_id, uint32_t record_index);
+tx_index_result_t tx_index_lookup(const char *tx_id, uint32_t *out_record_index);
+bool tx_index_find(const char *tx_id, uint32_t *out_record_index);
+bool tx_index_reset(void);
+uint32_t tx_index_get_bytes_written(void);
+
+#endif
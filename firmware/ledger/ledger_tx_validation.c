@@ -0,0 +1,116 @@
+// firmware/ledger/ledger_tx_validation.c
+//
+// Purpose:
+//   Checks on the ledger_tx_t records the firmware stores and syncs
+//   (ledger_validation.h): record format, device signatures through the
+//   verdict cache, and the funds check merges run in Lamport order.
+//
+// Notes:
+//   - ledger_validation.c holds the SeedTransaction validation model;
+//     this file is the part the node image links.
+//
+
+#include "ledger_validation.h"
+#include "ledger_storage.h"
+#include "verify_cache.h"
+#include "security_module.h"
+#include "device_config.h"
+
+#include <stddef.h>
+#include <string.h>
+
+// ---------------------------------------------------------
+// SIGNATURES
+// ---------------------------------------------------------
+
+// Received ledger_tx_t records are signed by their device over every
+// byte in front of the signature, with the device key check behind
+// security_verify().
+static bool
+verify_ledger_tx_item(const verify_item_t *item, void *ctx)
+{
+    (void)ctx;
+    return security_verify(item->msg, (uint16_t)item->msg_len, item->sig);
+}
+
+static void
+ledger_tx_item(const ledger_tx_t *tx, verify_item_t *item)
+{
+    item->signer     = (const uint8_t *)tx->device_id;
+    item->signer_len = sizeof(tx->device_id);
+    item->msg        = (const uint8_t *)tx;
+    item->msg_len    = offsetof(ledger_tx_t, signature);
+    item->sig        = tx->signature;
+    item->sig_len    = sizeof(tx->signature);
+}
+
+// Signature check for one received ledger record. Shares its cache key
+// with ledger_validation_check_signatures(), so a record pre-checked in
+// a batch is answered here without a second verify.
+bool
+ledger_validation_check_signature(const ledger_tx_t *tx)
+{
+    if (tx == NULL) return false;
+
+    verify_item_t item;
+    ledger_tx_item(tx, &item);
+    return verify_cache_check(&item, verify_ledger_tx_item, NULL);
+}
+
+// Batch pre-check for ledger_import_batch(). Returns the number valid;
+// the per-record verdicts stay in the cache for the apply path.
+uint32_t
+ledger_validation_check_signatures(const ledger_tx_t *txs, uint32_t count)
+{
+    if (txs == NULL) return 0;
+
+    uint32_t valid_count = 0;
+
+    for (uint32_t base = 0; base < count; base += VERIFY_BATCH_MAX) {
+        verify_item_t items[VERIFY_BATCH_MAX];
+        bool          verdict[VERIFY_BATCH_MAX];
+        uint32_t      n = 0;
+
+        for (uint32_t i = base; i < count && n < VERIFY_BATCH_MAX; i++) {
+            ledger_tx_item(&txs[i], &items[n++]);
+        }
+
+        valid_count += (uint32_t)verify_cache_check_batch(items, n, verdict,
+                                                          verify_ledger_tx_item, NULL);
+    }
+
+    return valid_count;
+}
+
+// ---------------------------------------------------------
+// MERGE CHECKS (conflict resolution)
+// ---------------------------------------------------------
+
+// Checks that do not depend on ledger position: format only.
+// Funds are checked separately, at the record's place in the order.
+bool
+ledger_validate_tx(const ledger_tx_t *tx)
+{
+    if (tx == NULL) return false;
+    if (tx->amount <= 0.0f) return false;
+    if (tx->tx_id[0] == '\0') return false;
+    if (tx->sender[0] == '\0') return false;
+    if (tx->receiver[0] == '\0') return false;
+
+    return strncmp(tx->sender, tx->receiver, SENDER_ID_LEN) != 0;
+}
+
+// Funds check against the balances the index holds right now. A
+// merge keeps them at the log prefix in front of its write cursor, so
+// this validates tx where it sits in Lamport order, not against
+// balances that already include later transactions.
+bool
+ledger_check_double_spend(const ledger_tx_t *tx)
+{
+    float balance = 0.0f;
+
+    if (tx == NULL || !ledger_storage_get_balance(tx->sender, &balance)) {
+        return false;
+    }
+    return tx->amount <= balance + LEDGER_CREDIT_LIMIT;
+}
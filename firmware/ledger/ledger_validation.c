@@ -13,15 +13,22 @@
 //   - Types like SeedTransaction, LedgerState, and CryptoContext are defined
 //     in shared headers (e.g., ledger_types.h, crypto.h, trust_score.h).
 //   - The real embedded implementation will optimize memory, I/O, and crypto.
+//   - The checks on the firmware's ledger_tx_t records (ledger_validation.h)
+//     are in ledger_tx_validation.c, which builds without those headers.
 //
 
 #include "ledger_validation.h"
 #include "ledger_storage.h"
+#include "ledger_balance_index.h"
 #include "crypto.h"
 #include "trust_score.h"
 #include "config.h"
 #include "timekeeping.h"
 #include "safe_memory.h"
+#include "verify_cache.h"
+#include "security_module.h"
+
+#include <stddef.h>
 
 // ---------------------------------------------------------
 // ENUMS & CONSTANTS
@@ -83,13 +90,22 @@ check_format(const SeedTransaction *tx)
 }
 
 // Detect duplicates / replays by checking if tx_id already exists.
+// Backed by the on-flash tx_id hash index: a new ID costs one slot read.
 static bool
 check_duplicate(const LedgerState *state, const SeedTransaction *tx)
 {
     if (!state || !tx) return false;
 
-    const LedgerEntry *existing = ledger_storage_find_entry(state, tx->tx_id);
-    return (existing != NULL);
+    return ledger_storage_transaction_exists(tx->tx_id);
+}
+
+// Cache adapters: item->msg is the SeedTransaction, item->signer its key.
+static bool
+verify_tx_item(const verify_item_t *item, void *ctx)
+{
+    return crypto_verify_signature((const CryptoContext *)ctx,
+                                   (const SeedTransaction *)item->msg,
+                                   (const DevicePublicKey *)item->signer);
 }
 
 // Validate digital signature using device's public key registry.
@@ -107,7 +123,15 @@ check_signature(const CryptoContext *crypto,
         return false;
     }
 
-    return crypto_verify_signature(crypto, tx, pub);
+    // The whole transaction, signature included, plus the signer key is
+    // the cache key; a batch pre-check or an earlier copy answers here.
+    verify_item_t item = {
+        (const uint8_t *)pub, sizeof(*pub),
+        (const uint8_t *)tx,  sizeof(*tx),
+        NULL, 0
+    };
+
+    return verify_cache_check(&item, verify_tx_item, (void *)crypto);
 }
 
 // Ensure lamport clock is plausible and not wildly behind/ahead.
@@ -117,7 +141,7 @@ check_lamport_clock(const LedgerState *state,
 {
     if (!state || !tx) return false;
 
-    uint64_t global_max = ledger_storage_get_max_lamport(state);
+    uint64_t global_max = ledger_storage_get_max_lamport();
     // Allow some slack; fully strict behavior would reject anything below
     if (tx->lamport > global_max + MAX_CLOCK_DRIFT_STEPS) {
         return false;
@@ -137,8 +161,7 @@ check_causal_ancestors(const LedgerState *state,
         const char *ref_id = tx->prev_tx_ids[i];
         if (!ref_id || ref_id[0] == '\0') continue;
 
-        const LedgerEntry *e = ledger_storage_find_entry(state, ref_id);
-        if (e == NULL) {
+        if (!ledger_storage_transaction_exists(ref_id)) {
             missing_count++;
             if (missing_count > MAX_MISSING_ANCESTORS) {
                 return REASON_MISSING_ANCESTOR;
@@ -151,6 +174,9 @@ check_causal_ancestors(const LedgerState *state,
 }
 
 // Calculate current spendable balance for a given account.
+// O(1) when the balance index knows the account: only applied (valid)
+// transactions ever reach it. Accounts the index dropped on overflow
+// fall back to walking the log, counting valid entries only.
 static bool
 compute_balance(const LedgerState *state,
                 const char *account_id,
@@ -158,6 +184,10 @@ compute_balance(const LedgerState *state,
 {
     if (!state || !account_id || !out_balance) return false;
 
+    if (balance_index_lookup(account_id, out_balance)) {
+        return true;
+    }
+
     float balance = 0.0f;
     const LedgerCursor *cur = ledger_storage_cursor_begin(state);
     while (!ledger_storage_cursor_end(cur)) {
@@ -317,6 +347,58 @@ ledger_validate_transaction(const LedgerState       *state,
     return true;
 }
 
+// ---------------------------------------------------------
+// BATCH SIGNATURE PRE-CHECK
+// ---------------------------------------------------------
+
+/**
+ * Verify the signatures of a group of received transactions through the
+ * signature cache. Verdicts land in the cache, so the per-transaction
+ * check_signature() in ledger_validate_transaction is then a cache hit. Transactions from unknown devices are marked
+ * invalid and never reach the verifier. Returns the number valid.
+ */
+size_t
+ledger_validate_signatures(const CryptoContext   *crypto,
+                           const SeedTransaction *txs,
+                           size_t                 count,
+                           bool                  *valid_out)
+{
+    if (!crypto || !txs || !valid_out) return 0;
+
+    size_t valid_count = 0;
+
+    for (size_t base = 0; base < count; base += VERIFY_BATCH_MAX) {
+        verify_item_t items[VERIFY_BATCH_MAX];
+        size_t        where[VERIFY_BATCH_MAX];
+        bool          verdict[VERIFY_BATCH_MAX];
+        size_t        n = 0;
+
+        for (size_t i = base; i < count && i < base + VERIFY_BATCH_MAX; i++) {
+            const DevicePublicKey *pub =
+                crypto_lookup_device_key(crypto, txs[i].device_id);
+
+            valid_out[i] = false;
+            if (pub == NULL) continue;
+
+            items[n].signer     = (const uint8_t *)pub;
+            items[n].signer_len = sizeof(*pub);
+            items[n].msg        = (const uint8_t *)&txs[i];
+            items[n].msg_len    = sizeof(txs[i]);
+            items[n].sig        = NULL;
+            items[n].sig_len    = 0;
+            where[n++] = i;
+        }
+
+        valid_count += verify_cache_check_batch(items, n, verdict,
+                                                verify_tx_item, (void *)crypto);
+        for (size_t j = 0; j < n; j++) {
+            valid_out[where[j]] = verdict[j];
+        }
+    }
+
+    return valid_count;
+}
+
 // ---------------------------------------------------------
 // HIGH-LEVEL LEDGER APPLY ENTRY
 // ---------------------------------------------------------
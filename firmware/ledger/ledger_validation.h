@@ -6,5 +6,7 @@
 
 bool ledger_validate_tx(const ledger_tx_t *tx);
 bool ledger_check_double_spend(const ledger_tx_t *tx);
+bool ledger_validation_check_signature(const ledger_tx_t *tx);
+uint32_t ledger_validation_check_signatures(const ledger_tx_t *txs, uint32_t count);
 
 #endif
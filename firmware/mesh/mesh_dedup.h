@@ -0,0 +1,50 @@
+#ifndef MESH_DEDUP_H
+#define MESH_DEDUP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define MESH_DEDUP_KEY_LEN       16
+
+// Bits per Bloom filter (power of two); two filters are kept
+#ifndef MESH_DEDUP_FILTER_BITS
+#define MESH_DEDUP_FILTER_BITS   16384
+#endif
+
+// Bits set per key
+#define MESH_DEDUP_HASHES        4
+
+// While traffic flows a key is remembered for half to all of this
+#ifndef MESH_DEDUP_WINDOW_MS
+#define MESH_DEDUP_WINDOW_MS     60000
+#endif
+
+// Keys per filter before it is rotated early; bounds the false-drop rate
+// (about 0.5% with both filters full at the defaults)
+#ifndef MESH_DEDUP_CAPACITY
+#define MESH_DEDUP_CAPACITY      1024
+#endif
+
+typedef struct {
+    uint32_t lookups;
+    uint32_t duplicates;          // lookups that matched a remembered key
+    uint32_t rotations;           // filters retired by age
+    uint32_t early_rotations;     // filters retired because they were full
+} mesh_dedup_stats_t;
+
+void     mesh_dedup_init(const uint8_t key[MESH_DEDUP_KEY_LEN]);
+void     mesh_dedup_clear(void);
+
+// Keys: a message's identity, or a digest of the frame bytes
+uint64_t mesh_dedup_key_msg(uint16_t src, uint32_t msg_id);
+uint64_t mesh_dedup_key_bytes(const uint8_t *data, size_t len);
+
+// True if `key` was seen within the window; otherwise remembers it
+bool     mesh_dedup_check(uint64_t key, uint32_t now_ms);
+bool     mesh_dedup_contains(uint64_t key, uint32_t now_ms);
+void     mesh_dedup_insert(uint64_t key, uint32_t now_ms);
+
+void     mesh_dedup_get_stats(mesh_dedup_stats_t *out);
+
+#endif
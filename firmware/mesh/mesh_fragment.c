@@ -0,0 +1,482 @@
+/**
+ * firmware/mesh/mesh_fragment.c
+ *
+ * Fragmentation and reassembly of large payloads (ledger snapshots) for Seed.
+ *
+ * This module is responsible for:
+ *  - Splitting a buffer into at most MAX_FRAGMENT_COUNT numbered fragments
+ *    that fit in one mesh frame each
+ *  - Reassembling incoming fragments into a small fixed pool of buffers
+ *  - Selective repeat: receivers NACK with a bitmap of the fragments they
+ *    are missing, and the sender retransmits only those
+ *  - Timing out transfers that stop making progress
+ *
+ * Wire format (carried as MESH_MSG_LEDGER_SYNC payload):
+ *
+ *   DATA: [kind=1][xfer_id(2)][origin(2)][seq(1)][count(1)][total_len(2)][data]
+ *   NACK: [kind=2][xfer_id(2)][origin(2)][missing bitmap(2)]
+ *
+ * A NACK with an empty bitmap is an ACK. Losing 10–20% of fragments costs
+ * one or two NACK rounds for just the lost pieces; the transfer never
+ * restarts from fragment zero.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stddef.h>
+
+#include "mesh_fragment.h"
+#include "radio_config.h"
+#include "timekeeping.h"
+
+// -----------------------------------------------------------------------------
+// Configuration knobs
+// -----------------------------------------------------------------------------
+
+// Payload bytes per fragment; header + data must fit a mesh_packet_t payload
+#define FRAG_DATA_SIZE              96U
+
+// Largest transfer we can carry
+#define FRAG_MAX_TRANSFER           (FRAG_DATA_SIZE * MAX_FRAGMENT_COUNT)
+
+// Concurrent inbound transfers (each holds a FRAG_MAX_TRANSFER buffer)
+#define FRAG_RX_POOL_SIZE           2U
+
+// Fragments sent per tick, to leave airtime for other traffic
+#define FRAG_TX_BURST               4U
+
+// Sender: gap between bursts while fragments are pending (ms)
+#define FRAG_TX_PACE_MS             200U
+
+// Receiver: NACK after this long without new fragments (ms)
+#define FRAG_NACK_INTERVAL_MS       4000U
+
+// Receiver: give up on a transfer after this many unanswered NACKs
+#define FRAG_MAX_NACKS              5U
+
+// Sender: consider a transfer finished after this long without NACKs (ms).
+// Outlasts a receiver's full NACK budget so lost NACKs don't strand it.
+#define FRAG_TX_LINGER_MS           (FRAG_NACK_INTERVAL_MS * (FRAG_MAX_NACKS + 1U))
+
+#define FRAG_KIND_DATA              1U
+#define FRAG_KIND_NACK              2U
+
+#define FRAG_DATA_HEADER            9U
+#define FRAG_NACK_LEN               7U
+
+#if MAX_FRAGMENT_COUNT > 16
+#error "NACK bitmap is 16 bits; raise its width with MAX_FRAGMENT_COUNT"
+#endif
+
+// -----------------------------------------------------------------------------
+// Local types
+// -----------------------------------------------------------------------------
+
+/**
+ * The single outbound transfer.
+ */
+typedef struct {
+    bool     active;
+    uint16_t dst;
+    uint16_t xfer_id;
+    uint16_t total_len;
+    uint8_t  count;
+    uint16_t pending;                   // fragments still to (re)send
+    uint32_t last_activity_ms;          // last send or NACK
+    uint8_t  data[FRAG_MAX_TRANSFER];
+} frag_tx_state_t;
+
+/**
+ * One reassembly buffer.
+ */
+typedef struct {
+    bool     in_use;
+    uint16_t origin;
+    uint16_t xfer_id;
+    uint16_t total_len;
+    uint8_t  count;
+    uint8_t  nacks_sent;
+    uint16_t received;                  // bitmap of fragments held
+    uint32_t last_progress_ms;
+    uint8_t  data[FRAG_MAX_TRANSFER];
+} frag_rx_slot_t;
+
+// -----------------------------------------------------------------------------
+// Static state
+// -----------------------------------------------------------------------------
+
+static uint16_t                next_xfer_id = 1;
+static mesh_fragment_handler_t deliver      = NULL;
+static frag_tx_state_t         tx_state;
+static frag_rx_slot_t          rx_pool[FRAG_RX_POOL_SIZE];
+
+// Recently completed transfers, so late duplicates don't reopen them
+static uint32_t                done_keys[FRAG_RX_POOL_SIZE];
+static uint8_t                 done_head = 0;
+
+// Provided by mesh_protocol.c
+extern bool mesh_send_ledger_sync(uint16_t dst, const uint8_t *payload, uint8_t len);
+extern uint16_t mesh_get_local_address(void);
+
+// -----------------------------------------------------------------------------
+// Forward declarations (internal helpers)
+// -----------------------------------------------------------------------------
+
+static void frag_send_data(uint8_t seq);
+static void frag_send_nack(const frag_rx_slot_t *slot);
+static void frag_handle_data(const uint8_t *payload, uint8_t len);
+static void frag_handle_nack(const uint8_t *payload, uint8_t len);
+static frag_rx_slot_t *frag_rx_slot_for(uint16_t origin, uint16_t xfer_id, uint32_t now);
+
+static uint16_t frag_all_mask(uint8_t count)
+{
+    return (count >= 16U) ? 0xFFFFU : (uint16_t)((1U << count) - 1U);
+}
+
+static uint32_t frag_key(uint16_t origin, uint16_t xfer_id)
+{
+    return ((uint32_t)origin << 16) | xfer_id;
+}
+
+static bool frag_recently_done(uint16_t origin, uint16_t xfer_id)
+{
+    uint32_t key = frag_key(origin, xfer_id);
+
+    for (uint32_t i = 0; i < FRAG_RX_POOL_SIZE; ++i) {
+        if (done_keys[i] == key) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+// Public API
+// -----------------------------------------------------------------------------
+
+void mesh_fragment_init(mesh_fragment_handler_t handler)
+{
+    deliver = handler;
+
+    memset(&tx_state, 0, sizeof(tx_state));
+    memset(rx_pool, 0, sizeof(rx_pool));
+    memset(done_keys, 0, sizeof(done_keys));
+    done_head = 0;
+}
+
+/**
+ * Start sending `data` to `dst` (or MESH_FRAGMENT_BROADCAST). Fragments go
+ * out FRAG_TX_BURST per tick. Returns false if the payload is too large or
+ * a previous transfer is still in progress.
+ */
+bool mesh_fragment_send(uint16_t dst, const uint8_t *data, uint16_t len)
+{
+    if (!data || len == 0 || len > FRAG_MAX_TRANSFER) {
+        return false;
+    }
+    if (tx_state.active) {
+        return false;
+    }
+
+    tx_state.active           = true;
+    tx_state.dst              = dst;
+    tx_state.xfer_id          = next_xfer_id++;
+    tx_state.total_len        = len;
+    tx_state.count            = (uint8_t)((len + FRAG_DATA_SIZE - 1U) / FRAG_DATA_SIZE);
+    tx_state.pending          = frag_all_mask(tx_state.count);
+    tx_state.last_activity_ms = time_now_ms();
+
+    memcpy(tx_state.data, data, len);
+    return true;
+}
+
+bool mesh_fragment_tx_busy(void)
+{
+    return tx_state.active;
+}
+
+/**
+ * Entry point for every MESH_MSG_LEDGER_SYNC payload.
+ */
+void mesh_fragment_on_message(const uint8_t *payload, uint8_t len)
+{
+    if (!payload || len == 0) return;
+
+    switch (payload[0]) {
+        case FRAG_KIND_DATA:
+            frag_handle_data(payload, len);
+            break;
+
+        case FRAG_KIND_NACK:
+            frag_handle_nack(payload, len);
+            break;
+
+        default:
+            // Not a fragment; ignore
+            break;
+    }
+}
+
+// ms from now_ms until `since + interval`, 0 if already past
+static uint32_t frag_due_in(uint32_t since, uint32_t interval, uint32_t now_ms)
+{
+    uint32_t elapsed = now_ms - since;
+    return (elapsed >= interval) ? 0U : interval - elapsed;
+}
+
+/**
+ * Sends pending fragments, NACKs stalled reassemblies and expires dead
+ * transfers. Returns ms until the next call has work to do, or
+ * UINT32_MAX when no transfer is in progress.
+ */
+uint32_t mesh_fragment_tick(uint32_t now_ms)
+{
+    uint32_t next_ms = UINT32_MAX;
+
+    // 1) Sender: push out the next burst of pending fragments
+    if (tx_state.active) {
+        uint8_t sent = 0;
+
+        for (uint8_t seq = 0; seq < tx_state.count && sent < FRAG_TX_BURST; ++seq) {
+            if (tx_state.pending & (1U << seq)) {
+                frag_send_data(seq);
+                tx_state.pending &= (uint16_t)~(1U << seq);
+                tx_state.last_activity_ms = now_ms;
+                sent++;
+            }
+        }
+
+        // Nothing left to send and nobody asked for more: done
+        if (tx_state.pending == 0 &&
+            (now_ms - tx_state.last_activity_ms) >= FRAG_TX_LINGER_MS) {
+            tx_state.active = false;
+        }
+
+        if (tx_state.pending != 0) {
+            next_ms = FRAG_TX_PACE_MS;
+        } else if (tx_state.active) {
+            next_ms = frag_due_in(tx_state.last_activity_ms, FRAG_TX_LINGER_MS, now_ms);
+        }
+    }
+
+    // 2) Receivers: ask for what is missing, or give up
+    for (uint32_t i = 0; i < FRAG_RX_POOL_SIZE; ++i) {
+        frag_rx_slot_t *slot = &rx_pool[i];
+        if (!slot->in_use) {
+            continue;
+        }
+        if ((now_ms - slot->last_progress_ms) < FRAG_NACK_INTERVAL_MS) {
+            continue;
+        }
+
+        if (slot->nacks_sent >= FRAG_MAX_NACKS) {
+            slot->in_use = false;   // sender has gone away
+            continue;
+        }
+
+        frag_send_nack(slot);
+        slot->nacks_sent++;
+        slot->last_progress_ms = now_ms;
+    }
+
+    for (uint32_t i = 0; i < FRAG_RX_POOL_SIZE; ++i) {
+        if (rx_pool[i].in_use) {
+            uint32_t due = frag_due_in(rx_pool[i].last_progress_ms, FRAG_NACK_INTERVAL_MS, now_ms);
+            if (due < next_ms) {
+                next_ms = due;
+            }
+        }
+    }
+
+    return next_ms;
+}
+
+// -----------------------------------------------------------------------------
+// Internal helpers - sending
+// -----------------------------------------------------------------------------
+
+static void frag_send_data(uint8_t seq)
+{
+    uint8_t  buf[FRAG_DATA_HEADER + FRAG_DATA_SIZE];
+    uint16_t offset = (uint16_t)seq * FRAG_DATA_SIZE;
+    uint16_t chunk  = tx_state.total_len - offset;
+
+    if (chunk > FRAG_DATA_SIZE) {
+        chunk = FRAG_DATA_SIZE;
+    }
+
+    uint16_t self_addr = mesh_get_local_address();
+
+    buf[0] = FRAG_KIND_DATA;
+    memcpy(&buf[1], &tx_state.xfer_id, 2);
+    memcpy(&buf[3], &self_addr, 2);
+    buf[5] = seq;
+    buf[6] = tx_state.count;
+    memcpy(&buf[7], &tx_state.total_len, 2);
+    memcpy(&buf[FRAG_DATA_HEADER], &tx_state.data[offset], chunk);
+
+    (void)mesh_send_ledger_sync(tx_state.dst, buf, (uint8_t)(FRAG_DATA_HEADER + chunk));
+}
+
+static void frag_send_nack(const frag_rx_slot_t *slot)
+{
+    uint8_t  buf[FRAG_NACK_LEN];
+    uint16_t missing = frag_all_mask(slot->count) & (uint16_t)~slot->received;
+
+    buf[0] = FRAG_KIND_NACK;
+    memcpy(&buf[1], &slot->xfer_id, 2);
+    memcpy(&buf[3], &slot->origin, 2);
+    memcpy(&buf[5], &missing, 2);
+
+    (void)mesh_send_ledger_sync(slot->origin, buf, FRAG_NACK_LEN);
+}
+
+// -----------------------------------------------------------------------------
+// Internal helpers - receiving
+// -----------------------------------------------------------------------------
+
+static void frag_handle_data(const uint8_t *payload, uint8_t len)
+{
+    if (len <= FRAG_DATA_HEADER) {
+        return;
+    }
+
+    uint16_t xfer_id, origin, total_len;
+    memcpy(&xfer_id, &payload[1], 2);
+    memcpy(&origin, &payload[3], 2);
+    uint8_t seq   = payload[5];
+    uint8_t count = payload[6];
+    memcpy(&total_len, &payload[7], 2);
+
+    if (origin == mesh_get_local_address()) {
+        return; // our own broadcast echoed back
+    }
+    if (count == 0 || count > MAX_FRAGMENT_COUNT || seq >= count ||
+        total_len == 0 || total_len > FRAG_MAX_TRANSFER ||
+        total_len > (uint16_t)count * FRAG_DATA_SIZE) {
+        return; // malformed
+    }
+
+    uint16_t offset = (uint16_t)seq * FRAG_DATA_SIZE;
+    uint16_t expect = total_len - offset;
+    if (expect > FRAG_DATA_SIZE) {
+        expect = FRAG_DATA_SIZE;
+    }
+    if (offset >= total_len || (uint16_t)(len - FRAG_DATA_HEADER) != expect) {
+        return;
+    }
+    if (frag_recently_done(origin, xfer_id)) {
+        return; // late retransmission for a transfer we already delivered
+    }
+
+    uint32_t now = time_now_ms();
+    frag_rx_slot_t *slot = frag_rx_slot_for(origin, xfer_id, now);
+    if (!slot) {
+        return;
+    }
+
+    if (slot->received == 0) {
+        slot->total_len = total_len;
+        slot->count     = count;
+    } else if (slot->total_len != total_len || slot->count != count) {
+        return; // inconsistent with earlier fragments
+    }
+
+    if (!(slot->received & (1U << seq))) {
+        memcpy(&slot->data[offset], &payload[FRAG_DATA_HEADER], expect);
+        slot->received  |= (uint16_t)(1U << seq);
+        slot->nacks_sent = 0;
+    }
+    slot->last_progress_ms = now;
+
+    if (slot->received == frag_all_mask(slot->count)) {
+        // Acknowledge so the sender can stop early, then hand it up
+        frag_send_nack(slot);
+        slot->in_use = false;
+
+        done_keys[done_head] = frag_key(slot->origin, slot->xfer_id);
+        done_head = (uint8_t)((done_head + 1U) % FRAG_RX_POOL_SIZE);
+
+        if (deliver) {
+            deliver(slot->data, slot->total_len);
+        }
+    }
+}
+
+/**
+ * A receiver reports what it is missing. Broadcast transfers merge the
+ * bitmaps of every receiver; an empty bitmap from the unicast peer ends
+ * the transfer.
+ */
+static void frag_handle_nack(const uint8_t *payload, uint8_t len)
+{
+    if (len < FRAG_NACK_LEN || !tx_state.active) {
+        return;
+    }
+
+    uint16_t xfer_id, origin, missing;
+    memcpy(&xfer_id, &payload[1], 2);
+    memcpy(&origin, &payload[3], 2);
+    memcpy(&missing, &payload[5], 2);
+
+    if (origin != mesh_get_local_address() || xfer_id != tx_state.xfer_id) {
+        return; // someone else's transfer, or an old one
+    }
+
+    missing &= frag_all_mask(tx_state.count);
+
+    if (missing == 0 && tx_state.dst != MESH_FRAGMENT_BROADCAST) {
+        tx_state.active = false;
+        return;
+    }
+
+    tx_state.pending         |= missing;
+    tx_state.last_activity_ms = time_now_ms();
+}
+
+/**
+ * Find the reassembly buffer for a transfer, or claim one. When the pool
+ * is full, the transfer that has gone longest without progress is dropped.
+ */
+static frag_rx_slot_t *frag_rx_slot_for(uint16_t origin, uint16_t xfer_id, uint32_t now)
+{
+    frag_rx_slot_t *victim = NULL;
+
+    for (uint32_t i = 0; i < FRAG_RX_POOL_SIZE; ++i) {
+        frag_rx_slot_t *slot = &rx_pool[i];
+
+        if (slot->in_use && slot->origin == origin && slot->xfer_id == xfer_id) {
+            return slot;
+        }
+        if (!slot->in_use) {
+            if (!victim || victim->in_use) {
+                victim = slot;
+            }
+        } else if (!victim ||
+                   (victim->in_use &&
+                    (int32_t)(slot->last_progress_ms - victim->last_progress_ms) < 0)) {
+            victim = slot;   // stalled longer than the current candidate
+        }
+    }
+
+    if (!victim) {
+        return NULL;
+    }
+
+    memset(victim, 0, offsetof(frag_rx_slot_t, data));
+    victim->in_use           = true;
+    victim->origin           = origin;
+    victim->xfer_id          = xfer_id;
+    victim->last_progress_ms = now;
+    return victim;
+}
+
+// -----------------------------------------------------------------------------
+// mesh_protocol upper-layer callback
+// -----------------------------------------------------------------------------
+
+void mesh_on_ledger_sync_message(const uint8_t *payload, uint8_t len)
+{
+    mesh_fragment_on_message(payload, len);
+}
@@ -0,0 +1,18 @@
+#ifndef MESH_FRAGMENT_H
+#define MESH_FRAGMENT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MESH_FRAGMENT_BROADCAST   0xFFFF
+
+// Called once per fully reassembled (and length-checked) transfer
+typedef void (*mesh_fragment_handler_t)(const uint8_t *data, uint16_t len);
+
+void mesh_fragment_init(mesh_fragment_handler_t handler);
+bool mesh_fragment_send(uint16_t dst, const uint8_t *data, uint16_t len);
+void mesh_fragment_on_message(const uint8_t *payload, uint8_t len);
+uint32_t mesh_fragment_tick(uint32_t now_ms);
+bool mesh_fragment_tx_busy(void);
+
+#endif
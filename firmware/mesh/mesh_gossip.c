@@ -0,0 +1,328 @@
+/**
+ * Seed Device Firmware
+ * Mesh Networking Stack — Controlled Gossip
+ *
+ * File: mesh_gossip.c
+ * Purpose:
+ *     Decides whether a node relays a broadcast it has just accepted, and
+ *     when. Plain flooding has every node repeat every frame; with 40
+ *     devices in range of each other that is 40 transmissions where two
+ *     or three would reach everyone.
+ *
+ * Policies (mesh_gossip_set_mode):
+ *     - FLOOD: relay every new frame at once (the old behavior).
+ *     - ADAPTIVE (the default): relay with probability DENSITY_TARGET /
+ *       neighbors, so about that many neighbors repeat each frame however
+ *       dense the area is. This holds from the first hop on: with 32
+ *       neighbors the chance that none of them relays is about 1.4%.
+ *     - ELECTED: each sender picks up to MESH_GOSSIP_RELAYS neighbors
+ *       from mesh_neighbor_table (reliable links, farthest first) and
+ *       marks them in the frame's route prefix. Elected nodes relay
+ *       first. The others wait longer and relay only if they overhear
+ *       no other copy, which fills gaps the election missed. A sender
+ *       with no usable neighbors elects nobody and receivers fall back
+ *       to ADAPTIVE.
+ *
+ *     Relays that are not sent at once wait a random backoff counted in
+ *     frame airtimes. Each copy of the same frame overheard meanwhile is
+ *     counted, and the relay is cancelled at MESH_GOSSIP_COPIES_K: the
+ *     neighborhood is already covered.
+ *
+ * Routed unicasts (mesh_gossip_standby): neighbors that are not the
+ * named next hop hold the frame like a gap filler. The next hop's own
+ * relay, or the destination's link ack, cancels it; if neither is heard
+ * the frame goes on from here instead of being lost with one link.
+ *
+ * The held frame is the received pool buffer (one reference), so holding
+ * costs no copy. The send hook given to mesh_gossip_init() queues it.
+ */
+
+#include "mesh_gossip.h"
+#include "mesh_neighbor_table.h"
+#include "radio_airtime.h"
+#include <string.h>
+
+// ---------------------------------------------------------------------------
+// Internal Static State
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    uint64_t      key;
+    packet_buf_t *buf;            // NULL = free slot
+    uint32_t      due_ms;
+    uint8_t       radio_type;
+    uint8_t       tx_class;
+    uint8_t       copies;         // copies heard, counting the one held
+    uint8_t       limit;          // cancelled when copies reaches this
+} gossip_pending_t;
+
+static gossip_pending_t     pending[MESH_GOSSIP_PENDING];
+static mesh_gossip_mode_t   mode = MESH_GOSSIP_DEFAULT_MODE;
+static mesh_gossip_send_fn  send_hook;
+static mesh_gossip_notify_t held_notify;
+static uint16_t             self_addr;
+static uint32_t             rng_state = 1;
+static mesh_gossip_stats_t  stats;
+
+// ---------------------------------------------------------------------------
+// Internal Helpers
+// ---------------------------------------------------------------------------
+
+static uint32_t gossip_random(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+// Relay probability (x256): about DENSITY_TARGET of our neighbors should
+// repeat a frame, so each of them does with TARGET / neighbors
+static uint32_t relay_probability(void)
+{
+    int n = neighbor_table_count();
+
+    if (n <= MESH_GOSSIP_DENSITY_TARGET)
+        return 256;
+    return (uint32_t)(MESH_GOSSIP_DENSITY_TARGET * 256 / n);
+}
+
+static bool gossip_draw(void)
+{
+    return (gossip_random() & 0xFF) < relay_probability();
+}
+
+static bool elected(uint16_t relay_mask)
+{
+    return (relay_mask & mesh_gossip_relay_bit(self_addr)) != 0;
+}
+
+static bool relay_now(packet_buf_t *buf, uint8_t radio_type, uint8_t tx_class)
+{
+    if (send_hook == NULL || !send_hook(buf, radio_type, tx_class))
+        return false;
+
+    stats.relayed++;
+    return true;
+}
+
+static void pending_free(gossip_pending_t *p)
+{
+    packet_buf_release(p->buf);
+    p->buf = NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------------
+
+void mesh_gossip_init(mesh_gossip_send_fn send, uint16_t self, uint32_t seed)
+{
+    for (uint8_t i = 0; i < MESH_GOSSIP_PENDING; i++) {
+        if (pending[i].buf != NULL)
+            pending_free(&pending[i]);
+    }
+    memset(&stats, 0, sizeof(stats));
+
+    send_hook = send;
+    self_addr = self;
+    rng_state = seed ? seed : 1;
+}
+
+void mesh_gossip_set_mode(mesh_gossip_mode_t m)
+{
+    mode = m;
+}
+
+void mesh_gossip_set_notify(mesh_gossip_notify_t fn)
+{
+    held_notify = fn;
+}
+
+// Hold buf for a backoff of first_slot + [0, slots) frame airtimes, or
+// relay it at once if the table is full
+static bool gossip_hold(uint64_t key, packet_buf_t *buf, uint8_t radio_type, uint8_t tx_class,
+                        uint32_t first_slot, uint32_t slots, uint8_t limit, uint32_t now_ms)
+{
+    gossip_pending_t *p = NULL;
+    for (uint8_t i = 0; i < MESH_GOSSIP_PENDING && p == NULL; i++) {
+        if (pending[i].buf == NULL)
+            p = &pending[i];
+    }
+    if (p == NULL) {
+        stats.table_full++;
+        return relay_now(buf, radio_type, tx_class);
+    }
+
+    uint32_t slot_ms = airtime_time_on_air_us(buf->len + RADIO_FRAME_OVERHEAD) / 1000 + 1;
+
+    packet_buf_retain(buf);
+    p->key        = key;
+    p->buf        = buf;
+    p->radio_type = radio_type;
+    p->tx_class   = tx_class;
+    p->copies     = 1;
+    p->limit      = limit;
+    p->due_ms     = now_ms + (first_slot + gossip_random() % slots) * slot_ms +
+                    gossip_random() % slot_ms;
+
+    if (held_notify)
+        held_notify();
+    return true;
+}
+
+/**
+ * A frame this node accepted and may relay. `relay_mask` is from the
+ * route prefix as received. The frame is sent at once, held for a
+ * backoff, or dropped; returns false only when it will never be sent.
+ * A held frame keeps a reference to buf.
+ */
+bool mesh_gossip_offer(uint64_t key, packet_buf_t *buf, uint8_t radio_type, uint8_t tx_class,
+                       uint16_t relay_mask, uint32_t now_ms)
+{
+    uint32_t first_slot, slots;
+    uint8_t  limit;
+
+    stats.offered++;
+
+    if (mode == MESH_GOSSIP_FLOOD)
+        return relay_now(buf, radio_type, tx_class);
+
+    if (mode == MESH_GOSSIP_ELECTED && relay_mask != MESH_RELAY_ALL) {
+        if (elected(relay_mask)) {
+            first_slot = 0;
+            slots      = MESH_GOSSIP_SLOTS / 2;
+            limit      = MESH_GOSSIP_COPIES_K;
+        } else {
+            // Gap filler: goes after the elected relays, and not at all
+            // once any other copy is heard
+            first_slot = MESH_GOSSIP_SLOTS;
+            slots      = MESH_GOSSIP_SLOTS;
+            limit      = 2;
+        }
+    } else {
+        if (!gossip_draw()) {
+            stats.skipped++;
+            return false;
+        }
+        first_slot = 0;
+        slots      = MESH_GOSSIP_SLOTS;
+        limit      = MESH_GOSSIP_COPIES_K;
+    }
+
+    return gossip_hold(key, buf, radio_type, tx_class, first_slot, slots, limit, now_ms);
+}
+
+/**
+ * A routed unicast this node overheard but is not the next hop for. Held
+ * like a gap filler, after the next hop's own relay would have gone, and
+ * cancelled by the first copy or link ack heard for it. buf already
+ * carries the route prefix this node would send.
+ */
+bool mesh_gossip_standby(uint64_t key, packet_buf_t *buf, uint8_t radio_type, uint8_t tx_class,
+                         uint32_t now_ms)
+{
+    stats.standby++;
+    return gossip_hold(key, buf, radio_type, tx_class,
+                       MESH_GOSSIP_SLOTS, MESH_GOSSIP_SLOTS, 2, now_ms);
+}
+
+// Another copy of a frame was received; counts against a held relay
+void mesh_gossip_overheard(uint64_t key)
+{
+    for (uint8_t i = 0; i < MESH_GOSSIP_PENDING; i++) {
+        gossip_pending_t *p = &pending[i];
+
+        if (p->buf == NULL || p->key != key)
+            continue;
+
+        stats.overheard++;
+        if (++p->copies >= p->limit) {
+            pending_free(p);
+            stats.suppressed++;
+        }
+        return;
+    }
+}
+
+/**
+ * Send held relays whose backoff has run out. Returns ms until the next
+ * one is due, or UINT32_MAX if none are held.
+ */
+uint32_t mesh_gossip_tick(uint32_t now_ms)
+{
+    uint32_t next = UINT32_MAX;
+
+    for (uint8_t i = 0; i < MESH_GOSSIP_PENDING; i++) {
+        gossip_pending_t *p = &pending[i];
+
+        if (p->buf == NULL)
+            continue;
+
+        int32_t wait = (int32_t)(p->due_ms - now_ms);
+        if (wait <= 0) {
+            (void)relay_now(p->buf, p->radio_type, p->tx_class);
+            pending_free(p);
+        } else if ((uint32_t)wait < next) {
+            next = (uint32_t)wait;
+        }
+    }
+    return next;
+}
+
+// Bit an address occupies in a relay mask (Fibonacci hash to 0..15)
+uint16_t mesh_gossip_relay_bit(uint16_t addr)
+{
+    return (uint16_t)(1u << ((uint16_t)(addr * 40503u) >> 12));
+}
+
+/**
+ * Relay mask for a broadcast this node sends: up to MESH_GOSSIP_RELAYS
+ * neighbors with ETX at most MESH_GOSSIP_ELECT_MAX_ETX, weakest signal
+ * (farthest away, so most new coverage) first. MESH_RELAY_ALL when not
+ * electing or no neighbor qualifies.
+ */
+uint16_t mesh_gossip_elect_relays(uint16_t exclude_addr)
+{
+    neighbor_entry_t *cand[MAX_NEIGHBORS];
+    neighbor_entry_t *pick[MESH_GOSSIP_RELAYS];
+    uint8_t picked = 0;
+    uint16_t mask = 0;
+
+    if (mode != MESH_GOSSIP_ELECTED)
+        return MESH_RELAY_ALL;
+
+    uint8_t n = neighbor_table_top_k(cand, MAX_NEIGHBORS);
+
+    for (uint8_t i = 0; i < n; i++) {
+        neighbor_entry_t *c = cand[i];
+
+        if (c->addr == NEIGHBOR_ADDR_NONE || c->addr == exclude_addr ||
+            c->etx_x16 > MESH_GOSSIP_ELECT_MAX_ETX)
+            continue;
+
+        // Keep the MESH_GOSSIP_RELAYS weakest, sorted weakest first
+        uint8_t pos = picked < MESH_GOSSIP_RELAYS ? picked : MESH_GOSSIP_RELAYS;
+        while (pos > 0 && pick[pos - 1]->rssi > c->rssi) {
+            if (pos < MESH_GOSSIP_RELAYS)
+                pick[pos] = pick[pos - 1];
+            pos--;
+        }
+        if (pos < MESH_GOSSIP_RELAYS) {
+            pick[pos] = c;
+            if (picked < MESH_GOSSIP_RELAYS)
+                picked++;
+        }
+    }
+
+    for (uint8_t i = 0; i < picked; i++)
+        mask |= mesh_gossip_relay_bit(pick[i]->addr);
+
+    return picked ? mask : MESH_RELAY_ALL;
+}
+
+void mesh_gossip_get_stats(mesh_gossip_stats_t *out)
+{
+    if (out != NULL)
+        *out = stats;
+}
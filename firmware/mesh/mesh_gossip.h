@@ -0,0 +1,63 @@
+#ifndef MESH_GOSSIP_H
+#define MESH_GOSSIP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "packet_pool.h"
+
+#define MESH_GOSSIP_PENDING         8     // relays held in backoff at once
+#define MESH_GOSSIP_COPIES_K        3     // cancel a held relay after this many copies
+#define MESH_GOSSIP_DENSITY_TARGET  4     // neighbors expected to relay each frame
+#define MESH_GOSSIP_SLOTS           8     // backoff window, in frame airtimes
+#define MESH_GOSSIP_RELAYS          3     // relays elected per broadcast
+#define MESH_GOSSIP_ELECT_MAX_ETX   32    // ETX ×16 an elected relay may have (2.0)
+
+// relay_mask value meaning "no election": every receiver decides itself
+#define MESH_RELAY_ALL              0xFFFF
+
+typedef enum {
+    MESH_GOSSIP_FLOOD = 0,      // relay every new frame at once
+    MESH_GOSSIP_ADAPTIVE,       // density-scaled probability + counter suppression
+    MESH_GOSSIP_ELECTED         // previous hop elects relays; others only fill gaps
+} mesh_gossip_mode_t;
+
+// ADAPTIVE delivers as well as FLOOD in mesh_sim with 13-34% fewer relays
+// (radio_mesh_overview.md §8). Override per build or mesh_gossip_set_mode().
+#ifndef MESH_GOSSIP_DEFAULT_MODE
+#define MESH_GOSSIP_DEFAULT_MODE    MESH_GOSSIP_ADAPTIVE
+#endif
+
+typedef struct {
+    uint32_t offered;           // new frames that could be relayed
+    uint32_t relayed;           // handed on for transmit
+    uint32_t skipped;           // not relayed: lost the gossip draw or not elected
+    uint32_t suppressed;        // held, then cancelled on overheard copies
+    uint32_t overheard;         // copies counted against held relays
+    uint32_t table_full;        // no room to hold: relayed at once
+    uint32_t standby;           // routed frames held in case the next hop missed them
+} mesh_gossip_stats_t;
+
+// Hands a relay to the transmit path (takes its own reference)
+typedef bool (*mesh_gossip_send_fn)(packet_buf_t *buf, uint8_t radio_type, uint8_t tx_class);
+
+// Called (main context) when a relay is held, so the caller can schedule
+// mesh_gossip_tick()
+typedef void (*mesh_gossip_notify_t)(void);
+
+void     mesh_gossip_init(mesh_gossip_send_fn send, uint16_t self, uint32_t seed);
+void     mesh_gossip_set_mode(mesh_gossip_mode_t mode);
+void     mesh_gossip_set_notify(mesh_gossip_notify_t fn);
+
+bool     mesh_gossip_offer(uint64_t key, packet_buf_t *buf, uint8_t radio_type, uint8_t tx_class,
+                           uint16_t relay_mask, uint32_t now_ms);
+bool     mesh_gossip_standby(uint64_t key, packet_buf_t *buf, uint8_t radio_type, uint8_t tx_class,
+                             uint32_t now_ms);
+void     mesh_gossip_overheard(uint64_t key);
+uint32_t mesh_gossip_tick(uint32_t now_ms);
+
+uint16_t mesh_gossip_relay_bit(uint16_t addr);
+uint16_t mesh_gossip_elect_relays(uint16_t exclude_addr);
+
+void     mesh_gossip_get_stats(mesh_gossip_stats_t *out);
+
+#endif
@@ -12,6 +12,20 @@
  *      - Energy-aware transmission scheduling
  *      - Trust-score-weighted propagation (future enhancement)
  *
+ * Design:
+ *   - Entries are found through a small hash index on the device ID
+ *     (chained buckets, like the scheduler's timer wheel), so a
+ *     heartbeat costs one short chain walk instead of a strcmp per slot.
+ *   - Each entry keeps its last RADIO_LINK_SAMPLES RSSI/SNR readings and
+ *     whether each expected heartbeat arrived; radio_compute_link_quality()
+ *     turns that into an ETX estimate.
+ *   - When full, a newcomer replaces the entry with the lowest link
+ *     quality discounted by time since last heard, if the newcomer's
+ *     first reading beats it. Strong, current neighbors are never pushed
+ *     out by a crowd of weak ones.
+ *   - neighbor_table_top_k() ranks entries by ETX for routing and gossip
+ *     fan-out.
+ *
  * Notes for Investors:
  *   - This module enables Seed devices to form a self-healing network
  *     without internet, cell towers, or infrastructure.
@@ -24,20 +38,40 @@
 #include "radio_interface.h"
 #include <string.h>
 
-#define MAX_NEIGHBORS       32
-#define NEIGHBOR_TIMEOUT_MS 300000   // 5 minutes
-#define RSSI_SMOOTH_FACTOR  0.2f     // exponential smoothing
+#define NEIGHBOR_TIMEOUT_MS   300000   // 5 minutes
+#define RSSI_SMOOTH_FACTOR    0.2f     // exponential smoothing
+
+// Neighbors heartbeat at this interval (HEARTBEAT_INTERVAL in main_loop.c);
+// a period with no frame from a neighbor counts as a lost delivery
+#define NEIGHBOR_BEACON_MS    10000
+
+#define NEIGHBOR_HASH_BUCKETS 64       // power of two, about 2x MAX_NEIGHBORS
+// Buckets and chains hold slot index + 1, so zeroed memory is an empty table
+#define NEIGHBOR_NONE         0
 
 // -------------------------------------------------------------
 // Data Structure
 // -------------------------------------------------------------
 
-static neighbor_entry_t neighbor_table[MAX_NEIGHBORS];
+static neighbor_entry_t       neighbor_table[MAX_NEIGHBORS];
+static uint8_t                hash_buckets[NEIGHBOR_HASH_BUCKETS];
+static int                    neighbor_count;
+static neighbor_table_stats_t stats;
 
 // -------------------------------------------------------------
 // Internal Helpers
 // -------------------------------------------------------------
 
+// FNV-1a over the part of the ID that is stored
+static uint32_t id_hash(const char *id) {
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < DEVICE_ID_MAX_LEN - 1 && id[i] != '\0'; i++) {
+        h ^= (uint8_t)id[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
 static int find_free_slot() {
     for (int i = 0; i < MAX_NEIGHBORS; i++) {
         if (!neighbor_table[i].active) {
@@ -47,56 +81,186 @@ static int find_free_slot() {
     return -1;
 }
 
-static int find_neighbor(const char *id) {
-    for (int i = 0; i < MAX_NEIGHBORS; i++) {
-        if (neighbor_table[i].active &&
-            strcmp(neighbor_table[i].device_id, id) == 0) {
-            return i;
+static int find_neighbor(const char *id, uint32_t hash) {
+    uint8_t link = hash_buckets[hash & (NEIGHBOR_HASH_BUCKETS - 1)];
+
+    while (link != NEIGHBOR_NONE) {
+        neighbor_entry_t *n = &neighbor_table[link - 1];
+        if (n->id_hash == hash &&
+            strncmp(n->device_id, id, DEVICE_ID_MAX_LEN - 1) == 0) {
+            return link - 1;
         }
+        link = n->hash_next;
     }
     return -1;
 }
 
+static void hash_link(uint8_t idx) {
+    uint8_t *head = &hash_buckets[neighbor_table[idx].id_hash & (NEIGHBOR_HASH_BUCKETS - 1)];
+    neighbor_table[idx].hash_next = *head;
+    *head = (uint8_t)(idx + 1);
+}
+
+static void hash_unlink(uint8_t idx) {
+    uint8_t *link = &hash_buckets[neighbor_table[idx].id_hash & (NEIGHBOR_HASH_BUCKETS - 1)];
+    while (*link != idx + 1) {
+        link = &neighbor_table[*link - 1].hash_next;
+    }
+    *link = neighbor_table[idx].hash_next;
+}
+
+static void remove_entry(uint8_t idx) {
+    hash_unlink(idx);
+    neighbor_table[idx].active = 0;
+    neighbor_count--;
+}
+
+// Device ID of an entry known only by mesh address: the address in hex
+static void addr_to_id(uint16_t addr, char id[5]) {
+    static const char hex[] = "0123456789ABCDEF";
+
+    id[0] = hex[(addr >> 12) & 0xF];
+    id[1] = hex[(addr >> 8) & 0xF];
+    id[2] = hex[(addr >> 4) & 0xF];
+    id[3] = hex[addr & 0xF];
+    id[4] = '\0';
+}
+
+// Heartbeat periods since the last frame that went by with nothing heard
+static uint8_t beacons_missed(const neighbor_entry_t *n, uint32_t now) {
+    uint32_t periods = (now - n->last_heard_ms + NEIGHBOR_BEACON_MS / 2) / NEIGHBOR_BEACON_MS;
+    if (periods == 0) {
+        return 0;
+    }
+    return (uint8_t)(periods - 1 > RADIO_LINK_OUTCOMES ? RADIO_LINK_OUTCOMES : periods - 1);
+}
+
+// Re-estimate the link, counting heartbeats overdue right now as lost
+static void link_refresh(neighbor_entry_t *n, uint32_t now) {
+    radio_link_history_t h = n->link;
+    radio_link_estimate_t est;
+
+    for (uint8_t i = beacons_missed(n, now); i > 0; i--) {
+        radio_link_add_outcome(&h, false);
+    }
+    radio_compute_link_quality(&h, &est);
+
+    n->etx_x16      = est.etx_x16;
+    n->link_quality = est.quality;
+}
+
+// Worth keeping: link quality, fading to zero as the entry goes unheard
+static uint32_t retain_score(const neighbor_entry_t *n, uint32_t now) {
+    uint32_t age = now - n->last_heard_ms;
+    if (age >= NEIGHBOR_TIMEOUT_MS) {
+        return 0;
+    }
+    return (uint32_t)n->link_quality * (NEIGHBOR_TIMEOUT_MS - age) / NEIGHBOR_TIMEOUT_MS;
+}
+
+static int8_t clamp_rssi(int rssi) {
+    return (int8_t)(rssi < -128 ? -128 : (rssi > 127 ? 127 : rssi));
+}
+
 // -------------------------------------------------------------
 // Initialization
 // -------------------------------------------------------------
 
 void neighbor_table_init() {
     memset(neighbor_table, 0, sizeof(neighbor_table));
+    memset(hash_buckets, 0, sizeof(hash_buckets));
+    memset(&stats, 0, sizeof(stats));
+    neighbor_count = 0;
 }
 
 // -------------------------------------------------------------
 // Add or Update Neighbor Entry
 // -------------------------------------------------------------
 
-void neighbor_table_heard_from(const char *device_id, int rssi) {
-    int idx = find_neighbor(device_id);
+// Called for every frame from a neighbor; snr_x4 may be RADIO_SNR_UNKNOWN
+void neighbor_table_heard_from(const char *device_id, int rssi, int8_t snr_x4) {
+    uint32_t now  = timekeeping_millis();
+    uint32_t hash = id_hash(device_id);
+    int idx = find_neighbor(device_id, hash);
 
-    // Case 1: Existing neighbor → update RSSI and timestamp
+    // Case 1: Existing neighbor → update RSSI, history and timestamp
     if (idx >= 0) {
         neighbor_entry_t *n = &neighbor_table[idx];
-        n->last_heard_ms = timekeeping_millis();
+
+        // One delivery outcome per heartbeat period, however many
+        // frames the neighbor sent in it
+        if (now - n->last_heard_ms >= NEIGHBOR_BEACON_MS / 2) {
+            for (uint8_t i = beacons_missed(n, now); i > 0; i--) {
+                radio_link_add_outcome(&n->link, false);
+            }
+            radio_link_add_outcome(&n->link, true);
+            n->last_heard_ms = now;
+        }
+        radio_link_add_signal(&n->link, clamp_rssi(rssi), snr_x4);
 
         // Smooth RSSI changes to avoid jitter in noisy radio environments
         n->rssi = (int)(n->rssi * (1.0f - RSSI_SMOOTH_FACTOR)
                         + rssi * RSSI_SMOOTH_FACTOR);
 
-        n->link_quality = radio_compute_link_quality(n->rssi);  
+        link_refresh(n, now);
         return;
     }
 
-    // Case 2: New neighbor → add if space available
-    int free_slot = find_free_slot();
-    if (free_slot >= 0) {
-        neighbor_entry_t *n = &neighbor_table[free_slot];
+    // Case 2: New neighbor → estimate from this one reading
+    neighbor_entry_t fresh;
+    memset(&fresh, 0, sizeof(fresh));
+    strncpy(fresh.device_id, device_id, DEVICE_ID_MAX_LEN - 1);
+    fresh.last_heard_ms = now;
+    fresh.rssi          = rssi;
+    fresh.id_hash       = hash;
+    fresh.addr          = NEIGHBOR_ADDR_NONE;
+    fresh.active        = 1;
+    radio_link_add_signal(&fresh.link, clamp_rssi(rssi), snr_x4);
+    link_refresh(&fresh, now);
 
-        strncpy(n->device_id, device_id, DEVICE_ID_MAX);
-        n->last_heard_ms = timekeeping_millis();
-        n->rssi = rssi;
-        n->link_quality = radio_compute_link_quality(rssi);
-        n->active = 1;
+    int slot = find_free_slot();
+
+    // Table full → replace the weakest, stalest entry if the newcomer beats it
+    if (slot < 0) {
+        uint32_t worst_score = UINT32_MAX;
+        for (int i = 0; i < MAX_NEIGHBORS; i++) {
+            uint32_t score = retain_score(&neighbor_table[i], now);
+            if (score < worst_score) {
+                worst_score = score;
+                slot = i;
+            }
+        }
+        if (worst_score >= fresh.link_quality) {
+            stats.rejected++;
+            return;
+        }
+        remove_entry((uint8_t)slot);
+        stats.evicted++;
+    }
+
+    neighbor_table[slot] = fresh;
+    hash_link((uint8_t)slot);
+    neighbor_count++;
+    stats.added++;
+}
+
+/**
+ * Same, for a neighbor known by its mesh address (the previous hop of
+ * a mesh_protocol frame). Its device ID is the address in hex.
+ */
+void neighbor_table_heard_from_addr(uint16_t addr, int rssi, int8_t snr_x4) {
+    char id[5];
+
+    if (addr == NEIGHBOR_ADDR_NONE) {
+        return;
+    }
+    addr_to_id(addr, id);
+    neighbor_table_heard_from(id, rssi, snr_x4);
+
+    neighbor_entry_t *n = neighbor_table_find(id);
+    if (n != NULL) {
+        n->addr = addr;
     }
-    // Else: Table full — future improvement: evict weakest entry
 }
 
 // -------------------------------------------------------------
@@ -107,10 +271,14 @@ void neighbor_table_prune() {
     uint32_t now = timekeeping_millis();
 
     for (int i = 0; i < MAX_NEIGHBORS; i++) {
-        if (neighbor_table[i].active &&
-            (now - neighbor_table[i].last_heard_ms > NEIGHBOR_TIMEOUT_MS)) {
-
-            neighbor_table[i].active = 0;
+        if (!neighbor_table[i].active) {
+            continue;
+        }
+        if (now - neighbor_table[i].last_heard_ms > NEIGHBOR_TIMEOUT_MS) {
+            remove_entry((uint8_t)i);
+            stats.expired++;
+        } else {
+            link_refresh(&neighbor_table[i], now);
         }
     }
 }
@@ -120,11 +288,7 @@ void neighbor_table_prune() {
 // -------------------------------------------------------------
 
 int neighbor_table_count() {
-    int count = 0;
-    for (int i = 0; i < MAX_NEIGHBORS; i++) {
-        if (neighbor_table[i].active) count++;
-    }
-    return count;
+    return neighbor_count;
 }
 
 neighbor_entry_t *neighbor_table_get(int index) {
@@ -133,20 +297,71 @@ neighbor_entry_t *neighbor_table_get(int index) {
     return &neighbor_table[index];
 }
 
-neighbor_entry_t *neighbor_table_best_link() {
-    neighbor_entry_t *best = NULL;
-    int best_lq = -1;
+neighbor_entry_t *neighbor_table_find(const char *device_id) {
+    int idx = find_neighbor(device_id, id_hash(device_id));
+    return idx >= 0 ? &neighbor_table[idx] : NULL;
+}
 
-    for (int i = 0; i < MAX_NEIGHBORS; i++) {
-        if (neighbor_table[i].active &&
-            neighbor_table[i].link_quality > best_lq) {
+neighbor_entry_t *neighbor_table_find_addr(uint16_t addr) {
+    char id[5];
 
-            best = &neighbor_table[i];
-            best_lq = neighbor_table[i].link_quality;
+    if (addr == NEIGHBOR_ADDR_NONE) {
+        return NULL;
+    }
+    addr_to_id(addr, id);
+
+    neighbor_entry_t *n = neighbor_table_find(id);
+    return (n != NULL && n->addr == addr) ? n : NULL;
+}
+
+/**
+ * Up to k usable neighbors, lowest ETX first (most recently heard
+ * first on a tie), for next-hop choice and gossip fan-out. Overdue
+ * heartbeats count against a link. Returns the number written.
+ */
+uint8_t neighbor_table_top_k(neighbor_entry_t **out, uint8_t k) {
+    uint32_t now = timekeeping_millis();
+    uint8_t found = 0;
+
+    for (int i = 0; i < MAX_NEIGHBORS && k > 0; i++) {
+        neighbor_entry_t *n = &neighbor_table[i];
+        if (!n->active) {
+            continue;
+        }
+        link_refresh(n, now);
+        if (n->etx_x16 == RADIO_ETX_INFINITE) {
+            continue;
+        }
+
+        // Insertion into the sorted prefix; the worst falls off the end
+        uint8_t pos = found < k ? found : k;
+        while (pos > 0 &&
+               (out[pos - 1]->etx_x16 > n->etx_x16 ||
+                (out[pos - 1]->etx_x16 == n->etx_x16 &&
+                 (int32_t)(n->last_heard_ms - out[pos - 1]->last_heard_ms) > 0))) {
+            if (pos < k) {
+                out[pos] = out[pos - 1];
+            }
+            pos--;
+        }
+        if (pos < k) {
+            out[pos] = n;
+            if (found < k) found++;
         }
     }
 
-    return best;
+    return found;
+}
+
+neighbor_entry_t *neighbor_table_best_link() {
+    neighbor_entry_t *best = NULL;
+    return neighbor_table_top_k(&best, 1) ? best : NULL;
+}
+
+void neighbor_table_get_stats(neighbor_table_stats_t *out) {
+    if (out != NULL) {
+        *out = stats;
+    }
 }
 
 // -------------------------------------------------------------
@@ -160,11 +375,13 @@ void neighbor_table_debug_print() {
     printf("---- Neighbor Table ----\n");
     for (int i = 0; i < MAX_NEIGHBORS; i++) {
         if (neighbor_table[i].active) {
-            printf("ID: %s | RSSI: %d | LQ: %d | Last seen: %lu ms\n",
+            printf("ID: %s | RSSI: %d | LQ: %d | ETX: %u.%02u | Last seen: %lu ms\n",
                    neighbor_table[i].device_id,
                    neighbor_table[i].rssi,
                    neighbor_table[i].link_quality,
-                   neighbor_table[i].last_heard_ms);
+                   neighbor_table[i].etx_x16 / 16,
+                   (neighbor_table[i].etx_x16 % 16) * 100 / 16,
+                   (unsigned long)neighbor_table[i].last_heard_ms);
         }
     }
     printf("-------------------------\n");
@@ -3,15 +3,43 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "device_config.h"
+#include "radio_interface.h"
+
+#define MAX_NEIGHBORS       32
+#define NEIGHBOR_ADDR_NONE  0xFFFF     // entry known only by device ID
+
+typedef struct {
+    char                 device_id[DEVICE_ID_MAX_LEN];
+    uint16_t             addr;              // mesh address, or NEIGHBOR_ADDR_NONE
+    uint32_t             last_heard_ms;
+    int                  rssi;              // smoothed, dBm
+    uint8_t              link_quality;      // 0..255, see radio_compute_link_quality()
+    uint16_t             etx_x16;           // expected transmissions ×16
+    radio_link_history_t link;              // recent RSSI/SNR and heartbeat delivery
+    uint8_t              active;
+
+    uint32_t             id_hash;           // hash index bookkeeping
+    uint8_t              hash_next;         // next slot in the chain + 1; 0 ends it
+} neighbor_entry_t;
 
 typedef struct {
-    uint8_t id[8];
-    uint32_t last_seen_timestamp;
-    int8_t rssi;
-} mesh_neighbor_t;
+    uint32_t added;
+    uint32_t evicted;             // replaced by a stronger newcomer while full
+    uint32_t rejected;            // newcomer weaker than every entry while full
+    uint32_t expired;             // not heard within the timeout
+} neighbor_table_stats_t;
 
-void neighbor_table_init(void);
-void neighbor_table_update(const uint8_t *id, int8_t rssi);
-uint8_t neighbor_table_count(void);
+void              neighbor_table_init(void);
+void              neighbor_table_heard_from(const char *device_id, int rssi, int8_t snr_x4);
+void              neighbor_table_heard_from_addr(uint16_t addr, int rssi, int8_t snr_x4);
+void              neighbor_table_prune(void);
+int               neighbor_table_count(void);
+neighbor_entry_t *neighbor_table_get(int index);
+neighbor_entry_t *neighbor_table_find(const char *device_id);
+neighbor_entry_t *neighbor_table_find_addr(uint16_t addr);
+neighbor_entry_t *neighbor_table_best_link(void);
+uint8_t           neighbor_table_top_k(neighbor_entry_t **out, uint8_t k);
+void              neighbor_table_get_stats(neighbor_table_stats_t *out);
 
 #endif
@@ -6,9 +6,18 @@
 //  - Defining on-air packet structure for the Seed mesh.
 //  - Encoding/decoding headers and payloads.
 //  - Attaching metadata (TTL, hop count, message type, IDs).
-//  - Basic flooding / forwarding with power-aware limits.
+//  - Forwarding: broadcasts under the controlled-gossip policy in
+//    mesh_gossip.c, addressed frames along the next hop from
+//    mesh_route_table.c. Relays pass the originator's signed frame on
+//    unchanged; only the routing prefix moves. A routed hop is
+//    acknowledged by the next hop's own relay or, at the destination,
+//    by a link ack; neighbors that hear neither relay it by gossip.
+//  - Aggregating small messages into shared, once-signed LoRa frames.
 //  - Invoking upper-layer handlers (ledger sync, group savings, trust-score updates).
 //
+// bench/mesh_protocol_bench.c measures aggregation through the real TX
+// queue and radio path.
+//
 // NOTE: This is an implementation skeleton meant to be “investor-ready”:
 //  - The structure and comments are realistic for an embedded project.
 //  - Many functions are stubs or simplified for clarity.
@@ -20,8 +29,18 @@
 
 #include "mesh_protocol.h"
 #include "radio_interface.h"
+#include "radio_airtime.h"
+#include "radio_config.h"
 #include "security_module.h"
 #include "storage_manager.h"
+#include "verify_cache.h"
+#include "packet_pool.h"
+#include "mesh_tx_queue.h"
+#include "mesh_dedup.h"
+#include "mesh_gossip.h"
+#include "mesh_neighbor_table.h"
+#include "mesh_route_table.h"
+#include "timekeeping.h"
 
 // -----------------------------------------------------------------------------
 // Mesh Protocol Constants
@@ -37,8 +56,27 @@
 // Time-to-Live for packets (in hops).
 #define MESH_DEFAULT_TTL             5
 
-// Simple replay cache size (number of recent message IDs cached).
-#define MESH_REPLAY_CACHE_SIZE       32
+// Type byte of the radio frame (radio_interface.c) carrying a mesh frame
+#define MESH_RADIO_TYPE              0x4D
+
+// Link ack from the destination of a routed unicast, naming the frame it
+// received: [acker(2)][src(2)][msg_id(4)]. Unsigned like the route prefix;
+// a forged one only cancels standby relays.
+#define MESH_ACK_RADIO_TYPE          0x41
+#define MESH_ACK_LEN                 8
+
+// security_sign_packet() appends a fixed-size signature to the body.
+#define MESH_SIGNATURE_LEN           64
+
+// Aggregated frames may use the full LoRa frame (radio_config.h), minus
+// the routing prefix and room for the one signature the frame carries.
+#define MESH_SIGNATURE_RESERVE       MESH_SIGNATURE_LEN
+#define MESH_AGG_FRAME_SIZE          MAX_PACKET_SIZE
+#define MESH_AGG_BODY_LIMIT          (MESH_AGG_FRAME_SIZE - MESH_ROUTE_HEADER_LEN - MESH_SIGNATURE_RESERVE)
+
+// Per-message record inside an aggregate:
+// [type(1)][src(2)][dst(2)][msg_id(4)][len(1)][payload]
+#define MESH_AGG_RECORD_HEADER       10
 
 // -----------------------------------------------------------------------------
 // Message Types (must align with docs: mesh-protocol/message_types/*)
@@ -50,55 +88,81 @@ typedef enum {
     MESH_MSG_HEARTBEAT         = 0x03, // Presence + health beacon
     MESH_MSG_GROUP_SAVINGS     = 0x04, // Savings-group contribution / payout
     MESH_MSG_TRUST_SCORE       = 0x05, // Trust score update / broadcast
-    MESH_MSG_ERROR_REPORT      = 0x06  // Error / anomaly report
+    MESH_MSG_ERROR_REPORT      = 0x06, // Error / anomaly report
+    MESH_MSG_AGGREGATE         = 0x07, // Several messages, one frame, one signature
+    MESH_MSG_LEDGER_RECON      = 0x08  // Range-hash reconciliation (mesh_sync.c)
 } mesh_msg_type_t;
 
 // -----------------------------------------------------------------------------
 // Basic Types
 // -----------------------------------------------------------------------------
 
-typedef uint16_t mesh_address_t;   // Short device address on mesh
 typedef uint32_t mesh_msg_id_t;    // Logical message identifier (for replay protection)
 
-// Mesh header placed at the beginning of every on-air packet.
-// Keep this compact: LoRa has limited payload capacity.
+// On-air frame:
+//
+//   [mesh_route_t][mesh_header_t][payload][signature]
+//    \_ mutable _/ \_________ signed by the source _________/
+//
+// The routing prefix is the only thing relays change, so it sits outside
+// the signature: a relay forwards the source's frame as-is and never
+// signs. It is not authenticated either; a receiver only trusts it as far
+// as the hop limits below, and a relay that lies about it could just as
+// well drop the frame. prev_hop, relay_mask and next_hop only steer link
+// estimates and who relays; a forged one costs delivery, not integrity.
+typedef struct {
+    uint8_t        ttl;        // Remaining hops
+    uint8_t        hops;       // Hops already traversed
+    mesh_address_t prev_hop;   // Node that sent this copy
+    uint16_t       relay_mask; // Relays elected by prev_hop (mesh_gossip.c)
+    mesh_address_t next_hop;   // Sole relay of a routed unicast, or ROUTE_NO_NEXT_HOP
+} mesh_route_t;
+
+#define MESH_ROUTE_HEADER_LEN        sizeof(mesh_route_t)
+
+// Signed header. Keep this compact: LoRa has limited payload capacity.
 typedef struct {
     mesh_msg_type_t type;     // Message type
     mesh_address_t  src;      // Source node
     mesh_address_t  dst;      // Destination node (0xFFFF = broadcast)
-    uint8_t         ttl;      // Remaining hops
-    uint8_t         hops;     // Hops already traversed
     mesh_msg_id_t   msg_id;   // Per-source unique identifier
 } mesh_header_t;
 
-// In-memory representation of a mesh packet (header + payload).
+// In-memory view of a mesh packet. The payload is not copied: it points
+// into the sender's buffer or the received pool buffer.
 typedef struct {
-    mesh_header_t header;
-    uint8_t       payload[MESH_MAX_PACKET_SIZE - sizeof(mesh_header_t)];
-    uint8_t       payload_len;
+    mesh_route_t   route;
+    mesh_header_t  header;
+    const uint8_t *payload;
+    uint8_t        payload_len;
 } mesh_packet_t;
 
+// Largest payload one message can carry: it must fit an aggregate
+// record, the biggest body a frame has room for
+#define MESH_MAX_PAYLOAD \
+    (MESH_AGG_BODY_LIMIT - sizeof(mesh_header_t) - 1 - MESH_AGG_RECORD_HEADER)
+
 // -----------------------------------------------------------------------------
 // External Dependencies (provided by other modules)
 // -----------------------------------------------------------------------------
 
-// radio_interface.c must provide these:
-extern bool radio_send_bytes(const uint8_t *data, uint8_t len);
-extern void radio_set_receive_callback(void (*cb)(const uint8_t *data, uint8_t len));
-
-// security_module.c must provide signing / verification:
-extern bool security_sign_packet(uint8_t *data, uint8_t *len, uint8_t max_len);
-extern bool security_verify_packet(const uint8_t *data, uint8_t len);
+// Frames go on air through the TX queue (mesh_tx_queue.c), which
+// schedules them by traffic class and duty-cycle budget. Signing and
+// verification are security_sign_packet() / security_verify_packet().
 
-// storage_manager.c can be used to persist replay cache, metrics, etc.
-// For now, we keep replay cache in RAM for simplicity.
+// storage_manager.c can be used to persist metrics, etc. Replay and
+// duplicate protection is the RAM filter in mesh_dedup.c, shared with
+// mesh_rx_handler.c.
 
-// Upper-layer callbacks (implemented elsewhere, e.g., ledger_manager.c):
+// Upper-layer callbacks (implemented elsewhere, e.g., ledger_manager.c).
+// payload points into the received packet buffer and is only valid for
+// the duration of the call:
 void mesh_on_transaction_message(const uint8_t *payload, uint8_t len);
 void mesh_on_ledger_sync_message(const uint8_t *payload, uint8_t len);
 void mesh_on_group_savings_message(const uint8_t *payload, uint8_t len);
 void mesh_on_trust_score_message(const uint8_t *payload, uint8_t len);
 void mesh_on_heartbeat_message(const uint8_t *payload, uint8_t len);
+void mesh_on_ledger_recon_message(mesh_address_t src, const uint8_t *payload, uint8_t len);
 
 // -----------------------------------------------------------------------------
 // Module State
@@ -107,17 +171,31 @@ void mesh_on_heartbeat_message(const uint8_t *payload, uint8_t len);
 static mesh_address_t g_local_address   = 0;
 static mesh_msg_id_t  g_next_msg_id     = 1;
 
-// Very simple replay cache; in production we might make this
-// a ring buffer persisted to flash, with timestamp/TTL.
-static mesh_msg_id_t  g_replay_cache[MESH_REPLAY_CACHE_SIZE];
-static uint8_t        g_replay_cache_head = 0;
+// Messages waiting to share a frame. All records in one aggregate are for
+// the same destination (a unicast next hop or broadcast).
+typedef struct {
+    bool           active;
+    mesh_address_t dst;
+    uint8_t        tx_class;                       // most urgent record's TxClass
+    uint8_t        count;
+    uint8_t        len;                            // bytes used in body[]
+    uint8_t        body[MESH_AGG_BODY_LIMIT];      // [outer header][count][records]
+} mesh_aggregate_t;
+
+static mesh_aggregate_t    g_agg;
+static mesh_agg_stats_t    g_agg_stats;
 
 // Forward declaration of internal handlers:
-static void mesh_radio_rx_callback(const uint8_t *data, uint8_t len);
-static bool mesh_is_duplicate(mesh_msg_id_t msg_id);
-static void mesh_record_seen(mesh_msg_id_t msg_id);
-static void mesh_handle_incoming_packet(mesh_packet_t *pkt);
-static void mesh_forward_packet(mesh_packet_t *pkt);
+static void mesh_radio_rx_callback(packet_buf_t *buf);
+static bool mesh_handle_incoming_packet(const mesh_packet_t *pkt);
+static void mesh_forward_frame(packet_buf_t *buf);
+static bool mesh_transmit_single(const mesh_packet_t *pkt);
+static bool mesh_agg_append(const mesh_packet_t *pkt);
+static bool mesh_agg_unpack(const uint8_t *data, uint16_t len);
+static bool mesh_relay_send(packet_buf_t *buf, uint8_t radio_type, uint8_t tx_class);
+static void mesh_send_link_ack(const mesh_header_t *header);
+static void mesh_handle_link_ack(const uint8_t *data, uint16_t len, packet_buf_t *buf);
+static TxClass mesh_tx_class(mesh_msg_type_t type);
 
 // -----------------------------------------------------------------------------
 // Initialization
@@ -128,27 +206,47 @@ void mesh_init(mesh_address_t local_addr)
     g_local_address = local_addr;
     g_next_msg_id   = 1;
 
-    // Clear replay cache
-    for (uint8_t i = 0; i < MESH_REPLAY_CACHE_SIZE; i++) {
-        g_replay_cache[i] = 0;
-    }
-    g_replay_cache_head = 0;
+    // Forget messages seen before a re-init
+    mesh_dedup_clear();
+
+    // Backoff draws only need to differ between neighbors
+    mesh_gossip_init(mesh_relay_send, local_addr, (uint32_t)local_addr * 2654435761u ^ time_now_ms());
+    route_table_init(local_addr);
+
+    memset(&g_agg, 0, sizeof(g_agg));
+    memset(&g_agg_stats, 0, sizeof(g_agg_stats));
 
     // Register radio receive callback so all incoming packets pass through here.
     radio_set_receive_callback(mesh_radio_rx_callback);
 }
 
+mesh_address_t mesh_get_local_address(void)
+{
+    return g_local_address;
+}
+
 // -----------------------------------------------------------------------------
 // Public Send APIs (for higher-level modules)
 // -----------------------------------------------------------------------------
 
+// Route prefix for a frame this node originates
+static void mesh_route_init(mesh_route_t *route, mesh_address_t dst)
+{
+    route->ttl        = MESH_DEFAULT_TTL;
+    route->hops       = 0;
+    route->prev_hop   = g_local_address;
+    route->relay_mask = (dst == 0xFFFF) ? mesh_gossip_elect_relays(g_local_address)
+                                        : MESH_RELAY_ALL;
+    route->next_hop   = (dst == 0xFFFF) ? ROUTE_NO_NEXT_HOP : route_table_next_hop(dst);
+}
+
 // Generic send helper
 static bool mesh_send_internal(mesh_msg_type_t type,
                                mesh_address_t dst,
                                const uint8_t *payload,
                                uint8_t payload_len)
 {
-    if (payload_len > (MESH_MAX_PACKET_SIZE - sizeof(mesh_header_t))) {
+    if (payload_len > MESH_MAX_PAYLOAD) {
         return false; // too large
     }
 
@@ -156,31 +254,43 @@ static bool mesh_send_internal(mesh_msg_type_t type,
     pkt.header.type  = type;
     pkt.header.src   = g_local_address;
     pkt.header.dst   = dst;
-    pkt.header.ttl   = MESH_DEFAULT_TTL;
-    pkt.header.hops  = 0;
     pkt.header.msg_id = g_next_msg_id++;
+    mesh_route_init(&pkt.route, dst);
 
-    pkt.payload_len = payload_len;
-    if (payload_len > 0 && payload != NULL) {
-        memcpy(pkt.payload, payload, payload_len);
-    }
+    pkt.payload     = payload;
+    pkt.payload_len = (payload != NULL) ? payload_len : 0;
+
+    // Batched with other messages for the same destination; goes on air
+    // when the frame fills up or on mesh_flush_pending().
+    return mesh_agg_append(&pkt);
+}
 
-    // Serialize header + payload into raw buffer
+// Serialize, sign and transmit one message in its own frame.
+static bool mesh_transmit_single(const mesh_packet_t *pkt)
+{
     uint8_t buffer[MESH_MAX_PACKET_SIZE];
+    uint8_t *body = &buffer[MESH_ROUTE_HEADER_LEN];
     uint8_t len = 0;
 
-    memcpy(&buffer[len], &pkt.header, sizeof(mesh_header_t));
+    memcpy(&body[len], &pkt->header, sizeof(mesh_header_t));
     len += sizeof(mesh_header_t);
-    memcpy(&buffer[len], pkt.payload, pkt.payload_len);
-    len += pkt.payload_len;
+    memcpy(&body[len], pkt->payload, pkt->payload_len);
+    len += pkt->payload_len;
 
-    // Sign packet for authenticity/integrity
-    if (!security_sign_packet(buffer, &len, MESH_MAX_PACKET_SIZE)) {
+    // Sign the body for authenticity/integrity; the route prefix stays out
+    if (!security_sign_packet(body, &len, MESH_MAX_PACKET_SIZE - MESH_ROUTE_HEADER_LEN)) {
         return false;
     }
 
-    // Send over radio
-    return radio_send_bytes(buffer, len);
+    memcpy(buffer, &pkt->route, MESH_ROUTE_HEADER_LEN);
+    len += MESH_ROUTE_HEADER_LEN;
+
+    g_agg_stats.frames_sent++;
+    g_agg_stats.bytes_on_air  += len + RADIO_FRAME_OVERHEAD;
+    g_agg_stats.airtime_us    += airtime_time_on_air_us(len + RADIO_FRAME_OVERHEAD);
+
+    // Queue for the radio; the queue keeps its own copy
+    return mesh_tx_queue_push_frame(buffer, len, MESH_RADIO_TYPE, mesh_tx_class(pkt->header.type));
 }
 
 bool mesh_send_transaction_broadcast(const uint8_t *payload, uint8_t len)
@@ -205,55 +315,305 @@ bool mesh_send_trust_score_update(const uint8_t *payload, uint8_t len)
     return mesh_send_internal(MESH_MSG_TRUST_SCORE, 0xFFFF, payload, len);
 }
 
+bool mesh_send_ledger_recon(mesh_address_t dst,
+                            const uint8_t *payload,
+                            uint8_t len)
+{
+    return mesh_send_internal(MESH_MSG_LEDGER_RECON, dst, payload, len);
+}
+
+// Presence beacon; neighbors also learn our routes from it
 bool mesh_send_heartbeat(void)
 {
-    uint8_t dummy = 0;
-    return mesh_send_internal(MESH_MSG_HEARTBEAT, 0xFFFF, &dummy, 0);
+    uint8_t advert[ROUTE_ADVERT_MAX_LEN];
+    uint8_t len = route_table_build_advert(advert, sizeof(advert));
+
+    return mesh_send_internal(MESH_MSG_HEARTBEAT, 0xFFFF, advert, len);
+}
+
+// -----------------------------------------------------------------------------
+// Frame Aggregation
+// -----------------------------------------------------------------------------
+//
+// Every frame pays for a preamble, radio header, CRC and signature, which
+// dwarfs a heartbeat or a short transaction. Messages for the same
+// destination are therefore packed into one MESH_MSG_AGGREGATE frame:
+//
+//   [mesh_route_t][outer mesh_header_t][count(1)][record]...[record][signature]
+//
+// signed once over everything after the route. Only locally originated
+// messages are aggregated, so the records share the frame's route and the
+// whole frame is relayed as one unit. A lone message is still sent in the
+// plain single-message format, so nothing is lost when traffic is light.
+
+static void mesh_agg_write_record(uint8_t *out, const mesh_packet_t *pkt)
+{
+    out[0] = (uint8_t)pkt->header.type;
+    memcpy(&out[1], &pkt->header.src, 2);
+    memcpy(&out[3], &pkt->header.dst, 2);
+    memcpy(&out[5], &pkt->header.msg_id, 4);
+    out[9] = pkt->payload_len;
+    memcpy(&out[MESH_AGG_RECORD_HEADER], pkt->payload, pkt->payload_len);
+}
+
+// Header fields of a record; the payload is left in place
+static void mesh_agg_read_record(const uint8_t *rec, mesh_packet_t *pkt)
+{
+    pkt->header.type = (mesh_msg_type_t)rec[0];
+    memcpy(&pkt->header.src, &rec[1], 2);
+    memcpy(&pkt->header.dst, &rec[3], 2);
+    memcpy(&pkt->header.msg_id, &rec[5], 4);
+    pkt->payload_len = rec[9];
+    pkt->payload     = &rec[MESH_AGG_RECORD_HEADER];
+}
+
+static void mesh_agg_open(mesh_address_t dst)
+{
+    mesh_header_t outer;
+    outer.type   = MESH_MSG_AGGREGATE;
+    outer.src    = g_local_address;
+    outer.dst    = dst;
+    outer.msg_id = g_next_msg_id++;
+
+    g_agg.active   = true;
+    g_agg.dst      = dst;
+    g_agg.tx_class = TX_CLASS_COUNT;
+    g_agg.count    = 0;
+
+    memcpy(g_agg.body, &outer, sizeof(outer));
+    g_agg.len = sizeof(outer) + 1;   // + record count
+}
+
+static bool mesh_agg_append(const mesh_packet_t *pkt)
+{
+    uint16_t need = MESH_AGG_RECORD_HEADER + pkt->payload_len;
+
+    g_agg_stats.messages_sent++;
+
+    if (sizeof(mesh_header_t) + 1 + need > MESH_AGG_BODY_LIMIT) {
+        // Never fits in an aggregate; send on its own
+        return mesh_transmit_single(pkt);
+    }
+
+    if (g_agg.active &&
+        (g_agg.dst != pkt->header.dst || g_agg.len + need > MESH_AGG_BODY_LIMIT)) {
+        (void)mesh_flush_pending();
+    }
+
+    if (!g_agg.active) {
+        mesh_agg_open(pkt->header.dst);
+    }
+
+    mesh_agg_write_record(&g_agg.body[g_agg.len], pkt);
+    g_agg.len += need;
+    g_agg.count++;
+
+    if (mesh_tx_class(pkt->header.type) < g_agg.tx_class) {
+        g_agg.tx_class = (uint8_t)mesh_tx_class(pkt->header.type);
+    }
+
+    return true;
+}
+
+/**
+ * Transmit whatever is batched. Called when the batch is full or its
+ * destination changes, and from the main loop / TX queue after each pass.
+ */
+bool mesh_flush_pending(void)
+{
+    if (!g_agg.active) {
+        return true;
+    }
+
+    g_agg.active = false;
+
+    // A lone message goes out unwrapped if it fits the single-message frame
+    if (g_agg.count == 1) {
+        mesh_packet_t lone;
+        mesh_agg_read_record(&g_agg.body[sizeof(mesh_header_t) + 1], &lone);
+        mesh_route_init(&lone.route, lone.header.dst);
+
+        if (MESH_ROUTE_HEADER_LEN + sizeof(mesh_header_t) + lone.payload_len +
+            MESH_SIGNATURE_RESERVE <= MESH_MAX_PACKET_SIZE) {
+            return mesh_transmit_single(&lone);
+        }
+    }
+
+    uint8_t buffer[MESH_AGG_FRAME_SIZE];
+    uint8_t *body = &buffer[MESH_ROUTE_HEADER_LEN];
+    uint8_t len = g_agg.len;
+
+    memcpy(body, g_agg.body, len);
+    body[sizeof(mesh_header_t)] = g_agg.count;
+
+    if (!security_sign_packet(body, &len, MESH_AGG_FRAME_SIZE - MESH_ROUTE_HEADER_LEN)) {
+        return false;
+    }
+
+    mesh_route_t route;
+    mesh_route_init(&route, g_agg.dst);
+    memcpy(buffer, &route, MESH_ROUTE_HEADER_LEN);
+    len += MESH_ROUTE_HEADER_LEN;
+
+    g_agg_stats.frames_sent++;
+    if (g_agg.count > 1) {
+        g_agg_stats.aggregated_frames++;
+    }
+    g_agg_stats.bytes_on_air += len + RADIO_FRAME_OVERHEAD;
+    g_agg_stats.airtime_us   += airtime_time_on_air_us(len + RADIO_FRAME_OVERHEAD);
+
+    return mesh_tx_queue_push_frame(buffer, len, MESH_RADIO_TYPE, (TxClass)g_agg.tx_class);
+}
+
+/**
+ * Split a verified aggregate frame back into individual packets. Each one
+ * goes through the normal handler, so replay protection and TTL apply per
+ * message exactly as for single frames. Returns true if any record should
+ * travel further; the caller then relays the whole frame once. len stops
+ * short of the signature.
+ *
+ * The frame is signed once, by the outer header's source, and only
+ * locally originated messages are aggregated, so a record naming any
+ * other source cannot be genuine and is dropped.
+ */
+static bool mesh_agg_unpack(const uint8_t *data, uint16_t len)
+{
+    uint16_t off = MESH_ROUTE_HEADER_LEN + sizeof(mesh_header_t);
+    bool forward = false;
+    mesh_header_t outer;
+    mesh_packet_t pkt;
+
+    if (off + 1 > len) {
+        return false;
+    }
+
+    memcpy(&pkt.route, data, MESH_ROUTE_HEADER_LEN);
+    memcpy(&outer, data + MESH_ROUTE_HEADER_LEN, sizeof(outer));
+
+    uint8_t count = data[off++];
+
+    for (uint8_t i = 0; i < count; i++) {
+        if (off + MESH_AGG_RECORD_HEADER > len) {
+            break; // truncated
+        }
+
+        const uint8_t *rec = &data[off];
+        uint8_t plen = rec[9];
+
+        if (off + MESH_AGG_RECORD_HEADER + plen > len) {
+            break;
+        }
+
+        mesh_agg_read_record(rec, &pkt);
+
+        if (pkt.header.type != MESH_MSG_AGGREGATE &&   // no nesting
+            pkt.header.src == outer.src) {
+            forward |= mesh_handle_incoming_packet(&pkt);
+        }
+
+        off += MESH_AGG_RECORD_HEADER + plen;
+    }
+
+    return forward;
+}
+
+void mesh_get_aggregation_stats(mesh_agg_stats_t *out)
+{
+    if (out != NULL) {
+        *out = g_agg_stats;
+    }
 }
 
 // -----------------------------------------------------------------------------
 // Radio Receive Path
 // -----------------------------------------------------------------------------
 
-// This is called by radio_interface.c when raw bytes are received.
-static void mesh_radio_rx_callback(const uint8_t *data, uint8_t len)
+static bool verify_packet_item(const verify_item_t *item, void *ctx)
+{
+    (void)ctx;
+    return security_verify_packet(item->msg, (uint8_t)item->msg_len);
+}
+
+// This is called by radio_interface.c for every received frame. The pool
+// buffer is only borrowed; nothing here copies the packet.
+static void mesh_radio_rx_callback(packet_buf_t *buf)
 {
-    if (len < sizeof(mesh_header_t)) {
+    const uint8_t *data = &buf->data[buf->offset];
+    uint16_t len = buf->len;
+    const uint8_t head = MESH_ROUTE_HEADER_LEN + sizeof(mesh_header_t);
+
+    if (buf->data[buf->offset - PACKET_BUF_HEADROOM + 1] == MESH_ACK_RADIO_TYPE) {
+        mesh_handle_link_ack(data, len, buf);
+        return;
+    }
+
+    if (len < head + MESH_SIGNATURE_LEN) {
         return; // too short to be valid
     }
 
-    // Verify signature (this also protects against many forms of tampering).
-    if (!security_verify_packet(data, len)) {
+    // Verify the source's signature over the body (this also protects
+    // against many forms of tampering). The route prefix is excluded, so
+    // every flooded copy of a packet hits the same verify-cache entry.
+    verify_item_t item = {
+        NULL, 0, data + MESH_ROUTE_HEADER_LEN, len - MESH_ROUTE_HEADER_LEN, NULL, 0
+    };
+    if (!verify_cache_check(&item, verify_packet_item, NULL)) {
         return;
     }
 
     mesh_packet_t pkt;
-    memcpy(&pkt.header, data, sizeof(mesh_header_t));
-    pkt.payload_len = (uint8_t)(len - sizeof(mesh_header_t));
+    bool forward;
+
+    memcpy(&pkt.route, data, MESH_ROUTE_HEADER_LEN);
+    memcpy(&pkt.header, data + MESH_ROUTE_HEADER_LEN, sizeof(mesh_header_t));
+
+    // Every verified frame is a reading of the link to whoever sent it
+    neighbor_table_heard_from_addr(pkt.route.prev_hop, buf->rssi, buf->snr_x4);
+
+    // A copy of a frame we are holding for relay counts toward suppressing it
+    mesh_gossip_overheard(mesh_dedup_key_msg(pkt.header.src, pkt.header.msg_id));
+
+    // Routed to us as the last hop: tell the neighbors standing by for it
+    if (pkt.header.dst == g_local_address && pkt.route.next_hop == g_local_address) {
+        mesh_send_link_ack(&pkt.header);
+    }
+
+    if (pkt.header.type == MESH_MSG_AGGREGATE) {
+        forward = mesh_agg_unpack(data, (uint16_t)(len - MESH_SIGNATURE_LEN));
+    } else {
+        // Upper layers get the payload alone, without the trailing signature
+        pkt.payload     = data + head;
+        pkt.payload_len = (uint8_t)(len - head - MESH_SIGNATURE_LEN);
 
-    if (pkt.payload_len > 0) {
-        memcpy(pkt.payload, data + sizeof(mesh_header_t), pkt.payload_len);
+        forward = mesh_handle_incoming_packet(&pkt);
     }
 
-    mesh_handle_incoming_packet(&pkt);
+    if (forward) {
+        mesh_forward_frame(buf);
+    }
 }
 
 // -----------------------------------------------------------------------------
 // Core Incoming Handler
 // -----------------------------------------------------------------------------
 
-static void mesh_handle_incoming_packet(mesh_packet_t *pkt)
+// Delivers the packet locally if it is ours; returns true if it should
+// also be relayed.
+static bool mesh_handle_incoming_packet(const mesh_packet_t *pkt)
 {
-    // Drop if TTL exhausted
-    if (pkt->header.ttl == 0 || pkt->header.hops >= MESH_MAX_HOPS) {
-        return;
+    // Drop if TTL exhausted. The route prefix is unsigned, so a TTL above
+    // what any source sends is treated as forged.
+    if (pkt->route.ttl == 0 || pkt->route.ttl > MESH_DEFAULT_TTL ||
+        pkt->route.hops >= MESH_MAX_HOPS) {
+        return false;
     }
 
-    // Replay protection
-    if (mesh_is_duplicate(pkt->header.msg_id)) {
-        return; // we've seen this message already
+    // Replay protection. msg_id is only unique per source, so the key
+    // covers both.
+    if (mesh_dedup_check(mesh_dedup_key_msg(pkt->header.src, pkt->header.msg_id),
+                         time_now_ms())) {
+        return false; // we've seen this message already
     }
-    mesh_record_seen(pkt->header.msg_id);
 
     bool is_for_me   = (pkt->header.dst == g_local_address);
     bool is_broadcast = (pkt->header.dst == 0xFFFF);
@@ -274,8 +634,15 @@ static void mesh_handle_incoming_packet(mesh_packet_t *pkt)
                 mesh_on_trust_score_message(pkt->payload, pkt->payload_len);
                 break;
             case MESH_MSG_HEARTBEAT:
+                // Only a neighbor's own copy describes routes through it
+                if (pkt->route.hops == 0 && pkt->route.prev_hop == pkt->header.src) {
+                    route_table_heard_advert(pkt->header.src, pkt->payload, pkt->payload_len);
+                }
                 mesh_on_heartbeat_message(pkt->payload, pkt->payload_len);
                 break;
+            case MESH_MSG_LEDGER_RECON:
+                mesh_on_ledger_recon_message(pkt->header.src, pkt->payload, pkt->payload_len);
+                break;
             case MESH_MSG_ERROR_REPORT:
                 // For future use: send to diagnostics/logging.
                 break;
@@ -285,59 +652,137 @@ static void mesh_handle_incoming_packet(mesh_packet_t *pkt)
         }
     }
 
-    // Forward if still has TTL and we are not the original source.
-    if (!is_for_me && pkt->header.ttl > 0) {
-        mesh_forward_packet(pkt);
+    // Heartbeats and ledger summaries are for the sender's neighbors only:
+    // link estimates and route adverts are taken from the first hop alone
+    if (is_broadcast && (pkt->header.type == MESH_MSG_HEARTBEAT ||
+                         pkt->header.type == MESH_MSG_LEDGER_RECON)) {
+        return false;
     }
+
+    // Forward if not addressed to us and a neighbour would still accept it
+    // (a frame relayed with TTL 0 is dropped on arrival).
+    return !is_for_me && pkt->route.ttl > 1;
 }
 
 // -----------------------------------------------------------------------------
-// Forwarding Logic (Simple Flooding)
+// Forwarding Logic (Controlled Gossip / Unicast Routes)
 // -----------------------------------------------------------------------------
 
-static void mesh_forward_packet(mesh_packet_t *pkt)
+static TxClass mesh_tx_class(mesh_msg_type_t type)
 {
-    // Decrement TTL and increment hops for the forwarded packet
-    pkt->header.ttl--;
-    pkt->header.hops++;
+    switch (type) {
+        case MESH_MSG_TRANSACTION:   return TX_CLASS_TRANSACTION;
+        case MESH_MSG_GROUP_SAVINGS: return TX_CLASS_GROUP_SAVINGS;
+        case MESH_MSG_TRUST_SCORE:   return TX_CLASS_TRUST;
+        case MESH_MSG_HEARTBEAT:     return TX_CLASS_HEARTBEAT;
+        default:                     return TX_CLASS_SYNC;
+    }
+}
 
-    // Re-serialize and re-sign.
-    uint8_t buffer[MESH_MAX_PACKET_SIZE];
-    uint8_t len = 0;
+// Send hook for mesh_gossip.c: a relay whose backoff ran out (or that
+// goes at once) joins the TX queue
+static bool mesh_relay_send(packet_buf_t *buf, uint8_t radio_type, uint8_t tx_class)
+{
+    if (!mesh_tx_queue_push_buf(buf, radio_type, (TxClass)tx_class)) {
+        return false;
+    }
+    g_agg_stats.frames_forwarded++;
+    return true;
+}
 
-    memcpy(&buffer[len], &pkt->header, sizeof(mesh_header_t));
-    len += sizeof(mesh_header_t);
-    memcpy(&buffer[len], pkt->payload, pkt->payload_len);
-    len += pkt->payload_len;
+/**
+ * Relay a received frame. The signed body goes back on air byte-for-byte,
+ * so the source's signature stays valid end to end and the relay does no
+ * signing or re-serialization. The route prefix is rewritten in place
+ * (this node as previous hop, its own relay election or next hop).
+ *
+ * A unicast frame that names a next hop is relayed by that node at once,
+ * to its own next hop. Other neighbors that can hear that next hop stand
+ * by (mesh_gossip_standby()): its relay, or the destination's link ack,
+ * is the ack that cancels them. Without a route the frame falls back to
+ * gossip, like a broadcast: the gossip policy sends, holds or drops it.
+ */
+static void mesh_forward_frame(packet_buf_t *buf)
+{
+    uint8_t *frame = &buf->data[buf->offset];
+    uint8_t radio_type = buf->data[buf->offset - PACKET_BUF_HEADROOM + 1];
+    mesh_header_t header;
+    mesh_route_t in, out;
 
-    if (!security_sign_packet(buffer, &len, MESH_MAX_PACKET_SIZE)) {
+    memcpy(&in, frame, MESH_ROUTE_HEADER_LEN);
+    memcpy(&header, frame + MESH_ROUTE_HEADER_LEN, sizeof(header));
+
+    bool standby = header.dst != 0xFFFF && in.next_hop != ROUTE_NO_NEXT_HOP &&
+                   in.next_hop != g_local_address;
+
+    // Routed along another neighbor: only stand in if we would hear it relay
+    if (standby && neighbor_table_find_addr(in.next_hop) == NULL) {
         return;
     }
 
-    (void)radio_send_bytes(buffer, len);
-}
+    out.ttl        = in.ttl - 1;
+    out.hops       = in.hops + 1;
+    out.prev_hop   = g_local_address;
+    out.relay_mask = MESH_RELAY_ALL;
+    out.next_hop   = ROUTE_NO_NEXT_HOP;
+    if (header.dst == 0xFFFF) {
+        out.relay_mask = mesh_gossip_elect_relays(in.prev_hop);
+    } else {
+        out.next_hop = route_table_next_hop(header.dst);
+    }
 
-// -----------------------------------------------------------------------------
-// Replay Cache Helpers
-// -----------------------------------------------------------------------------
+    // ...and have a route of our own that does not lead back to the sender
+    if (standby && (out.next_hop == ROUTE_NO_NEXT_HOP || out.next_hop == in.prev_hop)) {
+        return;
+    }
+    memcpy(frame, &out, MESH_ROUTE_HEADER_LEN);
 
-static bool mesh_is_duplicate(mesh_msg_id_t msg_id)
-{
-    for (uint8_t i = 0; i < MESH_REPLAY_CACHE_SIZE; i++) {
-        if (g_replay_cache[i] == msg_id) {
-            return true;
-        }
+    if (standby) {
+        (void)mesh_gossip_standby(mesh_dedup_key_msg(header.src, header.msg_id), buf,
+                                  radio_type, (uint8_t)mesh_tx_class(header.type),
+                                  time_now_ms());
+        return;
     }
-    return false;
+
+    if (out.next_hop != ROUTE_NO_NEXT_HOP) {
+        (void)mesh_relay_send(buf, radio_type, (uint8_t)mesh_tx_class(header.type));
+        return;
+    }
+
+    (void)mesh_gossip_offer(mesh_dedup_key_msg(header.src, header.msg_id), buf,
+                            radio_type, (uint8_t)mesh_tx_class(header.type),
+                            in.relay_mask, time_now_ms());
 }
 
-static void mesh_record_seen(mesh_msg_id_t msg_id)
+// Link ack for a routed frame that reached us, ahead of everything queued
+static void mesh_send_link_ack(const mesh_header_t *header)
 {
-    g_replay_cache[g_replay_cache_head] = msg_id;
-    g_replay_cache_head++;
-    if (g_replay_cache_head >= MESH_REPLAY_CACHE_SIZE) {
-        g_replay_cache_head = 0;
+    uint8_t ack[MESH_ACK_LEN];
+
+    memcpy(&ack[0], &g_local_address, sizeof(mesh_address_t));
+    memcpy(&ack[2], &header->src, sizeof(mesh_address_t));
+    memcpy(&ack[4], &header->msg_id, sizeof(mesh_msg_id_t));
+
+    (void)mesh_tx_queue_push_frame(ack, sizeof(ack), MESH_ACK_RADIO_TYPE, TX_CLASS_TRANSACTION);
+}
+
+// A neighbor's link ack: the frame it names arrived, so nobody nearby
+// needs to relay it on its behalf
+static void mesh_handle_link_ack(const uint8_t *data, uint16_t len, packet_buf_t *buf)
+{
+    mesh_address_t acker, src;
+    mesh_msg_id_t  msg_id;
+
+    if (len != MESH_ACK_LEN) {
+        return;
     }
+
+    memcpy(&acker,  &data[0], sizeof(acker));
+    memcpy(&src,    &data[2], sizeof(src));
+    memcpy(&msg_id, &data[4], sizeof(msg_id));
+
+    neighbor_table_heard_from_addr(acker, buf->rssi, buf->snr_x4);
+    mesh_gossip_overheard(mesh_dedup_key_msg(src, msg_id));
 }
 
 // -----------------------------------------------------------------------------
@@ -348,6 +793,9 @@ static void mesh_record_seen(mesh_msg_id_t msg_id)
 // intervals to emit heartbeats, adjust power settings, etc.
 void mesh_periodic_tick(void)
 {
+    // Don't let a partly filled aggregate wait past one tick
+    (void)mesh_flush_pending();
+
     // Example: send a heartbeat periodically (placeholder)
     // In production this would be gated by timers and duty-cycle limits.
     // mesh_send_heartbeat();
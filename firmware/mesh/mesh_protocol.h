@@ -6,8 +6,24 @@
 
 #define MAX_MESH_PACKET_SIZE 256
 
+typedef uint16_t mesh_address_t;   // Short device address on mesh
+
+typedef struct {
+    uint32_t messages_sent;       // logical messages handed to the radio path
+    uint32_t frames_sent;         // LoRa frames actually transmitted
+    uint32_t aggregated_frames;   // frames carrying more than one message
+    uint32_t frames_forwarded;    // received buffers queued for relay, not re-signed
+    uint32_t bytes_on_air;        // including radio framing
+    uint32_t airtime_us;          // estimated time-on-air
+} mesh_agg_stats_t;
+
 void mesh_protocol_init(void);
+void mesh_init(mesh_address_t local_addr);
+mesh_address_t mesh_get_local_address(void);
 bool mesh_protocol_encode(uint8_t type, const uint8_t *payload, uint16_t payload_len, uint8_t *out_buf, uint16_t *out_len);
 bool mesh_protocol_decode(const uint8_t *data, uint16_t len, uint8_t *type_out, uint8_t *payload_out, uint16_t *payload_len_out);
+bool mesh_send_heartbeat(void);
+bool mesh_flush_pending(void);
+void mesh_get_aggregation_stats(mesh_agg_stats_t *out);
 
 #endif
@@ -0,0 +1,269 @@
+/**
+ * Seed Device Firmware
+ * Mesh Networking Stack — Unicast Route Table
+ *
+ * File: mesh_route_table.c
+ * Purpose:
+ *     Next hop toward each known destination, so a frame addressed to one
+ *     peer (ledger sync fragments, NACKs, tx-range replies) travels one
+ *     path instead of being gossiped to the whole mesh.
+ *
+ * Distance vector over the existing heartbeats:
+ *     - Each heartbeat carries this node's sequence number and up to
+ *       ROUTE_ADVERT_MAX of its routes as (destination, sequence, cost).
+ *       Larger tables are advertised in turn over several heartbeats.
+ *     - Cost is expected transmissions: the advertised path ETX plus the
+ *       ETX of our link to the advertiser, from mesh_neighbor_table.
+ *     - Sequence numbers come from the destination itself (DSDV). A route
+ *       only moves to a cheaper path with the same or newer sequence, so
+ *       stale news can never pull a route into a loop. The current next
+ *       hop is always believed, so a path that got worse is tracked.
+ *     - A route whose next hop left the neighbor table, or that nobody
+ *       has refreshed within ROUTE_TIMEOUT_MS, is dropped; the sender then
+ *       falls back to gossip until heartbeats find a new path.
+ *
+ * The table is small enough that a linear scan beats keeping an index.
+ */
+
+#include "mesh_route_table.h"
+#include "mesh_neighbor_table.h"
+#include "timekeeping.h"
+#include <string.h>
+
+// Destinations heartbeat every 10 s; at ROUTE_ADVERT_MAX per heartbeat a
+// full table is re-advertised about every 55 s per hop
+#define ROUTE_REFRESH_MS    90000    // older than this: not advertised, may be replaced
+#define ROUTE_TIMEOUT_MS    240000   // older than this: dropped
+
+// ---------------------------------------------------------------------------
+// Internal Static State
+// ---------------------------------------------------------------------------
+
+static route_entry_t       routes[ROUTE_TABLE_SIZE];
+static uint16_t            self_addr;
+static uint8_t             self_seq;
+static uint8_t             advert_cursor;
+static route_table_stats_t stats;
+
+// ---------------------------------------------------------------------------
+// Internal Helpers
+// ---------------------------------------------------------------------------
+
+static route_entry_t *route_find(uint16_t dst)
+{
+    for (uint8_t i = 0; i < ROUTE_TABLE_SIZE; i++) {
+        if (routes[i].active && routes[i].dst == dst)
+            return &routes[i];
+    }
+    return NULL;
+}
+
+// Free slot, else the most expensive route if `cost` beats it
+static route_entry_t *route_slot(uint16_t cost)
+{
+    route_entry_t *worst = NULL;
+
+    for (uint8_t i = 0; i < ROUTE_TABLE_SIZE; i++) {
+        if (!routes[i].active)
+            return &routes[i];
+        if (worst == NULL || routes[i].metric > worst->metric)
+            worst = &routes[i];
+    }
+
+    if (worst->metric <= cost)
+        return NULL;
+    stats.evicted++;
+    return worst;
+}
+
+// Usable ETX of the link to a neighbor, or RADIO_ETX_INFINITE
+static uint16_t link_cost(uint16_t addr)
+{
+    neighbor_entry_t *n = neighbor_table_find_addr(addr);
+    return (n != NULL) ? n->etx_x16 : RADIO_ETX_INFINITE;
+}
+
+static void route_set(route_entry_t *r, uint16_t dst, uint16_t via, uint8_t seq,
+                      uint16_t cost, uint32_t now)
+{
+    if (!r->active || r->next_hop != via || r->metric != cost)
+        stats.updates++;
+
+    r->dst        = dst;
+    r->next_hop   = via;
+    r->metric     = cost;
+    r->seq        = seq;
+    r->active     = 1;
+    r->updated_ms = now;
+}
+
+// One advertised destination, reachable through `via` at `cost`
+static void route_consider(uint16_t dst, uint16_t via, uint8_t seq, uint16_t cost,
+                           uint32_t now)
+{
+    route_entry_t *r = route_find(dst);
+
+    if (r == NULL) {
+        if (cost >= ROUTE_METRIC_MAX)
+            return;
+        r = route_slot(cost);
+        if (r != NULL)
+            route_set(r, dst, via, seq, cost, now);
+        return;
+    }
+
+    int8_t age = (int8_t)(seq - r->seq);
+    if (age < 0)
+        return;                      // older than what we have
+
+    if (via == r->next_hop) {
+        // Our own path: follow it, better or worse
+        if (cost >= ROUTE_METRIC_MAX)
+            r->active = 0;
+        else
+            route_set(r, dst, via, seq, cost, now);
+        return;
+    }
+
+    // Another path: take it if cheaper, or if ours has gone quiet
+    if (cost < r->metric ||
+        (age > 0 && cost < ROUTE_METRIC_MAX && now - r->updated_ms > ROUTE_REFRESH_MS))
+        route_set(r, dst, via, seq, cost, now);
+}
+
+// ---------------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------------
+
+void route_table_init(uint16_t self)
+{
+    memset(routes, 0, sizeof(routes));
+    memset(&stats, 0, sizeof(stats));
+    self_addr     = self;
+    self_seq      = 0;
+    advert_cursor = 0;
+}
+
+/**
+ * Heartbeat payload: our sequence number (bumped on each call) and the
+ * next ROUTE_ADVERT_MAX fresh routes. Returns the length written.
+ */
+uint8_t route_table_build_advert(uint8_t *out, uint8_t max_len)
+{
+    uint32_t now   = timekeeping_millis();
+    uint8_t  count = 0;
+    uint8_t  len   = ROUTE_ADVERT_HEADER_LEN;
+
+    if (out == NULL || max_len < ROUTE_ADVERT_HEADER_LEN)
+        return 0;
+
+    out[0] = ++self_seq;
+
+    for (uint8_t scanned = 0;
+         scanned < ROUTE_TABLE_SIZE && count < ROUTE_ADVERT_MAX &&
+         len + ROUTE_ADVERT_ENTRY_LEN <= max_len;
+         scanned++) {
+        route_entry_t *r = &routes[advert_cursor];
+        advert_cursor = (uint8_t)((advert_cursor + 1) % ROUTE_TABLE_SIZE);
+
+        if (!r->active || now - r->updated_ms > ROUTE_REFRESH_MS)
+            continue;
+
+        memcpy(&out[len], &r->dst, 2);
+        out[len + 2] = r->seq;
+        out[len + 3] = (uint8_t)r->metric;
+        len += ROUTE_ADVERT_ENTRY_LEN;
+        count++;
+    }
+
+    out[1] = count;
+    return len;
+}
+
+/**
+ * A heartbeat heard directly from neighbor `from` (not relayed), after
+ * the neighbor table has taken its link reading.
+ */
+void route_table_heard_advert(uint16_t from, const uint8_t *advert, uint8_t len)
+{
+    uint32_t now  = timekeeping_millis();
+    uint16_t link = link_cost(from);
+
+    if (advert == NULL || len < ROUTE_ADVERT_HEADER_LEN || from == self_addr ||
+        link == RADIO_ETX_INFINITE)
+        return;
+
+    stats.adverts++;
+
+    // The neighbor itself, one link away
+    route_consider(from, from, advert[0], link, now);
+
+    uint8_t count = advert[1];
+    const uint8_t *e = &advert[ROUTE_ADVERT_HEADER_LEN];
+
+    for (uint8_t i = 0; i < count; i++, e += ROUTE_ADVERT_ENTRY_LEN) {
+        uint16_t dst;
+
+        if (ROUTE_ADVERT_HEADER_LEN + (i + 1u) * ROUTE_ADVERT_ENTRY_LEN > len)
+            break;                   // truncated
+
+        memcpy(&dst, &e[0], 2);
+        if (dst == self_addr || dst == from)
+            continue;
+
+        uint32_t cost = (uint32_t)e[3] + link;
+        route_consider(dst, from, e[2],
+                       cost < ROUTE_METRIC_MAX ? (uint16_t)cost : ROUTE_METRIC_MAX, now);
+    }
+}
+
+/**
+ * Neighbor to hand a frame for `dst` to, or ROUTE_NO_NEXT_HOP when no
+ * current route exists and the frame should be gossiped.
+ */
+uint16_t route_table_next_hop(uint16_t dst)
+{
+    route_entry_t *r = route_find(dst);
+
+    stats.lookups++;
+
+    if (r == NULL || timekeeping_millis() - r->updated_ms > ROUTE_TIMEOUT_MS ||
+        link_cost(r->next_hop) == RADIO_ETX_INFINITE) {
+        stats.misses++;
+        return ROUTE_NO_NEXT_HOP;
+    }
+    return r->next_hop;
+}
+
+// Drop routes nobody refreshed and routes through departed neighbors
+void route_table_prune(void)
+{
+    uint32_t now = timekeeping_millis();
+
+    for (uint8_t i = 0; i < ROUTE_TABLE_SIZE; i++) {
+        route_entry_t *r = &routes[i];
+
+        if (!r->active)
+            continue;
+        if (now - r->updated_ms > ROUTE_TIMEOUT_MS ||
+            neighbor_table_find_addr(r->next_hop) == NULL) {
+            r->active = 0;
+            stats.expired++;
+        }
+    }
+}
+
+int route_table_count(void)
+{
+    int n = 0;
+
+    for (uint8_t i = 0; i < ROUTE_TABLE_SIZE; i++)
+        n += routes[i].active;
+    return n;
+}
+
+void route_table_get_stats(route_table_stats_t *out)
+{
+    if (out != NULL)
+        *out = stats;
+}
@@ -0,0 +1,46 @@
+#ifndef MESH_ROUTE_TABLE_H
+#define MESH_ROUTE_TABLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define ROUTE_TABLE_SIZE         32
+#define ROUTE_ADVERT_MAX         6      // destinations per heartbeat
+#define ROUTE_ADVERT_HEADER_LEN  2      // [own seq(1)][count(1)]
+#define ROUTE_ADVERT_ENTRY_LEN   4      // [dst(2)][seq(1)][metric(1)]
+#define ROUTE_ADVERT_MAX_LEN     (ROUTE_ADVERT_HEADER_LEN + ROUTE_ADVERT_MAX * ROUTE_ADVERT_ENTRY_LEN)
+
+// Path cost (ETX ×16) at which a destination counts as unreachable; it
+// travels in one byte
+#define ROUTE_METRIC_MAX         255
+
+// No unicast next hop: the frame is relayed by gossip
+#define ROUTE_NO_NEXT_HOP        0xFFFF
+
+typedef struct {
+    uint16_t dst;
+    uint16_t next_hop;
+    uint16_t metric;            // path ETX ×16 through next_hop
+    uint8_t  seq;               // dst's heartbeat sequence this came from
+    uint8_t  active;
+    uint32_t updated_ms;
+} route_entry_t;
+
+typedef struct {
+    uint32_t adverts;             // neighbor heartbeats processed
+    uint32_t updates;             // routes added or changed
+    uint32_t evicted;             // replaced by a cheaper newcomer while full
+    uint32_t expired;             // not refreshed within the timeout
+    uint32_t lookups;
+    uint32_t misses;              // no usable route: sent by gossip
+} route_table_stats_t;
+
+void     route_table_init(uint16_t self_addr);
+uint8_t  route_table_build_advert(uint8_t *out, uint8_t max_len);
+void     route_table_heard_advert(uint16_t from, const uint8_t *advert, uint8_t len);
+uint16_t route_table_next_hop(uint16_t dst);
+void     route_table_prune(void);
+int      route_table_count(void);
+void     route_table_get_stats(route_table_stats_t *out);
+
+#endif
@@ -20,63 +20,34 @@
  * ============================================================================
  */
 
+#include <string.h>
+
 #include "mesh_rx_handler.h"
 #include "mesh_protocol.h"
 #include "mesh_tx_queue.h"
 #include "mesh_neighbor_table.h"
+#include "mesh_dedup.h"
 #include "../ledger/ledger_manager.h"
 #include "../security/security_module.h"
+#include "../core/verify_cache.h"
 #include "../utils/tiny_json_parser.h"
 #include "../utils/timekeeping.h"
 
 #define MAX_PACKET_SIZE    256
-#define REPLAY_CACHE_SIZE  128
 #define LAMPORT_UPDATE(x,y)  ((x) = ((x) > (y) ? (x) : (y)) + 1)
 
-// ---------------------------------------------------------------------------
-// GLOBAL STATE
-// ---------------------------------------------------------------------------
-
-static uint8_t replay_cache_index = 0;
-static uint32_t replay_cache[REPLAY_CACHE_SIZE];   // stores packet hashes to prevent replay
-
 // ---------------------------------------------------------------------------
 // INTERNAL HELPERS
 // ---------------------------------------------------------------------------
 
 /**
- * Check if this packet hash was seen recently.
- */
-static bool seen_recently(uint32_t hash)
-{
-    for (int i = 0; i < REPLAY_CACHE_SIZE; i++)
-    {
-        if (replay_cache[i] == hash)
-            return true;
-    }
-    return false;
-}
-
-/**
- * Add a packet hash to replay cache.
- */
-static void remember(uint32_t hash)
-{
-    replay_cache[replay_cache_index++] = hash;
-    if (replay_cache_index >= REPLAY_CACHE_SIZE)
-        replay_cache_index = 0;
-}
-
-/**
- * Compute a simple but stable hash of packet contents.
- * (Production version will use cryptographic hashing.)
+ * Verifier behind the signature cache; ctx is the parsed packet.
  */
-static uint32_t hash_packet(const uint8_t *data, uint16_t length)
+static bool verify_mesh_packet(const verify_item_t *item, void *ctx)
 {
-    uint32_t h = 5381;
-    for (int i = 0; i < length; i++)
-        h = ((h << 5) + h) ^ data[i];
-    return h;
+    const mesh_packet_t *packet = (const mesh_packet_t *)ctx;
+    return security_verify_signature(packet->sender_id, packet->signature,
+                                     item->msg, (uint16_t)item->msg_len);
 }
 
 // ---------------------------------------------------------------------------
@@ -94,18 +65,7 @@ void mesh_handle_rx_packet(const uint8_t *data, uint16_t length, int8_t rssi)
         return;
     }
 
-    // Step 1: hash + replay protection
-    uint32_t packet_hash = hash_packet(data, length);
-
-    if (seen_recently(packet_hash))
-    {
-        // Replay attempt OR redundant propagation
-        return;
-    }
-
-    remember(packet_hash);
-
-    // Step 2: Parse JSON packet
+    // Step 1: Parse JSON packet
     mesh_packet_t packet;
     if (!mesh_protocol_parse(data, length, &packet))
     {
@@ -113,15 +73,36 @@ void mesh_handle_rx_packet(const uint8_t *data, uint16_t length, int8_t rssi)
         return;
     }
 
-    // Step 3: Validate signature (critical for financial safety)
-    if (!security_verify_signature(packet.sender_id, packet.signature, data, length))
+    // Step 2: Validate signature (critical for financial safety).
+    // The signature travels inside the packet bytes, so signer + bytes
+    // is the whole cache key; gossip copies skip the verify.
+    verify_item_t item = {
+        (const uint8_t *)packet.sender_id, strlen(packet.sender_id),
+        data, length, NULL, 0
+    };
+    if (!verify_cache_check(&item, verify_mesh_packet, &packet))
     {
         // Reject packet silently; security failure
         return;
     }
 
+    // Step 3: replay protection, in the filter shared with mesh_protocol
+    // (see mesh_dedup.c). The key is a digest of signer and signature:
+    // the frame bytes would not do, since every relay counts the TTL
+    // down and each copy would look new. Only verified frames are
+    // remembered, so a forged copy cannot suppress the real one.
+    uint8_t identity[sizeof(packet.sender_id) + sizeof(packet.signature)];
+    memcpy(identity, packet.sender_id, sizeof(packet.sender_id));
+    memcpy(&identity[sizeof(packet.sender_id)], packet.signature, sizeof(packet.signature));
+
+    if (mesh_dedup_check(mesh_dedup_key_bytes(identity, sizeof(identity)), time_now_ms()))
+    {
+        // Replay attempt OR redundant propagation
+        return;
+    }
+
     // Step 4: Update neighbor table with RSSI info
-    mesh_neighbor_update(packet.sender_id, rssi);
+    neighbor_table_heard_from(packet.sender_id, rssi, RADIO_SNR_UNKNOWN);
 
     // Step 5: Lamport clock update (offline-safe ordering)
     LAMPORT_UPDATE(global_lamport_clock, packet.lamport);
@@ -168,6 +149,6 @@ void mesh_handle_rx_packet(const uint8_t *data, uint16_t length, int8_t rssi)
 // ---------------------------------------------------------------------------
 
 #ifdef UNIT_TEST
-bool test_seen_recently(uint32_t h) { return seen_recently(h); }
-void test_remember(uint32_t h) { remember(h); }
+bool test_seen_recently(uint32_t h) { return mesh_dedup_contains(h, time_now_ms()); }
+void test_remember(uint32_t h) { mesh_dedup_insert(h, time_now_ms()); }
 #endif
@@ -15,6 +15,10 @@
  *  - Deterministic: any two devices given the same messages reach the same final ledger state
  *  - Hardware-friendly: simple C code, minimal dynamic allocation, small structs
  *
+ * Everything travels as MESH_MSG_LEDGER_RECON messages (mesh_protocol.c);
+ * the first payload byte says which kind. Transactions go one per
+ * message, as standalone ledger records (ledger_tx_encode()).
+ *
  * NOTE: This is reference firmware-style code meant for early prototypes
  * and investor / technical review. It will evolve as hardware and protocol
  * details are finalized.
@@ -27,24 +31,73 @@
 #include "mesh_sync.h"
 #include "mesh_protocol.h"
 #include "ledger_manager.h"
+#include "ledger_record_codec.h"
 #include "timekeeping.h"
-#include "radio_interface.h"
 
 // -----------------------------------------------------------------------------
 // Configuration knobs
 // -----------------------------------------------------------------------------
 
-// How often to send a lightweight "I am alive + ledger summary" broadcast (ms)
-#define MESH_HEARTBEAT_INTERVAL_MS      15_000U  // 15 seconds
-
-// How often to initiate a sync check with at least one neighbor (ms)
-#define MESH_SYNC_CHECK_INTERVAL_MS     60_000U  // 60 seconds
+// How often to broadcast our ledger summary to neighbors (ms)
+#define MESH_SYNC_CHECK_INTERVAL_MS     60000U   // 60 seconds
 
 // Max number of outstanding sync requests we track at once
 #define MESH_MAX_PENDING_SYNC           4U
 
-// Maximum number of transaction IDs we will ask for in one request
-#define MESH_MAX_TX_REQUEST_BATCH       32U
+// Maximum number of transactions we will ask for in one request. Each
+// comes back in its own frame of up to ~1 s on air at SF9.
+#define MESH_MAX_TX_REQUEST_BATCH       4U
+
+// Range requests kept in flight per peer; each mismatched bucket is split
+// into this many sub-ranges so a single bucket still fills the window
+#define MESH_SYNC_WINDOW                4U
+
+// How long to wait for a range response before re-requesting that range (ms)
+#define MESH_SYNC_REQUEST_TIMEOUT_MS    15000U
+
+// Re-requests per range before giving up until the next summary round
+#define MESH_SYNC_MAX_RETRIES           3U
+
+// Number of Lamport-range buckets hashed into every ledger summary.
+// Must be <= 8 so a peer's mismatched buckets fit in one bitmask byte.
+#define MESH_SYNC_RANGE_BUCKETS         8U
+
+// Largest bucket_shift for which every bucket start fits in 32 bits
+#define MESH_SYNC_MAX_BUCKET_SHIFT      29U
+
+// Buckets the range-hash cache splits our own Lamport range into. Any
+// layout up to three shifts finer than ours folds out of them, so
+// neighbours whose ledgers run a little behind do not force a rewalk.
+#define MESH_SYNC_FINE_BUCKETS          64U
+
+// Bloom filter of "transactions I already hold" carried in range requests.
+// At 3 hashes over 384 bits, false positives stay near 2% up to
+// MESH_SYNC_FILTER_MAX_TXS entries; a sub-range holding more of ours is
+// cut short and the rest requested separately.
+#define MESH_SYNC_FILTER_BYTES          48U
+#define MESH_SYNC_FILTER_HASHES         3U
+#define MESH_SYNC_FILTER_MAX_TXS        40U
+
+// Transactions read from the ledger per page while walking a range
+#define MESH_SYNC_PAGE_TXS              16U
+
+// First payload byte of a MESH_MSG_LEDGER_RECON message
+#define MESH_SYNC_MSG_SUMMARY           0x01U   // [kind][mesh_ledger_summary_t]
+#define MESH_SYNC_MSG_RANGE_REQUEST     0x02U   // [kind][mesh_recon_request_t]
+#define MESH_SYNC_MSG_RANGE_RESPONSE    0x03U   // [kind][from_lamport(4)][seq][count][record]
+
+#define MESH_SYNC_RESPONSE_HEADER       7U
+
+// Summary layout carried in mesh_ledger_summary_t.version. Version 1 is
+// the 12-byte {last_lamport, tx_count, ledger_hash} summary of older
+// firmware, which has no version byte; later versions may append fields.
+#define MESH_SYNC_SUMMARY_VERSION       2U
+#define MESH_SYNC_SUMMARY_V1_LEN        12U
+
+// Payload budget per message (mesh_protocol.c MESH_MAX_PAYLOAD)
+#define MESH_SYNC_MAX_PAYLOAD           145U
+
+#define MESH_SYNC_BROADCAST             0xFFFFU
 
 // -----------------------------------------------------------------------------
 // Local types
@@ -58,112 +111,211 @@
 typedef struct {
     uint32_t last_lamport;     // Highest Lamport clock we've seen
     uint32_t tx_count;         // Total number of transactions
-    uint32_t ledger_hash;      // Lightweight hash over ledger checkpoint
+    uint32_t ledger_hash;      // XOR of all transaction-ID hashes
+    uint8_t  bucket_shift;     // Bucket i covers Lamport [i << shift, (i + 1) << shift)
+    uint8_t  version;          // MESH_SYNC_SUMMARY_VERSION
+    uint8_t  reserved[2];
+    uint32_t range_hash[MESH_SYNC_RANGE_BUCKETS]; // XOR of tx-ID hashes per bucket;
+                                                  // the last bucket is open-ended
 } mesh_ledger_summary_t;
 
+/**
+ * Range request with set reconciliation: "send me what you hold in
+ * [from_lamport, to_lamport] that is NOT in have_filter".
+ */
+typedef struct {
+    uint32_t from_lamport;
+    uint32_t max_count;
+    uint32_t to_lamport;                            // inclusive
+    uint32_t filter_seed;                           // varies per request so false
+                                                    // positives do not repeat
+    uint8_t  have_filter[MESH_SYNC_FILTER_BYTES];   // Bloom filter over tx IDs
+} mesh_recon_request_t;
+
+/**
+ * One outstanding range request inside a peer's window.
+ */
+typedef struct {
+    bool     in_flight;
+    uint8_t  attempts;                // re-requests sent after a timeout
+    uint8_t  received;                // response records seen for this request
+    uint32_t from_lamport;            // also the key the response echoes back
+    uint32_t to_lamport;              // inclusive
+    uint32_t highest_lamport;         // highest in the records seen so far
+    uint32_t deadline_ms;
+} mesh_sync_window_entry_t;
+
 /**
  * Tracks an in-progress sync with a specific neighbor.
  */
 typedef struct {
     bool     in_use;
-    uint32_t neighbor_id;
-    uint32_t last_request_time_ms;
-    uint32_t next_expected_lamport;   // For range-based fetches
+    mesh_address_t neighbor_id;
+    uint32_t start_time_ms;           // when the first range was requested
+    uint32_t bytes_received;          // range-response payload bytes
+    uint32_t peer_last_lamport;       // nothing to pull above this
+    uint32_t fill_cursor;             // next Lamport not yet requested
+    uint32_t fill_end;                // inclusive end of the bucket being split
+    uint32_t fill_chunk;              // sub-range width for that bucket
+    bool     fill_active;             // fill_cursor..fill_end still to request
+    uint8_t  bucket_shift;            // Peer's bucket layout
+    uint8_t  pending_buckets;         // Mismatched buckets not yet split (bitmask)
+    mesh_sync_window_entry_t window[MESH_SYNC_WINDOW];
 } mesh_pending_sync_t;
 
+/**
+ * Our own range hashes for one bucket layout.
+ */
+typedef struct {
+    uint8_t  bucket_shift;
+    uint32_t tx_count;
+    uint32_t last_lamport;
+    uint32_t ledger_hash;
+    uint32_t range_hash[MESH_SYNC_RANGE_BUCKETS];
+} mesh_range_hashes_t;
+
+/**
+ * Our range hashes at MESH_SYNC_FINE_BUCKETS granularity. Recomputing
+ * them walks the whole ledger, so keep the last result until the
+ * ledger changes.
+ */
+typedef struct {
+    bool     valid;
+    uint8_t  fine_shift;
+    uint32_t tx_count;
+    uint32_t last_lamport;
+    uint32_t ledger_hash;
+    uint32_t fine_hash[MESH_SYNC_FINE_BUCKETS];
+} mesh_recon_cache_t;
+
 // -----------------------------------------------------------------------------
 // Static state
 // -----------------------------------------------------------------------------
 
-static uint32_t           self_device_id        = 0;
-static uint32_t           last_heartbeat_ms     = 0;
 static uint32_t           last_sync_check_ms    = 0;
 static mesh_pending_sync_t pending_sync[MESH_MAX_PENDING_SYNC];
+static mesh_recon_cache_t  recon_cache;
+static mesh_sync_stats_t   sync_stats;
 
 // -----------------------------------------------------------------------------
 // Forward declarations (internal helpers)
 // -----------------------------------------------------------------------------
 
-static void mesh_sync_send_heartbeat(void);
-static void mesh_sync_handle_heartbeat(const mesh_packet_t *pkt);
+// mesh_protocol.c
+extern bool mesh_send_ledger_recon(mesh_address_t dst, const uint8_t *payload, uint8_t len);
 
-static void mesh_sync_consider_peer_summary(uint32_t neighbor_id,
+static void mesh_sync_send_summary(mesh_address_t dst);
+static void mesh_sync_consider_peer_summary(mesh_address_t neighbor_id,
                                             const mesh_ledger_summary_t *remote);
-
-static void mesh_sync_send_summary_request(uint32_t neighbor_id);
-static void mesh_sync_send_tx_range_request(uint32_t neighbor_id,
-                                            uint32_t from_lamport,
-                                            uint32_t max_count);
-
-static void mesh_sync_handle_summary(const mesh_packet_t *pkt);
-static void mesh_sync_handle_tx_range_request(const mesh_packet_t *pkt);
-static void mesh_sync_handle_tx_range_response(const mesh_packet_t *pkt);
-
-static mesh_pending_sync_t *mesh_sync_get_or_alloc_slot(uint32_t neighbor_id);
-static mesh_pending_sync_t *mesh_sync_find_slot(uint32_t neighbor_id);
+static void mesh_sync_consider_legacy_summary(mesh_address_t neighbor_id,
+                                              const mesh_ledger_summary_t *remote);
+
+static void mesh_sync_send_tx_range_request(mesh_pending_sync_t *slot,
+                                            mesh_sync_window_entry_t *entry);
+static void mesh_sync_fill_window(mesh_pending_sync_t *slot);
+static void mesh_sync_check_timeouts(uint32_t now);
+
+static void mesh_sync_build_summary(mesh_ledger_summary_t *out);
+static uint8_t mesh_sync_shift_for(uint32_t last_lamport);
+static void mesh_sync_range_hashes(uint8_t bucket_shift, mesh_range_hashes_t *out);
+static void mesh_sync_build_have_filter(mesh_recon_request_t *req);
+static uint32_t mesh_sync_collect_missing(const mesh_recon_request_t *req,
+                                          ledger_tx_t *out,
+                                          uint32_t max_out);
+static uint32_t mesh_sync_filter_cut(uint32_t from, uint32_t to);
+
+static void mesh_sync_handle_summary(mesh_address_t src, const uint8_t *body, uint8_t len);
+static void mesh_sync_handle_tx_range_request(mesh_address_t src, const uint8_t *body, uint8_t len);
+static void mesh_sync_handle_tx_range_response(mesh_address_t src, const uint8_t *body, uint8_t len);
+
+static mesh_pending_sync_t *mesh_sync_get_or_alloc_slot(mesh_address_t neighbor_id);
+static mesh_pending_sync_t *mesh_sync_find_slot(mesh_address_t neighbor_id);
+static void mesh_sync_finish_slot(mesh_pending_sync_t *slot);
 
 // -----------------------------------------------------------------------------
 // Public API
 // -----------------------------------------------------------------------------
 
-void mesh_sync_init(uint32_t device_id)
+void mesh_sync_init(void)
 {
-    self_device_id = device_id;
-    last_heartbeat_ms  = timekeeping_millis();
-    last_sync_check_ms = last_heartbeat_ms;
+    last_sync_check_ms = time_now_ms();
 
     memset(pending_sync, 0, sizeof(pending_sync));
+    memset(&recon_cache, 0, sizeof(recon_cache));
+    memset(&sync_stats, 0, sizeof(sync_stats));
 }
 
 /**
- * Called periodically from the main loop (e.g., every 500 ms).
- * Drives heartbeats and sync checks.
+ * Drives summary broadcasts and range re-requests. Returns ms until the
+ * next call has work to do: the next summary or the earliest range
+ * deadline, whichever comes first.
  */
-void mesh_sync_tick(void)
+uint32_t mesh_sync_tick(uint32_t now)
 {
-    uint32_t now = timekeeping_millis();
-
-    // 1) Periodic heartbeat broadcast
-    if ((now - last_heartbeat_ms) >= MESH_HEARTBEAT_INTERVAL_MS) {
-        mesh_sync_send_heartbeat();
-        last_heartbeat_ms = now;
-    }
-
-    // 2) Periodically initiate a sync check with neighbors
+    // 1) Periodically advertise our summary; neighbors that differ
+    //    pull what they lack from us, and we from them on theirs
     if ((now - last_sync_check_ms) >= MESH_SYNC_CHECK_INTERVAL_MS) {
-        // For now we simply broadcast a "summary request" which
-        // encourages neighbors to respond with their ledger summaries.
-        mesh_sync_send_summary_request(MESH_BROADCAST_ID);
+        mesh_sync_send_summary(MESH_SYNC_BROADCAST);
         last_sync_check_ms = now;
     }
 
-    // 3) (Optional future extension): handle timeouts for pending syncs,
-    // retry or prune old sync attempts, etc.
+    // 2) Re-request ranges whose responses never arrived
+    mesh_sync_check_timeouts(now);
+
+    uint32_t next = MESH_SYNC_CHECK_INTERVAL_MS - (now - last_sync_check_ms);
+
+    for (uint32_t s = 0; s < MESH_MAX_PENDING_SYNC; ++s) {
+        if (!pending_sync[s].in_use) {
+            continue;
+        }
+        for (uint32_t i = 0; i < MESH_SYNC_WINDOW; ++i) {
+            const mesh_sync_window_entry_t *entry = &pending_sync[s].window[i];
+            if (!entry->in_flight) {
+                continue;
+            }
+
+            int32_t wait = (int32_t)(entry->deadline_ms - now);
+            if (wait <= 0) {
+                return 0;
+            }
+            if ((uint32_t)wait < next) {
+                next = (uint32_t)wait;
+            }
+        }
+    }
+    return next;
 }
 
 /**
- * Called by mesh_protocol when a mesh packet addressed to us arrives,
- * and it is classified as a "sync-related" message.
+ * Counters for the range fetcher, including how long the most recent
+ * completed sync took and its throughput.
  */
-void mesh_sync_on_packet(const mesh_packet_t *pkt)
+void mesh_sync_get_stats(mesh_sync_stats_t *out)
 {
-    if (!pkt) return;
+    if (!out) return;
+    *out = sync_stats;
+}
 
-    switch (pkt->type) {
-        case MESH_MSG_HEARTBEAT:
-            mesh_sync_handle_heartbeat(pkt);
-            break;
+/**
+ * Upper-layer hook for mesh_protocol.c: a verified MESH_MSG_LEDGER_RECON
+ * message addressed to us (or broadcast by a neighbor). The payload is
+ * only valid for the call.
+ */
+void mesh_on_ledger_recon_message(mesh_address_t src, const uint8_t *payload, uint8_t len)
+{
+    if (!payload || len == 0) return;
 
-        case MESH_MSG_LEDGER_SUMMARY:
-            mesh_sync_handle_summary(pkt);
+    switch (payload[0]) {
+        case MESH_SYNC_MSG_SUMMARY:
+            mesh_sync_handle_summary(src, payload + 1, (uint8_t)(len - 1));
             break;
 
-        case MESH_MSG_TX_RANGE_REQUEST:
-            mesh_sync_handle_tx_range_request(pkt);
+        case MESH_SYNC_MSG_RANGE_REQUEST:
+            mesh_sync_handle_tx_range_request(src, payload + 1, (uint8_t)(len - 1));
             break;
 
-        case MESH_MSG_TX_RANGE_RESPONSE:
-            mesh_sync_handle_tx_range_response(pkt);
+        case MESH_SYNC_MSG_RANGE_RESPONSE:
+            mesh_sync_handle_tx_range_response(src, payload + 1, (uint8_t)(len - 1));
             break;
 
         default:
@@ -173,291 +325,743 @@ void mesh_sync_on_packet(const mesh_packet_t *pkt)
 }
 
 // -----------------------------------------------------------------------------
-// Internal helpers - heartbeat & summaries
+// Internal helpers - summaries
 // -----------------------------------------------------------------------------
 
 /**
- * Build and broadcast a heartbeat that includes a compact ledger summary.
+ * Send our compact ledger summary, to every neighbor or to one peer.
  */
-static void mesh_sync_send_heartbeat(void)
+static void mesh_sync_send_summary(mesh_address_t dst)
 {
-    mesh_ledger_summary_t summary = {0};
-    ledger_get_summary(&summary.last_lamport,
-                       &summary.tx_count,
-                       &summary.ledger_hash);
+    uint8_t msg[1 + sizeof(mesh_ledger_summary_t)];
+    mesh_ledger_summary_t summary;
 
-    mesh_packet_t pkt;
-    memset(&pkt, 0, sizeof(pkt));
-    pkt.type       = MESH_MSG_HEARTBEAT;
-    pkt.src_id     = self_device_id;
-    pkt.dest_id    = MESH_BROADCAST_ID;
-    pkt.payload_len = sizeof(summary);
+    mesh_sync_build_summary(&summary);
 
-    memcpy(pkt.payload, &summary, sizeof(summary));
+    msg[0] = MESH_SYNC_MSG_SUMMARY;
+    memcpy(&msg[1], &summary, sizeof(summary));
 
-    radio_send_packet(&pkt);
+    (void)mesh_send_ledger_recon(dst, msg, sizeof(msg));
 }
 
 /**
- * Process a heartbeat from another device.
- * We use the included summary only as a "hint" — the real work
- * happens when we exchange full summaries and range requests.
+ * Process a summary from another device.
  */
-static void mesh_sync_handle_heartbeat(const mesh_packet_t *pkt)
+static void mesh_sync_handle_summary(mesh_address_t src, const uint8_t *body, uint8_t len)
 {
-    if (!pkt) return;
-    if (pkt->payload_len != sizeof(mesh_ledger_summary_t)) {
-        // Malformed or older version; ignore gracefully
+    mesh_ledger_summary_t remote;
+
+    if (len == MESH_SYNC_SUMMARY_V1_LEN) {
+        memset(&remote, 0, sizeof(remote));
+        memcpy(&remote, body, MESH_SYNC_SUMMARY_V1_LEN);
+        remote.version = 1;
+        mesh_sync_consider_legacy_summary(src, &remote);
         return;
     }
 
-    mesh_ledger_summary_t remote;
-    memcpy(&remote, pkt->payload, sizeof(remote));
+    if (len < sizeof(mesh_ledger_summary_t)) {
+        return; // malformed; ignore gracefully
+    }
+
+    // Newer layouts only append fields; read the part we understand
+    memcpy(&remote, body, sizeof(remote));
+    if (remote.version < MESH_SYNC_SUMMARY_VERSION) {
+        return;
+    }
 
-    mesh_sync_consider_peer_summary(pkt->src_id, &remote);
+    mesh_sync_consider_peer_summary(src, &remote);
+}
+
+/**
+ * A version 1 summary has no range hashes. Keep the old rule: a peer
+ * that is ahead of us on Lamport or count has something we lack, so
+ * pull everything up to its highest Lamport, every bucket of the
+ * layout it would have used. The have-filter keeps what we already
+ * hold off the air.
+ */
+static void mesh_sync_consider_legacy_summary(mesh_address_t neighbor_id,
+                                              const mesh_ledger_summary_t *remote)
+{
+    uint32_t last_lamport = 0;
+    uint32_t tx_count     = 0;
+    ledger_get_summary(&last_lamport, &tx_count);
+
+    if (remote->last_lamport <= last_lamport && remote->tx_count <= tx_count) {
+        return;
+    }
+    if (mesh_sync_find_slot(neighbor_id)) {
+        return;
+    }
+
+    mesh_pending_sync_t *slot = mesh_sync_get_or_alloc_slot(neighbor_id);
+    if (!slot) {
+        return;
+    }
+
+    slot->bucket_shift      = mesh_sync_shift_for(remote->last_lamport);
+    slot->pending_buckets   = (uint8_t)((1U << MESH_SYNC_RANGE_BUCKETS) - 1U);
+    slot->peer_last_lamport = remote->last_lamport;
+    slot->start_time_ms     = time_now_ms();
+
+    mesh_sync_fill_window(slot);
 }
 
 /**
  * Ask whether we should try to sync with this peer based on their summary.
- * For now, we use a very simple rule:
- *  - If their last_lamport or tx_count is greater than ours, we probably
- *    are missing transactions and should fetch.
+ *
+ * Comparing last_lamport / tx_count alone misses peers that hold the same
+ * number of *different* transactions. Instead we hash our own ledger with
+ * the peer's bucket layout and compare bucket by bucket: every bucket whose
+ * hash differs holds at least one transaction one of us lacks. Only those
+ * Lamport ranges are requested, and each request carries a Bloom filter of
+ * what we already hold there, so the peer sends only our missing half of
+ * the symmetric difference. The peer pulls the other half from us the same
+ * way when it sees our summary.
  */
-static void mesh_sync_consider_peer_summary(uint32_t neighbor_id,
+static void mesh_sync_consider_peer_summary(mesh_address_t neighbor_id,
                                             const mesh_ledger_summary_t *remote)
 {
-    mesh_ledger_summary_t local;
-    ledger_get_summary(&local.last_lamport,
-                       &local.tx_count,
-                       &local.ledger_hash);
+    if (remote->bucket_shift > MESH_SYNC_MAX_BUCKET_SHIFT) {
+        return; // malformed layout
+    }
+
+    mesh_range_hashes_t local;
+    mesh_sync_range_hashes(remote->bucket_shift, &local);
+
+    if (local.ledger_hash == remote->ledger_hash &&
+        local.tx_count    == remote->tx_count) {
+        // Same transaction set; no action needed.
+        return;
+    }
+
+    uint8_t mismatched = 0;
+    for (uint32_t i = 0; i < MESH_SYNC_RANGE_BUCKETS; ++i) {
+        if (local.range_hash[i] != remote->range_hash[i]) {
+            mismatched |= (uint8_t)(1U << i);
+        }
+    }
 
-    bool remote_has_newer =
-        (remote->last_lamport > local.last_lamport) ||
-        (remote->tx_count     > local.tx_count);
+    if (mismatched == 0) {
+        return;
+    }
 
-    if (!remote_has_newer) {
-        // We are as up-to-date or newer; no action needed.
+    if (mesh_sync_find_slot(neighbor_id)) {
+        // Already reconciling with this peer; let that finish first.
         return;
     }
 
-    // Allocate / get a sync slot for this neighbor and request a range.
+    // Allocate a sync slot for this neighbor and open its request window.
+    // Other slots keep pulling from their peers in parallel.
     mesh_pending_sync_t *slot = mesh_sync_get_or_alloc_slot(neighbor_id);
     if (!slot) {
         // No free slots; we may log this and try later.
         return;
     }
 
-    slot->next_expected_lamport = local.last_lamport + 1;
-    slot->last_request_time_ms  = timekeeping_millis();
+    slot->bucket_shift      = remote->bucket_shift;
+    slot->pending_buckets   = mismatched;
+    slot->peer_last_lamport = remote->last_lamport;
+    slot->start_time_ms     = time_now_ms();
 
-    mesh_sync_send_tx_range_request(neighbor_id,
-                                    slot->next_expected_lamport,
-                                    MESH_MAX_TX_REQUEST_BATCH);
+    mesh_sync_fill_window(slot);
 }
 
 // -----------------------------------------------------------------------------
-// Internal helpers - summary + range messages
+// Internal helpers - range request / response
 // -----------------------------------------------------------------------------
 
 /**
- * Broadcast a request for ledger summaries from peers.
- * This is very cheap and used periodically to discover who has new data.
+ * Ask the slot's peer for transactions in the entry's Lamport range that
+ * are missing from our Bloom filter, and arm the entry's deadline.
  */
-static void mesh_sync_send_summary_request(uint32_t neighbor_id)
+static void mesh_sync_send_tx_range_request(mesh_pending_sync_t *slot,
+                                            mesh_sync_window_entry_t *entry)
 {
-    mesh_packet_t pkt;
-    memset(&pkt, 0, sizeof(pkt));
+    uint8_t msg[1 + sizeof(mesh_recon_request_t)];
+    mesh_recon_request_t req;
+    memset(&req, 0, sizeof(req));
+
+    req.from_lamport = entry->from_lamport;
+    req.to_lamport   = entry->to_lamport;
+    req.max_count    = MESH_MAX_TX_REQUEST_BATCH;
+    req.filter_seed  = time_now_ms() ^ slot->neighbor_id ^ entry->from_lamport;
 
-    pkt.type        = MESH_MSG_LEDGER_SUMMARY_REQUEST;
-    pkt.src_id      = self_device_id;
-    pkt.dest_id     = neighbor_id;  // could be broadcast or specific
+    mesh_sync_build_have_filter(&req);
 
-    pkt.payload_len = 0; // no body needed
+    msg[0] = MESH_SYNC_MSG_RANGE_REQUEST;
+    memcpy(&msg[1], &req, sizeof(req));
 
-    radio_send_packet(&pkt);
+    entry->in_flight       = true;
+    entry->received        = 0;
+    entry->highest_lamport = entry->from_lamport;
+    entry->deadline_ms     = time_now_ms() + MESH_SYNC_REQUEST_TIMEOUT_MS;
+    sync_stats.requests_sent++;
+
+    (void)mesh_send_ledger_recon(slot->neighbor_id, msg, sizeof(msg));
 }
 
 /**
- * Send a request for "transactions with Lamport >= from_lamport"
- * up to max_count. The peer is free to return fewer.
+ * Peer asks us: "give me up to max_count transactions in [from_lamport,
+ * to_lamport] that are not in my Bloom filter". Each goes back in its
+ * own message, numbered seq of count; an empty answer is one message
+ * with count 0. Records too long for a message are left out.
  */
-static void mesh_sync_send_tx_range_request(uint32_t neighbor_id,
-                                            uint32_t from_lamport,
-                                            uint32_t max_count)
+static void mesh_sync_handle_tx_range_request(mesh_address_t src, const uint8_t *body, uint8_t len)
 {
-    mesh_tx_range_request_t req;
-    req.from_lamport = from_lamport;
-    req.max_count    = max_count;
+    mesh_recon_request_t req;
+    ledger_tx_t          txs[MESH_MAX_TX_REQUEST_BATCH];
+    uint8_t              msg[MESH_SYNC_RESPONSE_HEADER + LEDGER_RECORD_MAX_BYTES];
+
+    if (len != sizeof(mesh_recon_request_t)) {
+        return;
+    }
+    memcpy(&req, body, sizeof(req));
 
-    mesh_packet_t pkt;
-    memset(&pkt, 0, sizeof(pkt));
+    uint32_t count = mesh_sync_collect_missing(&req, txs, MESH_MAX_TX_REQUEST_BATCH);
 
-    pkt.type        = MESH_MSG_TX_RANGE_REQUEST;
-    pkt.src_id      = self_device_id;
-    pkt.dest_id     = neighbor_id;
-    pkt.payload_len = sizeof(req);
+    msg[0] = MESH_SYNC_MSG_RANGE_RESPONSE;
+    memcpy(&msg[1], &req.from_lamport, sizeof(uint32_t));
+    msg[6] = (uint8_t)count;
+
+    if (count == 0) {
+        msg[5] = 0;
+        (void)mesh_send_ledger_recon(src, msg, MESH_SYNC_RESPONSE_HEADER);
+        return;
+    }
 
-    memcpy(pkt.payload, &req, sizeof(req));
+    for (uint32_t i = 0; i < count; ++i) {
+        uint16_t rec_len = ledger_tx_encode(&txs[i], &msg[MESH_SYNC_RESPONSE_HEADER]);
 
-    radio_send_packet(&pkt);
+        msg[5] = (uint8_t)i;
+        (void)mesh_send_ledger_recon(src, msg, (uint8_t)(MESH_SYNC_RESPONSE_HEADER + rec_len));
+    }
 }
 
 /**
- * Handle a peer asking us for our ledger summary.
+ * Peer has sent us one transaction of the requested Lamport range (or
+ * word that there is none).
  */
-static void mesh_sync_handle_summary(const mesh_packet_t *pkt)
+static void mesh_sync_handle_tx_range_response(mesh_address_t src, const uint8_t *body, uint8_t len)
 {
-    if (!pkt) return;
+    uint32_t    from_lamport;
+    ledger_tx_t tx;
+    bool        has_tx;
+
+    if (len < MESH_SYNC_RESPONSE_HEADER - 1U) {
+        return; // too small
+    }
 
-    if (pkt->type == MESH_MSG_LEDGER_SUMMARY_REQUEST) {
-        // Respond with our summary
-        mesh_ledger_summary_t summary = {0};
-        ledger_get_summary(&summary.last_lamport,
-                           &summary.tx_count,
-                           &summary.ledger_hash);
+    memcpy(&from_lamport, body, sizeof(uint32_t));
+    uint8_t seq   = body[4];
+    uint8_t count = body[5];
 
-        mesh_packet_t out;
-        memset(&out, 0, sizeof(out));
+    has_tx = len > MESH_SYNC_RESPONSE_HEADER - 1U;
+    if (has_tx) {
+        if (!ledger_tx_decode(body + MESH_SYNC_RESPONSE_HEADER - 1U,
+                              (uint16_t)(len - (MESH_SYNC_RESPONSE_HEADER - 1U)), &tx)) {
+            return; // malformed; ignore
+        }
 
-        out.type        = MESH_MSG_LEDGER_SUMMARY;
-        out.src_id      = self_device_id;
-        out.dest_id     = pkt->src_id;
-        out.payload_len = sizeof(summary);
+        // Import into local ledger
+        (void)ledger_apply_tx(&tx);
+    }
 
-        memcpy(out.payload, &summary, sizeof(summary));
-        radio_send_packet(&out);
+    // Update sync slot
+    mesh_pending_sync_t *slot = mesh_sync_find_slot(src);
+    if (!slot) {
+        // We didn't know we were syncing with this peer, but that's fine.
+        return;
+    }
+
+    slot->bytes_received += len;
+
+    // Responses echo from_lamport, which identifies the window entry.
+    // A late answer to a range we already gave up on matches nothing.
+    mesh_sync_window_entry_t *entry = NULL;
+    for (uint32_t i = 0; i < MESH_SYNC_WINDOW; ++i) {
+        if (slot->window[i].in_flight &&
+            slot->window[i].from_lamport == from_lamport) {
+            entry = &slot->window[i];
+            break;
+        }
     }
-    else if (pkt->type == MESH_MSG_LEDGER_SUMMARY) {
-        if (pkt->payload_len != sizeof(mesh_ledger_summary_t)) {
+
+    if (entry) {
+        if (has_tx) {
+            entry->received++;
+            if (tx.lamport > entry->highest_lamport) {
+                entry->highest_lamport = tx.lamport;
+            }
+        }
+
+        // The rest of this response is still on its way. If a record in
+        // it is lost, the bucket still mismatches and the next summary
+        // round fetches it; if the last one is lost, the timeout does.
+        if (count > 0 && seq + 1U < count) {
+            return;
+        }
+
+        uint32_t highest_lamport = (entry->received > 0)
+                                   ? entry->highest_lamport
+                                   : entry->to_lamport;
+
+        // A full batch means the peer stopped early; re-request the rest
+        // of this sub-range. Lamport values are not unique, so resume AT
+        // the highest one received: its siblings may not have fit. What
+        // we just imported is in the next have-filter and is skipped.
+        // A batch that did not move the start counts as a retry, so a
+        // peer that keeps resending the same records cannot pin us.
+        bool more = count >= MESH_MAX_TX_REQUEST_BATCH &&
+                    highest_lamport <= entry->to_lamport;
+
+        if (more && highest_lamport > entry->from_lamport) {
+            entry->attempts = 0;
+        } else if (more && entry->attempts >= MESH_SYNC_MAX_RETRIES) {
+            sync_stats.ranges_abandoned++;
+            more = false;
+        } else if (more) {
+            entry->attempts++;
+        }
+
+        if (more) {
+            entry->from_lamport = highest_lamport;
+            mesh_sync_send_tx_range_request(slot, entry);
             return;
         }
 
-        mesh_ledger_summary_t remote;
-        memcpy(&remote, pkt->payload, sizeof(remote));
-        mesh_sync_consider_peer_summary(pkt->src_id, &remote);
+        entry->in_flight = false;
     }
+
+    // Keep the window full; releases the slot once everything is fetched.
+    mesh_sync_fill_window(slot);
 }
 
 // -----------------------------------------------------------------------------
-// Internal helpers - range request / response
+// Internal helpers - request window
 // -----------------------------------------------------------------------------
 
 /**
- * Peer asks us: "give me up to max_count transactions with Lamport >= from_lamport".
+ * Produce the next sub-range to request from this peer. Each mismatched
+ * bucket is cut into MESH_SYNC_WINDOW pieces, clipped to the peer's
+ * highest Lamport, so even a single bad bucket is fetched in parallel.
  */
-static void mesh_sync_handle_tx_range_request(const mesh_packet_t *pkt)
+static bool mesh_sync_next_range(mesh_pending_sync_t *slot,
+                                 uint32_t *from,
+                                 uint32_t *to)
 {
-    if (!pkt) return;
-    if (pkt->payload_len != sizeof(mesh_tx_range_request_t)) {
-        return;
+    while (!slot->fill_active) {
+        uint32_t i;
+        for (i = 0; i < MESH_SYNC_RANGE_BUCKETS; ++i) {
+            if (slot->pending_buckets & (1U << i)) {
+                break;
+            }
+        }
+        if (i == MESH_SYNC_RANGE_BUCKETS) {
+            return false;
+        }
+        slot->pending_buckets &= (uint8_t)~(1U << i);
+
+        uint32_t start = i << slot->bucket_shift;
+        uint32_t end   = (i == MESH_SYNC_RANGE_BUCKETS - 1U)
+                         ? UINT32_MAX
+                         : (((i + 1U) << slot->bucket_shift) - 1U);
+
+        if (start > slot->peer_last_lamport) {
+            continue;   // only we hold data here; the peer pulls it from us
+        }
+        if (end > slot->peer_last_lamport) {
+            end = slot->peer_last_lamport;
+        }
+
+        slot->fill_cursor = start;
+        slot->fill_end    = end;
+        slot->fill_chunk  = (end - start) / MESH_SYNC_WINDOW + 1U;
+        slot->fill_active = true;
+    }
+
+    *from = slot->fill_cursor;
+
+    if (slot->fill_end - slot->fill_cursor < slot->fill_chunk) {
+        *to = slot->fill_end;
+    } else {
+        *to = slot->fill_cursor + slot->fill_chunk - 1U;
     }
 
-    mesh_tx_range_request_t req;
-    memcpy(&req, pkt->payload, sizeof(req));
+    // Keep our side of the have-filter small enough to stay accurate
+    uint32_t cut = mesh_sync_filter_cut(*from, *to);
+    if (cut != *from) {
+        *to = cut - 1U;
+    }
 
-    // Ask ledger_manager for a compact batch of transactions
-    mesh_tx_range_response_t resp;
-    memset(&resp, 0, sizeof(resp));
+    if (*to == slot->fill_end) {
+        slot->fill_active = false;
+    } else {
+        slot->fill_cursor = *to + 1U;
+    }
+    return true;
+}
 
-    resp.from_lamport = req.from_lamport;
-    resp.tx_count     = ledger_get_tx_batch(req.from_lamport,
-                                            req.max_count,
-                                            resp.txs,
-                                            MESH_MAX_TX_IN_RESPONSE);
+/**
+ * Top the peer's window up to MESH_SYNC_WINDOW outstanding requests.
+ * When nothing is in flight and nothing is left to ask for, the sync
+ * is complete.
+ */
+static void mesh_sync_fill_window(mesh_pending_sync_t *slot)
+{
+    bool busy = false;
 
-    mesh_packet_t out;
-    memset(&out, 0, sizeof(out));
+    for (uint32_t i = 0; i < MESH_SYNC_WINDOW; ++i) {
+        mesh_sync_window_entry_t *entry = &slot->window[i];
 
-    out.type        = MESH_MSG_TX_RANGE_RESPONSE;
-    out.src_id      = self_device_id;
-    out.dest_id     = pkt->src_id;
-    out.payload_len = sizeof(resp.from_lamport) +
-                      sizeof(resp.tx_count) +
-                      resp.tx_count * sizeof(mesh_tx_summary_t);
+        if (!entry->in_flight) {
+            uint32_t from = 0;
+            uint32_t to   = 0;
 
-    memcpy(out.payload, &resp, out.payload_len);
+            if (!mesh_sync_next_range(slot, &from, &to)) {
+                continue;
+            }
 
-    radio_send_packet(&out);
+            entry->from_lamport = from;
+            entry->to_lamport   = to;
+            entry->attempts     = 0;
+            mesh_sync_send_tx_range_request(slot, entry);
+        }
+        busy = true;
+    }
+
+    if (!busy) {
+        mesh_sync_finish_slot(slot);
+    }
 }
 
 /**
- * Peer has sent us a batch of transactions for the requested Lamport range.
+ * Re-request any range whose deadline passed. After MESH_SYNC_MAX_RETRIES
+ * the range is dropped; its bucket still mismatches, so the next summary
+ * exchange picks it up again.
  */
-static void mesh_sync_handle_tx_range_response(const mesh_packet_t *pkt)
+static void mesh_sync_check_timeouts(uint32_t now)
 {
-    if (!pkt) return;
-    if (pkt->payload_len < (sizeof(uint32_t) * 2)) {
-        return; // too small
+    for (uint32_t s = 0; s < MESH_MAX_PENDING_SYNC; ++s) {
+        mesh_pending_sync_t *slot = &pending_sync[s];
+        if (!slot->in_use) {
+            continue;
+        }
+
+        bool dropped = false;
+
+        for (uint32_t i = 0; i < MESH_SYNC_WINDOW; ++i) {
+            mesh_sync_window_entry_t *entry = &slot->window[i];
+
+            if (!entry->in_flight || (int32_t)(now - entry->deadline_ms) < 0) {
+                continue;
+            }
+
+            if (entry->attempts >= MESH_SYNC_MAX_RETRIES) {
+                entry->in_flight = false;
+                sync_stats.ranges_abandoned++;
+                dropped = true;
+                continue;
+            }
+
+            entry->attempts++;
+            sync_stats.retries++;
+            mesh_sync_send_tx_range_request(slot, entry);
+        }
+
+        if (dropped) {
+            mesh_sync_fill_window(slot);
+        }
     }
+}
 
-    mesh_tx_range_response_t resp;
-    memset(&resp, 0, sizeof(resp));
+// -----------------------------------------------------------------------------
+// Internal helpers - set reconciliation
+// -----------------------------------------------------------------------------
 
-    // We trust mesh_protocol to define resp packing, but for clarity:
-    memcpy(&resp.from_lamport, pkt->payload, sizeof(uint32_t));
-    memcpy(&resp.tx_count,
-           pkt->payload + sizeof(uint32_t),
-           sizeof(uint32_t));
+typedef void (*mesh_sync_tx_visitor_t)(const ledger_tx_t *tx, void *ctx);
 
-    if (resp.tx_count > MESH_MAX_TX_IN_RESPONSE) {
-        resp.tx_count = MESH_MAX_TX_IN_RESPONSE; // safety clamp
+// FNV-1a over the transaction ID; the unit both range hashes and filters use.
+static uint32_t mesh_sync_tx_hash(const ledger_tx_t *tx)
+{
+    const uint8_t *p = (const uint8_t *)tx->tx_id;
+    uint32_t h = 2166136261u;
+
+    for (size_t i = 0; i < sizeof(tx->tx_id); ++i) {
+        h ^= p[i];
+        h *= 16777619u;
     }
+    return h;
+}
 
-    size_t tx_bytes = resp.tx_count * sizeof(mesh_tx_summary_t);
-    if (pkt->payload_len < (sizeof(uint32_t) * 2 + tx_bytes)) {
-        // malformed; ignore
-        return;
+/**
+ * Walk our ledger's transactions with Lamport in [from, to], in ledger
+ * order, a page at a time via ledger_get_tx_batch(). Pages resume at the
+ * last Lamport seen and skip the entries already visited, so a run of
+ * equal Lamport values split across pages is neither lost nor repeated.
+ */
+static void mesh_sync_for_each_local_tx(uint32_t from,
+                                        uint32_t to,
+                                        mesh_sync_tx_visitor_t visit,
+                                        void *ctx)
+{
+    ledger_tx_t page[MESH_SYNC_PAGE_TXS];
+    uint32_t cursor = from;
+    uint32_t skip   = 0;   // entries at `cursor` already visited
+
+    for (;;) {
+        uint32_t n = ledger_get_tx_batch(cursor,
+                                         MESH_SYNC_PAGE_TXS,
+                                         page,
+                                         MESH_SYNC_PAGE_TXS);
+        if (n <= skip) {
+            return;
+        }
+
+        for (uint32_t i = skip; i < n; ++i) {
+            if (page[i].lamport > to) {
+                return;
+            }
+            visit(&page[i], ctx);
+        }
+
+        uint32_t last = page[n - 1].lamport;
+        uint32_t same = 0;
+        while (same < n && page[n - 1 - same].lamport == last) {
+            same++;
+        }
+
+        if (same == n && last == cursor) {
+            skip += n;       // whole page was one Lamport value
+        } else {
+            skip = same;
+        }
+        cursor = last;
     }
+}
+
+static uint8_t mesh_sync_shift_for(uint32_t last_lamport)
+{
+    uint8_t shift = 0;
+    while ((last_lamport >> shift) >= MESH_SYNC_RANGE_BUCKETS) {
+        shift++;
+    }
+    return shift;
+}
 
-    memcpy(resp.txs,
-           pkt->payload + sizeof(uint32_t) * 2,
-           tx_bytes);
+static void mesh_sync_hash_visitor(const ledger_tx_t *tx, void *ctx)
+{
+    mesh_recon_cache_t *c = (mesh_recon_cache_t *)ctx;
+    uint32_t bucket = tx->lamport >> c->fine_shift;
+    uint32_t h = mesh_sync_tx_hash(tx);
 
-    // Import into local ledger
-    for (uint32_t i = 0; i < resp.tx_count; ++i) {
-        ledger_import_tx_summary(&resp.txs[i]);
+    if (bucket >= MESH_SYNC_FINE_BUCKETS) {
+        bucket = MESH_SYNC_FINE_BUCKETS - 1U;
     }
 
-    // Update sync slot
-    mesh_pending_sync_t *slot = mesh_sync_find_slot(pkt->src_id);
-    if (!slot) {
-        // We didn't know we were syncing with this peer, but that's fine.
-        return;
+    c->fine_hash[bucket] ^= h;
+    c->ledger_hash       ^= h;
+}
+
+/**
+ * Our range hashes under the given bucket layout, folded from the fine
+ * buckets of recon_cache. A layout finer than the cache's (a peer far
+ * behind us) is hashed from the ledger into scratch instead, uncached.
+ */
+static void mesh_sync_range_hashes(uint8_t bucket_shift, mesh_range_hashes_t *out)
+{
+    mesh_recon_cache_t  scratch;
+    mesh_recon_cache_t *c = &recon_cache;
+    uint32_t last_lamport = 0;
+    uint32_t tx_count     = 0;
+    ledger_get_summary(&last_lamport, &tx_count);
+
+    uint8_t fine_shift = mesh_sync_shift_for(
+        last_lamport / (MESH_SYNC_FINE_BUCKETS / MESH_SYNC_RANGE_BUCKETS));
+    if (bucket_shift < fine_shift) {
+        c          = &scratch;
+        fine_shift = bucket_shift;
     }
 
-    if (resp.tx_count == 0) {
-        // No more txs in this range; sync is probably done.
-        slot->in_use = false;
-        return;
+    if (c != &recon_cache ||
+        !recon_cache.valid ||
+        recon_cache.tx_count     != tx_count ||
+        recon_cache.last_lamport != last_lamport) {
+        memset(c, 0, sizeof(*c));
+        c->fine_shift   = fine_shift;
+        c->tx_count     = tx_count;
+        c->last_lamport = last_lamport;
+
+        mesh_sync_for_each_local_tx(0, UINT32_MAX, mesh_sync_hash_visitor, c);
+        c->valid = true;
     }
 
-    // Advance expected lamport and request next batch if needed.
-    uint32_t highest_lamport = resp.txs[resp.tx_count - 1].lamport;
+    memset(out, 0, sizeof(*out));
+    out->bucket_shift = bucket_shift;
+    out->tx_count     = c->tx_count;
+    out->last_lamport = c->last_lamport;
+    out->ledger_hash  = c->ledger_hash;
+
+    for (uint32_t i = 0; i < MESH_SYNC_FINE_BUCKETS; ++i) {
+        uint32_t bucket = i >> (bucket_shift - c->fine_shift);
 
-    mesh_ledger_summary_t local;
-    ledger_get_summary(&local.last_lamport,
-                       &local.tx_count,
-                       &local.ledger_hash);
+        if (bucket >= MESH_SYNC_RANGE_BUCKETS) {
+            bucket = MESH_SYNC_RANGE_BUCKETS - 1U;
+        }
+        out->range_hash[bucket] ^= c->fine_hash[i];
+    }
+}
 
-    if (highest_lamport < local.last_lamport) {
-        // There might be more we don't have; ask again.
-        slot->next_expected_lamport = highest_lamport + 1;
-        slot->last_request_time_ms  = timekeeping_millis();
+static void mesh_sync_build_summary(mesh_ledger_summary_t *out)
+{
+    uint32_t last_lamport = 0;
+    uint32_t tx_count     = 0;
+    ledger_get_summary(&last_lamport, &tx_count);
+
+    mesh_range_hashes_t hashes;
+    mesh_sync_range_hashes(mesh_sync_shift_for(last_lamport), &hashes);
+
+    memset(out, 0, sizeof(*out));
+    out->last_lamport = hashes.last_lamport;
+    out->tx_count     = hashes.tx_count;
+    out->ledger_hash  = hashes.ledger_hash;
+    out->bucket_shift = hashes.bucket_shift;
+    out->version      = MESH_SYNC_SUMMARY_VERSION;
+    memcpy(out->range_hash, hashes.range_hash, sizeof(out->range_hash));
+}
 
-        mesh_sync_send_tx_range_request(pkt->src_id,
-                                        slot->next_expected_lamport,
-                                        MESH_MAX_TX_REQUEST_BATCH);
-    } else {
-        // We are fully caught up with this peer.
-        slot->in_use = false;
+/**
+ * Bloom filter bit positions by double hashing, salted with the
+ * request's seed so a false positive in one round is unlikely to
+ * repeat in the next.
+ */
+static void mesh_sync_filter_positions(uint32_t h,
+                                       uint32_t seed,
+                                       uint32_t pos[MESH_SYNC_FILTER_HASHES])
+{
+    const uint32_t bits = MESH_SYNC_FILTER_BYTES * 8U;
+    uint32_t h1 = h ^ seed;
+    uint32_t h2 = ((h >> 16) | (h << 16)) * 0x9E3779B1u | 1u;
+
+    for (uint32_t k = 0; k < MESH_SYNC_FILTER_HASHES; ++k) {
+        pos[k] = (h1 + k * h2) % bits;
+    }
+}
+
+static void mesh_sync_filter_add_visitor(const ledger_tx_t *tx, void *ctx)
+{
+    mesh_recon_request_t *req = (mesh_recon_request_t *)ctx;
+    uint32_t pos[MESH_SYNC_FILTER_HASHES];
+
+    mesh_sync_filter_positions(mesh_sync_tx_hash(tx), req->filter_seed, pos);
+    for (uint32_t k = 0; k < MESH_SYNC_FILTER_HASHES; ++k) {
+        req->have_filter[pos[k] >> 3] |= (uint8_t)(1U << (pos[k] & 7U));
+    }
+}
+
+static bool mesh_sync_filter_contains(const mesh_recon_request_t *req,
+                                      const ledger_tx_t *tx)
+{
+    uint32_t pos[MESH_SYNC_FILTER_HASHES];
+
+    mesh_sync_filter_positions(mesh_sync_tx_hash(tx), req->filter_seed, pos);
+    for (uint32_t k = 0; k < MESH_SYNC_FILTER_HASHES; ++k) {
+        if (!(req->have_filter[pos[k] >> 3] & (1U << (pos[k] & 7U)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void mesh_sync_build_have_filter(mesh_recon_request_t *req)
+{
+    memset(req->have_filter, 0, sizeof(req->have_filter));
+    mesh_sync_for_each_local_tx(req->from_lamport,
+                                req->to_lamport,
+                                mesh_sync_filter_add_visitor,
+                                req);
+}
+
+typedef struct {
+    uint32_t seen;
+    uint32_t cut;
+} mesh_sync_cut_ctx_t;
+
+static void mesh_sync_cut_visitor(const ledger_tx_t *tx, void *ctx)
+{
+    mesh_sync_cut_ctx_t *c = (mesh_sync_cut_ctx_t *)ctx;
+
+    if (++c->seen == MESH_SYNC_FILTER_MAX_TXS + 1U) {
+        c->cut = tx->lamport;
+    }
+}
+
+/**
+ * Where a request for [from, to] has to stop for its have-filter to hold
+ * at most MESH_SYNC_FILTER_MAX_TXS of our transactions: the Lamport of
+ * the first one past that, so the request covers [from, cut - 1]. Returns
+ * `from` when no cut is needed, or none is possible because the excess
+ * all shares Lamport `from`.
+ */
+static uint32_t mesh_sync_filter_cut(uint32_t from, uint32_t to)
+{
+    mesh_sync_cut_ctx_t ctx = { .seen = 0, .cut = from };
+
+    mesh_sync_for_each_local_tx(from, to, mesh_sync_cut_visitor, &ctx);
+    return ctx.cut;
+}
+
+typedef struct {
+    const mesh_recon_request_t *req;
+    ledger_tx_t          *out;
+    uint32_t                    max_out;
+    uint32_t                    count;
+    uint8_t                     scratch[LEDGER_RECORD_MAX_BYTES];
+} mesh_sync_collect_ctx_t;
+
+static void mesh_sync_collect_visitor(const ledger_tx_t *tx, void *ctx)
+{
+    mesh_sync_collect_ctx_t *c = (mesh_sync_collect_ctx_t *)ctx;
+
+    if (c->count >= c->max_out) {
+        return;
+    }
+    if (mesh_sync_filter_contains(c->req, tx)) {
+        return; // requester already has it (or a rare false positive)
     }
+    if (ledger_tx_encode(tx, c->scratch) >
+        MESH_SYNC_MAX_PAYLOAD - MESH_SYNC_RESPONSE_HEADER) {
+        return; // does not fit one response message
+    }
+    c->out[c->count++] = *tx;
+}
+
+/**
+ * Our transactions in the requested range that the requester lacks,
+ * in ledger order, up to the smaller of max_count and max_out.
+ */
+static uint32_t mesh_sync_collect_missing(const mesh_recon_request_t *req,
+                                          ledger_tx_t *out,
+                                          uint32_t max_out)
+{
+    mesh_sync_collect_ctx_t ctx = {
+        .req     = req,
+        .out     = out,
+        .max_out = (req->max_count < max_out) ? req->max_count : max_out,
+        .count   = 0
+    };
+
+    mesh_sync_for_each_local_tx(req->from_lamport,
+                                req->to_lamport,
+                                mesh_sync_collect_visitor,
+                                &ctx);
+    return ctx.count;
 }
 
 // -----------------------------------------------------------------------------
 // Internal helpers - pending sync slots
 // -----------------------------------------------------------------------------
 
-static mesh_pending_sync_t *mesh_sync_get_or_alloc_slot(uint32_t neighbor_id)
+static mesh_pending_sync_t *mesh_sync_get_or_alloc_slot(mesh_address_t neighbor_id)
 {
     mesh_pending_sync_t *free_slot = NULL;
 
@@ -474,14 +1078,19 @@ static mesh_pending_sync_t *mesh_sync_get_or_alloc_slot(uint32_t neighbor_id)
     if (free_slot) {
         free_slot->in_use   = true;
         free_slot->neighbor_id = neighbor_id;
-        free_slot->last_request_time_ms = 0;
-        free_slot->next_expected_lamport = 0;
+        free_slot->start_time_ms = 0;
+        free_slot->bytes_received = 0;
+        free_slot->peer_last_lamport = 0;
+        free_slot->fill_active = false;
+        free_slot->bucket_shift = 0;
+        free_slot->pending_buckets = 0;
+        memset(free_slot->window, 0, sizeof(free_slot->window));
     }
 
     return free_slot;
 }
 
-static mesh_pending_sync_t *mesh_sync_find_slot(uint32_t neighbor_id)
+static mesh_pending_sync_t *mesh_sync_find_slot(mesh_address_t neighbor_id)
 {
     for (uint32_t i = 0; i < MESH_MAX_PENDING_SYNC; ++i) {
         if (pending_sync[i].in_use &&
@@ -491,3 +1100,21 @@ static mesh_pending_sync_t *mesh_sync_find_slot(uint32_t neighbor_id)
     }
     return NULL;
 }
+
+/**
+ * Record completion time and throughput, then release the slot.
+ */
+static void mesh_sync_finish_slot(mesh_pending_sync_t *slot)
+{
+    uint32_t elapsed_ms = time_now_ms() - slot->start_time_ms;
+
+    sync_stats.syncs_completed++;
+    sync_stats.last_sync_ms    = elapsed_ms;
+    sync_stats.last_sync_bytes = slot->bytes_received;
+    sync_stats.last_bytes_per_sec =
+        (elapsed_ms > 0)
+            ? (uint32_t)(((uint64_t)slot->bytes_received * 1000U) / elapsed_ms)
+            : slot->bytes_received;
+
+    slot->in_use = false;
+}
@@ -4,9 +4,18 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+typedef struct {
+    uint32_t requests_sent;        // range requests, including re-requests
+    uint32_t retries;              // re-requests after a timeout
+    uint32_t ranges_abandoned;     // ranges dropped after the last retry
+    uint32_t syncs_completed;
+    uint32_t last_sync_ms;         // first request to last range fetched
+    uint32_t last_sync_bytes;      // range-response payload bytes received
+    uint32_t last_bytes_per_sec;
+} mesh_sync_stats_t;
+
 void mesh_sync_init(void);
-void mesh_sync_push_ledger_delta(void);
-void mesh_sync_receive_packet(const uint8_t *data, uint16_t len);
-void mesh_sync_tick(void);
+uint32_t mesh_sync_tick(uint32_t now_ms);   // ms until the next call is due
+void mesh_sync_get_stats(mesh_sync_stats_t *out);
 
 #endif
@@ -16,6 +16,23 @@
  *     - A controlled transmission queue prevents message loss and ensures fairness
  *       between message types.
  *
+ * Scheduling:
+ *     - Every packet belongs to a traffic class (see TxClass).
+ *     - Money transfers are strict priority: they always go first.
+ *     - The remaining classes share airtime by weighted round-robin, so a
+ *       sync burst cannot starve heartbeats and vice versa.
+ *     - Slots come from a free list and ready packets sit in per-class
+ *       rings, so enqueue and dequeue are O(1). Packets waiting for a
+ *       retry sit in a min-heap ordered by retry time.
+ *     - When the queue is full, lower-priority traffic is evicted to make
+ *       room for higher-priority traffic.
+ *     - Relayed frames are queued as the received pool buffer itself
+ *       (packet_pool.c); the queue holds a reference until it is done.
+ *     - Sends are gated by the channel's duty-cycle budget (radio_airtime.c).
+ *       Once the budget runs low, heartbeats are held back so the remaining
+ *       airtime goes to ledger data, and a queued heartbeat is replaced by a
+ *       newer one instead of both going on air.
+ *
  * Investor-friendly explanation:
  *     This file demonstrates that Seed has a real, structured firmware layer for
  *     store-and-forward mesh networking — a critical differentiator for an offline
@@ -24,107 +41,496 @@
  */
 
 #include "mesh_tx_queue.h"
+#include "mesh_protocol.h"
 #include "radio_interface.h"
+#include "radio_airtime.h"
 #include "timekeeping.h"
 #include "safe_memory.h"
+#include "packet_pool.h"
+#include "mesh_gossip.h"
+
+#include <string.h>
 
 #define MAX_TX_QUEUE_SIZE     32        // Configurable depending on RAM budget
 #define RETRY_BACKOFF_MS      5000      // 5-second retry interval (adaptive in future)
 #define MAX_RETRY_COUNT       5         // After 5 failures, packet is discarded
 
+#define TX_SLOT_NONE          0xFF
+
+// Below this share of the hourly airtime budget, heartbeats are deferred
+#define HEARTBEAT_RESERVE_PERCENT   25
+
+// How soon to look again when packets are waiting on the airtime budget
+#define TX_AIRTIME_RECHECK_MS       1000
+
+// Pool buffers the queue may hold; the rest of PACKET_POOL_HELD is for
+// relays in gossip backoff, and the RX ring keeps its own
+#define TX_QUEUE_MAX_BUFS           (PACKET_POOL_HELD - MESH_GOSSIP_PENDING)
+
+#if PACKET_POOL_HELD <= MESH_GOSSIP_PENDING
+#error "PACKET_POOL_HELD leaves no pool buffers for the TX queue"
+#endif
+
+/**
+ * Weighted round-robin shares for the non-strict classes, in packets per
+ * round. TX_CLASS_TRANSACTION is strict priority and has no weight.
+ */
+static const uint8_t class_weight[TX_CLASS_COUNT] = {
+    0,  // TX_CLASS_TRANSACTION (strict)
+    4,  // TX_CLASS_SYNC
+    2,  // TX_CLASS_GROUP_SAVINGS
+    2,  // TX_CLASS_TRUST
+    1   // TX_CLASS_HEARTBEAT
+};
+
 /**
  * Data structure for an outgoing packet.
  * Each packet includes:
- *   - Serialized payload
- *   - Packet type (transaction, sync, heartbeat…)
+ *   - A copy of a frame this node originated, or a pool buffer
+ *     holding a frame being relayed
+ *   - Traffic class
  *   - Retry counter
  *   - Timestamp for next retry
+ *   - Free-list link / heap position
  */
 typedef struct {
-    MeshPacket packet;
+    uint8_t    frame[MAX_PACKET_SIZE];  // own frame, copied at enqueue
+    uint8_t    frame_len;
+    packet_buf_t *buf;                  // zero-copy frame instead of frame[]
+    uint8_t    radio_type;              // frame type byte
+    uint8_t    cls;
     uint8_t    retry_count;
+    uint8_t    next_free;               // free-list link while unused
+    uint8_t    heap_pos;                // index in retry heap, TX_SLOT_NONE if ready
     uint32_t   next_retry_timestamp;
+    uint32_t   enqueue_timestamp;
     bool       in_use;
 } TxQueueSlot;
 
+/**
+ * Ring of slot indices for one class. Capacity equals the pool, so a
+ * ring can never overflow on its own.
+ */
+typedef struct {
+    uint8_t idx[MAX_TX_QUEUE_SIZE];
+    uint8_t head;
+    uint8_t count;
+} TxClassRing;
+
 /**
  * The transmission queue itself.
  */
-static TxQueueSlot tx_queue[MAX_TX_QUEUE_SIZE];
+static TxQueueSlot  tx_queue[MAX_TX_QUEUE_SIZE];
+static uint8_t      free_head;
+static uint8_t      used_count;
+static uint8_t      buf_count;                      // slots holding a pool buffer
+
+static TxClassRing  ready_ring[TX_CLASS_COUNT];
+static uint8_t      class_total[TX_CLASS_COUNT];   // ready + waiting for retry
+static uint8_t      class_credit[TX_CLASS_COUNT];
+
+static uint8_t      retry_heap[MAX_TX_QUEUE_SIZE];  // slot indices, min by retry time
+static uint8_t      retry_heap_len;
+
+static TxClassStats class_stats[TX_CLASS_COUNT];
+
+static mesh_tx_notify_t enqueue_notify = NULL;
+
+/* ---------------- Free list ---------------- */
+
+static uint8_t slot_alloc() {
+    uint8_t i = free_head;
+    if (i != TX_SLOT_NONE) {
+        free_head = tx_queue[i].next_free;
+        used_count++;
+    }
+    return i;
+}
+
+static void slot_free(uint8_t i) {
+    if (tx_queue[i].buf != NULL) {
+        packet_buf_release(tx_queue[i].buf);
+        tx_queue[i].buf = NULL;
+        buf_count--;
+    }
+    class_total[tx_queue[i].cls]--;
+    tx_queue[i].in_use = false;
+    tx_queue[i].next_free = free_head;
+    free_head = i;
+    used_count--;
+}
+
+/* ---------------- Per-class rings ---------------- */
+
+static void ring_push(TxClassRing *r, uint8_t i) {
+    r->idx[(r->head + r->count) % MAX_TX_QUEUE_SIZE] = i;
+    r->count++;
+}
+
+static uint8_t ring_peek(const TxClassRing *r) {
+    return r->idx[r->head];
+}
+
+static uint8_t ring_newest(const TxClassRing *r) {
+    return r->idx[(r->head + r->count - 1) % MAX_TX_QUEUE_SIZE];
+}
+
+static uint8_t ring_pop(TxClassRing *r) {
+    uint8_t i = r->idx[r->head];
+    r->head = (r->head + 1) % MAX_TX_QUEUE_SIZE;
+    r->count--;
+    return i;
+}
+
+/* ---------------- Retry min-heap ---------------- */
+
+static bool retry_before(uint8_t a, uint8_t b) {
+    // Wrap-safe comparison of millisecond timestamps
+    return (int32_t)(tx_queue[a].next_retry_timestamp -
+                     tx_queue[b].next_retry_timestamp) < 0;
+}
+
+static void heap_set(uint8_t pos, uint8_t i) {
+    retry_heap[pos] = i;
+    tx_queue[i].heap_pos = pos;
+}
+
+static void heap_sift_up(uint8_t pos) {
+    uint8_t i = retry_heap[pos];
+    while (pos > 0) {
+        uint8_t parent = (pos - 1) / 2;
+        if (!retry_before(i, retry_heap[parent]))
+            break;
+        heap_set(pos, retry_heap[parent]);
+        pos = parent;
+    }
+    heap_set(pos, i);
+}
+
+static void heap_sift_down(uint8_t pos) {
+    uint8_t i = retry_heap[pos];
+    for (;;) {
+        uint8_t child = 2 * pos + 1;
+        if (child >= retry_heap_len)
+            break;
+        if (child + 1 < retry_heap_len && retry_before(retry_heap[child + 1], retry_heap[child]))
+            child++;
+        if (!retry_before(retry_heap[child], i))
+            break;
+        heap_set(pos, retry_heap[child]);
+        pos = child;
+    }
+    heap_set(pos, i);
+}
+
+static void heap_push(uint8_t i) {
+    heap_set(retry_heap_len, i);
+    retry_heap_len++;
+    heap_sift_up(tx_queue[i].heap_pos);
+}
+
+static void heap_remove(uint8_t pos) {
+    uint8_t removed = retry_heap[pos];
+    retry_heap_len--;
+
+    if (pos < retry_heap_len) {
+        uint8_t moved = retry_heap[retry_heap_len];
+        heap_set(pos, moved);
+        heap_sift_up(pos);
+        heap_sift_down(tx_queue[moved].heap_pos);
+    }
+    tx_queue[removed].heap_pos = TX_SLOT_NONE;
+}
+
+/* ---------------- Scheduling ---------------- */
+
+/**
+ * Make room for a packet of class `cls` by dropping the oldest packet of
+ * the lowest-priority class below it. Returns false if everything queued
+ * is at least as important.
+ */
+static bool evict_lower_than(TxClass cls) {
+    for (int c = TX_CLASS_COUNT - 1; c > (int)cls; c--) {
+        if (class_total[c] == 0)
+            continue;
+
+        uint8_t victim = TX_SLOT_NONE;
+
+        if (ready_ring[c].count > 0) {
+            victim = ring_pop(&ready_ring[c]);
+        } else {
+            // Only retrying packets left in this class
+            for (uint8_t h = 0; h < retry_heap_len; h++) {
+                if (tx_queue[retry_heap[h]].cls == c) {
+                    victim = retry_heap[h];
+                    heap_remove(h);
+                    break;
+                }
+            }
+        }
+
+        if (victim == TX_SLOT_NONE)
+            continue;
+
+        class_stats[c].dropped_evicted++;
+        slot_free(victim);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Move packets whose retry time has arrived back into their class ring.
+ */
+static void promote_due_retries(uint32_t now) {
+    while (retry_heap_len > 0) {
+        uint8_t i = retry_heap[0];
+        if ((int32_t)(now - tx_queue[i].next_retry_timestamp) < 0)
+            break;
+        heap_remove(0);
+        ring_push(&ready_ring[tx_queue[i].cls], i);
+    }
+}
+
+/**
+ * On-air size of a queued packet as radio_interface will frame it.
+ */
+static uint16_t packet_air_len(const TxQueueSlot *slot) {
+    uint16_t len = slot->buf ? slot->buf->len : slot->frame_len;
+    return (uint16_t)(len + RADIO_FRAME_OVERHEAD);
+}
+
+/**
+ * Pick the next class to transmit from: transactions strictly first,
+ * then weighted round-robin over the rest in priority order. Heartbeats
+ * are skipped while the airtime budget is low.
+ */
+static int pick_class(bool hold_heartbeats) {
+    if (ready_ring[TX_CLASS_TRANSACTION].count > 0)
+        return TX_CLASS_TRANSACTION;
+
+    for (int pass = 0; pass < 2; pass++) {
+        for (int c = TX_CLASS_TRANSACTION + 1; c < TX_CLASS_COUNT; c++) {
+            if (hold_heartbeats && c == TX_CLASS_HEARTBEAT)
+                continue;
+            if (ready_ring[c].count > 0 && class_credit[c] > 0) {
+                class_credit[c]--;
+                return c;
+            }
+        }
+
+        // Every backlogged class used its share: start a new round
+        for (int c = 0; c < TX_CLASS_COUNT; c++)
+            class_credit[c] = class_weight[c];
+    }
+    return -1;
+}
 
 /**
  * Initialize empty queue.
  */
 void mesh_tx_queue_init() {
-    SAFE_MEMSET(tx_queue, 0, sizeof(tx_queue));
+    memset(tx_queue, 0, sizeof(tx_queue));
+    memset(ready_ring, 0, sizeof(ready_ring));
+    memset(class_total, 0, sizeof(class_total));
+    memset(class_stats, 0, sizeof(class_stats));
+
+    for (uint8_t i = 0; i < MAX_TX_QUEUE_SIZE; i++) {
+        tx_queue[i].next_free = (i + 1 < MAX_TX_QUEUE_SIZE) ? (uint8_t)(i + 1) : TX_SLOT_NONE;
+        tx_queue[i].heap_pos  = TX_SLOT_NONE;
+    }
+    free_head      = 0;
+    used_count     = 0;
+    buf_count      = 0;
+    retry_heap_len = 0;
+
+    for (int c = 0; c < TX_CLASS_COUNT; c++)
+        class_credit[c] = class_weight[c];
+}
+
+/**
+ * Claim a slot for a packet of class `cls` and put it on the ready ring,
+ * evicting lower-priority traffic if needed. TX_SLOT_NONE if full.
+ */
+static uint8_t enqueue_slot(TxClass cls) {
+    if (free_head == TX_SLOT_NONE && !evict_lower_than(cls)) {
+        class_stats[cls].dropped_full++;
+        return TX_SLOT_NONE;
+    }
+
+    uint8_t i = slot_alloc();
+    uint32_t now = time_now_ms();
+
+    tx_queue[i].buf = NULL;
+    tx_queue[i].cls = (uint8_t)cls;
+    tx_queue[i].retry_count = 0;
+    tx_queue[i].next_retry_timestamp = now;
+    tx_queue[i].enqueue_timestamp = now;
+    tx_queue[i].heap_pos = TX_SLOT_NONE;
+    tx_queue[i].in_use = true;
+
+    ring_push(&ready_ring[cls], i);
+    class_total[cls]++;
+    class_stats[cls].enqueued++;
+
+    if (enqueue_notify)
+        enqueue_notify();
+    return i;
 }
 
 /**
- * Attempt to push a packet into the queue.
+ * Attempt to push a frame this node originated into the queue. The
+ * frame is copied, so the caller's buffer is free again on return.
+ * The traffic class comes from the protocol layer (mesh_protocol.c).
  * Returns:
- *     true  — if successfully added
- *     false — if queue is full
- */
-bool mesh_tx_queue_push(MeshPacket *pkt) {
-    for (int i = 0; i < MAX_TX_QUEUE_SIZE; i++) {
-        if (!tx_queue[i].in_use) {
-            tx_queue[i].packet = *pkt;
-            tx_queue[i].retry_count = 0;
-            tx_queue[i].next_retry_timestamp = time_now_ms();
-            tx_queue[i].in_use = true;
-            return true;
-        }
+ *     true  — if successfully added (possibly by evicting lower-priority traffic)
+ *     false — if queue is full of equal or higher-priority packets
+ */
+bool mesh_tx_queue_push_frame(const uint8_t *frame, uint16_t len, uint8_t radio_type, TxClass cls) {
+    uint8_t i;
+
+    if (frame == NULL || len > MAX_PACKET_SIZE || cls >= TX_CLASS_COUNT)
+        return false;
+
+    // Only our latest heartbeat matters; replace a queued one in place
+    if (cls == TX_CLASS_HEARTBEAT && ready_ring[cls].count > 0 &&
+        tx_queue[ring_newest(&ready_ring[cls])].buf == NULL) {
+        i = ring_newest(&ready_ring[cls]);
+        class_stats[cls].superseded++;
+    } else {
+        i = enqueue_slot(cls);
+        if (i == TX_SLOT_NONE)
+            return false;
     }
-    // Queue full — in production firmware, optionally prioritize urgent message types.
-    return false;
+
+    memcpy(tx_queue[i].frame, frame, len);
+    tx_queue[i].frame_len  = (uint8_t)len;
+    tx_queue[i].radio_type = radio_type;
+    return true;
+}
+
+/**
+ * Queue a pool buffer as-is, e.g. a received frame being relayed. The
+ * queue takes its own reference and drops it once the frame is sent,
+ * evicted or given up on, so the caller keeps (and releases) its own.
+ */
+bool mesh_tx_queue_push_buf(packet_buf_t *buf, uint8_t radio_type, TxClass cls) {
+    if (buf == NULL || cls >= TX_CLASS_COUNT)
+        return false;
+
+    // Holding more would leave the RX ring short of buffers
+    if (buf_count >= TX_QUEUE_MAX_BUFS) {
+        class_stats[cls].dropped_full++;
+        return false;
+    }
+
+    uint8_t i = enqueue_slot(cls);
+    if (i == TX_SLOT_NONE)
+        return false;
+
+    packet_buf_retain(buf);
+    buf_count++;
+    tx_queue[i].buf = buf;
+    tx_queue[i].radio_type = radio_type;
+    return true;
+}
+
+/**
+ * Called whenever a packet is queued, so the caller can schedule
+ * mesh_tx_queue_process() instead of polling it.
+ */
+void mesh_tx_queue_set_notify(mesh_tx_notify_t fn) {
+    enqueue_notify = fn;
 }
 
 /**
  * Transmit all packets that are ready.
- * Called periodically by main loop.
+ * Returns how many ms until it is worth calling again: 0 if a retry is
+ * already due, UINT32_MAX if the queue is empty.
  */
-void mesh_tx_queue_process() {
+uint32_t mesh_tx_queue_process(void) {
     uint32_t now = time_now_ms();
 
-    for (int i = 0; i < MAX_TX_QUEUE_SIZE; i++) {
-        if (!tx_queue[i].in_use)
-            continue;
+    uint8_t channel = radio_get_channel();
 
-        // Not time to retry yet
-        if (now < tx_queue[i].next_retry_timestamp)
-            continue;
+    promote_due_retries(now);
+
+    for (;;) {
+        bool hold_heartbeats =
+            airtime_remaining_us(channel) <
+            (AIRTIME_HOURLY_BUDGET_US / 100UL) * HEARTBEAT_RESERVE_PERCENT;
+
+        int c = pick_class(hold_heartbeats);
+        if (c < 0)
+            break;
+
+        // Out of airtime for this packet: keep order and wait for refill
+        if (!airtime_can_send(channel, packet_air_len(&tx_queue[ring_peek(&ready_ring[c])]))) {
+            if (class_credit[c] < class_weight[c])
+                class_credit[c]++;
+            break;
+        }
+
+        uint8_t i = ring_pop(&ready_ring[c]);
+        bool sent = tx_queue[i].buf
+            ? radio_send_buf(tx_queue[i].radio_type, tx_queue[i].buf)
+            : radio_send(tx_queue[i].radio_type, tx_queue[i].frame, tx_queue[i].frame_len);
 
-        RadioStatus status = radio_send_packet(&tx_queue[i].packet);
+        if (sent) {
+            // Packet successfully transmitted — record latency and clear slot
+            uint32_t latency = now - tx_queue[i].enqueue_timestamp;
 
-        if (status == RADIO_OK) {
-            // Packet successfully transmitted — clear slot
-            tx_queue[i].in_use = false;
+            class_stats[c].sent++;
+            class_stats[c].total_latency_ms += latency;
+            if (latency > class_stats[c].max_latency_ms)
+                class_stats[c].max_latency_ms = latency;
+
+            slot_free(i);
         }
         else {
             // Transmission failure — retry with exponential backoff
             tx_queue[i].retry_count++;
 
             if (tx_queue[i].retry_count >= MAX_RETRY_COUNT) {
-                // Drop packet, but mark for analytics if needed
-                tx_queue[i].in_use = false;
+                // Drop packet, but count it for analytics
+                class_stats[c].dropped_retries++;
+                slot_free(i);
             }
             else {
                 // Schedule next attempt with exponential backoff
                 uint32_t delay = RETRY_BACKOFF_MS * (1 << tx_queue[i].retry_count);
                 tx_queue[i].next_retry_timestamp = now + delay;
+                heap_push(i);
             }
         }
     }
+
+    // Send whatever the protocol layer batched during this pass
+    (void)mesh_flush_pending();
+
+    // Still waiting in a ring: held back by the airtime budget
+    if (used_count > retry_heap_len)
+        return TX_AIRTIME_RECHECK_MS;
+
+    if (retry_heap_len > 0) {
+        int32_t wait = (int32_t)(tx_queue[retry_heap[0]].next_retry_timestamp - now);
+        return wait > 0 ? (uint32_t)wait : 0;
+    }
+    return UINT32_MAX;
 }
 
 /**
  * Returns the number of active messages waiting to be sent.
  */
 int mesh_tx_queue_size() {
-    int count = 0;
-    for (int i = 0; i < MAX_TX_QUEUE_SIZE; i++) {
-        if (tx_queue[i].in_use)
-            count++;
-    }
-    return count;
+    return used_count;
+}
+
+/**
+ * Per-class counters for observing queue behaviour under load.
+ */
+void mesh_tx_queue_get_stats(TxClass cls, TxClassStats *out) {
+    if (out == NULL || cls >= TX_CLASS_COUNT)
+        return;
+    *out = class_stats[cls];
 }
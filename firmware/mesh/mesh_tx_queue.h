@@ -3,9 +3,39 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "packet_pool.h"
+
+// Traffic classes, highest priority first
+typedef enum {
+    TX_CLASS_TRANSACTION = 0,
+    TX_CLASS_SYNC,
+    TX_CLASS_GROUP_SAVINGS,
+    TX_CLASS_TRUST,
+    TX_CLASS_HEARTBEAT,
+    TX_CLASS_COUNT
+} TxClass;
+
+typedef struct {
+    uint32_t enqueued;
+    uint32_t sent;
+    uint32_t dropped_full;        // rejected: queue full of equal/higher priority
+    uint32_t dropped_evicted;     // pushed out by higher-priority traffic
+    uint32_t dropped_retries;     // gave up after MAX_RETRY_COUNT failures
+    uint32_t superseded;          // replaced in queue by a newer packet
+    uint32_t total_latency_ms;    // enqueue → successful send, summed
+    uint32_t max_latency_ms;
+} TxClassStats;
+
+// Called (main context) each time a packet is queued
+typedef void (*mesh_tx_notify_t)(void);
 
 void mesh_tx_queue_init(void);
 bool mesh_tx_queue_enqueue(const uint8_t *data, uint16_t len);
 bool mesh_tx_queue_dequeue(uint8_t *buffer, uint16_t *len_out);
+bool mesh_tx_queue_push_frame(const uint8_t *frame, uint16_t len, uint8_t radio_type, TxClass cls);
+bool mesh_tx_queue_push_buf(packet_buf_t *buf, uint8_t radio_type, TxClass cls);
+uint32_t mesh_tx_queue_process(void);
+void mesh_tx_queue_set_notify(mesh_tx_notify_t fn);
+void mesh_tx_queue_get_stats(TxClass cls, TxClassStats *out);
 
 #endif
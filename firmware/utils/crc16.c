@@ -33,11 +33,232 @@
  *  Example expected outputs:
  *    CRC16("123456789") → 0x29B1
  *
+ *  Implementations (select with -DCRC16_IMPL=..., see crc16.h)
+ *  -----------------------------------------------------------
+ *    BITWISE  8 shift/xor steps per byte, no table
+ *    NIBBLE   two lookups per byte in a 16-entry table (32 B)
+ *    TABLE    one lookup per byte in a 256-entry table (512 B), default
+ *    SLICE4/8 4 or 8 bytes per step; 2/4 KB tables built in RAM on
+ *             first use, intended for host tools
+ *
+ *  All variants are bit-exact. firmware/bench/crc16_bench.c checks
+ *  and times whichever one is built.
+ *
  * -------------------------------------------------------------
  */
 
 #include "crc16.h"
 
+#define CRC16_POLY  0x1021
+#define CRC16_INIT  0xFFFF
+
+// Only the selected variant's table is built
+#if CRC16_IMPL == CRC16_IMPL_NIBBLE
+#define CRC16_NEED_NIBBLE  1
+#else
+#define CRC16_NEED_NIBBLE  0
+#endif
+
+#if CRC16_IMPL == CRC16_IMPL_SLICE4 || CRC16_IMPL == CRC16_IMPL_SLICE8
+#define CRC16_NEED_SLICE   1
+#else
+#define CRC16_NEED_SLICE   0
+#endif
+
+/* -------------------------------------------------------------
+ *  Lookup tables
+ * ------------------------------------------------------------- */
+
+// crc16_table[b] = CRC of byte b with a zero initial value
+static const uint16_t crc16_table[256] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+    0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+    0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+    0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+    0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+    0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+    0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+    0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+    0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+    0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+    0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+    0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+    0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+    0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+    0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+    0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+    0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+    0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+    0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+    0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+    0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+    0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+    0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+    0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+    0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+    0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+    0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+    0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+    0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0
+};
+
+#if CRC16_NEED_NIBBLE
+// Same recurrence for 4-bit input
+static const uint16_t crc16_nibble_table[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+#endif
+
+#if CRC16_NEED_SLICE
+// slice_table[k][b] = CRC of byte b followed by k zero bytes
+static uint16_t slice_table[8][256];
+static uint8_t  slice_ready = 0;
+
+static void slice_init(void)
+{
+    for (uint16_t b = 0; b < 256; b++)
+    {
+        slice_table[0][b] = crc16_table[b];
+        for (uint8_t k = 1; k < 8; k++)
+        {
+            uint16_t prev = slice_table[k - 1][b];
+            slice_table[k][b] = (uint16_t)(prev << 8) ^ crc16_table[prev >> 8];
+        }
+    }
+    slice_ready = 1;
+}
+#endif
+
+/* -------------------------------------------------------------
+ *  Variants (all take and return the running CRC state)
+ * ------------------------------------------------------------- */
+
+static inline uint16_t step_bitwise(uint16_t crc, uint8_t byte)
+{
+    crc ^= (uint16_t)byte << 8;
+
+    for (uint8_t bit = 0; bit < 8; bit++)
+    {
+        if (crc & 0x8000)
+            crc = (crc << 1) ^ CRC16_POLY;
+        else
+            crc <<= 1;
+    }
+
+    return crc & 0xFFFF;
+}
+
+#if CRC16_NEED_NIBBLE
+static inline uint16_t step_nibble(uint16_t crc, uint8_t byte)
+{
+    crc = (uint16_t)(crc << 4) ^ crc16_nibble_table[(crc >> 12) ^ (byte >> 4)];
+    crc = (uint16_t)(crc << 4) ^ crc16_nibble_table[(crc >> 12) ^ (byte & 0x0F)];
+    return crc;
+}
+#endif
+
+static inline uint16_t step_table(uint16_t crc, uint8_t byte)
+{
+    return (uint16_t)(crc << 8) ^ crc16_table[(crc >> 8) ^ byte];
+}
+
+static inline uint16_t run_bitwise(uint16_t crc, const uint8_t *data, uint32_t length)
+{
+    for (uint32_t i = 0; i < length; i++)
+        crc = step_bitwise(crc, data[i]);
+    return crc;
+}
+
+#if CRC16_NEED_NIBBLE
+static inline uint16_t run_nibble(uint16_t crc, const uint8_t *data, uint32_t length)
+{
+    for (uint32_t i = 0; i < length; i++)
+        crc = step_nibble(crc, data[i]);
+    return crc;
+}
+#endif
+
+static inline uint16_t run_table(uint16_t crc, const uint8_t *data, uint32_t length)
+{
+    for (uint32_t i = 0; i < length; i++)
+        crc = step_table(crc, data[i]);
+    return crc;
+}
+
+#if CRC16_NEED_SLICE
+/*
+ * The CRC state only overlaps the first two bytes of each block;
+ * every byte of the block is then looked up independently and the
+ * results XORed together.
+ */
+static inline uint16_t run_slice4(uint16_t crc, const uint8_t *data, uint32_t length)
+{
+    if (!slice_ready)
+        slice_init();
+
+    while (length >= 4)
+    {
+        crc = slice_table[3][data[0] ^ (crc >> 8)] ^
+              slice_table[2][data[1] ^ (crc & 0xFF)] ^
+              slice_table[1][data[2]] ^
+              slice_table[0][data[3]];
+        data   += 4;
+        length -= 4;
+    }
+
+    return run_table(crc, data, length);
+}
+
+static inline uint16_t run_slice8(uint16_t crc, const uint8_t *data, uint32_t length)
+{
+    if (!slice_ready)
+        slice_init();
+
+    while (length >= 8)
+    {
+        crc = slice_table[7][data[0] ^ (crc >> 8)] ^
+              slice_table[6][data[1] ^ (crc & 0xFF)] ^
+              slice_table[5][data[2]] ^
+              slice_table[4][data[3]] ^
+              slice_table[3][data[4]] ^
+              slice_table[2][data[5]] ^
+              slice_table[1][data[6]] ^
+              slice_table[0][data[7]];
+        data   += 8;
+        length -= 8;
+    }
+
+    return run_table(crc, data, length);
+}
+#endif
+
+#if   CRC16_IMPL == CRC16_IMPL_BITWISE
+#define CRC16_RUN   run_bitwise
+#define CRC16_STEP  step_bitwise
+#elif CRC16_IMPL == CRC16_IMPL_NIBBLE
+#define CRC16_RUN   run_nibble
+#define CRC16_STEP  step_nibble
+#elif CRC16_IMPL == CRC16_IMPL_TABLE
+#define CRC16_RUN   run_table
+#define CRC16_STEP  step_table
+#elif CRC16_IMPL == CRC16_IMPL_SLICE4
+#define CRC16_RUN   run_slice4
+#define CRC16_STEP  step_table
+#elif CRC16_IMPL == CRC16_IMPL_SLICE8
+#define CRC16_RUN   run_slice8
+#define CRC16_STEP  step_table
+#else
+#error "Unknown CRC16_IMPL"
+#endif
+
+/* -------------------------------------------------------------
+ *  Public API
+ * ------------------------------------------------------------- */
+
 /**
  * Computes CRC-16/CCITT-FALSE over a buffer.
  *
@@ -47,22 +268,7 @@
  */
 uint16_t crc16_compute(const uint8_t *data, uint16_t length)
 {
-    uint16_t crc = 0xFFFF;
-
-    for (uint16_t i = 0; i < length; i++)
-    {
-        crc ^= (uint16_t)data[i] << 8;
-
-        for (uint8_t bit = 0; bit < 8; bit++)
-        {
-            if (crc & 0x8000)
-                crc = (crc << 1) ^ 0x1021;
-            else
-                crc <<= 1;
-        }
-    }
-
-    return crc & 0xFFFF;
+    return CRC16_RUN(CRC16_INIT, data, length);
 }
 
 /**
@@ -75,17 +281,7 @@ uint16_t crc16_compute(const uint8_t *data, uint16_t length)
  */
 uint16_t crc16_update(uint16_t crc, uint8_t byte)
 {
-    crc ^= (uint16_t)byte << 8;
-
-    for (uint8_t bit = 0; bit < 8; bit++)
-    {
-        if (crc & 0x8000)
-            crc = (crc << 1) ^ 0x1021;
-        else
-            crc <<= 1;
-    }
-
-    return crc & 0xFFFF;
+    return CRC16_STEP(crc, byte);
 }
 
 /**
@@ -3,6 +3,17 @@
 
 #include <stdint.h>
 
+// Implementation selected at compile time (-DCRC16_IMPL=...)
+#define CRC16_IMPL_BITWISE  0   // no table; smallest, slowest
+#define CRC16_IMPL_NIBBLE   1   // 32-byte table for RAM/flash-tight targets
+#define CRC16_IMPL_TABLE    2   // 512-byte table
+#define CRC16_IMPL_SLICE4   3   // host tools: 4 bytes per step
+#define CRC16_IMPL_SLICE8   4   // host tools: 8 bytes per step
+
+#ifndef CRC16_IMPL
+#define CRC16_IMPL          CRC16_IMPL_TABLE
+#endif
+
 uint16_t crc16_compute(const uint8_t *data, uint16_t length);
 uint16_t crc16_update(uint16_t crc, uint8_t byte);
 uint8_t  crc16_verify(const uint8_t *data, uint16_t length, uint16_t expected);
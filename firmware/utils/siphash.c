@@ -0,0 +1,85 @@
+/**
+ * siphash.c
+ * --------------------------------------------
+ * Seed Device Firmware — SipHash-2-4
+ *
+ * Reference algorithm (Aumasson & Bernstein), byte-at-a-time
+ * so it needs no alignment and reads nothing past `len`.
+ * Inputs here are radio frames and signature tuples of a few
+ * hundred bytes at most, so the simple loop is fast enough.
+ */
+
+#include "siphash.h"
+
+#define ROTL64(x, b)  (((x) << (b)) | ((x) >> (64 - (b))))
+
+static void sip_round(siphash_t *s)
+{
+    s->v0 += s->v1; s->v1 = ROTL64(s->v1, 13); s->v1 ^= s->v0; s->v0 = ROTL64(s->v0, 32);
+    s->v2 += s->v3; s->v3 = ROTL64(s->v3, 16); s->v3 ^= s->v2;
+    s->v0 += s->v3; s->v3 = ROTL64(s->v3, 21); s->v3 ^= s->v0;
+    s->v2 += s->v1; s->v1 = ROTL64(s->v1, 17); s->v1 ^= s->v2; s->v2 = ROTL64(s->v2, 32);
+}
+
+static void sip_compress(siphash_t *s, uint64_t m)
+{
+    s->v3 ^= m;
+    sip_round(s);
+    sip_round(s);
+    s->v0 ^= m;
+}
+
+void siphash_key_load(const uint8_t key[SIPHASH_KEY_LEN], uint64_t *k0, uint64_t *k1)
+{
+    *k0 = 0;
+    *k1 = 0;
+    for (uint8_t i = 0; i < 8; i++) {
+        *k0 |= (uint64_t)key[i]     << (8 * i);
+        *k1 |= (uint64_t)key[i + 8] << (8 * i);
+    }
+}
+
+void siphash_init(siphash_t *s, uint64_t k0, uint64_t k1)
+{
+    s->v0 = k0 ^ 0x736f6d6570736575ULL;
+    s->v1 = k1 ^ 0x646f72616e646f6dULL;
+    s->v2 = k0 ^ 0x6c7967656e657261ULL;
+    s->v3 = k1 ^ 0x7465646279746573ULL;
+    s->tail  = 0;
+    s->total = 0;
+}
+
+void siphash_update(siphash_t *s, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+
+    for (size_t i = 0; i < len; i++) {
+        s->tail |= (uint64_t)p[i] << (8 * (s->total & 7));
+        s->total++;
+        if ((s->total & 7) == 0) {
+            sip_compress(s, s->tail);
+            s->tail = 0;
+        }
+    }
+}
+
+uint64_t siphash_final(siphash_t *s)
+{
+    sip_compress(s, s->tail | ((uint64_t)(s->total & 0xFF) << 56));
+
+    s->v2 ^= 0xFF;
+    sip_round(s);
+    sip_round(s);
+    sip_round(s);
+    sip_round(s);
+    return s->v0 ^ s->v1 ^ s->v2 ^ s->v3;
+}
+
+uint64_t siphash24(uint64_t k0, uint64_t k1, const void *data, size_t len)
+{
+    siphash_t s;
+
+    siphash_init(&s, k0, k1);
+    siphash_update(&s, data, len);
+    return siphash_final(&s);
+}
@@ -0,0 +1,40 @@
+/**
+ * siphash.h
+ * --------------------------------------------
+ * Seed Device Firmware — SipHash-2-4
+ *
+ * Keyed 64-bit hash for lookup tables that peers can feed:
+ * without the key, colliding inputs cannot be precomputed.
+ * Not a MAC for data leaving the device.
+ *
+ * Used by:
+ *   - core/verify_cache (signature verdict tags)
+ *   - mesh/mesh_dedup (replay / duplicate filter keys)
+ */
+
+#ifndef SIPHASH_H
+#define SIPHASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SIPHASH_KEY_LEN  16
+
+// Streaming state; input may be fed in pieces of any size
+typedef struct {
+    uint64_t v0, v1, v2, v3;
+    uint64_t tail;             // pending bytes, little-endian
+    uint32_t total;
+} siphash_t;
+
+// Split a 16-byte key into the two little-endian halves
+void     siphash_key_load(const uint8_t key[SIPHASH_KEY_LEN], uint64_t *k0, uint64_t *k1);
+
+void     siphash_init(siphash_t *s, uint64_t k0, uint64_t k1);
+void     siphash_update(siphash_t *s, const void *data, size_t len);
+uint64_t siphash_final(siphash_t *s);
+
+// One-shot
+uint64_t siphash24(uint64_t k0, uint64_t k1, const void *data, size_t len);
+
+#endif
@@ -27,10 +27,27 @@ static volatile uint64_t g_millis = 0;          // Monotonic millisecond time
 static volatile uint32_t g_seconds = 0;         // Derived seconds counter
 static const uint32_t SECONDS_PER_TICK = 1000;  // 1000ms = 1s
 
+// On the host, mesh_sim.c replaces the millisecond clock with its
+// virtual one; other host builds keep this one
+#ifdef SEED_HOST_SIM
+#define TK_CLOCK_HOOK __attribute__((weak))
+#else
+#define TK_CLOCK_HOOK
+#endif
+
 // ---------------------------------------------------------------------------
 // Interrupt-driven tick increment
 // ---------------------------------------------------------------------------
 
+/**
+ * @brief Reset the counters at boot, before the tick interrupt runs.
+ */
+void timekeeping_init(void)
+{
+    g_millis  = 0;
+    g_seconds = 0;
+}
+
 /**
  * @brief Called from the hardware timer interrupt every 1ms.
  */
@@ -51,11 +68,19 @@ void timekeeping_tick_isr(void)
 /**
  * @brief Get time in milliseconds since boot.
  */
-uint64_t timekeeping_millis(void)
+TK_CLOCK_HOOK uint64_t timekeeping_millis(void)
 {
     return g_millis;
 }
 
+/**
+ * @brief Get time in milliseconds since boot, wrapping at 32 bits.
+ */
+TK_CLOCK_HOOK uint32_t time_now_ms(void)
+{
+    return (uint32_t)g_millis;
+}
+
 /**
  * @brief Get time in seconds since boot.
  */
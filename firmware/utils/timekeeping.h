@@ -21,6 +21,7 @@
 #define TIMEKEEPING_H
 
 #include <stdint.h>
+#include <stdbool.h>
 
 // --------------------------------------------
 // Logical Clock
@@ -73,4 +74,37 @@ uint32_t tk_get_monotonic_tick(void);
  */
 void tk_tick_isr(void);
 
+// --------------------------------------------
+// Millisecond Time (timekeeping.c)
+// --------------------------------------------
+
+/**
+ * Milliseconds since boot, wrapping every ~49 days. Used for
+ * deadlines and timeouts; compare with (int32_t)(a - b) or
+ * unsigned differences so the wrap is harmless.
+ */
+uint32_t time_now_ms(void);
+
+/**
+ * Milliseconds since boot, full width.
+ */
+uint64_t timekeeping_millis(void);
+uint32_t timekeeping_seconds(void);
+
+/**
+ * Resets the millisecond counter. Called once at boot, before
+ * the tick interrupt is enabled.
+ */
+void timekeeping_init(void);
+
+/**
+ * Called from the hardware timer interrupt every 1 ms.
+ */
+void timekeeping_tick_isr(void);
+
+void     timekeeping_delay_ms(uint32_t ms);
+bool     timekeeping_timeout_expired(uint64_t start, uint32_t timeout);
+uint32_t timekeeping_elapsed_ms(uint64_t since);
+bool     timekeeping_periodic(uint64_t *next_timestamp, uint32_t period_ms);
+
 #endif // TIMEKEEPING_H